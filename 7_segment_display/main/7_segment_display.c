@@ -5,7 +5,9 @@
 #include <esp_err.h>
 #include <time.h>
 #include "ds1307.h"
+#include "i2c_bus.h"
 #include "pca9685.h"
+#include "segment_display.h"
 
 // Single I2C bus configuration
 #define SDA_GPIO 21
@@ -19,40 +21,15 @@
 static const char *TAG = "7_segment_display";
 static i2c_dev_t dev;
 
-// 7-segment display patterns (common cathode)
-const uint8_t digit_patterns[10] = {
-    0x3F, // 0 - ABCDEF
-    0x06, // 1 - BC
-    0x5B, // 2 - ABGED
-    0x4F, // 3 - ABGCD
-    0x66, // 4 - FBGC
-    0x6D, // 5 - AFGCD
-    0x7D, // 6 - AFGECD
-    0x07, // 7 - ABC
-    0x7F, // 8 - ABCDEFG
-    0x6F  // 9 - ABCDFG
+// One digit per controller, segments A-G on channels 0-6
+static const segment_channel_t digit_map[2][7] = {
+    SEGMENT_DIGIT_CHANNELS(0, PCA9685_CHANNEL_0),
+    SEGMENT_DIGIT_CHANNELS(1, PCA9685_CHANNEL_0),
 };
 
-void set_digit(pca9685_dev_t *pca, uint8_t digit, uint16_t pulse_0deg, uint16_t pulse_90deg) {
-    uint8_t pattern = digit_patterns[digit % 10];
-    for (int seg = 0; seg < 7; seg++) {
-        uint16_t pulse = (pattern & (1 << seg)) ? pulse_90deg : pulse_0deg;
-        pca9685_set_servo_pulse(pca, seg, pulse);
-    }
-}
-
 void app_main(void) {   
     // Configure single I2C bus
-    i2c_config_t conf = {
-        .mode = I2C_MODE_MASTER,
-        .sda_io_num = SDA_GPIO,
-        .scl_io_num = SCL_GPIO,
-        .sda_pullup_en = GPIO_PULLUP_ENABLE,
-        .scl_pullup_en = GPIO_PULLUP_ENABLE,
-        .master.clk_speed = 400000
-    };
-    ESP_ERROR_CHECK(i2c_param_config(I2C_PORT, &conf));
-    ESP_ERROR_CHECK(i2c_driver_install(I2C_PORT, conf.mode, 0, 0, 0));
+    ESP_ERROR_CHECK(i2c_bus_init(I2C_PORT, SDA_GPIO, SCL_GPIO, 400000));
     ESP_LOGI(TAG, "I2C bus initialized");
     vTaskDelay(500 / portTICK_PERIOD_MS);
 
@@ -81,20 +58,31 @@ void app_main(void) {
     ESP_LOGI(TAG, "PCA9685 @ 0x%02X initialized", PCA2_ADDR);
     vTaskDelay(500 / portTICK_PERIOD_MS);
 
-    const uint16_t pulse_0deg = 500;  // 0 degrees position
-    const uint16_t pulse_90deg = 1500; // 90 degrees position
+    pca9685_dev_t *const controllers[] = {&pca1, &pca2};
+    const segment_display_config_t display_cfg = {
+        .controllers = controllers,
+        .num_controllers = 2,
+        .digits = digit_map,
+        .num_digits = 2,
+        .pulse_off_us = 500,  // 0 degrees position
+        .pulse_on_us = 1500,  // 90 degrees position
+    };
+    static segment_display_t display;
+    ESP_ERROR_CHECK(segment_display_init(&display, &display_cfg));
 
     while (1) {
         // Count from 0 to 9 on both displays
         for (int digit = 0; digit < 10; digit++) {
             ESP_LOGI(TAG, "Displaying digit %d", digit);
-            
-            // Set digit on first display (PCA1)
-            set_digit(&pca1, digit, pulse_0deg, pulse_90deg);
-            
-            // Set digit on second display (PCA2)
-            set_digit(&pca2, digit, pulse_0deg, pulse_90deg);
-            
+
+            // Same digit on both displays; only the segments that differ from the last one move
+            segment_display_set_digit(&display, 0, digit);
+            segment_display_set_digit(&display, 1, digit);
+            esp_err_t err = segment_display_commit(&display);
+            if (err != ESP_OK) {
+                ESP_LOGE(TAG, "Display update failed: %s", esp_err_to_name(err));
+            }
+
             // Wait 10 seconds before showing next digit
             vTaskDelay(2000 / portTICK_PERIOD_MS);
         }
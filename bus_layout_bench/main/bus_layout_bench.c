@@ -0,0 +1,123 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_log.h>
+#include <esp_err.h>
+#include <esp_timer.h>
+#include "pca9685.h"
+#include "i2c_bus.h"
+#include "i2c_exec.h"
+
+// Wiring for the split layout: PCA1 on the first controller, PCA2 on the second.
+// Set PCA2_PORT to I2C_NUM_0 when both controllers share one bus.
+#define SDA_GPIO  21
+#define SCL_GPIO  22
+#define SDA2_GPIO 25
+#define SCL2_GPIO 26
+#define CLK_HZ    100000
+#define PCA1_PORT I2C_NUM_0
+#define PCA2_PORT I2C_NUM_1
+#define PCA1_ADDR 0x40
+#define PCA2_ADDR 0x41
+#define ITERATIONS 50
+
+static const char *TAG = "bus_layout_bench";
+static pca9685_dev_t pca1, pca2;
+static i2c_batch_t batch1, batch2;
+static i2c_exec_req_t req2;
+
+typedef struct {
+    int64_t min_us;
+    int64_t max_us;
+    int64_t total_us;
+} timing_t;
+
+// Worst case refresh: all 14 digit channels of both controllers change (e.g. 09:59 -> 10:00)
+static void stage_all(int n) {
+    uint16_t pulses[14];
+    for (int ch = 0; ch < 14; ch++) {
+        pulses[ch] = ((n + ch) & 1) ? 1500 : 660;
+    }
+    pca9685_stage_servo_pulses(&pca1, PCA9685_CHANNEL_0, pulses, 14);
+    pca9685_stage_servo_pulses(&pca2, PCA9685_CHANNEL_0, pulses, 14);
+}
+
+// Both controllers in one frame on one bus (only possible when they share a port)
+static void refresh_single_frame(void) {
+    i2c_batch_begin(&batch1);
+    pca9685_queue(&pca1, &batch1);
+    pca9685_queue(&pca2, &batch1);
+    i2c_exec_run(PCA1_PORT, &batch1, I2C_EXEC_PRIO_HIGH);
+}
+
+// One controller after the other, each on its own port. A proxy for the single-bus layout:
+// two transactions with two STOPs where one shared bus would carry one frame, and two
+// executors handing over. The real single-bus figure comes from refresh_single_frame with
+// both controllers wired to one port.
+static void refresh_serial(void) {
+    i2c_batch_begin(&batch1);
+    i2c_batch_begin(&batch2);
+    pca9685_queue(&pca1, &batch1);
+    pca9685_queue(&pca2, &batch2);
+    i2c_exec_run(PCA1_PORT, &batch1, I2C_EXEC_PRIO_HIGH);
+    i2c_exec_run(PCA2_PORT, &batch2, I2C_EXEC_PRIO_HIGH);
+}
+
+// Both controllers at once, one executor per core
+static void refresh_parallel(void) {
+    i2c_batch_begin(&batch1);
+    i2c_batch_begin(&batch2);
+    pca9685_queue(&pca1, &batch1);
+    pca9685_queue(&pca2, &batch2);
+    ESP_ERROR_CHECK(i2c_exec_submit(PCA2_PORT, &batch2, I2C_EXEC_PRIO_HIGH, &req2));
+    i2c_exec_run(PCA1_PORT, &batch1, I2C_EXEC_PRIO_HIGH);
+    i2c_exec_wait(&req2, portMAX_DELAY);
+}
+
+static timing_t measure(const char *name, void (*refresh)(void)) {
+    timing_t t = { .min_us = INT64_MAX, .max_us = 0, .total_us = 0 };
+    for (int n = 0; n < ITERATIONS; n++) {
+        int64_t start = esp_timer_get_time();
+        stage_all(n);
+        refresh();
+        int64_t elapsed = esp_timer_get_time() - start;
+        if (elapsed < t.min_us) t.min_us = elapsed;
+        if (elapsed > t.max_us) t.max_us = elapsed;
+        t.total_us += elapsed;
+        vTaskDelay(pdMS_TO_TICKS(20)); // let servos see at least one PWM period
+    }
+    ESP_LOGI(TAG, "%-12s min %lld us, avg %lld us, max %lld us", name, (long long)t.min_us,
+             (long long)(t.total_us / ITERATIONS), (long long)t.max_us);
+    return t;
+}
+
+void app_main(void) {
+    ESP_ERROR_CHECK(i2c_bus_init(PCA1_PORT, SDA_GPIO, SCL_GPIO, CLK_HZ));
+    ESP_ERROR_CHECK(i2c_exec_start(PCA1_PORT, 10, 0));
+    if (PCA2_PORT != PCA1_PORT) {
+        ESP_ERROR_CHECK(i2c_bus_init(PCA2_PORT, SDA2_GPIO, SCL2_GPIO, CLK_HZ));
+        ESP_ERROR_CHECK(i2c_exec_start(PCA2_PORT, 10, 1));
+    }
+    i2c_exec_req_init(&req2);
+
+    ESP_ERROR_CHECK(pca9685_init(&pca1, PCA1_PORT, PCA1_ADDR));
+    ESP_ERROR_CHECK(pca9685_set_frequency(&pca1, 50));
+    ESP_ERROR_CHECK(pca9685_init(&pca2, PCA2_PORT, PCA2_ADDR));
+    ESP_ERROR_CHECK(pca9685_set_frequency(&pca2, 50));
+
+    ESP_LOGI(TAG, "End-to-end refresh latency, 28 channels changing, %d iterations at %d Hz",
+             ITERATIONS, CLK_HZ);
+    if (PCA2_PORT == PCA1_PORT) {
+        measure("single-bus", refresh_single_frame);
+        ESP_LOGI(TAG, "Both controllers share a port; rewire PCA2 to compare the split layout");
+        return;
+    }
+
+    timing_t serial = measure("serial proxy", refresh_serial);
+    timing_t parallel = measure("parallel", refresh_parallel);
+    ESP_LOGI(TAG, "Split layout speedup over the serial proxy: %.2fx (avg)",
+             (double)serial.total_us / (double)(parallel.total_us ? parallel.total_us : 1));
+    ESP_LOGI(TAG, "The proxy runs the halves back to back on two ports, not one shared bus; set "
+             "PCA2_PORT to I2C_NUM_0 with both controllers on it to measure the single-bus layout");
+}
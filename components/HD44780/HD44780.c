@@ -1,4 +1,7 @@
+#include "HD44780.h"
+#include "i2c_bus.h"
 #include "rom/ets_sys.h"
+#include "esp_timer.h"
 #include "sdkconfig.h"
 #include <driver/i2c.h>
 #include <esp_log.h>
@@ -30,6 +33,17 @@
 #define LCD_FUNCTION_SET_4BIT 0x28 // 4-bit data, 2-line display, 5 x 7 font
 #define LCD_SET_CURSOR 0x80        // set cursor position
 
+// Minimum waits (datasheet figure 24 and table 6). Execution times are given for the
+// typical 270 kHz oscillator; they scale with its period and the slowest parts run at
+// 190 kHz, so these are sized for 190 kHz.
+#define LCD_POWER_ON_US 40000  // Vcc at 2.7 V until the first instruction
+#define LCD_RESET_WAIT_US 4100 // after the first function reset
+#define LCD_RESET2_WAIT_US 100 // after the second function reset
+#define LCD_EXEC_US 60         // most instructions 37 us, data writes 41 us at 270 kHz; 58 us at 190 kHz
+#define LCD_EXEC_LONG_US 2200  // clear display and return home, 1.52 ms at 270 kHz; 2.16 ms at 190 kHz
+#define LCD_BATCH_EXEC_NS 59000 // batched writes: data write time at 190 kHz, the longest of the short ones
+#define LCD_BATCH_PAD_MAX 8     // idle bytes a batched write may carry
+
 // Pin mappings
 // P0 -> RS
 // P1 -> RW
@@ -41,68 +55,79 @@
 // P7 -> D7
 
 static char tag[] = "LCD Driver";
+static i2c_port_t LCD_port = I2C_NUM_0;
 static uint8_t LCD_addr;
 static uint8_t SDA_pin;
 static uint8_t SCL_pin;
 static uint8_t LCD_cols;
 static uint8_t LCD_rows;
+static i2c_batch_t *LCD_batch; // when set, writes are queued here instead of sent
 
 static void LCD_writeNibble(uint8_t nibble, uint8_t mode);
 static void LCD_writeByte(uint8_t data, uint8_t mode);
 static void LCD_pulseEnable(uint8_t nibble);
 
+static i2c_bus_client_t LCD_client;
+
+// Shares LCD_port through i2c_bus: a no-op if the application already initialized it
 static esp_err_t I2C_init(void) {
-  ESP_LOGI(tag, "I2C_init: SDA=%d, SCL=%d", SDA_pin, SCL_pin);
-  i2c_config_t conf = {.mode = I2C_MODE_MASTER,
-                       .sda_io_num = SDA_pin,
-                       .scl_io_num = SCL_pin,
-                       .sda_pullup_en = GPIO_PULLUP_ENABLE,
-                       .scl_pullup_en = GPIO_PULLUP_ENABLE,
-                       .master.clk_speed = 100000};
-  esp_err_t err = i2c_param_config(I2C_NUM_0, &conf);
-  if (err != ESP_OK) ESP_LOGE(tag, "i2c_param_config failed: %d", err);
-  err = i2c_driver_install(I2C_NUM_0, I2C_MODE_MASTER, 0, 0, 0);
-  if (err != ESP_OK) ESP_LOGE(tag, "i2c_driver_install failed: %d", err);
+  ESP_LOGI(tag, "I2C_init: port=%d, SDA=%d, SCL=%d", LCD_port, SDA_pin, SCL_pin);
+  esp_err_t err = i2c_bus_init(LCD_port, SDA_pin, SCL_pin, 100000);
+  if (err != ESP_OK) ESP_LOGE(tag, "i2c_bus_init failed: %d", err);
+  i2c_bus_client_init(&LCD_client, LCD_port, "HD44780");
+  return err;
+}
+
+// One byte to the PCF8574, holding the shared bus lock for the transaction
+static esp_err_t LCD_send(uint8_t data) {
+  esp_err_t err = i2c_bus_acquire(&LCD_client, 1000 / portTICK_PERIOD_MS);
+  if (err != ESP_OK) return err;
+  // i2c_master_write_to_device uses a stack command link, so no heap traffic per byte
+  err = i2c_master_write_to_device(LCD_port, LCD_addr, &data, 1, 1000 / portTICK_PERIOD_MS);
+  i2c_bus_release(&LCD_client);
   return err;
 }
 
 void LCD_init(uint8_t addr, uint8_t dataPin, uint8_t clockPin, uint8_t cols,
               uint8_t rows) {
-  ESP_LOGI(tag, "LCD_init: addr=0x%02X, SDA=%d, SCL=%d, cols=%d, rows=%d", addr, dataPin, clockPin, cols, rows);
+  LCD_initOnPort(I2C_NUM_0, addr, dataPin, clockPin, cols, rows);
+}
+
+void LCD_initOnPort(i2c_port_t port, uint8_t addr, uint8_t dataPin,
+                    uint8_t clockPin, uint8_t cols, uint8_t rows) {
+  ESP_LOGI(tag, "LCD_init: port=%d, addr=0x%02X, SDA=%d, SCL=%d, cols=%d, rows=%d", port, addr, dataPin, clockPin, cols, rows);
+  LCD_port = port;
   LCD_addr = addr;
   SDA_pin = dataPin;
   SCL_pin = clockPin;
   LCD_cols = cols;
   LCD_rows = rows;
   I2C_init();
-  vTaskDelay(500 / portTICK_PERIOD_MS); // Increased initial delay
+  // esp_timer counts from the application start, which comes well after the LCD's supply
+  // rose, so this only waits after an unusually fast boot
+  int64_t since_boot = esp_timer_get_time();
+  if (since_boot < LCD_POWER_ON_US) ets_delay_us(LCD_POWER_ON_US - since_boot);
 
-  // Reset the LCD controller
+  // Reset the LCD controller: the HD44780 may be in 8-bit or in 4-bit mode mid-byte
   ESP_LOGI(tag, "Sending LCD_FUNCTION_RESET sequence");
-  LCD_writeNibble(LCD_FUNCTION_RESET,
-                  LCD_COMMAND);      // First part of reset sequence
-  vTaskDelay(50 / portTICK_PERIOD_MS); // Increased delay (was 10)
-  LCD_writeNibble(LCD_FUNCTION_RESET,
-                  LCD_COMMAND); // second part of reset sequence
-  ets_delay_us(500);            // Increased delay (was 200)
+  LCD_writeNibble(LCD_FUNCTION_RESET, LCD_COMMAND);
+  ets_delay_us(LCD_RESET_WAIT_US);
+  LCD_writeNibble(LCD_FUNCTION_RESET, LCD_COMMAND);
+  ets_delay_us(LCD_RESET2_WAIT_US);
   LCD_writeNibble(LCD_FUNCTION_RESET, LCD_COMMAND);    // Third time's a charm
   LCD_writeNibble(LCD_FUNCTION_SET_4BIT, LCD_COMMAND); // Activate 4-bit mode
-  ets_delay_us(200);                                    // Increased delay (was 80)
 
-  // --- Busy flag now available ---
-  // Function Set instruction
+  // --- Busy flag now available; every nibble waits out the instruction time ---
   LCD_writeByte(LCD_FUNCTION_SET_4BIT,
                 LCD_COMMAND); // Set mode, lines, and font
-  ets_delay_us(200);
 
   // Clear Display instruction
   LCD_writeByte(LCD_CLEAR, LCD_COMMAND); // clear display RAM
-  vTaskDelay(10 / portTICK_PERIOD_MS);      // Increased delay (was 2)
+  ets_delay_us(LCD_EXEC_LONG_US);
 
   // Entry Mode Set instruction
   LCD_writeByte(LCD_ENTRY_MODE,
                 LCD_COMMAND); // Set desired shift characteristics
-  ets_delay_us(200);
 
   LCD_writeByte(LCD_DISPLAY_ON, LCD_COMMAND); // Ensure LCD is set to on
   ESP_LOGI(tag, "LCD init sequence complete");
@@ -130,70 +155,75 @@ void LCD_writeStr(char *str) {
   }
 }
 
+void LCD_setBatch(i2c_batch_t *batch) {
+  LCD_batch = batch;
+  if (batch) i2c_batch_set_client(batch, &LCD_client);
+}
+
 void LCD_home(void) {
+  // The long execution time cannot be expressed inside a batch, always send now
+  i2c_batch_t *batch = LCD_batch;
+  LCD_batch = NULL;
   LCD_writeByte(LCD_HOME, LCD_COMMAND);
-  vTaskDelay(2 / portTICK_PERIOD_MS); // This command takes a while to complete
+  LCD_batch = batch;
+  ets_delay_us(LCD_EXEC_LONG_US); // This command takes a while to complete
 }
 
 void LCD_clearScreen(void) {
+  i2c_batch_t *batch = LCD_batch;
+  LCD_batch = NULL;
   LCD_writeByte(LCD_CLEAR, LCD_COMMAND);
-  vTaskDelay(2 / portTICK_PERIOD_MS); // This command takes a while to complete
+  LCD_batch = batch;
+  ets_delay_us(LCD_EXEC_LONG_US); // This command takes a while to complete
 }
 
 static void LCD_writeNibble(uint8_t nibble, uint8_t mode) {
   uint8_t data = (nibble & 0xF0) | mode | LCD_BACKLIGHT;
-  ESP_LOGI(tag, "LCD_writeNibble: nibble=0x%02X mode=0x%02X data=0x%02X", nibble, mode, data);
-  i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-  esp_err_t err;
-  err = i2c_master_start(cmd);
-  if (err != ESP_OK) ESP_LOGE(tag, "i2c_master_start failed: %d", err);
-  err = i2c_master_write_byte(cmd, (LCD_addr << 1) | I2C_MASTER_WRITE, 1);
-  if (err != ESP_OK) ESP_LOGE(tag, "i2c_master_write_byte (addr) failed: %d", err);
-  err = i2c_master_write_byte(cmd, data, 1);
-  if (err != ESP_OK) ESP_LOGE(tag, "i2c_master_write_byte (data) failed: %d", err);
-  err = i2c_master_stop(cmd);
-  if (err != ESP_OK) ESP_LOGE(tag, "i2c_master_stop failed: %d", err);
-  err = i2c_master_cmd_begin(I2C_NUM_0, cmd, 1000 / portTICK_PERIOD_MS);
-  if (err != ESP_OK) ESP_LOGE(tag, "i2c_master_cmd_begin failed: %d", err);
-  i2c_cmd_link_delete(cmd);
+  ESP_LOGD(tag, "LCD_writeNibble: nibble=0x%02X mode=0x%02X data=0x%02X", nibble, mode, data);
+  esp_err_t err = LCD_send(data);
+  if (err != ESP_OK) ESP_LOGE(tag, "LCD_send failed: %d", err);
 
   LCD_pulseEnable(data); // Clock data into LCD
 }
 
+// Idle bytes after a batched write so the instruction has run before the next one. A port
+// not set up through i2c_bus is taken to run at 1 MHz, the fastest the ESP32 drives.
+static size_t LCD_batchPad(void) {
+  uint32_t clk_hz = i2c_bus_get_clock(LCD_port);
+  if (!clk_hz) clk_hz = 1000000;
+  uint64_t byte_ns = 9ULL * 1000000000ULL / clk_hz; // 8 bits and the ACK
+  size_t bytes = (LCD_BATCH_EXEC_NS + byte_ns - 1) / byte_ns;
+  size_t pad = bytes > 3 ? bytes - 3 : 0;
+  return pad < LCD_BATCH_PAD_MAX ? pad : LCD_BATCH_PAD_MAX;
+}
+
 static void LCD_writeByte(uint8_t data, uint8_t mode) {
-  ESP_LOGI(tag, "LCD_writeByte: data=0x%02X mode=0x%02X", data, mode);
+  ESP_LOGD(tag, "LCD_writeByte: data=0x%02X mode=0x%02X", data, mode);
+  if (LCD_batch) {
+    // Both nibbles as one segment: the PCF8574 latches each byte on its ACK, so bytes on
+    // the wire pace the E edges. The instruction runs from the last falling edge until the
+    // next write's high nibble is clocked in, at least 3 bytes later (the next write joins
+    // this segment); idle bytes with E low make up the rest at fast clocks.
+    uint8_t hi = (data & 0xF0) | mode | LCD_BACKLIGHT;
+    uint8_t lo = ((data << 4) & 0xF0) | mode | LCD_BACKLIGHT;
+    uint8_t seq[6 + LCD_BATCH_PAD_MAX] = {hi, hi | LCD_ENABLE, hi, lo, lo | LCD_ENABLE, lo};
+    size_t len = 6;
+    for (size_t pad = LCD_batchPad(); pad > 0; pad--) seq[len++] = lo;
+    esp_err_t err = i2c_batch_write(LCD_batch, LCD_addr, seq, len);
+    if (err != ESP_OK) ESP_LOGE(tag, "i2c_batch_write failed: %d", err);
+    return;
+  }
   LCD_writeNibble(data & 0xF0, mode);
   LCD_writeNibble((data << 4) & 0xF0, mode);
 }
 
 static void LCD_pulseEnable(uint8_t data) {
-  ESP_LOGI(tag, "LCD_pulseEnable: data=0x%02X", data);
-  i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-  esp_err_t err;
-  err = i2c_master_start(cmd);
-  if (err != ESP_OK) ESP_LOGE(tag, "pulse: i2c_master_start failed: %d", err);
-  err = i2c_master_write_byte(cmd, (LCD_addr << 1) | I2C_MASTER_WRITE, 1);
-  if (err != ESP_OK) ESP_LOGE(tag, "pulse: i2c_master_write_byte (addr) failed: %d", err);
-  err = i2c_master_write_byte(cmd, data | LCD_ENABLE, 1);
-  if (err != ESP_OK) ESP_LOGE(tag, "pulse: i2c_master_write_byte (data|EN) failed: %d", err);
-  err = i2c_master_stop(cmd);
-  if (err != ESP_OK) ESP_LOGE(tag, "pulse: i2c_master_stop failed: %d", err);
-  err = i2c_master_cmd_begin(I2C_NUM_0, cmd, 1000 / portTICK_PERIOD_MS);
-  if (err != ESP_OK) ESP_LOGE(tag, "pulse: i2c_master_cmd_begin failed: %d", err);
-  i2c_cmd_link_delete(cmd);
-  ets_delay_us(10); // Increased delay (was 1)
-
-  cmd = i2c_cmd_link_create();
-  err = i2c_master_start(cmd);
-  if (err != ESP_OK) ESP_LOGE(tag, "pulse2: i2c_master_start failed: %d", err);
-  err = i2c_master_write_byte(cmd, (LCD_addr << 1) | I2C_MASTER_WRITE, 1);
-  if (err != ESP_OK) ESP_LOGE(tag, "pulse2: i2c_master_write_byte (addr) failed: %d", err);
-  err = i2c_master_write_byte(cmd, (data & ~LCD_ENABLE), 1);
-  if (err != ESP_OK) ESP_LOGE(tag, "pulse2: i2c_master_write_byte (data&~EN) failed: %d", err);
-  err = i2c_master_stop(cmd);
-  if (err != ESP_OK) ESP_LOGE(tag, "pulse2: i2c_master_stop failed: %d", err);
-  err = i2c_master_cmd_begin(I2C_NUM_0, cmd, 1000 / portTICK_PERIOD_MS);
-  if (err != ESP_OK) ESP_LOGE(tag, "pulse2: i2c_master_cmd_begin failed: %d", err);
-  i2c_cmd_link_delete(cmd);
-  ets_delay_us(2000); // Increased delay (was 500)
+  ESP_LOGD(tag, "LCD_pulseEnable: data=0x%02X", data);
+  esp_err_t err = LCD_send(data | LCD_ENABLE);
+  if (err != ESP_OK) ESP_LOGE(tag, "pulse: LCD_send (data|EN) failed: %d", err);
+  ets_delay_us(1); // E high at least 450 ns; the I2C byte alone takes longer
+
+  err = LCD_send(data & ~LCD_ENABLE);
+  if (err != ESP_OK) ESP_LOGE(tag, "pulse2: LCD_send (data&~EN) failed: %d", err);
+  ets_delay_us(LCD_EXEC_US); // instruction time; clear and home wait on in their callers
 }
@@ -1,9 +1,17 @@
 #pragma once
 #include <stdint.h>
+#include "i2c_batch.h"
 void LCD_init(uint8_t addr, uint8_t dataPin, uint8_t clockPin, uint8_t cols,
               uint8_t rows);
+// LCD_init on a given I2C port (LCD_init uses I2C_NUM_0)
+void LCD_initOnPort(i2c_port_t port, uint8_t addr, uint8_t dataPin,
+                    uint8_t clockPin, uint8_t cols, uint8_t rows);
 void LCD_setCursor(uint8_t col, uint8_t row);
 void LCD_home(void);
 void LCD_clearScreen(void);
 void LCD_writeChar(char c);
 void LCD_writeStr(char *str);
+// Queue subsequent LCD writes into batch instead of sending them (NULL to send
+// directly again). LCD_clearScreen and LCD_home are always sent immediately. Queued
+// writes are paced by their bytes on the wire and padded for the port's i2c_bus clock.
+void LCD_setBatch(i2c_batch_t *batch);
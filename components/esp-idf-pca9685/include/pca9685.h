@@ -2,10 +2,16 @@
 #define PCA9685_H
 
 #include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
 #include "esp_err.h"
 #include "driver/i2c.h"
+#include "i2c_batch.h"
+#include "i2c_bus.h"
 
 #define PCA9685_DEFAULT_ADDRESS 0x40
+#define PCA9685_FRAME_MAX_DEVICES 62   /**< PCA9685s one I2C bus can address */
+#define PCA9685_FRAME_UNSENT      0xFF /**< pca9685_plan_frame: device has nothing staged */
 
 /**
  * @brief Enumeration of PCA9685 PWM output channels.
@@ -32,22 +38,58 @@ typedef enum {
     PCA9685_CHANNEL_COUNT   /**< Total number of channels (16) */
 } pca9685_channel_t;
 
+/**
+ * @brief Write counters kept per PCA9685 device.
+ *
+ * A "write" is one channel's four LEDn registers. Suppressed writes are channels whose
+ * requested value already matched the shadow copy and therefore never reached the bus.
+ */
+typedef struct {
+    uint32_t transactions;      /**< I2C transactions used for LEDn writes */
+    uint32_t writes_issued;     /**< Channel writes sent over I2C */
+    uint32_t writes_suppressed; /**< Channel writes skipped because the value was unchanged */
+    uint32_t checks;            /**< pca9685_check readbacks done */
+    uint32_t resets_detected;   /**< Checks that found MODE1/PRE_SCALE lost, chip restored */
+    uint32_t led_mismatches;    /**< Spot-read LEDn registers that differed from the shadow */
+} pca9685_stats_t;
+
+/**
+ * @brief What pca9685_check found.
+ */
+typedef enum {
+    PCA9685_CHECK_OK = 0,        /**< Registers read back as configured */
+    PCA9685_CHECK_RESET,         /**< Configuration lost (e.g. brown-out reset); chip re-initialized and restored */
+    PCA9685_CHECK_LED_MISMATCH,  /**< A spot-read channel differed from the shadow; all channels rewritten */
+} pca9685_check_result_t;
+
 /**
  * @brief PCA9685 device configuration structure.
  *
- * Holds the configuration parameters for a PCA9685 device, including the I2C port and address.
+ * Holds the configuration parameters for a PCA9685 device, including the I2C port and address,
+ * plus a shadow copy of the 16 LEDn ON/OFF registers so unchanged channels are not rewritten.
+ * Values staged with the pca9685_stage_* calls live in the shadow until the next commit.
  */
 typedef struct {
     i2c_port_t i2c_port;    /**< I2C port number (e.g., I2C_NUM_0 or I2C_NUM_1) */
     uint8_t i2c_addr;       /**< I2C address of the PCA9685 (e.g., 0x40 to 0x7F) */
     float pwm_freq_hz;      /**< Current PWM frequency in Hz, set by pca9685_set_frequency */
+    uint8_t prescale;       /**< PRE_SCALE value written by pca9685_set_frequency, 0 before */
+    uint16_t led_on[PCA9685_CHANNEL_COUNT];  /**< Shadow of the LEDn_ON registers */
+    uint16_t led_off[PCA9685_CHANNEL_COUNT]; /**< Shadow of the LEDn_OFF registers */
+    uint16_t phase[PCA9685_CHANNEL_COUNT];   /**< Count each channel's pulse starts at, see pca9685_stage_phase */
+    uint16_t shadow_valid;  /**< Bit n set when the chip is known to hold led_on/led_off[n]; clear = staged or unknown */
+    uint16_t inflight_mask; /**< Channels queued into an i2c_batch_t that has not completed yet */
+    uint8_t check_channel;  /**< Next channel pca9685_check spot-reads */
+    pca9685_stats_t stats;  /**< Write counters, see pca9685_reset_stats */
+    i2c_bus_client_t bus_client; /**< Shared-bus client ("pca9685@0xNN") for locking and metrics */
 } pca9685_dev_t;
 
 /**
  * @brief Initialize a PCA9685 device.
  *
  * Configures the PCA9685 for operation on the specified I2C port and address.
- * Assumes the I2C driver is already initialized externally (e.g., by the application).
+ * Assumes the I2C driver is already initialized externally (e.g., by i2c_bus_init).
+ * Registers the device as an i2c_bus client; every transaction holds the shared bus lock.
  * Puts the device into sleep mode briefly, enables auto-increment, and restarts the oscillator.
  * All PWM channels are set to 0% duty cycle on initialization.
  *
@@ -61,6 +103,26 @@ typedef struct {
  */
 esp_err_t pca9685_init(pca9685_dev_t *dev, i2c_port_t port, uint8_t addr);
 
+/**
+ * @brief Initialize a PCA9685 and set its PWM frequency in one I2C transaction.
+ *
+ * Does what pca9685_init followed by pca9685_set_frequency does, for boot paths: MODE1
+ * (asleep, auto-increment) and MODE2, then ALL_LED off with PRE_SCALE, then MODE1 awake,
+ * as three segments of one transaction. There is no probe and no delay; the chip wakes with
+ * every output off, so nothing waits on its oscillator. Safe whether the chip comes from
+ * power-on or was left running by an earlier boot.
+ *
+ * @param dev Pointer to the PCA9685 device configuration structure.
+ * @param port I2C port number (e.g., I2C_NUM_0 or I2C_NUM_1).
+ * @param addr I2C address of the PCA9685 (typically 0x40 to 0x7F).
+ * @param freq_hz Desired PWM frequency in Hz (24 to 1526).
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if dev is NULL or freq_hz is out of range.
+ *     - ESP_FAIL or other errors if I2C communication fails (a missing chip included).
+ */
+esp_err_t pca9685_init_frequency(pca9685_dev_t *dev, i2c_port_t port, uint8_t addr, float freq_hz);
+
 /**
  * @brief Set the PWM frequency for all channels.
  *
@@ -82,7 +144,7 @@ esp_err_t pca9685_set_frequency(pca9685_dev_t *dev, float freq_hz);
  *
  * Sets the duty cycle for the specified PWM channel, from 0 to 4095 (12-bit resolution),
  * corresponding to 0% to 100% duty cycle. The PWM signal uses the frequency set by
- * pca9685_set_frequency.
+ * pca9685_set_frequency. Nothing is sent if the channel already holds this value.
  *
  * @param dev Pointer to the initialized PCA9685 device configuration structure.
  * @param channel PWM channel to configure (PCA9685_CHANNEL_0 to PCA9685_CHANNEL_15).
@@ -94,6 +156,30 @@ esp_err_t pca9685_set_frequency(pca9685_dev_t *dev, float freq_hz);
  */
 esp_err_t pca9685_set_duty(pca9685_dev_t *dev, pca9685_channel_t channel, uint16_t duty);
 
+/**
+ * @brief Set the PWM duty cycle for a run of consecutive channels in one I2C transaction.
+ *
+ * Relies on register auto-increment (enabled by pca9685_init) to write the LEDn
+ * registers of channels first_channel .. first_channel + count - 1 in a single
+ * START/address/register/data/STOP sequence, i.e. up to 64 data bytes for all
+ * 16 channels instead of one transaction per channel.
+ *
+ * Channels whose value matches the device's shadow registers are skipped. The remaining
+ * dirty channels (including any staged earlier) are sent as contiguous bursts joined by
+ * repeated STARTs, see pca9685_commit.
+ *
+ * @param dev Pointer to the initialized PCA9685 device configuration structure.
+ * @param first_channel First PWM channel of the run.
+ * @param duty Array of count duty cycle values (0 to 4095).
+ * @param count Number of consecutive channels to write (1 to 16).
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if dev or duty is NULL, the run exceeds channel 15, or a duty > 4095.
+ *     - ESP_FAIL or other errors if I2C communication fails.
+ */
+esp_err_t pca9685_set_duty_range(pca9685_dev_t *dev, pca9685_channel_t first_channel,
+                                 const uint16_t *duty, size_t count);
+
 /**
  * @brief Set the PWM pulse width for a servo on a specific channel.
  *
@@ -112,4 +198,243 @@ esp_err_t pca9685_set_duty(pca9685_dev_t *dev, pca9685_channel_t channel, uint16
  */
 esp_err_t pca9685_set_servo_pulse(pca9685_dev_t *dev, pca9685_channel_t channel, uint16_t pulse_us);
 
+/**
+ * @brief Convert a servo pulse width to the OFF count at the device's PWM frequency.
+ *
+ * @param dev Pointer to the initialized PCA9685 device configuration structure.
+ * @param pulse_us Pulse width in microseconds (500 to 2500).
+ * @param duty Out: OFF count (0-4095).
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if pulse_us is out of range.
+ *     - ESP_ERR_INVALID_STATE if PWM frequency is not set.
+ */
+esp_err_t pca9685_pulse_to_duty(const pca9685_dev_t *dev, uint16_t pulse_us, uint16_t *duty);
+
+/**
+ * @brief Duty of a channel as staged or held, i.e. its pulse length in counts whatever its phase.
+ *
+ * @param dev Pointer to the initialized PCA9685 device configuration structure.
+ * @param channel PWM channel (PCA9685_CHANNEL_0 to PCA9685_CHANNEL_15).
+ * @return OFF minus ON count (0-4095), 0 if the channel has no pulse or dev or channel is
+ *         invalid. A channel switched off by pca9685_stage_full_off reports the pulse it resumes.
+ */
+uint16_t pca9685_get_duty(const pca9685_dev_t *dev, pca9685_channel_t channel);
+
+/**
+ * @brief Set the count within the PWM period at which a channel's pulse starts.
+ *
+ * By default every pulse starts at count 0, so all outputs of a chip rise together each
+ * period and the servos draw their current at the same instant. Spreading the starts over
+ * the period (see pca9685_array_stagger) flattens that peak; the pulse length is unchanged,
+ * ON = phase and OFF = phase + duty, wrapping around the end of the period. A channel with
+ * a pulse is re-staged with the new start; one at duty 0 stays off.
+ *
+ * @param dev Pointer to the initialized PCA9685 device configuration structure.
+ * @param channel PWM channel (PCA9685_CHANNEL_0 to PCA9685_CHANNEL_15).
+ * @param on_count Start of the pulse (0 to 4095).
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if dev is NULL, channel is invalid, or on_count > 4095.
+ */
+esp_err_t pca9685_stage_phase(pca9685_dev_t *dev, pca9685_channel_t channel, uint16_t on_count);
+
+/**
+ * @brief Switch channels fully off, or back on, keeping their ON/OFF counts.
+ *
+ * Sets or clears the full-off flag (bit 4 of LEDn_OFF_H): a flagged channel stays low
+ * all period, so an idle servo gets no holding pulse, and clearing the flag resumes the
+ * same pulse. Staging a duty on a flagged channel clears the flag as well. Channels
+ * without a pulse (duty 0) are left alone.
+ *
+ * @param dev Pointer to the initialized PCA9685 device configuration structure.
+ * @param mask Bit n selects channel n.
+ * @param full_off true to switch the channels off, false to resume their pulses.
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if dev is NULL.
+ */
+esp_err_t pca9685_stage_full_off(pca9685_dev_t *dev, uint16_t mask, bool full_off);
+
+/**
+ * @brief Channels that have a pulse (duty above 0), and of those, the ones switched fully off.
+ *
+ * @param dev Pointer to the initialized PCA9685 device configuration structure.
+ * @param full_off Out: bit n set when channel n has a pulse but is fully off (may be NULL).
+ * @return Bit n set when channel n has a pulse, switched off or not; 0 if dev is NULL.
+ */
+uint16_t pca9685_pulse_mask(const pca9685_dev_t *dev, uint16_t *full_off);
+
+/**
+ * @brief Set servo pulse widths for a run of consecutive channels in one I2C transaction.
+ *
+ * Burst counterpart of pca9685_set_servo_pulse, see pca9685_set_duty_range.
+ *
+ * @param dev Pointer to the initialized PCA9685 device configuration structure.
+ * @param first_channel First PWM channel of the run.
+ * @param pulse_us Array of count pulse widths in microseconds (500 to 2500).
+ * @param count Number of consecutive channels to write (1 to 16).
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if dev or pulse_us is NULL, the run exceeds channel 15, or a pulse is out of range.
+ *     - ESP_ERR_INVALID_STATE if PWM frequency is not set.
+ *     - ESP_FAIL or other errors if I2C communication fails.
+ */
+esp_err_t pca9685_set_servo_pulses(pca9685_dev_t *dev, pca9685_channel_t first_channel,
+                                   const uint16_t *pulse_us, size_t count);
+
+/**
+ * @brief Stage duty cycles for a run of consecutive channels without touching the bus.
+ *
+ * Updates the shadow registers only. Channels whose value is unchanged stay clean and are
+ * counted as suppressed writes; the others are sent by the next pca9685_commit or
+ * pca9685_commit_frame involving this device.
+ *
+ * @param dev Pointer to the initialized PCA9685 device configuration structure.
+ * @param first_channel First PWM channel of the run.
+ * @param duty Array of count duty cycle values (0 to 4095).
+ * @param count Number of consecutive channels to stage (1 to 16).
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if dev or duty is NULL, the run exceeds channel 15, or a duty > 4095.
+ */
+esp_err_t pca9685_stage_duty_range(pca9685_dev_t *dev, pca9685_channel_t first_channel,
+                                   const uint16_t *duty, size_t count);
+
+/**
+ * @brief Stage servo pulse widths for a run of consecutive channels without touching the bus.
+ *
+ * Pulse width counterpart of pca9685_stage_duty_range.
+ *
+ * @param dev Pointer to the initialized PCA9685 device configuration structure.
+ * @param first_channel First PWM channel of the run.
+ * @param pulse_us Array of count pulse widths in microseconds (500 to 2500).
+ * @param count Number of consecutive channels to stage (1 to 16).
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if dev or pulse_us is NULL, the run exceeds channel 15, or a pulse is out of range.
+ *     - ESP_ERR_INVALID_STATE if PWM frequency is not set.
+ */
+esp_err_t pca9685_stage_servo_pulses(pca9685_dev_t *dev, pca9685_channel_t first_channel,
+                                     const uint16_t *pulse_us, size_t count);
+
+/**
+ * @brief Send every staged (dirty) channel of one device.
+ *
+ * Equivalent to pca9685_commit_frame with a single device.
+ *
+ * @param dev Pointer to the initialized PCA9685 device configuration structure.
+ * @return
+ *     - ESP_OK on success, or if nothing was staged.
+ *     - ESP_ERR_INVALID_ARG if dev is NULL.
+ *     - ESP_FAIL or other errors if I2C communication fails; the channels stay staged.
+ */
+esp_err_t pca9685_commit(pca9685_dev_t *dev);
+
+/**
+ * @brief Send the staged channels of several devices so all outputs change together.
+ *
+ * Queues every device with pca9685_queue into an i2c_batch_t, i.e. one I2C transaction
+ * holding a START/address/register/data segment per dirty run of every device, joined by
+ * repeated STARTs and closed by a single STOP. pca9685_init
+ * leaves MODE2 OCH cleared (outputs change on STOP), so every chip in the frame latches
+ * its new values on that one STOP condition instead of hundreds of microseconds apart.
+ * A frame larger than one batch is split as pca9685_plan_frame packs it and latches
+ * batch by batch, a few milliseconds apart.
+ *
+ * @param devs Array of count device pointers, all on the same I2C port.
+ * @param count Number of devices in the frame (1-PCA9685_FRAME_MAX_DEVICES).
+ * @return
+ *     - ESP_OK on success, or if nothing was staged.
+ *     - ESP_ERR_INVALID_ARG if devs or an entry is NULL, count is out of range, or the ports differ.
+ *     - The first error of a batch (ESP_FAIL or other I2C errors); the channels of failed
+ *       batches stay staged, the other batches are sent.
+ */
+esp_err_t pca9685_commit_frame(pca9685_dev_t *const *devs, size_t count);
+
+/**
+ * @brief Queue the staged (dirty) channels of a device into a shared I2C batch.
+ *
+ * Lets PCA9685 updates ride in the same transaction as writes to other devices on the bus.
+ * The shadow registers are marked clean by a completion callback once the batch has been
+ * submitted successfully; on failure the channels stay staged.
+ *
+ * @param dev Pointer to the initialized PCA9685 device configuration structure.
+ * @param batch Batch started with i2c_batch_begin, submitted on dev's I2C port.
+ * @return
+ *     - ESP_OK on success, or if nothing was staged.
+ *     - ESP_ERR_INVALID_ARG if dev or batch is NULL.
+ *     - ESP_ERR_NO_MEM if the batch has no room left.
+ */
+esp_err_t pca9685_queue(pca9685_dev_t *dev, i2c_batch_t *batch);
+
+/**
+ * @brief Room the staged channels of a device would take in a batch, without queueing them.
+ *
+ * Lets a scheduler pack several devices into batches before calling pca9685_queue.
+ *
+ * @param dev Pointer to the initialized PCA9685 device configuration structure.
+ * @param segments Out: START segments pca9685_queue would add (0 if nothing is staged).
+ * @return Payload bytes pca9685_queue would add, register bytes included.
+ */
+size_t pca9685_queue_size(const pca9685_dev_t *dev, size_t *segments);
+
+/**
+ * @brief Pack the staged channels of several devices into as few batches as possible.
+ *
+ * Each device with staged channels is one burst of pca9685_queue_size; bursts are packed
+ * first-fit by decreasing size into batches bounded by I2C_BATCH_BUF_SIZE,
+ * I2C_BATCH_MAX_SEGMENTS and I2C_BATCH_MAX_CALLBACKS. A single device always fits one batch.
+ *
+ * @param devs Array of count device pointers.
+ * @param count Number of devices (at most PCA9685_FRAME_MAX_DEVICES).
+ * @param batch_of Out: per device, the batch to queue it into, or PCA9685_FRAME_UNSENT if
+ *                 nothing is staged.
+ * @return Number of batches, 0 if nothing is staged or an argument is invalid.
+ */
+size_t pca9685_plan_frame(pca9685_dev_t *const *devs, size_t count, uint8_t *batch_of);
+
+/**
+ * @brief Read back the configuration (and optionally one channel) and repair the chip if it was lost.
+ *
+ * A PCA9685 that browns out comes back asleep at its power-on defaults, and as unchanged
+ * channels are never rewritten it would stay blank. One read of PRE_SCALE, MODE1 and MODE2
+ * (auto-increment rolls over from PRE_SCALE to MODE1) detects that; the chip is then
+ * re-initialized with the driver's prescale and every channel rewritten from the shadow,
+ * phases and full-off flags included. Other chips are not touched.
+ *
+ * With spot_led, each call also reads the LEDn registers of one channel, the next one
+ * every call, and compares them with the shadow.
+ *
+ * Do not call while another task stages or commits on the device.
+ *
+ * @param dev Pointer to the initialized PCA9685 device configuration structure, frequency set.
+ * @param spot_led Also compare one channel's LEDn registers.
+ * @param result Out: what was found (may be NULL).
+ * @return
+ *     - ESP_OK on success, including after a successful repair.
+ *     - ESP_ERR_INVALID_ARG if dev is NULL.
+ *     - ESP_ERR_INVALID_STATE if the frequency has not been set.
+ *     - ESP_FAIL or other errors if I2C communication fails; a failed repair is retried by
+ *       the next check, the rewrite by the next commit.
+ */
+esp_err_t pca9685_check(pca9685_dev_t *dev, bool spot_led, pca9685_check_result_t *result);
+
+/**
+ * @brief Forget the shadow register contents so the next write of every channel goes to the bus.
+ *
+ * Use after anything that may have changed the LEDn registers behind the driver's back
+ * (power loss on the PCA9685, a software reset, another bus master).
+ *
+ * @param dev Pointer to the initialized PCA9685 device configuration structure.
+ */
+void pca9685_invalidate_shadow(pca9685_dev_t *dev);
+
+/**
+ * @brief Clear the write counters in dev->stats.
+ *
+ * @param dev Pointer to the initialized PCA9685 device configuration structure.
+ */
+void pca9685_reset_stats(pca9685_dev_t *dev);
+
 #endif // PCA9685_H
\ No newline at end of file
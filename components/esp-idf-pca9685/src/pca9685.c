@@ -2,33 +2,53 @@
 #include "esp_log.h"
 #include "driver/i2c.h"
 #include <math.h>
+#include <string.h>
+#include <stdio.h>
 
 static const char *TAG = "PCA9685";
 
 // Internal register definitions
 #define PCA9685_REG_MODE1        0x00
+#define PCA9685_REG_MODE2        0x01
 #define PCA9685_REG_PRE_SCALE    0xFE
 #define PCA9685_REG_ALL_LED_ON_L 0xFA
 #define PCA9685_REG_LED0_ON_L    0x06
 #define PCA9685_MODE1_RESTART    (1 << 7)
 #define PCA9685_MODE1_AI         (1 << 5)
 #define PCA9685_MODE1_SLEEP      (1 << 4)
+#define PCA9685_LED_FULL         (1 << 12) // LEDn_ON/OFF bit 4 of the high byte
+#define PCA9685_MODE2_OCH        (1 << 3)
+#define PCA9685_MODE2_OUTDRV     (1 << 2)
 
 static esp_err_t write_reg(pca9685_dev_t *dev, uint8_t reg, uint8_t value) {
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, (dev->i2c_addr << 1) | I2C_MASTER_WRITE, true);
-    i2c_master_write_byte(cmd, reg, true);
-    i2c_master_write_byte(cmd, value, true);
-    i2c_master_stop(cmd);
-    esp_err_t ret = i2c_master_cmd_begin(dev->i2c_port, cmd, pdMS_TO_TICKS(100));
-    i2c_cmd_link_delete(cmd);
+    // i2c_master_write_to_device builds its command link on the stack, no heap involved
+    uint8_t data[2] = { reg, value };
+    esp_err_t ret = i2c_bus_acquire(&dev->bus_client, pdMS_TO_TICKS(100));
+    if (ret == ESP_OK) {
+        ret = i2c_master_write_to_device(dev->i2c_port, dev->i2c_addr, data, sizeof(data),
+                                         pdMS_TO_TICKS(100));
+        i2c_bus_release(&dev->bus_client);
+    }
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to write reg 0x%02X: %s", reg, esp_err_to_name(ret));
     }
     return ret;
 }
 
+static esp_err_t read_regs(pca9685_dev_t *dev, uint8_t reg, uint8_t *data, size_t len) {
+    // Register pointer, repeated START, read: one transaction
+    esp_err_t ret = i2c_bus_acquire(&dev->bus_client, pdMS_TO_TICKS(100));
+    if (ret == ESP_OK) {
+        ret = i2c_master_write_read_device(dev->i2c_port, dev->i2c_addr, &reg, 1, data, len,
+                                           pdMS_TO_TICKS(100));
+        i2c_bus_release(&dev->bus_client);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to read reg 0x%02X: %s", reg, esp_err_to_name(ret));
+    }
+    return ret;
+}
+
 esp_err_t pca9685_init(pca9685_dev_t *dev, i2c_port_t port, uint8_t addr) {
     if (!dev) return ESP_ERR_INVALID_ARG;
 
@@ -36,14 +56,29 @@ esp_err_t pca9685_init(pca9685_dev_t *dev, i2c_port_t port, uint8_t addr) {
     dev->i2c_port = port;
     dev->i2c_addr = addr;
     dev->pwm_freq_hz = 0;
+    dev->prescale = 0;
+    dev->shadow_valid = 0;
+    dev->inflight_mask = 0;
+    dev->check_channel = 0;
+    memset(&dev->stats, 0, sizeof(dev->stats));
+
+    char name[16];
+    snprintf(name, sizeof(name), "pca9685@0x%02X", addr);
+    esp_err_t ret = i2c_bus_client_init(&dev->bus_client, port, name);
+    if (ret != ESP_OK) return ret;
 
     // Probe the device to ensure I2C bus is ready
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+    uint8_t link[I2C_LINK_RECOMMENDED_SIZE(1)];
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create_static(link, sizeof(link));
     i2c_master_start(cmd);
     i2c_master_write_byte(cmd, (addr << 1) | I2C_MASTER_WRITE, true);
     i2c_master_stop(cmd);
-    esp_err_t ret = i2c_master_cmd_begin(port, cmd, pdMS_TO_TICKS(100));
-    i2c_cmd_link_delete(cmd);
+    ret = i2c_bus_acquire(&dev->bus_client, pdMS_TO_TICKS(100));
+    if (ret == ESP_OK) {
+        ret = i2c_master_cmd_begin(port, cmd, pdMS_TO_TICKS(100));
+        i2c_bus_release(&dev->bus_client);
+    }
+    i2c_cmd_link_delete_static(cmd);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to probe PCA9685 at 0x%02X: %s", addr, esp_err_to_name(ret));
         return ret;
@@ -54,6 +89,9 @@ esp_err_t pca9685_init(pca9685_dev_t *dev, i2c_port_t port, uint8_t addr) {
     vTaskDelay(pdMS_TO_TICKS(5));
     ret = write_reg(dev, PCA9685_REG_MODE1, PCA9685_MODE1_AI | PCA9685_MODE1_RESTART);
     if (ret != ESP_OK) return ret;
+    // Totem-pole outputs, OCH = 0: outputs change on STOP, which pca9685_commit_frame relies on
+    ret = write_reg(dev, PCA9685_REG_MODE2, PCA9685_MODE2_OUTDRV);
+    if (ret != ESP_OK) return ret;
 
     ret = write_reg(dev, PCA9685_REG_ALL_LED_ON_L, 0);
     if (ret != ESP_OK) return ret;
@@ -64,15 +102,25 @@ esp_err_t pca9685_init(pca9685_dev_t *dev, i2c_port_t port, uint8_t addr) {
     ret = write_reg(dev, PCA9685_REG_ALL_LED_ON_L + 3, 0);
     if (ret != ESP_OK) return ret;
 
+    // ALL_LED registers mirror into every LEDn register, so the shadow is known from here
+    memset(dev->led_on, 0, sizeof(dev->led_on));
+    memset(dev->led_off, 0, sizeof(dev->led_off));
+    memset(dev->phase, 0, sizeof(dev->phase));
+    dev->shadow_valid = 0xFFFF;
+
     ESP_LOGI(TAG, "PCA9685 initialized");
     return ESP_OK;
 }
 
+static uint8_t prescale_for(float freq_hz) {
+    uint8_t prescale = (uint8_t)(roundf(25000000.0f / (4096.0f * freq_hz)) - 1);
+    return prescale < 3 ? 3 : prescale;
+}
+
 esp_err_t pca9685_set_frequency(pca9685_dev_t *dev, float freq_hz) {
     if (!dev || freq_hz < 24 || freq_hz > 1526) return ESP_ERR_INVALID_ARG;
 
-    uint8_t prescale = (uint8_t)(roundf(25000000.0f / (4096.0f * freq_hz)) - 1);
-    if (prescale < 3) prescale = 3;
+    uint8_t prescale = prescale_for(freq_hz);
 
     esp_err_t ret = write_reg(dev, PCA9685_REG_MODE1, PCA9685_MODE1_SLEEP);
     if (ret != ESP_OK) return ret;
@@ -83,42 +131,423 @@ esp_err_t pca9685_set_frequency(pca9685_dev_t *dev, float freq_hz) {
     ret = write_reg(dev, PCA9685_REG_MODE1, PCA9685_MODE1_AI | PCA9685_MODE1_RESTART);
     if (ret != ESP_OK) return ret;
 
+    dev->prescale = prescale;
     dev->pwm_freq_hz = 25000000.0f / ((prescale + 1) * 4096.0f);
     ESP_LOGI(TAG, "Set PWM frequency to %.2f Hz (prescale=%d)", dev->pwm_freq_hz, prescale);
     return ESP_OK;
 }
 
-esp_err_t pca9685_set_duty(pca9685_dev_t *dev, pca9685_channel_t channel, uint16_t duty) {
-    if (!dev || channel >= PCA9685_CHANNEL_COUNT || duty > 4095) return ESP_ERR_INVALID_ARG;
+esp_err_t pca9685_init_frequency(pca9685_dev_t *dev, i2c_port_t port, uint8_t addr, float freq_hz) {
+    if (!dev || freq_hz < 24 || freq_hz > 1526) return ESP_ERR_INVALID_ARG;
+
+    dev->i2c_port = port;
+    dev->i2c_addr = addr;
+    dev->pwm_freq_hz = 0;
+    dev->prescale = 0;
+    dev->shadow_valid = 0;
+    dev->inflight_mask = 0;
+    dev->check_channel = 0;
+    memset(&dev->stats, 0, sizeof(dev->stats));
 
-    uint8_t reg = PCA9685_REG_LED0_ON_L + (channel * 4);
-    uint8_t data[4] = { 0, 0, duty & 0xFF, (duty >> 8) & 0x0F };
+    char name[16];
+    snprintf(name, sizeof(name), "pca9685@0x%02X", addr);
+    esp_err_t ret = i2c_bus_client_init(&dev->bus_client, port, name);
+    if (ret != ESP_OK) return ret;
 
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, (dev->i2c_addr << 1) | I2C_MASTER_WRITE, true);
-    i2c_master_write_byte(cmd, reg, true);
-    i2c_master_write(cmd, data, 4, true);
-    i2c_master_stop(cmd);
-    esp_err_t ret = i2c_master_cmd_begin(dev->i2c_port, cmd, pdMS_TO_TICKS(100));
-    i2c_cmd_link_delete(cmd);
+    // PRE_SCALE only takes while SLEEP is set, and the chip may be awake and running from
+    // before a reset, so: asleep with AI and MODE2 set, then ALL_LED off and PRE_SCALE in one
+    // auto-incremented run, then awake. RESTART is left alone, so the 500 us the oscillator
+    // needs before it may be set is no wait here; with every output off, PWM just starts
+    // once the oscillator runs. A missing chip NACKs its address and fails the transaction.
+    uint8_t prescale = prescale_for(freq_hz);
+    const uint8_t mode[2] = {PCA9685_MODE1_SLEEP | PCA9685_MODE1_AI, PCA9685_MODE2_OUTDRV};
+    const uint8_t all_off[5] = {0, 0, 0, 0, prescale};
+    const uint8_t wake = PCA9685_MODE1_AI;
+    i2c_batch_t batch;
+    i2c_batch_begin(&batch);
+    i2c_batch_set_client(&batch, &dev->bus_client);
+    ret = i2c_batch_write_reg(&batch, addr, PCA9685_REG_MODE1, mode, sizeof(mode));
+    if (ret == ESP_OK) ret = i2c_batch_write_reg(&batch, addr, PCA9685_REG_ALL_LED_ON_L, all_off, sizeof(all_off));
+    if (ret == ESP_OK) ret = i2c_batch_write_reg(&batch, addr, PCA9685_REG_MODE1, &wake, 1);
+    if (ret == ESP_OK) ret = i2c_batch_submit(&batch, port, pdMS_TO_TICKS(100));
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize PCA9685 at 0x%02X: %s", addr, esp_err_to_name(ret));
+        return ret;
+    }
 
+    memset(dev->led_on, 0, sizeof(dev->led_on));
+    memset(dev->led_off, 0, sizeof(dev->led_off));
+    memset(dev->phase, 0, sizeof(dev->phase));
+    dev->shadow_valid = 0xFFFF;
+    dev->prescale = prescale;
+    dev->pwm_freq_hz = 25000000.0f / ((prescale + 1) * 4096.0f);
+    ESP_LOGI(TAG, "PCA9685 at 0x%02X initialized at %.2f Hz (prescale=%d)", addr, dev->pwm_freq_hz, prescale);
+    return ESP_OK;
+}
+
+// A full rewrite of identical values (e.g. every servo to one position) goes out as a
+// single ALL_LED write instead of 16 LEDn writes
+static bool all_led_frame(const pca9685_dev_t *dev, uint16_t dirty) {
+    if (dirty != 0xFFFF) return false;
+    for (int ch = 1; ch < PCA9685_CHANNEL_COUNT; ch++) {
+        if (dev->led_on[ch] != dev->led_on[0] || dev->led_off[ch] != dev->led_off[0]) return false;
+    }
+    return true;
+}
+
+// Queue one register write per contiguous run of dirty channels into the batch
+static int queue_dirty_runs(pca9685_dev_t *dev, i2c_batch_t *batch, uint16_t dirty) {
+    if (all_led_frame(dev, dirty)) {
+        uint8_t data[4] = {
+            dev->led_on[0] & 0xFF, (dev->led_on[0] >> 8) & 0x1F,
+            dev->led_off[0] & 0xFF, (dev->led_off[0] >> 8) & 0x1F,
+        };
+        return i2c_batch_write_reg(batch, dev->i2c_addr, PCA9685_REG_ALL_LED_ON_L, data, 4) == ESP_OK;
+    }
+
+    int runs = 0;
+    int ch = 0;
+    while (ch < PCA9685_CHANNEL_COUNT) {
+        if (!(dirty & (1u << ch))) {
+            ch++;
+            continue;
+        }
+        // LEDn_ON_L..LEDn_OFF_H of consecutive channels, sent back to back thanks to MODE1 AI
+        uint8_t data[PCA9685_CHANNEL_COUNT * 4];
+        int first = ch;
+        uint8_t *p = data;
+        while (ch < PCA9685_CHANNEL_COUNT && (dirty & (1u << ch))) {
+            *p++ = dev->led_on[ch] & 0xFF;
+            *p++ = (dev->led_on[ch] >> 8) & 0x1F;
+            *p++ = dev->led_off[ch] & 0xFF;
+            *p++ = (dev->led_off[ch] >> 8) & 0x1F;
+            ch++;
+        }
+        if (i2c_batch_write_reg(batch, dev->i2c_addr, PCA9685_REG_LED0_ON_L + (first * 4),
+                                data, p - data) != ESP_OK) {
+            break;
+        }
+        runs++;
+    }
+    return runs;
+}
+
+size_t pca9685_queue_size(const pca9685_dev_t *dev, size_t *segments) {
+    uint16_t dirty = dev ? ~dev->shadow_valid & 0xFFFF : 0;
+    size_t runs = 0;
+    size_t bytes = 0;
+    if (dirty && all_led_frame(dev, dirty)) {
+        runs = 1;
+        bytes = 5;
+    } else {
+        // Same run splitting as queue_dirty_runs: register byte plus 4 bytes per channel
+        for (int ch = 0; ch < PCA9685_CHANNEL_COUNT; ch++) {
+            if (!(dirty & (1u << ch))) continue;
+            if (ch == 0 || !(dirty & (1u << (ch - 1)))) {
+                runs++;
+                bytes++;
+            }
+            bytes += 4;
+        }
+    }
+    if (segments) *segments = runs;
+    return bytes;
+}
+
+// Batch completion: channels still marked in-flight now match the chip
+static void finish_commit(void *ctx, esp_err_t ret) {
+    pca9685_dev_t *dev = ctx;
+    uint16_t sent = dev->inflight_mask;
+    dev->inflight_mask = 0;
     if (ret == ESP_OK) {
-        ESP_LOGI(TAG, "Set channel %d duty to %u", channel, duty);
+        dev->shadow_valid |= sent;
+        dev->stats.transactions++;
+        dev->stats.writes_issued += __builtin_popcount(sent);
+        // Debug level: this runs per controller on every servo_motion tick
+        ESP_LOGD(TAG, "0x%02X: committed %d channel(s)", dev->i2c_addr, __builtin_popcount(sent));
+    } else {
+        // The chip may hold either the old or the new values now; keep them dirty
+        ESP_LOGE(TAG, "0x%02X: failed to commit channels (mask 0x%04X): %s", dev->i2c_addr,
+                 sent, esp_err_to_name(ret));
     }
-    return ret;
 }
 
-esp_err_t pca9685_set_servo_pulse(pca9685_dev_t *dev, pca9685_channel_t channel, uint16_t pulse_us) {
-    if (!dev || channel >= PCA9685_CHANNEL_COUNT || pulse_us < 500 || pulse_us > 2500) {
+esp_err_t pca9685_queue(pca9685_dev_t *dev, i2c_batch_t *batch) {
+    if (!dev || !batch) return ESP_ERR_INVALID_ARG;
+
+    uint16_t dirty = ~dev->shadow_valid & 0xFFFF;
+    if (dirty == 0) return ESP_OK;
+    i2c_batch_set_client(batch, &dev->bus_client);
+    if (queue_dirty_runs(dev, batch, dirty) == 0) return ESP_ERR_NO_MEM;
+    dev->inflight_mask = dirty;
+    return i2c_batch_on_complete(batch, finish_commit, dev);
+}
+
+// LEDn_ON/OFF for a duty at the channel's phase; duty 0 keeps the output low all period
+static void channel_regs(const pca9685_dev_t *dev, int ch, uint16_t duty, uint16_t *on, uint16_t *off) {
+    *on = duty ? dev->phase[ch] : 0;
+    *off = duty ? (dev->phase[ch] + duty) & 0x0FFF : 0;
+}
+
+// Stage ON/OFF on a channel unless it is known to hold them already
+static void stage_regs(pca9685_dev_t *dev, int ch, uint16_t on, uint16_t off) {
+    if ((dev->shadow_valid & (1u << ch)) && dev->led_on[ch] == on && dev->led_off[ch] == off) {
+        dev->stats.writes_suppressed++;
+        return;
+    }
+    dev->led_on[ch] = on;
+    dev->led_off[ch] = off;
+    dev->shadow_valid &= ~(1u << ch);
+    dev->inflight_mask &= ~(1u << ch);
+}
+
+uint16_t pca9685_get_duty(const pca9685_dev_t *dev, pca9685_channel_t channel) {
+    if (!dev || channel >= PCA9685_CHANNEL_COUNT) return 0;
+    // The full-off flag sits above the 12 count bits and does not change the pulse kept
+    return (dev->led_off[channel] - dev->led_on[channel]) & 0x0FFF;
+}
+
+esp_err_t pca9685_stage_full_off(pca9685_dev_t *dev, uint16_t mask, bool full_off) {
+    if (!dev) return ESP_ERR_INVALID_ARG;
+
+    for (int ch = 0; ch < PCA9685_CHANNEL_COUNT; ch++) {
+        if (!(mask & (1u << ch)) || !pca9685_get_duty(dev, ch)) continue;
+        uint16_t off = full_off ? dev->led_off[ch] | PCA9685_LED_FULL : dev->led_off[ch] & ~PCA9685_LED_FULL;
+        stage_regs(dev, ch, dev->led_on[ch], off);
+    }
+    return ESP_OK;
+}
+
+uint16_t pca9685_pulse_mask(const pca9685_dev_t *dev, uint16_t *full_off) {
+    uint16_t pulses = 0, off = 0;
+    for (int ch = 0; dev && ch < PCA9685_CHANNEL_COUNT; ch++) {
+        if (!pca9685_get_duty(dev, ch)) continue;
+        pulses |= 1u << ch;
+        if (dev->led_off[ch] & PCA9685_LED_FULL) off |= 1u << ch;
+    }
+    if (full_off) *full_off = off;
+    return pulses;
+}
+
+esp_err_t pca9685_stage_phase(pca9685_dev_t *dev, pca9685_channel_t channel, uint16_t on_count) {
+    if (!dev || channel >= PCA9685_CHANNEL_COUNT || on_count > 4095) return ESP_ERR_INVALID_ARG;
+
+    uint16_t duty = pca9685_get_duty(dev, channel);
+    dev->phase[channel] = on_count;
+    if (duty) {
+        uint16_t on, off;
+        channel_regs(dev, channel, duty, &on, &off);
+        stage_regs(dev, channel, on, off | (dev->led_off[channel] & PCA9685_LED_FULL));
+    }
+    return ESP_OK;
+}
+
+esp_err_t pca9685_stage_duty_range(pca9685_dev_t *dev, pca9685_channel_t first_channel,
+                                   const uint16_t *duty, size_t count) {
+    if (!dev || !duty || count == 0 || first_channel >= PCA9685_CHANNEL_COUNT ||
+        first_channel + count > PCA9685_CHANNEL_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (duty[i] > 4095) return ESP_ERR_INVALID_ARG;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        uint16_t on, off;
+        channel_regs(dev, first_channel + i, duty[i], &on, &off);
+        stage_regs(dev, first_channel + i, on, off);
+    }
+    return ESP_OK;
+}
+
+esp_err_t pca9685_commit(pca9685_dev_t *dev) {
+    return pca9685_commit_frame(&dev, 1);
+}
+
+size_t pca9685_plan_frame(pca9685_dev_t *const *devs, size_t count, uint8_t *batch_of) {
+    if (!devs || !batch_of || count > PCA9685_FRAME_MAX_DEVICES) return 0;
+
+    uint16_t bytes[PCA9685_FRAME_MAX_DEVICES];
+    uint8_t segments[PCA9685_FRAME_MAX_DEVICES];
+    uint8_t order[PCA9685_FRAME_MAX_DEVICES];
+    size_t sorted = 0;
+    for (size_t i = 0; i < count; i++) {
+        size_t segs;
+        bytes[i] = pca9685_queue_size(devs[i], &segs);
+        segments[i] = segs;
+        batch_of[i] = PCA9685_FRAME_UNSENT;
+        if (bytes[i] == 0) continue;
+
+        // Insertion by decreasing size; at most 62 entries
+        size_t pos = sorted++;
+        while (pos > 0 && bytes[order[pos - 1]] < bytes[i]) {
+            order[pos] = order[pos - 1];
+            pos--;
+        }
+        order[pos] = i;
+    }
+
+    // First-fit decreasing: every burst goes into the first batch with room for it
+    struct {
+        uint16_t bytes;
+        uint8_t segments;
+        uint8_t callbacks;
+    } bins[PCA9685_FRAME_MAX_DEVICES];
+    size_t num_bins = 0;
+    for (size_t k = 0; k < sorted; k++) {
+        size_t i = order[k];
+        size_t b = 0;
+        while (b < num_bins && (bins[b].bytes + bytes[i] > I2C_BATCH_BUF_SIZE ||
+                                bins[b].segments + segments[i] > I2C_BATCH_MAX_SEGMENTS ||
+                                bins[b].callbacks >= I2C_BATCH_MAX_CALLBACKS)) {
+            b++;
+        }
+        if (b == num_bins) {
+            bins[num_bins].bytes = 0;
+            bins[num_bins].segments = 0;
+            bins[num_bins].callbacks = 0;
+            num_bins++;
+        }
+        bins[b].bytes += bytes[i];
+        bins[b].segments += segments[i];
+        bins[b].callbacks++;
+        batch_of[i] = b;
+    }
+    return num_bins;
+}
+
+esp_err_t pca9685_commit_frame(pca9685_dev_t *const *devs, size_t count) {
+    if (!devs || count == 0 || count > PCA9685_FRAME_MAX_DEVICES) return ESP_ERR_INVALID_ARG;
+    for (size_t i = 0; i < count; i++) {
+        if (!devs[i] || devs[i]->i2c_port != devs[0]->i2c_port) return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t batch_of[PCA9685_FRAME_MAX_DEVICES];
+    size_t num_batches = pca9685_plan_frame(devs, count, batch_of);
+    i2c_batch_t batch;
+    esp_err_t first_err = ESP_OK;
+    for (size_t b = 0; b < num_batches; b++) {
+        i2c_batch_begin(&batch);
+        esp_err_t ret = ESP_OK;
+        for (size_t i = 0; i < count && ret == ESP_OK; i++) {
+            if (batch_of[i] == b) ret = pca9685_queue(devs[i], &batch);
+        }
+        // Submitted even if queueing failed: the batch then sends nothing and its callbacks
+        // leave the queued channels dirty. Single STOP: every chip in the batch latches together.
+        esp_err_t sent = i2c_batch_submit(&batch, devs[0]->i2c_port, pdMS_TO_TICKS(100));
+        if (ret == ESP_OK) ret = sent;
+        if (ret != ESP_OK && first_err == ESP_OK) first_err = ret;
+    }
+    return first_err;
+}
+
+esp_err_t pca9685_set_duty_range(pca9685_dev_t *dev, pca9685_channel_t first_channel,
+                                 const uint16_t *duty, size_t count) {
+    esp_err_t ret = pca9685_stage_duty_range(dev, first_channel, duty, count);
+    if (ret != ESP_OK) return ret;
+    return pca9685_commit(dev);
+}
+
+esp_err_t pca9685_check(pca9685_dev_t *dev, bool spot_led, pca9685_check_result_t *result) {
+    if (result) *result = PCA9685_CHECK_OK;
+    if (!dev) return ESP_ERR_INVALID_ARG;
+    if (dev->prescale == 0) return ESP_ERR_INVALID_STATE;
+
+    // PRE_SCALE, MODE1, MODE2. After a reset AI is off and all three reads return PRE_SCALE.
+    uint8_t regs[3];
+    esp_err_t ret = read_regs(dev, PCA9685_REG_PRE_SCALE, regs, sizeof(regs));
+    if (ret != ESP_OK) return ret;
+    dev->stats.checks++;
+
+    uint8_t mode1 = regs[1] & (PCA9685_MODE1_AI | PCA9685_MODE1_SLEEP);
+    uint8_t mode2 = regs[2] & (PCA9685_MODE2_OCH | PCA9685_MODE2_OUTDRV);
+    if (regs[0] != dev->prescale || mode1 != PCA9685_MODE1_AI || mode2 != PCA9685_MODE2_OUTDRV) {
+        ESP_LOGW(TAG, "0x%02X: lost configuration (PRE_SCALE 0x%02X, MODE1 0x%02X, MODE2 0x%02X), restoring",
+                 dev->i2c_addr, regs[0], regs[1], regs[2]);
+        dev->stats.resets_detected++;
+        if (result) *result = PCA9685_CHECK_RESET;
+        // Same sequence as pca9685_init and pca9685_set_frequency, shadow kept
+        ret = write_reg(dev, PCA9685_REG_MODE1, PCA9685_MODE1_SLEEP);
+        if (ret == ESP_OK) ret = write_reg(dev, PCA9685_REG_PRE_SCALE, dev->prescale);
+        if (ret == ESP_OK) ret = write_reg(dev, PCA9685_REG_MODE1, PCA9685_MODE1_AI | PCA9685_MODE1_RESTART);
+        if (ret == ESP_OK) ret = write_reg(dev, PCA9685_REG_MODE2, PCA9685_MODE2_OUTDRV);
+        if (ret != ESP_OK) return ret;
+        dev->shadow_valid = 0;
+        return pca9685_commit(dev);
+    }
+
+    if (spot_led) {
+        int ch = dev->check_channel;
+        dev->check_channel = (ch + 1) % PCA9685_CHANNEL_COUNT;
+        uint8_t led[4];
+        ret = read_regs(dev, PCA9685_REG_LED0_ON_L + ch * 4, led, sizeof(led));
+        if (ret != ESP_OK) return ret;
+        // Only a channel the chip is known to hold can be compared
+        if ((dev->shadow_valid & ~dev->inflight_mask) & (1u << ch)) {
+            uint16_t on = led[0] | ((led[1] & 0x1F) << 8);
+            uint16_t off = led[2] | ((led[3] & 0x1F) << 8);
+            if (on != dev->led_on[ch] || off != dev->led_off[ch]) {
+                ESP_LOGW(TAG, "0x%02X: ch%d reads 0x%04X/0x%04X, expected 0x%04X/0x%04X, rewriting",
+                         dev->i2c_addr, ch, on, off, dev->led_on[ch], dev->led_off[ch]);
+                dev->stats.led_mismatches++;
+                if (result) *result = PCA9685_CHECK_LED_MISMATCH;
+                dev->shadow_valid = 0;
+                return pca9685_commit(dev);
+            }
+        }
+    }
+    return ESP_OK;
+}
+
+void pca9685_invalidate_shadow(pca9685_dev_t *dev) {
+    if (dev) dev->shadow_valid = 0;
+}
+
+void pca9685_reset_stats(pca9685_dev_t *dev) {
+    if (dev) memset(&dev->stats, 0, sizeof(dev->stats));
+}
+
+esp_err_t pca9685_set_duty(pca9685_dev_t *dev, pca9685_channel_t channel, uint16_t duty) {
+    return pca9685_set_duty_range(dev, channel, &duty, 1);
+}
+
+esp_err_t pca9685_pulse_to_duty(const pca9685_dev_t *dev, uint16_t pulse_us, uint16_t *duty) {
+    if (!dev || !duty) return ESP_ERR_INVALID_ARG;
+    if (pulse_us < 500 || pulse_us > 2500) {
         return ESP_ERR_INVALID_ARG;
     }
     if (dev->pwm_freq_hz == 0) {
         return ESP_ERR_INVALID_STATE;
     }
 
-    uint32_t duty = (uint32_t)((pulse_us * 4096.0f * dev->pwm_freq_hz) / 1000000.0f);
-    if (duty > 4095) duty = 4095;
+    uint32_t counts = (uint32_t)((pulse_us * 4096.0f * dev->pwm_freq_hz) / 1000000.0f);
+    if (counts > 4095) counts = 4095;
+    *duty = (uint16_t)counts;
+    return ESP_OK;
+}
+
+esp_err_t pca9685_stage_servo_pulses(pca9685_dev_t *dev, pca9685_channel_t first_channel,
+                                     const uint16_t *pulse_us, size_t count) {
+    if (!dev || !pulse_us || count == 0 || first_channel >= PCA9685_CHANNEL_COUNT ||
+        first_channel + count > PCA9685_CHANNEL_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint16_t duty[PCA9685_CHANNEL_COUNT];
+    for (size_t i = 0; i < count; i++) {
+        esp_err_t ret = pca9685_pulse_to_duty(dev, pulse_us[i], &duty[i]);
+        if (ret != ESP_OK) return ret;
+    }
+    return pca9685_stage_duty_range(dev, first_channel, duty, count);
+}
+
+esp_err_t pca9685_set_servo_pulses(pca9685_dev_t *dev, pca9685_channel_t first_channel,
+                                   const uint16_t *pulse_us, size_t count) {
+    esp_err_t ret = pca9685_stage_servo_pulses(dev, first_channel, pulse_us, count);
+    if (ret != ESP_OK) return ret;
+    return pca9685_commit(dev);
+}
 
-    return pca9685_set_duty(dev, channel, (uint16_t)duty);
-}
\ No newline at end of file
+esp_err_t pca9685_set_servo_pulse(pca9685_dev_t *dev, pca9685_channel_t channel, uint16_t pulse_us) {
+    return pca9685_set_servo_pulses(dev, channel, &pulse_us, 1);
+}
@@ -0,0 +1,150 @@
+#include "fast_boot.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <string.h>
+
+static const char *TAG = "fast_boot";
+
+// Slots are taken atomically, so tasks may begin and mark phases concurrently
+static int take_phase(fast_boot_t *boot, const char *name, bool parallel) {
+    uint32_t i = __atomic_fetch_add(&boot->num_phases, 1, __ATOMIC_RELAXED);
+    if (i >= FAST_BOOT_MAX_PHASES) return -1;
+    fast_boot_phase_t *phase = &boot->phases[i];
+    phase->name = name;
+    phase->result = ESP_OK;
+    phase->parallel = parallel;
+    phase->end_us = 0;
+    phase->start_us = esp_timer_get_time();
+    return i;
+}
+
+static void finish_phase(fast_boot_t *boot, int i, esp_err_t result) {
+    if (i < 0) return;
+    boot->phases[i].result = result;
+    __atomic_store_n(&boot->phases[i].end_us, esp_timer_get_time(), __ATOMIC_RELEASE);
+}
+
+esp_err_t fast_boot_init(fast_boot_t *boot) {
+    if (!boot) return ESP_ERR_INVALID_ARG;
+    memset(boot, 0, sizeof(*boot));
+    boot->done = xQueueCreateStatic(FAST_BOOT_MAX_STEPS, sizeof(size_t), boot->done_storage, &boot->done_buf);
+    return ESP_OK;
+}
+
+static esp_err_t run_step(fast_boot_t *boot, size_t i) {
+    const fast_boot_step_t *step = boot->slots[i].step;
+    esp_err_t ret = step->fn(step->ctx);
+    boot->slots[i].result = ret;
+    finish_phase(boot, boot->slots[i].phase, ret);
+    if (ret != ESP_OK) ESP_LOGE(TAG, "%s failed: %s", step->name, esp_err_to_name(ret));
+    return ret;
+}
+
+static void step_task(void *param) {
+    fast_boot_slot_t *slot = param;
+    fast_boot_t *boot = slot->boot;
+    size_t i = slot->index;
+    run_step(boot, i);
+    xQueueSend(boot->done, &i, portMAX_DELAY);
+    vTaskDelete(NULL);
+}
+
+esp_err_t fast_boot_run(fast_boot_t *boot, const fast_boot_step_t *steps, size_t count, UBaseType_t priority) {
+    if (!boot || !steps || count == 0 || count > FAST_BOOT_MAX_STEPS) return ESP_ERR_INVALID_ARG;
+
+    bool on_task[FAST_BOOT_MAX_STEPS] = {false};
+    size_t spawned = 0;
+    for (size_t i = 0; i < count; i++) {
+        boot->slots[i].step = &steps[i];
+        boot->slots[i].boot = boot;
+        boot->slots[i].index = i;
+        boot->slots[i].phase = -1;
+        boot->slots[i].result = ESP_OK;
+    }
+    // Tasks first, so their steps are under way while the caller runs steps[0]
+    for (size_t i = 1; i < count; i++) {
+        boot->slots[i].phase = take_phase(boot, steps[i].name, true);
+        if (xTaskCreate(step_task, steps[i].name, FAST_BOOT_STACK_SIZE, &boot->slots[i], priority, NULL) == pdPASS) {
+            on_task[i] = true;
+            spawned++;
+        } else {
+            ESP_LOGW(TAG, "No task for %s, running it on the caller", steps[i].name);
+            if (boot->slots[i].phase >= 0) boot->phases[boot->slots[i].phase].parallel = false;
+        }
+    }
+
+    boot->slots[0].phase = take_phase(boot, steps[0].name, false);
+    run_step(boot, 0);
+    for (size_t i = 1; i < count; i++) {
+        if (on_task[i]) continue;
+        if (boot->slots[i].phase >= 0) boot->phases[boot->slots[i].phase].start_us = esp_timer_get_time();
+        run_step(boot, i);
+    }
+    for (size_t n = 0; n < spawned; n++) {
+        size_t i;
+        xQueueReceive(boot->done, &i, portMAX_DELAY);
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (boot->slots[i].result != ESP_OK) return boot->slots[i].result;
+    }
+    return ESP_OK;
+}
+
+int fast_boot_begin(fast_boot_t *boot, const char *name) {
+    return boot ? take_phase(boot, name, false) : -1;
+}
+
+void fast_boot_end(fast_boot_t *boot, int phase, esp_err_t result) {
+    if (boot) finish_phase(boot, phase, result);
+}
+
+void fast_boot_mark(fast_boot_t *boot, const char *name) {
+    if (!boot) return;
+    finish_phase(boot, take_phase(boot, name, false), ESP_OK);
+}
+
+int64_t fast_boot_phase_end(const fast_boot_t *boot, const char *name) {
+    if (!boot || !name) return 0;
+    uint32_t count = __atomic_load_n(&boot->num_phases, __ATOMIC_RELAXED);
+    if (count > FAST_BOOT_MAX_PHASES) count = FAST_BOOT_MAX_PHASES;
+    for (uint32_t i = 0; i < count; i++) {
+        const fast_boot_phase_t *phase = &boot->phases[i];
+        int64_t end = __atomic_load_n(&phase->end_us, __ATOMIC_ACQUIRE);
+        if (end && phase->name && strcmp(phase->name, name) == 0) return end;
+    }
+    return 0;
+}
+
+void fast_boot_log(const fast_boot_t *boot) {
+    if (!boot) return;
+    uint32_t count = __atomic_load_n(&boot->num_phases, __ATOMIC_RELAXED);
+    if (count > FAST_BOOT_MAX_PHASES) {
+        ESP_LOGW(TAG, "%lu phase(s) not recorded, timeline full", (unsigned long)(count - FAST_BOOT_MAX_PHASES));
+        count = FAST_BOOT_MAX_PHASES;
+    }
+
+    // Start order; a handful of phases, so a selection pass per line will do
+    bool shown[FAST_BOOT_MAX_PHASES] = {false};
+    ESP_LOGI(TAG, "Boot timeline (ms from the application start):");
+    for (uint32_t n = 0; n < count; n++) {
+        int first = -1;
+        for (uint32_t i = 0; i < count; i++) {
+            if (!shown[i] && (first < 0 || boot->phases[i].start_us < boot->phases[first].start_us)) first = i;
+        }
+        shown[first] = true;
+        const fast_boot_phase_t *phase = &boot->phases[first];
+        int64_t end = __atomic_load_n(&phase->end_us, __ATOMIC_ACQUIRE);
+        float start_ms = phase->start_us / 1000.0f;
+        if (!end) {
+            ESP_LOGI(TAG, "  %8.1f            %-16s running", start_ms, phase->name);
+        } else if (end == phase->start_us) {
+            ESP_LOGI(TAG, "  %8.1f            %s", start_ms, phase->name);
+        } else {
+            ESP_LOGI(TAG, "  %8.1f - %8.1f %-16s %7.1f ms%s%s%s", start_ms, end / 1000.0f, phase->name,
+                     (end - phase->start_us) / 1000.0f, phase->parallel ? ", own task" : "",
+                     phase->result == ESP_OK ? "" : ", failed: ",
+                     phase->result == ESP_OK ? "" : esp_err_to_name(phase->result));
+        }
+    }
+}
@@ -0,0 +1,135 @@
+#ifndef FAST_BOOT_H
+#define FAST_BOOT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+/*
+ * Boot orchestration and timeline.
+ *
+ * fast_boot_run brings several devices up at once: each step runs on its own task (the
+ * first on the caller), so one device's datasheet waits leave the bus free for the others
+ * instead of adding up. Steps on one I2C port still take turns on the bus lock.
+ *
+ * Every step run, every fast_boot_begin/fast_boot_end pair and every fast_boot_mark is
+ * recorded as a phase in esp_timer time, i.e. from the application start, and
+ * fast_boot_log prints them as a timeline. Marking the point where the display is first
+ * right (digits landed, date drawn) makes the time to a correct display trackable.
+ */
+
+#define FAST_BOOT_MAX_PHASES 16
+#define FAST_BOOT_MAX_STEPS 4
+#define FAST_BOOT_STACK_SIZE 4096 /**< Step task stack; steps queue I2C batches on it */
+
+/**
+ * @brief A bring-up step: returns ESP_OK or the error that failed it.
+ */
+typedef esp_err_t (*fast_boot_fn_t)(void *ctx);
+
+/**
+ * @brief A step of fast_boot_run.
+ */
+typedef struct {
+    const char *name;        /**< Phase name in the timeline */
+    fast_boot_fn_t fn;
+    void *ctx;
+} fast_boot_step_t;
+
+/**
+ * @brief One timeline entry.
+ */
+typedef struct {
+    const char *name;
+    int64_t start_us;        /**< esp_timer time the phase began */
+    int64_t end_us;          /**< esp_timer time it ended, start_us for a mark, 0 while running */
+    esp_err_t result;
+    bool parallel;           /**< Ran on a task of its own */
+} fast_boot_phase_t;
+
+/**
+ * @brief A step under way in fast_boot_run.
+ */
+typedef struct {
+    const fast_boot_step_t *step;
+    void *boot;              /**< The fast_boot_t, for the step's task */
+    size_t index;            /**< Position in the steps given */
+    int phase;               /**< Timeline entry, -1 if the timeline is full */
+    esp_err_t result;
+} fast_boot_slot_t;
+
+/**
+ * @brief Orchestrator state. Treat as opaque.
+ */
+typedef struct {
+    fast_boot_phase_t phases[FAST_BOOT_MAX_PHASES];
+    uint32_t num_phases;     /**< Entries taken, may exceed FAST_BOOT_MAX_PHASES (dropped) */
+    QueueHandle_t done;      /**< Indices of the steps finished on their tasks */
+    StaticQueue_t done_buf;
+    uint8_t done_storage[FAST_BOOT_MAX_STEPS * sizeof(size_t)];
+    fast_boot_slot_t slots[FAST_BOOT_MAX_STEPS];
+} fast_boot_t;
+
+/**
+ * @brief Start an empty timeline.
+ *
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if boot is NULL.
+ */
+esp_err_t fast_boot_init(fast_boot_t *boot);
+
+/**
+ * @brief Run steps concurrently and wait until all have finished.
+ *
+ * steps[0] runs on the calling task, the others on tasks of their own at priority, which
+ * delete themselves when done. A step whose task cannot be created runs on the caller
+ * after steps[0] instead. Each step is recorded as a phase.
+ *
+ * @param boot Initialized orchestrator.
+ * @param steps Steps to run.
+ * @param count Number of steps (1-FAST_BOOT_MAX_STEPS).
+ * @param priority Priority of the step tasks.
+ * @return
+ *     - ESP_OK if every step returned ESP_OK.
+ *     - ESP_ERR_INVALID_ARG if a pointer is NULL or count is out of range.
+ *     - Otherwise the error of the first failed step in list order; the others still ran.
+ */
+esp_err_t fast_boot_run(fast_boot_t *boot, const fast_boot_step_t *steps, size_t count, UBaseType_t priority);
+
+/**
+ * @brief Begin a phase run on the calling task.
+ *
+ * @return Phase handle for fast_boot_end, -1 if the timeline is full or boot is NULL.
+ */
+int fast_boot_begin(fast_boot_t *boot, const char *name);
+
+/**
+ * @brief End a phase begun with fast_boot_begin (ignored for -1).
+ */
+void fast_boot_end(fast_boot_t *boot, int phase, esp_err_t result);
+
+/**
+ * @brief Record a point in time, e.g. the display first showing the right time. Any task
+ *        may mark.
+ */
+void fast_boot_mark(fast_boot_t *boot, const char *name);
+
+/**
+ * @brief esp_timer time of a phase's end (its time for a mark).
+ *
+ * @return The time, or 0 if no finished phase has that name.
+ */
+int64_t fast_boot_phase_end(const fast_boot_t *boot, const char *name);
+
+/**
+ * @brief Log the phases in start order with start, end and duration in milliseconds.
+ *        Phases still running are shown as such.
+ */
+void fast_boot_log(const fast_boot_t *boot);
+
+#endif // FAST_BOOT_H
@@ -0,0 +1,110 @@
+#include "frame_store.h"
+#include "esp_log.h"
+#include <string.h>
+
+static const char *TAG = "frame_store";
+
+#define FRAME_MAGIC   0xF5
+#define FRAME_VERSION 1
+// Magic, version, digits, colons, segments..., colon bits, CRC
+#define RECORD_SIZE(digits) (6 + (digits))
+#define MAX_RECORD RECORD_SIZE(SEGMENT_DISPLAY_MAX_DIGITS)
+
+// CRC-8/MAXIM (polynomial 0x31 reflected), the checksum of Dallas/Maxim parts
+static uint8_t crc8(const uint8_t *data, size_t len) {
+    uint8_t crc = 0;
+    while (len--) {
+        crc ^= *data++;
+        for (int bit = 0; bit < 8; bit++) crc = (crc >> 1) ^ (0x8C & -(crc & 1));
+    }
+    return crc;
+}
+
+static esp_err_t ram_lock(frame_store_t *store) {
+    return store->bus ? i2c_bus_acquire(store->bus, pdMS_TO_TICKS(1000)) : ESP_OK;
+}
+
+static void ram_unlock(frame_store_t *store) {
+    if (store->bus) i2c_bus_release(store->bus);
+}
+
+esp_err_t frame_store_init(frame_store_t *store, i2c_dev_t *rtc, i2c_bus_client_t *bus) {
+    if (!store || !rtc) return ESP_ERR_INVALID_ARG;
+    memset(store, 0, sizeof(*store));
+    store->rtc = rtc;
+    store->bus = bus;
+    return ESP_OK;
+}
+
+esp_err_t frame_store_load(frame_store_t *store, segment_display_frame_t *frame) {
+    if (!store || !frame) return ESP_ERR_INVALID_ARG;
+
+    // The header first: the record's length depends on the digit count
+    uint8_t record[MAX_RECORD];
+    esp_err_t ret = ram_lock(store);
+    if (ret != ESP_OK) return ret;
+    ret = ds1307_read_ram(store->rtc, FRAME_STORE_RAM_OFFSET, record, 4);
+    size_t size = RECORD_SIZE(record[2]);
+    bool header_ok = ret == ESP_OK && record[0] == FRAME_MAGIC && record[1] == FRAME_VERSION &&
+                     record[2] <= SEGMENT_DISPLAY_MAX_DIGITS && record[3] <= 8;
+    if (header_ok) ret = ds1307_read_ram(store->rtc, FRAME_STORE_RAM_OFFSET + 4, record + 4, size - 4);
+    ram_unlock(store);
+    if (ret != ESP_OK) {
+        store->stats.errors++;
+        return ret;
+    }
+    if (record[0] != FRAME_MAGIC) return ESP_ERR_NOT_FOUND;
+    if (record[1] != FRAME_VERSION) return ESP_ERR_INVALID_VERSION;
+    if (!header_ok || crc8(record, size - 1) != record[size - 1]) {
+        ESP_LOGW(TAG, "Stored frame is corrupt");
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    memset(frame, 0, sizeof(*frame));
+    frame->num_digits = record[2];
+    frame->num_colons = record[3];
+    memcpy(frame->segments, &record[4], frame->num_digits);
+    frame->colons = record[4 + frame->num_digits];
+    store->stored = *frame;
+    store->known = true;
+    return ESP_OK;
+}
+
+esp_err_t frame_store_save(frame_store_t *store, const segment_display_frame_t *frame) {
+    if (!store || !frame || frame->num_digits > SEGMENT_DISPLAY_MAX_DIGITS || frame->num_colons > 8) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (store->known && !memcmp(&store->stored, frame, sizeof(*frame))) {
+        store->stats.unchanged++;
+        return ESP_OK;
+    }
+
+    uint8_t record[MAX_RECORD];
+    size_t size = RECORD_SIZE(frame->num_digits);
+    record[0] = FRAME_MAGIC;
+    record[1] = FRAME_VERSION;
+    record[2] = frame->num_digits;
+    record[3] = frame->num_colons;
+    memcpy(&record[4], frame->segments, frame->num_digits);
+    record[4 + frame->num_digits] = frame->colons;
+    record[size - 1] = crc8(record, size - 1);
+
+    // One write: the chip takes the bytes in order, so a reset midway leaves a bad CRC
+    esp_err_t ret = ram_lock(store);
+    if (ret != ESP_OK) return ret;
+    ret = ds1307_write_ram(store->rtc, FRAME_STORE_RAM_OFFSET, record, size);
+    ram_unlock(store);
+    if (ret != ESP_OK) {
+        store->stats.errors++;
+        store->known = false;
+        return ret;
+    }
+    store->stored = *frame;
+    store->known = true;
+    store->stats.saves++;
+    return ESP_OK;
+}
+
+void frame_store_reset_stats(frame_store_t *store) {
+    if (store) memset(&store->stats, 0, sizeof(store->stats));
+}
@@ -0,0 +1,86 @@
+#ifndef FRAME_STORE_H
+#define FRAME_STORE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "ds1307.h"
+#include "i2c_bus.h"
+#include "segment_display.h"
+
+/*
+ * Last display frame in the DS1307's battery-backed RAM.
+ *
+ * The 56 bytes of NVRAM survive resets and power loss as long as the RTC battery lasts,
+ * and unlike flash they take a write every minute for free. A record is a magic byte, a
+ * format version, the layout (digits and colons), the segments and a CRC-8; after a reset
+ * the frame read back lets segment_display_restore continue from where the servos stand
+ * instead of sweeping them.
+ */
+
+#define FRAME_STORE_RAM_OFFSET 0   /**< Record position in the NVRAM; the rest stays free */
+
+/**
+ * @brief Counters, cleared by frame_store_reset_stats.
+ */
+typedef struct {
+    uint32_t saves;           /**< Records written */
+    uint32_t unchanged;       /**< Saves skipped: the frame was stored already */
+    uint32_t errors;          /**< Failed NVRAM transfers */
+} frame_store_stats_t;
+
+/**
+ * @brief Store state. Treat as opaque.
+ */
+typedef struct {
+    i2c_dev_t *rtc;
+    i2c_bus_client_t *bus;
+    segment_display_frame_t stored;  /**< Frame in the NVRAM, valid when known */
+    bool known;
+    frame_store_stats_t stats;
+} frame_store_t;
+
+/**
+ * @brief Set up a store. Nothing is read yet.
+ *
+ * @param store Store state to initialize.
+ * @param rtc Initialized DS1307 descriptor.
+ * @param bus Client whose lock is held around NVRAM access (may be NULL).
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if store or rtc is NULL.
+ */
+esp_err_t frame_store_init(frame_store_t *store, i2c_dev_t *rtc, i2c_bus_client_t *bus);
+
+/**
+ * @brief Read the stored frame.
+ *
+ * @param store Initialized store.
+ * @param frame Out: the frame; only written on ESP_OK.
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if a pointer is NULL.
+ *     - ESP_ERR_NOT_FOUND if the NVRAM holds no record (first boot, battery replaced).
+ *     - ESP_ERR_INVALID_VERSION if the record has another format version.
+ *     - ESP_ERR_INVALID_CRC if the record does not check out.
+ *     - ESP_ERR_TIMEOUT if the bus lock cannot be taken; errors from ds1307_read_ram.
+ */
+esp_err_t frame_store_load(frame_store_t *store, segment_display_frame_t *frame);
+
+/**
+ * @brief Store a frame, unless it is the one stored already.
+ *
+ * @return
+ *     - ESP_OK on success, including when nothing had to be written.
+ *     - ESP_ERR_INVALID_ARG if a pointer is NULL or the frame has more than
+ *       SEGMENT_DISPLAY_MAX_DIGITS digits or 8 colons.
+ *     - ESP_ERR_TIMEOUT if the bus lock cannot be taken; errors from ds1307_write_ram.
+ */
+esp_err_t frame_store_save(frame_store_t *store, const segment_display_frame_t *frame);
+
+/**
+ * @brief Clear store->stats.
+ */
+void frame_store_reset_stats(frame_store_t *store);
+
+#endif // FRAME_STORE_H
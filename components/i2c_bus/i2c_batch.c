@@ -0,0 +1,135 @@
+#include "i2c_batch.h"
+#include "esp_log.h"
+#include <string.h>
+
+static const char *TAG = "i2c_batch";
+
+// Command link storage for a full batch, one per port: only the holder of the port's bus
+// lock builds a link in it, so neither a caller's stack nor the heap is used
+static uint8_t links[I2C_NUM_MAX][I2C_BATCH_LINK_SIZE];
+
+esp_err_t i2c_batch_begin(i2c_batch_t *batch) {
+    if (!batch) return ESP_ERR_INVALID_ARG;
+
+    batch->used = 0;
+    batch->num_segments = 0;
+    batch->error = ESP_OK;
+    batch->num_callbacks = 0;
+    batch->client = NULL;
+    return ESP_OK;
+}
+
+void i2c_batch_set_client(i2c_batch_t *batch, i2c_bus_client_t *client) {
+    if (!batch) return;
+    if (!client || !batch->client) batch->client = client;
+}
+
+// Reserve len bytes of payload storage; NULL (and the batch failed) when it does not fit
+static uint8_t *reserve(i2c_batch_t *batch, size_t len) {
+    if (batch->used + len > sizeof(batch->buf)) {
+        ESP_LOGE(TAG, "Batch full (%u + %u bytes)", (unsigned)batch->used, (unsigned)len);
+        batch->error = ESP_ERR_NO_MEM;
+        return NULL;
+    }
+    uint8_t *p = &batch->buf[batch->used];
+    batch->used += len;
+    return p;
+}
+
+static esp_err_t add_segment(i2c_batch_t *batch, uint8_t addr, bool merge, size_t offset, size_t len) {
+    if (batch->num_segments >= I2C_BATCH_MAX_SEGMENTS) {
+        ESP_LOGE(TAG, "Batch full (%d segments)", I2C_BATCH_MAX_SEGMENTS);
+        batch->error = ESP_ERR_NO_MEM;
+        return ESP_ERR_NO_MEM;
+    }
+    batch->segments[batch->num_segments].addr = addr;
+    batch->segments[batch->num_segments].merge = merge;
+    batch->segments[batch->num_segments].offset = offset;
+    batch->segments[batch->num_segments].len = len;
+    batch->num_segments++;
+    return ESP_OK;
+}
+
+esp_err_t i2c_batch_write_reg(i2c_batch_t *batch, uint8_t addr, uint8_t reg,
+                              const uint8_t *data, size_t len) {
+    if (!batch || (!data && len)) return ESP_ERR_INVALID_ARG;
+
+    size_t offset = batch->used;
+    uint8_t *p = reserve(batch, len + 1);
+    if (!p) return ESP_ERR_NO_MEM;
+    p[0] = reg;
+    if (len) memcpy(&p[1], data, len);
+    return add_segment(batch, addr, false, offset, len + 1);
+}
+
+esp_err_t i2c_batch_write(i2c_batch_t *batch, uint8_t addr, const uint8_t *data, size_t len) {
+    if (!batch || !data || len == 0) return ESP_ERR_INVALID_ARG;
+
+    size_t offset = batch->used;
+    uint8_t *p = reserve(batch, len);
+    if (!p) return ESP_ERR_NO_MEM;
+    memcpy(p, data, len);
+
+    if (batch->num_segments > 0) {
+        uint8_t last = batch->num_segments - 1;
+        if (batch->segments[last].merge && batch->segments[last].addr == addr &&
+            batch->segments[last].offset + batch->segments[last].len == offset) {
+            batch->segments[last].len += len;
+            return ESP_OK;
+        }
+    }
+    return add_segment(batch, addr, true, offset, len);
+}
+
+esp_err_t i2c_batch_on_complete(i2c_batch_t *batch, i2c_batch_cb_t cb, void *ctx) {
+    if (!batch || !cb) return ESP_ERR_INVALID_ARG;
+    if (batch->num_callbacks >= I2C_BATCH_MAX_CALLBACKS) {
+        batch->error = ESP_ERR_NO_MEM;
+        return ESP_ERR_NO_MEM;
+    }
+    batch->callbacks[batch->num_callbacks].cb = cb;
+    batch->callbacks[batch->num_callbacks].ctx = ctx;
+    batch->num_callbacks++;
+    return ESP_OK;
+}
+
+esp_err_t i2c_batch_submit(i2c_batch_t *batch, i2c_port_t port, TickType_t timeout) {
+    if (!batch) return ESP_ERR_INVALID_ARG;
+
+    esp_err_t ret = batch->error;
+    i2c_bus_client_t *client = batch->client ? batch->client : i2c_bus_default_client(port);
+    if (ret == ESP_OK && batch->num_segments > 0 && (!client || client->port != port)) {
+        ESP_LOGE(TAG, "Batch for port %d charged to a client of another port", port);
+        ret = ESP_ERR_INVALID_ARG;
+    }
+    if (ret == ESP_OK && batch->num_segments > 0) {
+        ret = i2c_bus_acquire(client, timeout);
+    }
+    if (ret == ESP_OK && batch->num_segments > 0) {
+        // START + address + payload per segment and one STOP, in the port's link storage
+        i2c_cmd_handle_t cmd = i2c_cmd_link_create_static(links[port], sizeof(links[port]));
+        for (uint8_t i = 0; i < batch->num_segments; i++) {
+            // i2c_master_start after the first segment is emitted as a repeated START
+            i2c_master_start(cmd);
+            i2c_master_write_byte(cmd, (batch->segments[i].addr << 1) | I2C_MASTER_WRITE, true);
+            i2c_master_write(cmd, &batch->buf[batch->segments[i].offset], batch->segments[i].len, true);
+        }
+        i2c_master_stop(cmd);
+        ret = i2c_master_cmd_begin(port, cmd, timeout);
+        i2c_cmd_link_delete_static(cmd);
+        i2c_bus_release(client);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Batch of %u segment(s), %u bytes failed: %s", batch->num_segments,
+                     (unsigned)batch->used, esp_err_to_name(ret));
+        }
+    }
+
+    for (uint8_t i = 0; i < batch->num_callbacks; i++) {
+        batch->callbacks[i].cb(batch->callbacks[i].ctx, ret);
+    }
+    batch->num_callbacks = 0;
+    batch->num_segments = 0;
+    batch->used = 0;
+    batch->client = NULL;
+    return ret;
+}
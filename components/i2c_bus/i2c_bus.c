@@ -0,0 +1,178 @@
+#include "i2c_bus.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <string.h>
+
+static const char *TAG = "i2c_bus";
+
+typedef struct {
+    bool initialized;
+    gpio_num_t sda, scl;
+    uint32_t clk_hz;
+    SemaphoreHandle_t lock;
+    StaticSemaphore_t lock_buf;
+    i2c_bus_client_t *clients;
+    i2c_bus_client_t default_client;
+} bus_t;
+
+static bus_t buses[I2C_NUM_MAX];
+static portMUX_TYPE buses_mux = portMUX_INITIALIZER_UNLOCKED;
+
+// Ports exist once i2c_bus_init has set them up; it alone creates the lock and default
+// client, outside any critical section
+static bus_t *get_bus(i2c_port_t port) {
+    if (port < 0 || port >= I2C_NUM_MAX) return NULL;
+    bus_t *bus = &buses[port];
+    return __atomic_load_n(&bus->initialized, __ATOMIC_ACQUIRE) ? bus : NULL;
+}
+
+esp_err_t i2c_bus_init(i2c_port_t port, gpio_num_t sda, gpio_num_t scl, uint32_t clk_hz) {
+    if (port < 0 || port >= I2C_NUM_MAX) return ESP_ERR_INVALID_ARG;
+    bus_t *bus = &buses[port];
+    if (bus->initialized) {
+        ESP_LOGI(TAG, "Port %d already initialized", port);
+        return ESP_OK;
+    }
+    if (!bus->lock) {
+        bus->lock = xSemaphoreCreateMutexStatic(&bus->lock_buf);
+        strcpy(bus->default_client.name, "default");
+        bus->default_client.port = port;
+        bus->default_client.next = bus->clients;
+        bus->clients = &bus->default_client;
+    }
+
+    i2c_config_t conf = {
+        .mode = I2C_MODE_MASTER,
+        .sda_io_num = sda,
+        .scl_io_num = scl,
+        .sda_pullup_en = GPIO_PULLUP_ENABLE,
+        .scl_pullup_en = GPIO_PULLUP_ENABLE,
+        .master.clk_speed = clk_hz
+    };
+    esp_err_t err = i2c_param_config(port, &conf);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "i2c_param_config failed: %s", esp_err_to_name(err));
+        return err;
+    }
+    err = i2c_driver_install(port, conf.mode, 0, 0, 0);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "i2c_driver_install failed: %s", esp_err_to_name(err));
+        return err;
+    }
+    bus->sda = sda;
+    bus->scl = scl;
+    bus->clk_hz = clk_hz;
+    __atomic_store_n(&bus->initialized, true, __ATOMIC_RELEASE);
+    ESP_LOGI(TAG, "Port %d initialized: SDA=%d, SCL=%d, %lu Hz", port, sda, scl, (unsigned long)clk_hz);
+    return ESP_OK;
+}
+
+bool i2c_bus_is_initialized(i2c_port_t port) {
+    return get_bus(port) != NULL;
+}
+
+esp_err_t i2c_bus_set_clock(i2c_port_t port, uint32_t clk_hz) {
+    if (port < 0 || port >= I2C_NUM_MAX || !clk_hz) return ESP_ERR_INVALID_ARG;
+    bus_t *bus = get_bus(port);
+    if (!bus) return ESP_ERR_INVALID_STATE;
+
+    // Between transactions only: the reconfiguration holds the bus like any client
+    i2c_bus_acquire(&bus->default_client, portMAX_DELAY);
+    i2c_config_t conf = {
+        .mode = I2C_MODE_MASTER,
+        .sda_io_num = bus->sda,
+        .scl_io_num = bus->scl,
+        .sda_pullup_en = GPIO_PULLUP_ENABLE,
+        .scl_pullup_en = GPIO_PULLUP_ENABLE,
+        .master.clk_speed = clk_hz
+    };
+    esp_err_t err = i2c_param_config(port, &conf);
+    if (err == ESP_OK) bus->clk_hz = clk_hz;
+    i2c_bus_release(&bus->default_client);
+    if (err != ESP_OK) ESP_LOGE(TAG, "i2c_param_config failed: %s", esp_err_to_name(err));
+    return err;
+}
+
+uint32_t i2c_bus_get_clock(i2c_port_t port) {
+    bus_t *bus = get_bus(port);
+    return bus ? bus->clk_hz : 0;
+}
+
+esp_err_t i2c_bus_client_init(i2c_bus_client_t *client, i2c_port_t port, const char *name) {
+    if (port < 0 || port >= I2C_NUM_MAX || !client || !name) return ESP_ERR_INVALID_ARG;
+    bus_t *bus = get_bus(port);
+    if (!bus) return ESP_ERR_INVALID_STATE;
+
+    // Re-initializing a registered client (e.g. a device brought up again) must not relink it
+    bool registered = false;
+    for (i2c_bus_client_t *c = bus->clients; c; c = c->next) {
+        if (c == client) registered = true;
+    }
+
+    i2c_bus_client_t *next = registered ? client->next : bus->clients;
+    memset(client, 0, sizeof(*client));
+    strncpy(client->name, name, sizeof(client->name) - 1);
+    client->port = port;
+    client->next = next;
+
+    if (!registered) {
+        portENTER_CRITICAL(&buses_mux);
+        client->next = bus->clients;
+        bus->clients = client;
+        portEXIT_CRITICAL(&buses_mux);
+    }
+    return ESP_OK;
+}
+
+i2c_bus_client_t *i2c_bus_default_client(i2c_port_t port) {
+    bus_t *bus = get_bus(port);
+    return bus ? &bus->default_client : NULL;
+}
+
+esp_err_t i2c_bus_acquire(i2c_bus_client_t *client, TickType_t timeout) {
+    if (!client) return ESP_ERR_INVALID_ARG;
+    bus_t *bus = get_bus(client->port);
+    if (!bus) return ESP_ERR_INVALID_STATE;
+
+    int64_t start = esp_timer_get_time();
+    if (xSemaphoreTake(bus->lock, timeout) != pdTRUE) {
+        client->stats.timeouts++;
+        ESP_LOGW(TAG, "%s: timed out waiting for port %d", client->name, client->port);
+        return ESP_ERR_TIMEOUT;
+    }
+    client->acquired_at_us = esp_timer_get_time();
+
+    uint32_t wait = (uint32_t)(client->acquired_at_us - start);
+    client->stats.acquisitions++;
+    client->stats.total_wait_us += wait;
+    if (wait > client->stats.max_wait_us) client->stats.max_wait_us = wait;
+    return ESP_OK;
+}
+
+void i2c_bus_release(i2c_bus_client_t *client) {
+    if (!client) return;
+    bus_t *bus = get_bus(client->port);
+    if (!bus) return;
+
+    uint32_t hold = (uint32_t)(esp_timer_get_time() - client->acquired_at_us);
+    client->stats.total_hold_us += hold;
+    if (hold > client->stats.max_hold_us) client->stats.max_hold_us = hold;
+    xSemaphoreGive(bus->lock);
+}
+
+void i2c_bus_log_stats(i2c_port_t port) {
+    bus_t *bus = get_bus(port);
+    if (!bus) return;
+
+    for (i2c_bus_client_t *c = bus->clients; c; c = c->next) {
+        if (c->stats.acquisitions == 0 && c->stats.timeouts == 0) continue;
+        ESP_LOGI(TAG, "port %d %-15s n=%lu wait avg/max %lu/%lu us, hold avg/max %lu/%lu us, timeouts %lu",
+                 port, c->name, (unsigned long)c->stats.acquisitions,
+                 (unsigned long)(c->stats.total_wait_us / (c->stats.acquisitions ? c->stats.acquisitions : 1)),
+                 (unsigned long)c->stats.max_wait_us,
+                 (unsigned long)(c->stats.total_hold_us / (c->stats.acquisitions ? c->stats.acquisitions : 1)),
+                 (unsigned long)c->stats.max_hold_us, (unsigned long)c->stats.timeouts);
+    }
+}
@@ -0,0 +1,103 @@
+#include "i2c_exec.h"
+#include "esp_log.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+
+static const char *TAG = "i2c_exec";
+
+typedef struct {
+    TaskHandle_t task;
+    QueueHandle_t queues[I2C_EXEC_PRIO_COUNT];
+} executor_t;
+
+static executor_t executors[I2C_NUM_MAX];
+
+static void exec_task(void *param) {
+    i2c_port_t port = (i2c_port_t)(intptr_t)param;
+    executor_t *ex = &executors[port];
+
+    while (1) {
+        // One notification per submitted request
+        ulTaskNotifyTake(pdFALSE, portMAX_DELAY);
+
+        i2c_exec_req_t *req = NULL;
+        for (int prio = 0; prio < I2C_EXEC_PRIO_COUNT && !req; prio++) {
+            xQueueReceive(ex->queues[prio], &req, 0);
+        }
+        if (!req) continue;
+
+        req->result = i2c_batch_submit(req->batch, port, pdMS_TO_TICKS(I2C_EXEC_TIMEOUT_MS));
+        // The Give is the only completion signal and the last touch of req: the waiter may
+        // return, and a request on its stack go away, as soon as it is taken
+        xSemaphoreGive(req->done_sem);
+    }
+}
+
+esp_err_t i2c_exec_start(i2c_port_t port, UBaseType_t task_priority, BaseType_t core) {
+    if (port < 0 || port >= I2C_NUM_MAX) return ESP_ERR_INVALID_ARG;
+    executor_t *ex = &executors[port];
+    if (ex->task) return ESP_ERR_INVALID_STATE;
+
+    for (int prio = 0; prio < I2C_EXEC_PRIO_COUNT; prio++) {
+        ex->queues[prio] = xQueueCreate(I2C_EXEC_QUEUE_LEN, sizeof(i2c_exec_req_t *));
+        if (!ex->queues[prio]) return ESP_ERR_NO_MEM;
+    }
+    if (xTaskCreatePinnedToCore(exec_task, "i2c_exec", I2C_EXEC_STACK_SIZE, (void *)(intptr_t)port,
+                                task_priority, &ex->task, core) != pdPASS) {
+        ex->task = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "Executor started on port %d (priority %u)", port, (unsigned)task_priority);
+    return ESP_OK;
+}
+
+TaskHandle_t i2c_exec_task(i2c_port_t port) {
+    return port >= 0 && port < I2C_NUM_MAX ? executors[port].task : NULL;
+}
+
+esp_err_t i2c_exec_req_init(i2c_exec_req_t *req) {
+    if (!req) return ESP_ERR_INVALID_ARG;
+    req->batch = NULL;
+    req->result = ESP_ERR_INVALID_STATE;
+    req->done = false;
+    req->done_sem = xSemaphoreCreateBinaryStatic(&req->done_sem_buf);
+    return ESP_OK;
+}
+
+esp_err_t i2c_exec_submit(i2c_port_t port, i2c_batch_t *batch, i2c_exec_prio_t prio,
+                          i2c_exec_req_t *req) {
+    if (port < 0 || port >= I2C_NUM_MAX || !batch || !req || prio >= I2C_EXEC_PRIO_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    executor_t *ex = &executors[port];
+    if (!ex->task || !req->done_sem) return ESP_ERR_INVALID_STATE;
+
+    req->batch = batch;
+    req->result = ESP_ERR_INVALID_STATE;
+    req->done = false;
+
+    if (xQueueSend(ex->queues[prio], &req, 0) != pdTRUE) {
+        ESP_LOGW(TAG, "Port %d priority %d queue full", port, prio);
+        return ESP_ERR_TIMEOUT;
+    }
+    xTaskNotifyGive(ex->task);
+    return ESP_OK;
+}
+
+esp_err_t i2c_exec_wait(i2c_exec_req_t *req, TickType_t timeout) {
+    if (!req) return ESP_ERR_INVALID_ARG;
+    if (!req->done) {
+        if (!req->done_sem || xSemaphoreTake(req->done_sem, timeout) != pdTRUE) return ESP_ERR_TIMEOUT;
+        req->done = true;
+    }
+    return req->result;
+}
+
+esp_err_t i2c_exec_run(i2c_port_t port, i2c_batch_t *batch, i2c_exec_prio_t prio) {
+    i2c_exec_req_t req;
+    i2c_exec_req_init(&req);
+    esp_err_t ret = i2c_exec_submit(port, batch, prio, &req);
+    if (ret == ESP_OK) ret = i2c_exec_wait(&req, portMAX_DELAY);
+    vSemaphoreDelete(req.done_sem);
+    return ret;
+}
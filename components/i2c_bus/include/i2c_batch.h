@@ -0,0 +1,142 @@
+#ifndef I2C_BATCH_H
+#define I2C_BATCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "driver/i2c.h"
+#include "i2c_bus.h"
+
+#define I2C_BATCH_BUF_SIZE      512 /**< Bytes of payload a batch can carry (copied on queue) */
+#define I2C_BATCH_MAX_SEGMENTS  16  /**< START segments a batch can carry */
+#define I2C_BATCH_MAX_CALLBACKS 8   /**< Completion callbacks a batch can carry */
+/** Command link storage for a full batch: START, address, payload per segment and a STOP */
+#define I2C_BATCH_LINK_SIZE I2C_LINK_RECOMMENDED_SIZE(I2C_BATCH_MAX_SEGMENTS)
+
+/**
+ * @brief Called once per registered client after the batch has run (or failed).
+ *
+ * @param ctx Context pointer given to i2c_batch_on_complete.
+ * @param result Result of i2c_master_cmd_begin for the whole batch.
+ */
+typedef void (*i2c_batch_cb_t)(void *ctx, esp_err_t result);
+
+/**
+ * @brief A queue of writes to several devices sent as one I2C command link.
+ *
+ * Each queued write becomes a START/address/payload segment; consecutive segments are
+ * joined by repeated STARTs and a single STOP closes the batch, so one
+ * i2c_master_cmd_begin covers every device touched. Payloads are copied into the batch
+ * so callers may pass stack buffers.
+ *
+ * The command link is only built inside i2c_batch_submit, in static storage of the port
+ * used under its bus lock (i2c_cmd_link_create_static), so a batch touches neither the heap
+ * nor more of the caller's stack than the batch itself.
+ */
+typedef struct {
+    uint8_t buf[I2C_BATCH_BUF_SIZE]; /**< Payload storage */
+    size_t used;                    /**< Bytes of buf in use */
+    struct {
+        uint8_t addr;               /**< 7-bit device address */
+        bool merge;                 /**< Plain write that a following write to addr may extend */
+        uint16_t offset;            /**< Payload start in buf */
+        uint16_t len;               /**< Payload length */
+    } segments[I2C_BATCH_MAX_SEGMENTS];
+    uint8_t num_segments;           /**< Entries used in segments */
+    esp_err_t error;                /**< First queueing error, reported by i2c_batch_submit */
+    struct {
+        i2c_batch_cb_t cb;
+        void *ctx;
+    } callbacks[I2C_BATCH_MAX_CALLBACKS];
+    uint8_t num_callbacks;          /**< Entries used in callbacks */
+    i2c_bus_client_t *client;       /**< Client charged for the bus time, NULL = port default */
+} i2c_batch_t;
+
+/**
+ * @brief Start an empty batch.
+ *
+ * @param batch Batch to initialize.
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if batch is NULL.
+ */
+esp_err_t i2c_batch_begin(i2c_batch_t *batch);
+
+/**
+ * @brief Queue a START, the device address (write) and len payload bytes.
+ *
+ * If the previous segment is a plain write to the same address, the payload is appended
+ * to it instead (no repeated START), which suits byte-stream devices such as the PCF8574.
+ *
+ * @param batch Batch started with i2c_batch_begin.
+ * @param addr 7-bit I2C address of the target device.
+ * @param data Payload bytes, copied into the batch.
+ * @param len Number of payload bytes.
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if batch or data is NULL.
+ *     - ESP_ERR_NO_MEM if the payload or segment does not fit; the batch is then failed as a whole.
+ */
+esp_err_t i2c_batch_write(i2c_batch_t *batch, uint8_t addr, const uint8_t *data, size_t len);
+
+/**
+ * @brief Queue a register write: START, address, register byte, then len payload bytes.
+ *
+ * @param batch Batch started with i2c_batch_begin.
+ * @param addr 7-bit I2C address of the target device.
+ * @param reg First register to write (devices with auto-increment take the rest in sequence).
+ * @param data Payload bytes, copied into the batch.
+ * @param len Number of payload bytes.
+ * @return See i2c_batch_write.
+ */
+esp_err_t i2c_batch_write_reg(i2c_batch_t *batch, uint8_t addr, uint8_t reg,
+                              const uint8_t *data, size_t len);
+
+/**
+ * @brief Register a callback to run with the batch result after i2c_batch_submit.
+ *
+ * Lets drivers that queued writes update their own state (shadow registers, counters)
+ * once the transaction outcome is known.
+ *
+ * @param batch Batch started with i2c_batch_begin.
+ * @param cb Callback to invoke.
+ * @param ctx Context handed to cb.
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if batch or cb is NULL.
+ *     - ESP_ERR_NO_MEM if I2C_BATCH_MAX_CALLBACKS are already registered.
+ */
+esp_err_t i2c_batch_on_complete(i2c_batch_t *batch, i2c_batch_cb_t cb, void *ctx);
+
+/**
+ * @brief Name the bus client the batch's bus time is accounted to.
+ *
+ * The first driver that queues into a batch usually sets itself; later calls with a
+ * client already set are ignored unless client is NULL, which resets to the default.
+ *
+ * @param batch Batch started with i2c_batch_begin.
+ * @param client Registered bus client, or NULL for the port's default client.
+ */
+void i2c_batch_set_client(i2c_batch_t *batch, i2c_bus_client_t *client);
+
+/**
+ * @brief Close the batch with a STOP and run it as one transaction.
+ *
+ * The port is held through i2c_bus_acquire for the duration of the transaction.
+ * Completion callbacks run before returning. An empty batch completes without touching
+ * the bus. The batch can be reused with i2c_batch_begin afterwards.
+ *
+ * @param batch Batch started with i2c_batch_begin.
+ * @param port I2C port to run the batch on.
+ * @param timeout Ticks to wait for the bus, as for i2c_master_cmd_begin.
+ * @return
+ *     - ESP_OK on success or if the batch was empty.
+ *     - The first queueing error, if any write could not be queued.
+ *     - ESP_ERR_INVALID_ARG if port is out of range or the batch's client is on another port.
+ *     - ESP_ERR_TIMEOUT if the bus could not be acquired within timeout.
+ *     - ESP_FAIL or other errors if I2C communication fails.
+ */
+esp_err_t i2c_batch_submit(i2c_batch_t *batch, i2c_port_t port, TickType_t timeout);
+
+#endif // I2C_BATCH_H
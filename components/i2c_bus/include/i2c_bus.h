@@ -0,0 +1,141 @@
+#ifndef I2C_BUS_H
+#define I2C_BUS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "driver/i2c.h"
+#include "driver/gpio.h"
+
+/**
+ * @brief Bus time accounting for one client of a shared I2C port.
+ *
+ * Wait time runs from i2c_bus_acquire until the lock is obtained, hold time from then
+ * until i2c_bus_release.
+ */
+typedef struct {
+    uint32_t acquisitions;   /**< Number of successful acquires */
+    uint32_t timeouts;       /**< Acquires that gave up */
+    uint64_t total_wait_us;  /**< Sum of wait times */
+    uint32_t max_wait_us;    /**< Longest single wait */
+    uint64_t total_hold_us;  /**< Sum of hold times */
+    uint32_t max_hold_us;    /**< Longest single hold */
+} i2c_bus_client_stats_t;
+
+/**
+ * @brief A named user of a shared I2C port (a driver or a device instance).
+ *
+ * Storage is owned by the caller and must stay valid while registered.
+ */
+typedef struct i2c_bus_client {
+    char name[16];                  /**< Shown by i2c_bus_log_stats */
+    i2c_port_t port;                /**< Port the client uses */
+    i2c_bus_client_stats_t stats;   /**< Contention metrics */
+    int64_t acquired_at_us;         /**< Timestamp of the current hold */
+    struct i2c_bus_client *next;    /**< Registry link */
+} i2c_bus_client_t;
+
+/**
+ * @brief The one init point for an I2C port shared by several drivers.
+ *
+ * Creates the port's bus lock and default client, configures the port as master and
+ * installs the driver. Every other i2c_bus call, and the drivers built on it, need the
+ * port set up here first. Later calls for an already initialized port return ESP_OK
+ * without touching the driver, so drivers may call this from their own init functions
+ * without clobbering the application's setup. Call it for a port before any task uses it.
+ *
+ * @param port I2C port number.
+ * @param sda SDA GPIO.
+ * @param scl SCL GPIO.
+ * @param clk_hz SCL clock frequency in Hz.
+ * @return
+ *     - ESP_OK on success or if the port was already initialized.
+ *     - ESP_ERR_INVALID_ARG if port is out of range.
+ *     - Errors from i2c_param_config / i2c_driver_install.
+ */
+esp_err_t i2c_bus_init(i2c_port_t port, gpio_num_t sda, gpio_num_t scl, uint32_t clk_hz);
+
+/**
+ * @brief Check whether i2c_bus_init has set up a port.
+ *
+ * @param port I2C port number.
+ * @return true if the port is initialized.
+ */
+bool i2c_bus_is_initialized(i2c_port_t port);
+
+/**
+ * @brief Change the SCL clock of an initialized port.
+ *
+ * Waits for the bus like a client, so no transaction is cut short.
+ *
+ * @param port I2C port number.
+ * @param clk_hz New SCL clock frequency in Hz.
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if port is out of range or clk_hz is 0.
+ *     - ESP_ERR_INVALID_STATE if i2c_bus_init has not set up the port.
+ *     - Errors from i2c_param_config.
+ */
+esp_err_t i2c_bus_set_clock(i2c_port_t port, uint32_t clk_hz);
+
+/**
+ * @brief SCL clock of a port, for drivers that pace a device by bytes on the wire.
+ *
+ * @param port I2C port number.
+ * @return The clock set by i2c_bus_init or i2c_bus_set_clock, 0 if the port is not initialized.
+ */
+uint32_t i2c_bus_get_clock(i2c_port_t port);
+
+/**
+ * @brief Register a client so its metrics show up in i2c_bus_log_stats.
+ *
+ * @param client Caller-owned client storage.
+ * @param port Port the client uses.
+ * @param name Short name, truncated to 15 characters.
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if client or name is NULL or port is out of range.
+ *     - ESP_ERR_INVALID_STATE if i2c_bus_init has not set up the port.
+ */
+esp_err_t i2c_bus_client_init(i2c_bus_client_t *client, i2c_port_t port, const char *name);
+
+/**
+ * @brief Take exclusive use of the client's port.
+ *
+ * Everything a client does on the bus between acquire and release is one critical
+ * section, so multi-transaction sequences cannot interleave with other clients.
+ * Not recursive: a client must not acquire a port it already holds.
+ *
+ * @param client Registered client.
+ * @param timeout Ticks to wait for the bus.
+ * @return
+ *     - ESP_OK once the bus is held.
+ *     - ESP_ERR_INVALID_ARG if client is NULL.
+ *     - ESP_ERR_INVALID_STATE if i2c_bus_init has not set up the client's port.
+ *     - ESP_ERR_TIMEOUT if another client held the bus for longer than timeout.
+ */
+esp_err_t i2c_bus_acquire(i2c_bus_client_t *client, TickType_t timeout);
+
+/**
+ * @brief Give the port back and account the hold time.
+ *
+ * @param client Client that acquired the port.
+ */
+void i2c_bus_release(i2c_bus_client_t *client);
+
+/**
+ * @brief Client used for bus access that does not name its own client.
+ *
+ * @param port I2C port number.
+ * @return The port's shared default client, or NULL if the port is not initialized.
+ */
+i2c_bus_client_t *i2c_bus_default_client(i2c_port_t port);
+
+/**
+ * @brief Log wait and hold metrics of every registered client on a port.
+ *
+ * @param port I2C port number.
+ */
+void i2c_bus_log_stats(i2c_port_t port);
+
+#endif // I2C_BUS_H
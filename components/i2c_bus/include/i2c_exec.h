@@ -0,0 +1,118 @@
+#ifndef I2C_EXEC_H
+#define I2C_EXEC_H
+
+#include <stdbool.h>
+#include "esp_err.h"
+#include "driver/i2c.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "i2c_batch.h"
+
+#define I2C_EXEC_QUEUE_LEN   8    /**< Requests that can wait per priority level */
+#define I2C_EXEC_STACK_SIZE  4608 /**< Executor task stack: i2c_batch_submit, the I2C driver and batch callbacks */
+#define I2C_EXEC_TIMEOUT_MS  100  /**< Bus timeout handed to i2c_master_cmd_begin */
+
+/**
+ * @brief Priority level of a queued transaction.
+ *
+ * The executor always drains every HIGH request before it starts a LOW one, so a servo
+ * frame waits at most for the one LOW transaction already on the wire.
+ */
+typedef enum {
+    I2C_EXEC_PRIO_HIGH = 0, /**< Time-critical traffic, e.g. PCA9685 frame commits */
+    I2C_EXEC_PRIO_LOW,      /**< Everything else, e.g. LCD redraws */
+    I2C_EXEC_PRIO_COUNT
+} i2c_exec_prio_t;
+
+/**
+ * @brief Handle of one asynchronous transaction (a future for its result).
+ *
+ * Owned by the caller and set up once with i2c_exec_req_init. It must stay valid, together
+ * with its batch, until i2c_exec_wait has returned the result; only then may it be
+ * submitted again or go out of scope. Completion is signalled through a statically
+ * allocated semaphore, so submitting never touches the heap.
+ */
+typedef struct {
+    i2c_batch_t *batch;          /**< Batch to run */
+    esp_err_t result;            /**< Result of i2c_batch_submit, valid once done */
+    bool done;                   /**< Completion taken by i2c_exec_wait; the caller's side only */
+    SemaphoreHandle_t done_sem;  /**< Given by the executor on completion, its last touch of the request */
+    StaticSemaphore_t done_sem_buf;
+} i2c_exec_req_t;
+
+/**
+ * @brief Start the bus-owner task for an I2C port.
+ *
+ * The I2C driver must already be installed on the port. Call once per port.
+ *
+ * @param port I2C port the executor owns.
+ * @param task_priority FreeRTOS priority of the executor task.
+ * @param core Core to pin the task to, or tskNO_AFFINITY.
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if port is out of range.
+ *     - ESP_ERR_INVALID_STATE if an executor already runs on the port.
+ *     - ESP_ERR_NO_MEM if the task or queues cannot be created.
+ */
+esp_err_t i2c_exec_start(i2c_port_t port, UBaseType_t task_priority, BaseType_t core);
+
+/**
+ * @brief The executor task of a port, e.g. to watch its stack high-water mark.
+ *
+ * @param port I2C port.
+ * @return The task, or NULL if no executor runs on the port.
+ */
+TaskHandle_t i2c_exec_task(i2c_port_t port);
+
+/**
+ * @brief Set up a request handle. Once per handle, not per submit.
+ *
+ * @param req Caller-owned request handle.
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if req is NULL.
+ */
+esp_err_t i2c_exec_req_init(i2c_exec_req_t *req);
+
+/**
+ * @brief Queue a batch for the executor and return immediately.
+ *
+ * Completion callbacks registered on the batch run in the executor task. Do not stage new
+ * values into devices that are part of the batch until it has completed.
+ *
+ * @param port I2C port whose executor runs the batch.
+ * @param batch Batch built with the i2c_batch_* calls.
+ * @param prio Priority level.
+ * @param req Request handle set up with i2c_exec_req_init and not in flight, see i2c_exec_wait.
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if an argument is NULL or out of range.
+ *     - ESP_ERR_INVALID_STATE if no executor runs on the port or req was not set up.
+ *     - ESP_ERR_TIMEOUT if the priority queue is full.
+ */
+esp_err_t i2c_exec_submit(i2c_port_t port, i2c_batch_t *batch, i2c_exec_prio_t prio,
+                          i2c_exec_req_t *req);
+
+/**
+ * @brief Wait for a submitted request to finish.
+ *
+ * @param req Request passed to i2c_exec_submit.
+ * @param timeout Ticks to wait.
+ * @return
+ *     - The batch result once done, also on later calls until the next submit.
+ *     - ESP_ERR_TIMEOUT if it has not finished within timeout; wait again later.
+ */
+esp_err_t i2c_exec_wait(i2c_exec_req_t *req, TickType_t timeout);
+
+/**
+ * @brief Submit a batch and block until it has run.
+ *
+ * @param port I2C port whose executor runs the batch.
+ * @param batch Batch built with the i2c_batch_* calls.
+ * @param prio Priority level.
+ * @return See i2c_exec_submit and i2c_exec_wait.
+ */
+esp_err_t i2c_exec_run(i2c_port_t port, i2c_batch_t *batch, i2c_exec_prio_t prio);
+
+#endif // I2C_EXEC_H
@@ -0,0 +1,139 @@
+#ifndef PCA9685_ARRAY_H
+#define PCA9685_ARRAY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "pca9685.h"
+#include "i2c_batch.h"
+
+/*
+ * Servo arrays over many PCA9685s.
+ *
+ * A pca9685_array_t numbers the channels of a list of controllers globally: servo n is
+ * channel n % 16 of controller n / 16, in list order. Writes are only staged in the
+ * controllers' shadows; pca9685_array_commit then sends every dirty channel of the array,
+ * one burst per controller, packed into as few I2C transactions as the batch limits allow.
+ */
+
+#define PCA9685_ARRAY_MAX_CONTROLLERS PCA9685_FRAME_MAX_DEVICES /**< PCA9685s one I2C bus can address */
+
+/** Global servo index of a channel on the controller at position controller in the list */
+#define PCA9685_ARRAY_SERVO(controller, channel) ((controller) * PCA9685_CHANNEL_COUNT + (channel))
+
+/**
+ * @brief Counters of pca9685_array_commit, cleared by pca9685_array_reset_stats.
+ */
+typedef struct {
+    uint32_t frames;        /**< Commits that had something to send */
+    uint32_t batches;       /**< I2C transactions used */
+    uint32_t bursts;        /**< Controller bursts sent (one per dirty controller per frame) */
+    uint32_t bytes;         /**< Payload bytes queued, register bytes included */
+} pca9685_array_stats_t;
+
+/**
+ * @brief Array state. Treat as opaque.
+ */
+typedef struct {
+    pca9685_dev_t *controllers[PCA9685_ARRAY_MAX_CONTROLLERS];
+    size_t num_controllers;
+    i2c_batch_t batch;                  /**< Reused for every transaction of a commit */
+    pca9685_array_stats_t stats;
+} pca9685_array_t;
+
+/**
+ * @brief Set up an array over initialized controllers.
+ *
+ * @param array Array state to initialize.
+ * @param controllers count controllers, frequency set; their position gives the servo numbers.
+ * @param count Number of controllers (1-PCA9685_ARRAY_MAX_CONTROLLERS), on one or both ports.
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if a pointer is NULL, count is out of range, or two
+ *       controllers share a port and address.
+ */
+esp_err_t pca9685_array_init(pca9685_array_t *array, pca9685_dev_t *const *controllers, size_t count);
+
+/**
+ * @brief Number of servos (16 per controller).
+ */
+size_t pca9685_array_size(const pca9685_array_t *array);
+
+/**
+ * @brief Controller and local channel of a servo.
+ *
+ * @param array Initialized array.
+ * @param servo Global servo index.
+ * @param channel Out: channel on the returned controller (may be NULL).
+ * @return The controller, or NULL if servo is out of range.
+ */
+pca9685_dev_t *pca9685_array_locate(const pca9685_array_t *array, size_t servo, pca9685_channel_t *channel);
+
+/**
+ * @brief Stage duty cycles for count consecutive servos, which may span controllers.
+ *
+ * @param array Initialized array.
+ * @param first_servo Global index of the first servo.
+ * @param duty count OFF counts (0-4095).
+ * @param count Number of servos.
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if a pointer is NULL, the range leaves the array or a duty
+ *       exceeds 4095; nothing is staged then.
+ */
+esp_err_t pca9685_array_stage_duty(pca9685_array_t *array, size_t first_servo,
+                                   const uint16_t *duty, size_t count);
+
+/**
+ * @brief Stage servo pulses (500-2500 us) for count consecutive servos, which may span controllers.
+ *
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if a pointer is NULL, the range leaves the array or a pulse is
+ *       out of range; controllers before the offending one keep their staged pulses.
+ *     - ESP_ERR_INVALID_STATE if a controller's frequency has not been set.
+ */
+esp_err_t pca9685_array_stage_pulses(pca9685_array_t *array, size_t first_servo,
+                                     const uint16_t *pulse_us, size_t count);
+
+/**
+ * @brief Spread the pulse starts of all servos evenly over the PWM period.
+ *
+ * Servo pulses are short (0.5-2.5 ms of 20 ms), so with every start at count 0 all servos
+ * draw current at once. Here channel ch of controller c starts at
+ * (ch * controllers + c) * 4096 / servos: neighbouring channels of one chip are
+ * 4096 / 16 counts apart, and the chips fill the gaps in between. The PCA9685s run on
+ * their own oscillators, so the offsets between chips drift; the spacing within each chip
+ * holds regardless. Servos with a pulse are re-staged and go out with the next commit.
+ *
+ * @param array Initialized array.
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if array is NULL.
+ */
+esp_err_t pca9685_array_stagger(pca9685_array_t *array);
+
+/**
+ * @brief Send everything staged on the array's controllers.
+ *
+ * Each dirty controller goes out as one burst (a register write per run of dirty
+ * channels, or a single ALL_LED write when all 16 channels get the same value at the same
+ * phase). Bursts are packed per port by pca9685_plan_frame, first-fit by decreasing size
+ * into batches bounded by I2C_BATCH_BUF_SIZE, I2C_BATCH_MAX_SEGMENTS and
+ * I2C_BATCH_MAX_CALLBACKS, which minimizes the number of transactions per frame. Controllers in one batch latch on its STOP; a frame larger
+ * than a batch latches batch by batch, a few milliseconds apart.
+ *
+ * @param array Initialized array.
+ * @return
+ *     - ESP_OK on success, including when nothing was staged.
+ *     - The first error from i2c_batch_submit; the controllers of failed batches stay
+ *       dirty and are retried by the next commit.
+ */
+esp_err_t pca9685_array_commit(pca9685_array_t *array);
+
+/**
+ * @brief Clear array->stats.
+ */
+void pca9685_array_reset_stats(pca9685_array_t *array);
+
+#endif // PCA9685_ARRAY_H
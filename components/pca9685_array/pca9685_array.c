@@ -0,0 +1,146 @@
+#include "pca9685_array.h"
+#include "esp_log.h"
+#include <string.h>
+
+static const char *TAG = "pca9685_array";
+
+esp_err_t pca9685_array_init(pca9685_array_t *array, pca9685_dev_t *const *controllers, size_t count) {
+    if (!array || !controllers || count == 0 || count > PCA9685_ARRAY_MAX_CONTROLLERS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (!controllers[i]) return ESP_ERR_INVALID_ARG;
+        for (size_t j = 0; j < i; j++) {
+            if (controllers[j]->i2c_port == controllers[i]->i2c_port &&
+                controllers[j]->i2c_addr == controllers[i]->i2c_addr) {
+                return ESP_ERR_INVALID_ARG;
+            }
+        }
+    }
+
+    memset(array, 0, sizeof(*array));
+    memcpy(array->controllers, controllers, count * sizeof(controllers[0]));
+    array->num_controllers = count;
+    return ESP_OK;
+}
+
+size_t pca9685_array_size(const pca9685_array_t *array) {
+    return array ? array->num_controllers * PCA9685_CHANNEL_COUNT : 0;
+}
+
+pca9685_dev_t *pca9685_array_locate(const pca9685_array_t *array, size_t servo, pca9685_channel_t *channel) {
+    if (!array || servo >= pca9685_array_size(array)) return NULL;
+    if (channel) *channel = servo % PCA9685_CHANNEL_COUNT;
+    return array->controllers[servo / PCA9685_CHANNEL_COUNT];
+}
+
+static bool range_ok(const pca9685_array_t *array, size_t first_servo, const uint16_t *values, size_t count) {
+    return array && values && count > 0 && first_servo < pca9685_array_size(array) &&
+           count <= pca9685_array_size(array) - first_servo;
+}
+
+esp_err_t pca9685_array_stage_duty(pca9685_array_t *array, size_t first_servo,
+                                   const uint16_t *duty, size_t count) {
+    if (!range_ok(array, first_servo, duty, count)) return ESP_ERR_INVALID_ARG;
+    for (size_t i = 0; i < count; i++) {
+        if (duty[i] > 4095) return ESP_ERR_INVALID_ARG;
+    }
+
+    // One call per controller touched, for the part of the range it holds
+    while (count > 0) {
+        pca9685_channel_t channel;
+        pca9685_dev_t *dev = pca9685_array_locate(array, first_servo, &channel);
+        size_t n = PCA9685_CHANNEL_COUNT - channel;
+        if (n > count) n = count;
+        esp_err_t ret = pca9685_stage_duty_range(dev, channel, duty, n);
+        if (ret != ESP_OK) return ret;
+        first_servo += n;
+        duty += n;
+        count -= n;
+    }
+    return ESP_OK;
+}
+
+esp_err_t pca9685_array_stage_pulses(pca9685_array_t *array, size_t first_servo,
+                                     const uint16_t *pulse_us, size_t count) {
+    if (!range_ok(array, first_servo, pulse_us, count)) return ESP_ERR_INVALID_ARG;
+
+    while (count > 0) {
+        pca9685_channel_t channel;
+        pca9685_dev_t *dev = pca9685_array_locate(array, first_servo, &channel);
+        size_t n = PCA9685_CHANNEL_COUNT - channel;
+        if (n > count) n = count;
+        esp_err_t ret = pca9685_stage_servo_pulses(dev, channel, pulse_us, n);
+        if (ret != ESP_OK) return ret;
+        first_servo += n;
+        pulse_us += n;
+        count -= n;
+    }
+    return ESP_OK;
+}
+
+esp_err_t pca9685_array_stagger(pca9685_array_t *array) {
+    if (!array) return ESP_ERR_INVALID_ARG;
+
+    uint32_t servos = pca9685_array_size(array);
+    for (size_t c = 0; c < array->num_controllers; c++) {
+        for (int ch = 0; ch < PCA9685_CHANNEL_COUNT; ch++) {
+            uint32_t slot = ch * array->num_controllers + c;
+            pca9685_stage_phase(array->controllers[c], ch, slot * 4096 / servos);
+        }
+    }
+    return ESP_OK;
+}
+
+// Sends the dirty controllers of one port; returns the first submit error
+static esp_err_t commit_port(pca9685_array_t *array, i2c_port_t port) {
+    pca9685_dev_t *devs[PCA9685_ARRAY_MAX_CONTROLLERS];
+    size_t count = 0;
+    for (size_t i = 0; i < array->num_controllers; i++) {
+        if (array->controllers[i]->i2c_port == port) devs[count++] = array->controllers[i];
+    }
+    uint8_t batch_of[PCA9685_ARRAY_MAX_CONTROLLERS];
+    size_t num_batches = pca9685_plan_frame(devs, count, batch_of);
+
+    esp_err_t first_err = ESP_OK;
+    for (size_t b = 0; b < num_batches; b++) {
+        i2c_batch_begin(&array->batch);
+        uint32_t bursts = 0, bytes = 0;
+        esp_err_t ret = ESP_OK;
+        for (size_t i = 0; i < count && ret == ESP_OK; i++) {
+            if (batch_of[i] != b) continue;
+            bytes += pca9685_queue_size(devs[i], NULL);
+            bursts++;
+            ret = pca9685_queue(devs[i], &array->batch);
+        }
+        esp_err_t sent = i2c_batch_submit(&array->batch, port, pdMS_TO_TICKS(100));
+        if (ret == ESP_OK) ret = sent;
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Port %d batch %u/%u failed: %s", port, (unsigned)(b + 1),
+                     (unsigned)num_batches, esp_err_to_name(ret));
+            if (first_err == ESP_OK) first_err = ret;
+            continue;
+        }
+        array->stats.batches++;
+        array->stats.bursts += bursts;
+        array->stats.bytes += bytes;
+    }
+    return first_err;
+}
+
+esp_err_t pca9685_array_commit(pca9685_array_t *array) {
+    if (!array) return ESP_ERR_INVALID_ARG;
+
+    uint32_t batches = array->stats.batches;
+    esp_err_t first_err = ESP_OK;
+    for (i2c_port_t port = 0; port < I2C_NUM_MAX; port++) {
+        esp_err_t ret = commit_port(array, port);
+        if (ret != ESP_OK && first_err == ESP_OK) first_err = ret;
+    }
+    if (array->stats.batches != batches) array->stats.frames++;
+    return first_err;
+}
+
+void pca9685_array_reset_stats(pca9685_array_t *array) {
+    if (array) memset(&array->stats, 0, sizeof(array->stats));
+}
@@ -0,0 +1,140 @@
+#ifndef RTC_TICK_H
+#define RTC_TICK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "driver/gpio.h"
+#include "ds1307.h"
+#include "i2c_bus.h"
+
+/*
+ * Second ticks from the DS1307 SQW/OUT pin.
+ *
+ * Set to 1 Hz, SQW/OUT falls each time the seconds register advances. A falling-edge
+ * interrupt on that pin wakes rtc_tick_wait right on the second, and the time is counted
+ * on from the edges: the RTC is read at start, on each minute rollover (so the minute the
+ * display shows always comes from the chip) and after an edge failed to come within
+ * RTC_TICK_TIMEOUT_MS. Without the pin (sqw_gpio = GPIO_NUM_NC) every wait sleeps a
+ * second and reads the RTC, as a plain polling loop would.
+ */
+
+#define RTC_TICK_TIMEOUT_MS 1500 /**< Wait for an edge this long before reading the RTC instead */
+
+/**
+ * @brief Tick configuration.
+ */
+typedef struct {
+    i2c_dev_t *rtc;               /**< Initialized DS1307 descriptor */
+    i2c_bus_client_t *bus;        /**< Client whose lock is held around RTC access (may be NULL) */
+    gpio_num_t sqw_gpio;          /**< Input wired to SQW/OUT (open drain, pulled up here),
+                                       GPIO_NUM_NC to poll */
+} rtc_tick_config_t;
+
+/**
+ * @brief Counters, cleared by rtc_tick_reset_stats.
+ */
+typedef struct {
+    uint32_t edges;               /**< SQW edges taken */
+    uint32_t rtc_reads;           /**< Time reads from the RTC */
+    uint32_t timeouts;            /**< Waits without an edge within RTC_TICK_TIMEOUT_MS */
+    uint32_t resyncs;             /**< RTC reads that disagreed with the counted seconds */
+    uint32_t max_latency_us;      /**< Longest time from an edge to rtc_tick_wait returning,
+                                       RTC read included */
+} rtc_tick_stats_t;
+
+/**
+ * @brief Tick state. Treat as opaque.
+ */
+typedef struct {
+    rtc_tick_config_t cfg;
+    SemaphoreHandle_t edge;
+    StaticSemaphore_t edge_buf;
+    volatile uint32_t isr_edges;  /**< Edges counted by the ISR */
+    volatile int64_t edge_us;     /**< esp_timer time of the last edge */
+    uint32_t edges_seen;          /**< isr_edges at the last wait */
+    struct tm time;               /**< Counted time */
+    bool valid;                   /**< time was read or counted from a read */
+    rtc_tick_stats_t stats;
+} rtc_tick_t;
+
+/**
+ * @brief Start the 1 Hz square wave and attach its interrupt, then read the time once.
+ *
+ * Installs the GPIO ISR service if the application has not. If the square wave or its
+ * interrupt cannot be set up (e.g. the DS1307 does not answer), the error is logged and the
+ * tick polls the RTC as with sqw_gpio = GPIO_NUM_NC; tick->cfg.sqw_gpio shows which.
+ *
+ * @param tick Tick state to initialize; must stay valid while the interrupt is attached.
+ * @param cfg Configuration (copied).
+ * @return
+ *     - ESP_OK on success, also when the SQW setup or the first read failed.
+ *     - ESP_ERR_INVALID_ARG if a pointer is NULL.
+ */
+esp_err_t rtc_tick_init(rtc_tick_t *tick, const rtc_tick_config_t *cfg);
+
+/**
+ * @brief Wait for the next second and get the time.
+ *
+ * Returns on the next SQW edge, or after RTC_TICK_TIMEOUT_MS (a second without the pin).
+ * Seconds counted past several edges since the last call are all applied.
+ *
+ * @param tick Initialized tick.
+ * @param time Out: the time; tm_sec is counted, the rest comes from the last RTC read.
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if a pointer is NULL.
+ *     - The error of the RTC read or the bus lock; the next call reads again.
+ */
+esp_err_t rtc_tick_wait(rtc_tick_t *tick, struct tm *time);
+
+/**
+ * @brief Wait for the next SQW edge only, without reading the RTC.
+ *
+ * For callers keeping time elsewhere (e.g. in the system clock) that need the instant the
+ * RTC's second began.
+ *
+ * @param tick Initialized tick with an SQW pin.
+ * @param timeout Ticks to wait.
+ * @param edge_us Out: esp_timer time of the last edge (may be NULL).
+ * @return
+ *     - ESP_OK on an edge.
+ *     - ESP_ERR_INVALID_ARG if tick is NULL.
+ *     - ESP_ERR_INVALID_STATE without an SQW pin.
+ *     - ESP_ERR_TIMEOUT if no edge came within timeout (counted in stats.timeouts).
+ */
+esp_err_t rtc_tick_wait_edge(rtc_tick_t *tick, TickType_t timeout, int64_t *edge_us);
+
+/**
+ * @brief Read the time from the RTC now; counting goes on from it.
+ *
+ * Right after rtc_tick_wait_edge returned, the time read began at that edge.
+ *
+ * @param tick Initialized tick.
+ * @param time Out: the time read.
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if a pointer is NULL.
+ *     - The error of the RTC read or the bus lock.
+ */
+esp_err_t rtc_tick_read(rtc_tick_t *tick, struct tm *time);
+
+/**
+ * @brief Detach the interrupt and stop the square wave (SQW/OUT follows the OUT bit again).
+ *
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if tick is NULL.
+ *     - The error of the bus lock or the control register write.
+ */
+esp_err_t rtc_tick_deinit(rtc_tick_t *tick);
+
+/**
+ * @brief Clear tick->stats.
+ */
+void rtc_tick_reset_stats(rtc_tick_t *tick);
+
+#endif // RTC_TICK_H
@@ -0,0 +1,177 @@
+#include "rtc_tick.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <string.h>
+
+static const char *TAG = "rtc_tick";
+
+static void IRAM_ATTR sqw_isr(void *arg) {
+    rtc_tick_t *tick = arg;
+    tick->edge_us = esp_timer_get_time();
+    tick->isr_edges++;
+    BaseType_t woken = pdFALSE;
+    xSemaphoreGiveFromISR(tick->edge, &woken);
+    if (woken) portYIELD_FROM_ISR();
+}
+
+// i2cdev does its own transactions, so RTC access takes the shared bus lock from here
+static esp_err_t rtc_lock(rtc_tick_t *tick) {
+    return tick->cfg.bus ? i2c_bus_acquire(tick->cfg.bus, pdMS_TO_TICKS(1000)) : ESP_OK;
+}
+
+static void rtc_unlock(rtc_tick_t *tick) {
+    if (tick->cfg.bus) i2c_bus_release(tick->cfg.bus);
+}
+
+static esp_err_t read_time(rtc_tick_t *tick) {
+    esp_err_t ret = rtc_lock(tick);
+    if (ret != ESP_OK) return ret;
+    struct tm now;
+    ret = ds1307_get_time(tick->cfg.rtc, &now);
+    rtc_unlock(tick);
+    tick->stats.rtc_reads++;
+    tick->valid = ret == ESP_OK;
+    if (tick->valid) tick->time = now;
+    return ret;
+}
+
+static esp_err_t set_squarewave(rtc_tick_t *tick, bool enable) {
+    esp_err_t ret = rtc_lock(tick);
+    if (ret != ESP_OK) return ret;
+    ret = ds1307_set_squarewave_freq(tick->cfg.rtc, DS1307_1HZ);
+    if (ret == ESP_OK) ret = ds1307_enable_squarewave(tick->cfg.rtc, enable);
+    rtc_unlock(tick);
+    return ret;
+}
+
+// Square wave on, pin configured and the edge interrupt attached last
+static esp_err_t start_sqw(rtc_tick_t *tick) {
+    esp_err_t ret = set_squarewave(tick, true);
+    if (ret != ESP_OK) return ret;
+    const gpio_config_t io = {
+        .pin_bit_mask = 1ULL << tick->cfg.sqw_gpio,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_ENABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_NEGEDGE,
+    };
+    ret = gpio_config(&io);
+    if (ret != ESP_OK) return ret;
+    // ESP_ERR_INVALID_STATE: the application installed the service already
+    ret = gpio_install_isr_service(0);
+    if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) return ret;
+    return gpio_isr_handler_add(tick->cfg.sqw_gpio, sqw_isr, tick);
+}
+
+esp_err_t rtc_tick_init(rtc_tick_t *tick, const rtc_tick_config_t *cfg) {
+    if (!tick || !cfg || !cfg->rtc) return ESP_ERR_INVALID_ARG;
+
+    memset(tick, 0, sizeof(*tick));
+    tick->cfg = *cfg;
+    tick->edge = xSemaphoreCreateBinaryStatic(&tick->edge_buf);
+
+    if (cfg->sqw_gpio != GPIO_NUM_NC) {
+        esp_err_t ret = start_sqw(tick);
+        if (ret != ESP_OK) {
+            // A missing or unresponsive RTC must not stop the clock: read it once a second
+            ESP_LOGE(TAG, "Cannot start the 1 Hz square wave (%s), polling the RTC instead",
+                     esp_err_to_name(ret));
+            tick->cfg.sqw_gpio = GPIO_NUM_NC;
+        }
+    }
+
+    // Seconds that passed before the read are in it already; one during the read at worst
+    // puts the count a second ahead until the next rollover reads the RTC again
+    esp_err_t ret = read_time(tick);
+    tick->edges_seen = tick->isr_edges;
+    xSemaphoreTake(tick->edge, 0);
+    if (ret != ESP_OK) ESP_LOGW(TAG, "First RTC read failed: %s", esp_err_to_name(ret));
+    return ESP_OK;
+}
+
+// Edges since the last call, at least one; 0 if none came within timeout
+static uint32_t wait_edges(rtc_tick_t *tick, TickType_t timeout) {
+    // An edge landing between the take and reading the count gives the semaphore again
+    // although it is counted already: wait on until a new one comes
+    uint32_t edges = 0;
+    while (edges == 0) {
+        if (xSemaphoreTake(tick->edge, timeout) != pdTRUE) {
+            tick->stats.timeouts++;
+            return 0;
+        }
+        edges = tick->isr_edges - tick->edges_seen;
+    }
+    tick->edges_seen += edges;
+    tick->stats.edges += edges;
+    return edges;
+}
+
+esp_err_t rtc_tick_wait(rtc_tick_t *tick, struct tm *time) {
+    if (!tick || !time) return ESP_ERR_INVALID_ARG;
+
+    if (tick->cfg.sqw_gpio == GPIO_NUM_NC) {
+        vTaskDelay(pdMS_TO_TICKS(1000));
+        esp_err_t ret = read_time(tick);
+        if (ret == ESP_OK) *time = tick->time;
+        return ret;
+    }
+
+    uint32_t edges = wait_edges(tick, pdMS_TO_TICKS(RTC_TICK_TIMEOUT_MS));
+    if (edges == 0) {
+        ESP_LOGW(TAG, "No SQW edge for %d ms, reading the RTC", RTC_TICK_TIMEOUT_MS);
+        esp_err_t ret = read_time(tick);
+        if (ret == ESP_OK) *time = tick->time;
+        return ret;
+    }
+
+    esp_err_t ret = ESP_OK;
+    if (tick->valid && tick->time.tm_sec + edges < 60) {
+        tick->time.tm_sec += edges;
+    } else {
+        // Minute rollover (or nothing to count from): the RTC has the new minute by now
+        int expected_sec = (tick->time.tm_sec + edges) % 60;
+        bool counted = tick->valid;
+        ret = read_time(tick);
+        if (ret == ESP_OK && counted && tick->time.tm_sec != expected_sec) tick->stats.resyncs++;
+    }
+
+    uint32_t latency_us = esp_timer_get_time() - tick->edge_us;
+    if (latency_us > tick->stats.max_latency_us) tick->stats.max_latency_us = latency_us;
+    if (ret == ESP_OK) *time = tick->time;
+    return ret;
+}
+
+esp_err_t rtc_tick_wait_edge(rtc_tick_t *tick, TickType_t timeout, int64_t *edge_us) {
+    if (!tick) return ESP_ERR_INVALID_ARG;
+    if (tick->cfg.sqw_gpio == GPIO_NUM_NC) return ESP_ERR_INVALID_STATE;
+
+    uint32_t edges = wait_edges(tick, timeout);
+    if (edges == 0) return ESP_ERR_TIMEOUT;
+    // Counted on, so rtc_tick_wait can be mixed in
+    if (tick->valid && tick->time.tm_sec + edges < 60) {
+        tick->time.tm_sec += edges;
+    } else {
+        tick->valid = false;
+    }
+    if (edge_us) *edge_us = tick->edge_us;
+    return ESP_OK;
+}
+
+esp_err_t rtc_tick_read(rtc_tick_t *tick, struct tm *time) {
+    if (!tick || !time) return ESP_ERR_INVALID_ARG;
+    esp_err_t ret = read_time(tick);
+    if (ret == ESP_OK) *time = tick->time;
+    return ret;
+}
+
+esp_err_t rtc_tick_deinit(rtc_tick_t *tick) {
+    if (!tick) return ESP_ERR_INVALID_ARG;
+    if (tick->cfg.sqw_gpio == GPIO_NUM_NC) return ESP_OK;
+
+    gpio_isr_handler_remove(tick->cfg.sqw_gpio);
+    return set_squarewave(tick, false);
+}
+
+void rtc_tick_reset_stats(rtc_tick_t *tick) {
+    if (tick) memset(&tick->stats, 0, sizeof(tick->stats));
+}
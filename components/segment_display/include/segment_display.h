@@ -0,0 +1,286 @@
+#ifndef SEGMENT_DISPLAY_H
+#define SEGMENT_DISPLAY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "pca9685.h"
+#include "i2c_batch.h"
+#include "servo_motion.h"
+#include "servo_cal.h"
+
+// Segments lit for each glyph, bit 0 = segment A through bit 6 = G
+#define SEGMENT_GLYPH_0 0x3F // ABCDEF
+#define SEGMENT_GLYPH_1 0x06 // BC
+#define SEGMENT_GLYPH_2 0x5B // ABGED
+#define SEGMENT_GLYPH_3 0x4F // ABGCD
+#define SEGMENT_GLYPH_4 0x66 // FBGC
+#define SEGMENT_GLYPH_5 0x6D // AFGCD
+#define SEGMENT_GLYPH_6 0x7D // AFGECD
+#define SEGMENT_GLYPH_7 0x07 // ABC
+#define SEGMENT_GLYPH_8 0x7F // ABCDEFG
+#define SEGMENT_GLYPH_9 0x6F // ABCDFG
+
+/**
+ * @brief Segments lit for each decimal digit, SEGMENT_GLYPH_0..9 as an array.
+ */
+extern const uint8_t segment_digit_patterns[10];
+
+/*
+ * Compile-time write plans.
+ *
+ * A plan holds, for one digit position, the LEDn_OFF count of each of its 7 channels for
+ * every glyph, computed by the preprocessor from the calibration and the PCA9685
+ * prescale. Showing a digit is then a table lookup staged with
+ * pca9685_stage_duty_range: no per-segment bit tests and no float pulse conversion.
+ * Define one plan per position of the configured layout, e.g.
+ *
+ *   static const segment_plan_digit_t plan[] = {
+ *       SEGMENT_PLAN_DIGIT(PCA9685_CHANNEL_0, 660, 1500, SEGMENT_PLAN_PRESCALE(50)),
+ *       SEGMENT_PLAN_DIGIT(PCA9685_CHANNEL_7, 660, 1500, SEGMENT_PLAN_PRESCALE(50)),
+ *   };
+ *
+ * Pulse widths must be in the 500-2500 us range accepted by the servo calls.
+ */
+
+/** PRE_SCALE pca9685_set_frequency writes for freq_hz: round(25 MHz / (4096 * freq_hz)) - 1 */
+#define SEGMENT_PLAN_PRESCALE(freq_hz) \
+    ((25000000u + 2048u * (freq_hz)) / (4096u * (freq_hz)) - 1u)
+
+/** Counts of a pulse at a prescale: one count is (prescale + 1) * 40 ns */
+#define SEGMENT_PLAN_DUTY(pulse_us, prescale) \
+    ((uint16_t)((uint32_t)(pulse_us) * 25u / ((prescale) + 1u)))
+
+#define SEGMENT_PLAN_SEG(glyph, seg, pulse_0deg, pulse_90deg, prescale) \
+    SEGMENT_PLAN_DUTY((((glyph) >> (seg)) & 1) ? (pulse_90deg) : (pulse_0deg), prescale)
+
+#define SEGMENT_PLAN_GLYPH(glyph, p0, p90, ps) {                                        \
+    SEGMENT_PLAN_SEG(glyph, 0, p0, p90, ps), SEGMENT_PLAN_SEG(glyph, 1, p0, p90, ps),   \
+    SEGMENT_PLAN_SEG(glyph, 2, p0, p90, ps), SEGMENT_PLAN_SEG(glyph, 3, p0, p90, ps),   \
+    SEGMENT_PLAN_SEG(glyph, 4, p0, p90, ps), SEGMENT_PLAN_SEG(glyph, 5, p0, p90, ps),   \
+    SEGMENT_PLAN_SEG(glyph, 6, p0, p90, ps) }
+
+/** Initializer for a segment_plan_digit_t */
+#define SEGMENT_PLAN_DIGIT(first_channel, pulse_0deg, pulse_90deg, prescale) {          \
+    (first_channel), (prescale), {                                                      \
+        SEGMENT_PLAN_GLYPH(SEGMENT_GLYPH_0, pulse_0deg, pulse_90deg, prescale),         \
+        SEGMENT_PLAN_GLYPH(SEGMENT_GLYPH_1, pulse_0deg, pulse_90deg, prescale),         \
+        SEGMENT_PLAN_GLYPH(SEGMENT_GLYPH_2, pulse_0deg, pulse_90deg, prescale),         \
+        SEGMENT_PLAN_GLYPH(SEGMENT_GLYPH_3, pulse_0deg, pulse_90deg, prescale),         \
+        SEGMENT_PLAN_GLYPH(SEGMENT_GLYPH_4, pulse_0deg, pulse_90deg, prescale),         \
+        SEGMENT_PLAN_GLYPH(SEGMENT_GLYPH_5, pulse_0deg, pulse_90deg, prescale),         \
+        SEGMENT_PLAN_GLYPH(SEGMENT_GLYPH_6, pulse_0deg, pulse_90deg, prescale),         \
+        SEGMENT_PLAN_GLYPH(SEGMENT_GLYPH_7, pulse_0deg, pulse_90deg, prescale),         \
+        SEGMENT_PLAN_GLYPH(SEGMENT_GLYPH_8, pulse_0deg, pulse_90deg, prescale),         \
+        SEGMENT_PLAN_GLYPH(SEGMENT_GLYPH_9, pulse_0deg, pulse_90deg, prescale) } }
+
+/**
+ * @brief Precomputed channel counts of one digit position.
+ */
+typedef struct {
+    pca9685_channel_t first_channel; /**< Channel of segment A; B-G follow */
+    uint8_t prescale;                /**< PRE_SCALE the counts were computed for */
+    uint16_t duty[10][7];            /**< LEDn_OFF count per glyph and segment */
+} segment_plan_digit_t;
+
+/**
+ * @brief Stage a digit on 7 consecutive servo channels, segment A first.
+ *
+ * Lit segments get pulse_90deg, the others pulse_0deg. Nothing moves until the
+ * controller is committed (pca9685_commit, pca9685_commit_frame or pca9685_queue).
+ *
+ * @param pca PCA9685 driving the digit.
+ * @param first_channel Channel of segment A; segments B-G follow.
+ * @param digit Digit to show (taken modulo 10).
+ * @param pulse_0deg Pulse width in microseconds of a segment that is off.
+ * @param pulse_90deg Pulse width in microseconds of a segment that is on.
+ * @return
+ *     - ESP_OK on success.
+ *     - Errors from pca9685_stage_servo_pulses.
+ */
+esp_err_t segment_set_digit(pca9685_dev_t *pca, pca9685_channel_t first_channel, uint8_t digit,
+                            uint16_t pulse_0deg, uint16_t pulse_90deg);
+
+/**
+ * @brief Stage a digit from its precomputed plan.
+ *
+ * Same effect as segment_set_digit with the plan's calibration. Unchanged segments are
+ * still suppressed by the driver's shadow, and nothing moves until the controller is
+ * committed.
+ *
+ * @param pca PCA9685 driving the digit.
+ * @param plan Plan of the digit position.
+ * @param digit Digit to show (taken modulo 10).
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if pca or plan is NULL.
+ *     - ESP_ERR_INVALID_STATE if the controller runs at another prescale than the plan's.
+ */
+esp_err_t segment_plan_stage(pca9685_dev_t *pca, const segment_plan_digit_t *plan, uint8_t digit);
+
+/*
+ * Display engine.
+ *
+ * A segment_display_t drives any number of seven-segment digits (plus on/off colon
+ * segments) spread over a list of PCA9685s, with an arbitrary channel per segment. It
+ * keeps the segments it last showed, so setting a digit only stages the segments that
+ * change; refresh cost follows the number of moving segments, not the number of digits.
+ */
+
+#define SEGMENT_DISPLAY_MAX_DIGITS      16
+#define SEGMENT_DISPLAY_MAX_COLONS      8
+#define SEGMENT_DISPLAY_MAX_CONTROLLERS 16
+
+/**
+ * @brief One servo: a channel on one of the display's controllers.
+ */
+typedef struct {
+    uint8_t controller;         /**< Index into segment_display_config_t.controllers */
+    pca9685_channel_t channel;  /**< Channel on that controller */
+} segment_channel_t;
+
+/** Channels of segments A-G of a digit wired to 7 consecutive channels of one controller */
+#define SEGMENT_DIGIT_CHANNELS(controller, first_channel) {                            \
+    {(controller), (first_channel)},     {(controller), (first_channel) + 1},           \
+    {(controller), (first_channel) + 2}, {(controller), (first_channel) + 3},           \
+    {(controller), (first_channel) + 4}, {(controller), (first_channel) + 5},           \
+    {(controller), (first_channel) + 6} }
+
+/**
+ * @brief Layout and calibration of a display. The arrays must outlive the display.
+ */
+typedef struct {
+    pca9685_dev_t *const *controllers;  /**< Initialized PCA9685s, frequency already set */
+    size_t num_controllers;
+    const segment_channel_t (*digits)[7]; /**< Per digit, left to right: segments A-G */
+    size_t num_digits;
+    const segment_channel_t *colons;    /**< On/off segments such as the colons of HH:MM:SS */
+    size_t num_colons;
+    uint16_t pulse_off_us;              /**< Pulse of a segment that is off (500-2500 us) */
+    uint16_t pulse_on_us;               /**< Pulse of a segment that is on (500-2500 us) */
+    const servo_cal_t *cal;             /**< Optional per-servo pulses, by controller index; the
+                                             channels it does not calibrate take the two above */
+    servo_motion_t *motion;             /**< Optional: ease segment moves through this engine,
+                                             which must own every controller of the display */
+} segment_display_config_t;
+
+/**
+ * @brief What a display shows, e.g. to keep across a reset.
+ */
+typedef struct {
+    uint8_t num_digits;
+    uint8_t num_colons;
+    uint8_t segments[SEGMENT_DISPLAY_MAX_DIGITS];  /**< Lit segments per digit */
+    uint8_t colons;                                /**< Bit n: colon n on */
+} segment_display_frame_t;
+
+/**
+ * @brief Display state. Treat as opaque.
+ */
+typedef struct {
+    segment_display_config_t cfg;
+    uint8_t segments[SEGMENT_DISPLAY_MAX_DIGITS];  /**< Lit segments as last staged */
+    uint16_t digits_unknown;                       /**< Digits whose servos may be anywhere */
+    uint8_t colons;                                /**< Bit n: colon n on */
+    uint8_t colons_unknown;
+    uint16_t duty_off[SEGMENT_DISPLAY_MAX_CONTROLLERS]; /**< Counts per controller prescale */
+    uint16_t duty_on[SEGMENT_DISPLAY_MAX_CONTROLLERS];
+    uint32_t segments_staged;                      /**< Segment moves staged since init */
+} segment_display_t;
+
+/**
+ * @brief Set up a display. Nothing is sent; the first update writes every segment.
+ *
+ * @param disp Display state to initialize.
+ * @param cfg Layout and calibration (copied; the arrays it points to are not).
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG on a NULL pointer, too many digits/colons/controllers,
+ *       a controller index or channel out of range, or pulses outside 500-2500 us.
+ *     - ESP_ERR_INVALID_STATE if a controller's frequency has not been set.
+ */
+esp_err_t segment_display_init(segment_display_t *disp, const segment_display_config_t *cfg);
+
+/**
+ * @brief Stage a digit (0-9) at a position, 0 being the leftmost.
+ *
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if the position does not exist.
+ *     - Errors from pca9685_stage_duty_range.
+ */
+esp_err_t segment_display_set_digit(segment_display_t *disp, size_t position, uint8_t digit);
+
+/**
+ * @brief Stage raw segments at a position, bit 0 = A through bit 6 = G (0 blanks it).
+ *
+ * @return See segment_display_set_digit.
+ */
+esp_err_t segment_display_set_segments(segment_display_t *disp, size_t position, uint8_t segments);
+
+/**
+ * @brief Stage a colon segment on or off.
+ *
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if the colon does not exist.
+ *     - Errors from pca9685_stage_duty_range.
+ */
+esp_err_t segment_display_set_colon(segment_display_t *disp, size_t colon, bool on);
+
+/**
+ * @brief Get the frame last staged.
+ *
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if a pointer is NULL.
+ *     - ESP_ERR_INVALID_STATE if a digit or colon has not been set since init or invalidate.
+ */
+esp_err_t segment_display_get_frame(const segment_display_t *disp, segment_display_frame_t *frame);
+
+/**
+ * @brief Take the servos as standing at a frame already, e.g. the one saved before a reset.
+ *
+ * Every segment's pulse is staged without a move (servo_motion_place with an engine) and
+ * the display continues from the frame: the next update only moves what differs. The
+ * pulses go out with the next commit or engine tick; servos that were there do not move.
+ *
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if a pointer is NULL or the frame has another number of digits
+ *       or colons.
+ *     - Errors from servo_motion_place or pca9685_stage_duty_range.
+ */
+esp_err_t segment_display_restore(segment_display_t *disp, const segment_display_frame_t *frame);
+
+/**
+ * @brief Queue the staged changes of every controller on a port into a batch.
+ *
+ * Used when the application submits batches itself (e.g. through i2c_exec); the
+ * controllers latch together on the batch's STOP. Not used with a motion engine, whose
+ * tick sends the segments.
+ *
+ * @return
+ *     - ESP_OK on success, including when nothing changed.
+ *     - Errors from pca9685_queue.
+ */
+esp_err_t segment_display_queue(segment_display_t *disp, i2c_port_t port, i2c_batch_t *batch);
+
+/**
+ * @brief Send the staged changes now: one pca9685_commit_frame per port in use.
+ *        Not used with a motion engine, whose tick sends the segments.
+ *
+ * @return
+ *     - ESP_OK on success, including when nothing changed.
+ *     - The first error from pca9685_commit_frame.
+ */
+esp_err_t segment_display_commit(segment_display_t *disp);
+
+/**
+ * @brief Forget what is shown, e.g. after a controller was re-initialized. The next
+ *        update of each digit and colon writes all of its segments.
+ */
+void segment_display_invalidate(segment_display_t *disp);
+
+#endif // SEGMENT_DISPLAY_H
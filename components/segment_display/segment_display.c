@@ -0,0 +1,193 @@
+#include "segment_display.h"
+#include <string.h>
+
+const uint8_t segment_digit_patterns[10] = {
+    SEGMENT_GLYPH_0, SEGMENT_GLYPH_1, SEGMENT_GLYPH_2, SEGMENT_GLYPH_3, SEGMENT_GLYPH_4,
+    SEGMENT_GLYPH_5, SEGMENT_GLYPH_6, SEGMENT_GLYPH_7, SEGMENT_GLYPH_8, SEGMENT_GLYPH_9
+};
+
+esp_err_t segment_set_digit(pca9685_dev_t *pca, pca9685_channel_t first_channel, uint8_t digit,
+                            uint16_t pulse_0deg, uint16_t pulse_90deg) {
+    uint8_t pattern = segment_digit_patterns[digit % 10];
+    uint16_t pulses[7];
+    for (int seg = 0; seg < 7; seg++) {
+        pulses[seg] = (pattern & (1 << seg)) ? pulse_90deg : pulse_0deg;
+    }
+    return pca9685_stage_servo_pulses(pca, first_channel, pulses, 7);
+}
+
+esp_err_t segment_plan_stage(pca9685_dev_t *pca, const segment_plan_digit_t *plan, uint8_t digit) {
+    if (!pca || !plan) return ESP_ERR_INVALID_ARG;
+    // The counts are only right for the prescale they were computed for
+    if (pca->prescale != plan->prescale) return ESP_ERR_INVALID_STATE;
+    return pca9685_stage_duty_range(pca, plan->first_channel, plan->duty[digit % 10], 7);
+}
+
+esp_err_t segment_display_init(segment_display_t *disp, const segment_display_config_t *cfg) {
+    if (!disp || !cfg || !cfg->controllers || (cfg->num_digits && !cfg->digits) ||
+        (cfg->num_colons && !cfg->colons) || cfg->num_controllers == 0 ||
+        cfg->num_controllers > SEGMENT_DISPLAY_MAX_CONTROLLERS ||
+        cfg->num_digits > SEGMENT_DISPLAY_MAX_DIGITS || cfg->num_colons > SEGMENT_DISPLAY_MAX_COLONS ||
+        cfg->pulse_off_us < 500 || cfg->pulse_off_us > 2500 ||
+        cfg->pulse_on_us < 500 || cfg->pulse_on_us > 2500) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (size_t d = 0; d < cfg->num_digits; d++) {
+        for (int seg = 0; seg < 7; seg++) {
+            const segment_channel_t *ch = &cfg->digits[d][seg];
+            if (ch->controller >= cfg->num_controllers || ch->channel >= PCA9685_CHANNEL_COUNT) {
+                return ESP_ERR_INVALID_ARG;
+            }
+        }
+    }
+    for (size_t c = 0; c < cfg->num_colons; c++) {
+        if (cfg->colons[c].controller >= cfg->num_controllers ||
+            cfg->colons[c].channel >= PCA9685_CHANNEL_COUNT) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+
+    if (cfg->cal && cfg->cal->num_controllers > cfg->num_controllers) return ESP_ERR_INVALID_ARG;
+
+    memset(disp, 0, sizeof(*disp));
+    disp->cfg = *cfg;
+    for (size_t i = 0; i < cfg->num_controllers; i++) {
+        const pca9685_dev_t *pca = cfg->controllers[i];
+        if (!pca) return ESP_ERR_INVALID_ARG;
+        if (pca->prescale == 0) return ESP_ERR_INVALID_STATE;
+        // Same integer conversion as the compile-time plans, done once per controller
+        disp->duty_off[i] = SEGMENT_PLAN_DUTY(cfg->pulse_off_us, pca->prescale);
+        disp->duty_on[i] = SEGMENT_PLAN_DUTY(cfg->pulse_on_us, pca->prescale);
+    }
+    segment_display_invalidate(disp);
+    return ESP_OK;
+}
+
+static uint16_t segment_duty(const segment_display_t *disp, const segment_channel_t *ch, bool on) {
+    const servo_cal_entry_t *cal = servo_cal_get(disp->cfg.cal, ch->controller, ch->channel);
+    if (!cal) return on ? disp->duty_on[ch->controller] : disp->duty_off[ch->controller];
+    uint8_t prescale = disp->cfg.controllers[ch->controller]->prescale;
+    return SEGMENT_PLAN_DUTY(on ? cal->pulse_on_us : cal->pulse_off_us, prescale);
+}
+
+static esp_err_t stage_segment(segment_display_t *disp, const segment_channel_t *ch, bool on) {
+    uint16_t duty = segment_duty(disp, ch, on);
+    pca9685_dev_t *pca = disp->cfg.controllers[ch->controller];
+    esp_err_t ret = disp->cfg.motion ? servo_motion_move(disp->cfg.motion, pca, ch->channel, duty)
+                                     : pca9685_stage_duty_range(pca, ch->channel, &duty, 1);
+    if (ret == ESP_OK) disp->segments_staged++;
+    return ret;
+}
+
+// Pulse of a servo that is at its position already
+static esp_err_t place_segment(segment_display_t *disp, const segment_channel_t *ch, bool on) {
+    uint16_t duty = segment_duty(disp, ch, on);
+    pca9685_dev_t *pca = disp->cfg.controllers[ch->controller];
+    return disp->cfg.motion ? servo_motion_place(disp->cfg.motion, pca, ch->channel, duty)
+                            : pca9685_stage_duty_range(pca, ch->channel, &duty, 1);
+}
+
+esp_err_t segment_display_set_segments(segment_display_t *disp, size_t position, uint8_t segments) {
+    if (!disp || position >= disp->cfg.num_digits) return ESP_ERR_INVALID_ARG;
+
+    segments &= 0x7F;
+    uint8_t changed = (disp->digits_unknown & (1u << position)) ? 0x7F
+                                                                : segments ^ disp->segments[position];
+    for (int seg = 0; changed; seg++, changed >>= 1) {
+        if (!(changed & 1)) continue;
+        esp_err_t ret = stage_segment(disp, &disp->cfg.digits[position][seg], segments & (1u << seg));
+        if (ret != ESP_OK) return ret;
+    }
+    disp->segments[position] = segments;
+    disp->digits_unknown &= ~(1u << position);
+    return ESP_OK;
+}
+
+esp_err_t segment_display_set_digit(segment_display_t *disp, size_t position, uint8_t digit) {
+    return segment_display_set_segments(disp, position, segment_digit_patterns[digit % 10]);
+}
+
+esp_err_t segment_display_set_colon(segment_display_t *disp, size_t colon, bool on) {
+    if (!disp || colon >= disp->cfg.num_colons) return ESP_ERR_INVALID_ARG;
+
+    uint8_t bit = 1u << colon;
+    if (!(disp->colons_unknown & bit) && !!(disp->colons & bit) == on) return ESP_OK;
+    esp_err_t ret = stage_segment(disp, &disp->cfg.colons[colon], on);
+    if (ret != ESP_OK) return ret;
+    disp->colons = on ? (disp->colons | bit) : (disp->colons & ~bit);
+    disp->colons_unknown &= ~bit;
+    return ESP_OK;
+}
+
+esp_err_t segment_display_get_frame(const segment_display_t *disp, segment_display_frame_t *frame) {
+    if (!disp || !frame) return ESP_ERR_INVALID_ARG;
+    if (disp->digits_unknown || disp->colons_unknown) return ESP_ERR_INVALID_STATE;
+
+    memset(frame, 0, sizeof(*frame));
+    frame->num_digits = disp->cfg.num_digits;
+    frame->num_colons = disp->cfg.num_colons;
+    memcpy(frame->segments, disp->segments, disp->cfg.num_digits);
+    frame->colons = disp->colons;
+    return ESP_OK;
+}
+
+esp_err_t segment_display_restore(segment_display_t *disp, const segment_display_frame_t *frame) {
+    if (!disp || !frame || frame->num_digits != disp->cfg.num_digits ||
+        frame->num_colons != disp->cfg.num_colons) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    for (size_t d = 0; d < disp->cfg.num_digits; d++) {
+        uint8_t segments = frame->segments[d] & 0x7F;
+        for (int seg = 0; seg < 7; seg++) {
+            esp_err_t ret = place_segment(disp, &disp->cfg.digits[d][seg], segments & (1u << seg));
+            if (ret != ESP_OK) return ret;
+        }
+        disp->segments[d] = segments;
+        disp->digits_unknown &= ~(1u << d);
+    }
+    for (size_t c = 0; c < disp->cfg.num_colons; c++) {
+        esp_err_t ret = place_segment(disp, &disp->cfg.colons[c], frame->colons & (1u << c));
+        if (ret != ESP_OK) return ret;
+    }
+    disp->colons = frame->colons & ((1u << disp->cfg.num_colons) - 1);
+    disp->colons_unknown = 0;
+    return ESP_OK;
+}
+
+esp_err_t segment_display_queue(segment_display_t *disp, i2c_port_t port, i2c_batch_t *batch) {
+    if (!disp || !batch) return ESP_ERR_INVALID_ARG;
+    // The driver's shadow knows what is staged (or left over from a failed batch);
+    // pca9685_queue adds nothing for a controller without changes
+    for (size_t i = 0; i < disp->cfg.num_controllers; i++) {
+        pca9685_dev_t *pca = disp->cfg.controllers[i];
+        if (pca->i2c_port != port) continue;
+        esp_err_t ret = pca9685_queue(pca, batch);
+        if (ret != ESP_OK) return ret;
+    }
+    return ESP_OK;
+}
+
+esp_err_t segment_display_commit(segment_display_t *disp) {
+    if (!disp) return ESP_ERR_INVALID_ARG;
+    esp_err_t first_err = ESP_OK;
+    for (i2c_port_t port = 0; port < I2C_NUM_MAX; port++) {
+        pca9685_dev_t *frame[SEGMENT_DISPLAY_MAX_CONTROLLERS];
+        size_t count = 0;
+        for (size_t i = 0; i < disp->cfg.num_controllers; i++) {
+            pca9685_dev_t *pca = disp->cfg.controllers[i];
+            if (pca->i2c_port == port && (~pca->shadow_valid & 0xFFFF)) frame[count++] = pca;
+        }
+        if (count == 0) continue;
+        // Failed channels stay dirty in the driver's shadow and go out with the next commit
+        esp_err_t ret = pca9685_commit_frame(frame, count);
+        if (ret != ESP_OK && first_err == ESP_OK) first_err = ret;
+    }
+    return first_err;
+}
+
+void segment_display_invalidate(segment_display_t *disp) {
+    if (!disp) return;
+    disp->digits_unknown = (uint16_t)((1u << disp->cfg.num_digits) - 1);
+    disp->colons_unknown = (uint8_t)((1u << disp->cfg.num_colons) - 1);
+}
@@ -0,0 +1,182 @@
+#ifndef SERVO_CAL_H
+#define SERVO_CAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "pca9685.h"
+
+/*
+ * Per-servo calibration table.
+ *
+ * Each channel of each controller (numbered like the display's controller list) gets its
+ * own segment-off and segment-on pulse, so servos that differ need no common compromise,
+ * and the time its swing between them takes. A channel left at 0 has no calibration and
+ * takes the display's global pulses. The table is kept in NVS as one blob with a version
+ * and a CRC-32, and survives a dead RTC battery.
+ *
+ * servo_cal_sweep finds the entries on the hardware. Hobby servos report no position, but
+ * their supply current tells what they do: a servo at rest draws little, one in motion
+ * much more, and one pushing against a mechanical stop the stall current for as long as
+ * the pulse holds it there. The sweep steps the pulse out from mid-travel towards each
+ * endpoint and stops where the current stays up, then times a full swing by the current.
+ */
+
+#ifndef SERVO_CAL_MAX_CONTROLLERS
+#define SERVO_CAL_MAX_CONTROLLERS 4     /**< Sizes the table and its NVS blob */
+#endif
+#define SERVO_CAL_NVS_KEY "servo_cal"
+/** servo_cal_sweep: the peak current must exceed the unpowered one by this many drive_ma */
+#define SERVO_CAL_SWEEP_PEAK_FACTOR 2
+
+/**
+ * @brief Calibration of one servo.
+ */
+typedef struct {
+    uint16_t pulse_off_us;  /**< Segment hidden (0 degrees), 500-2500 us; 0 = not calibrated */
+    uint16_t pulse_on_us;   /**< Segment shown (90 degrees), 500-2500 us */
+    uint16_t travel_ms;     /**< Measured swing between the two, 0 = not measured */
+} servo_cal_entry_t;
+
+/**
+ * @brief Calibration of every servo of up to SERVO_CAL_MAX_CONTROLLERS controllers.
+ */
+typedef struct {
+    uint8_t num_controllers;
+    servo_cal_entry_t entries[SERVO_CAL_MAX_CONTROLLERS][PCA9685_CHANNEL_COUNT];
+} servo_cal_t;
+
+/**
+ * @brief Start a table with the same pulses on every channel (0 and 0 for none).
+ *
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if cal is NULL, num_controllers exceeds SERVO_CAL_MAX_CONTROLLERS
+ *       or a pulse is outside 500-2500 us.
+ */
+esp_err_t servo_cal_init(servo_cal_t *cal, size_t num_controllers, uint16_t pulse_off_us, uint16_t pulse_on_us);
+
+/**
+ * @brief Set the pulses of one servo; a measured travel time is kept.
+ *
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if cal is NULL, the controller or channel is outside the table
+ *       or a pulse is outside 500-2500 us.
+ */
+esp_err_t servo_cal_set(servo_cal_t *cal, size_t controller, pca9685_channel_t channel,
+                        uint16_t pulse_off_us, uint16_t pulse_on_us);
+
+/**
+ * @brief Set the measured swing time of a calibrated servo.
+ *
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if cal is NULL or the controller or channel is outside the table.
+ *     - ESP_ERR_INVALID_STATE if the servo has no pulses set.
+ */
+esp_err_t servo_cal_set_travel(servo_cal_t *cal, size_t controller, pca9685_channel_t channel, uint16_t travel_ms);
+
+/**
+ * @brief Calibration of one servo.
+ *
+ * @return The entry, or NULL if cal is NULL, the servo is outside the table or not calibrated.
+ */
+const servo_cal_entry_t *servo_cal_get(const servo_cal_t *cal, size_t controller, pca9685_channel_t channel);
+
+/**
+ * @brief Load the table saved under an NVS namespace. nvs_flash_init must have run.
+ *
+ * @param cal Out: the table; left untouched unless ESP_OK is returned.
+ * @param nvs_namespace NVS namespace, e.g. the application's.
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if a pointer is NULL.
+ *     - ESP_ERR_NOT_FOUND if no table was saved.
+ *     - ESP_ERR_INVALID_VERSION if the blob has another size or format version.
+ *     - ESP_ERR_INVALID_CRC if the checksum or a pulse does not check out.
+ *     - Other errors from nvs_open and nvs_get_blob.
+ */
+esp_err_t servo_cal_load(servo_cal_t *cal, const char *nvs_namespace);
+
+/**
+ * @brief Save the table under an NVS namespace, committed before returning.
+ *
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if a pointer is NULL.
+ *     - Errors from nvs_open, nvs_set_blob and nvs_commit.
+ */
+esp_err_t servo_cal_save(const servo_cal_t *cal, const char *nvs_namespace);
+
+/**
+ * @brief Reads the current drawn by the servo supply.
+ *
+ * @param ctx Context given in the sweep configuration.
+ * @param current_ma Out: current in mA. Only differences are used, so an uncalibrated
+ *                   offset does no harm.
+ */
+typedef esp_err_t (*servo_cal_sense_fn_t)(void *ctx, uint32_t *current_ma);
+
+/**
+ * @brief How servo_cal_sweep looks for the endpoints.
+ */
+typedef struct {
+    servo_cal_sense_fn_t sense;  /**< Supply current of the servo swept */
+    void *sense_ctx;
+    uint16_t pulse_off_us;       /**< Nominal endpoints, e.g. the display's global pulses */
+    uint16_t pulse_on_us;
+    uint16_t search_us;          /**< How far past a nominal endpoint a stop is looked for */
+    uint16_t step_us;            /**< Pulse step of the sweep */
+    uint16_t step_ms;            /**< Wait after each step before the current is read */
+    uint32_t drive_ma;           /**< Current above the resting one that means the servo drives */
+    uint16_t margin_us;          /**< Kept off a stop found */
+    uint16_t timeout_ms;         /**< Longest swing accepted */
+} servo_cal_sweep_config_t;
+
+/**
+ * @brief What servo_cal_sweep found.
+ */
+typedef struct {
+    uint16_t pulse_off_us;       /**< Endpoints to calibrate with */
+    uint16_t pulse_on_us;
+    uint16_t travel_ms;          /**< Slower direction of the swing between them */
+    bool stop_off;               /**< A stop set the off endpoint (else the nominal stands) */
+    bool stop_on;
+    uint32_t rest_ma;            /**< Current with the servo holding at mid-travel */
+    uint32_t idle_ma;            /**< Current with the channel unpowered */
+    uint32_t peak_ma;            /**< Highest current read during the sweep */
+} servo_cal_sweep_result_t;
+
+/**
+ * @brief Find the endpoints and swing time of one servo.
+ *
+ * The servo is centred between the nominal endpoints, then the pulse is stepped from there
+ * towards each one and up to search_us past it. Where the current stays drive_ma above the
+ * resting current for two reads in a row the servo is held by a stop, and the endpoint is
+ * taken margin_us back from there; with no stop in reach the nominal endpoint stands. A
+ * nominal endpoint beyond a stop (a servo stalling at rest) is thereby pulled in as well.
+ * Last, the swing is timed both ways from the command until the current falls back.
+ * A sweep whose current never rose SERVO_CAL_SWEEP_PEAK_FACTOR * drive_ma above the
+ * unpowered current is refused: a floating or miswired sense input, not a servo.
+ *
+ * Any other servo on the supply adds to the current and should be unpowered meanwhile.
+ * The channel is left without a pulse. Takes a few seconds per servo.
+ *
+ * @param dev Controller of the servo, frequency set.
+ * @param channel Channel of the servo.
+ * @param cfg Sweep configuration.
+ * @param result Out: the endpoints and swing time.
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if a pointer is NULL, a pulse is out of range or a step is 0.
+ *     - ESP_ERR_NOT_FOUND if the current never rose on a swing: no servo on the channel.
+ *     - ESP_ERR_TIMEOUT if a swing did not end within timeout_ms.
+ *     - ESP_ERR_INVALID_RESPONSE if the current never rose clearly above the unpowered one.
+ *     - Errors from the driver or the sense callback.
+ */
+esp_err_t servo_cal_sweep(pca9685_dev_t *dev, pca9685_channel_t channel, const servo_cal_sweep_config_t *cfg,
+                          servo_cal_sweep_result_t *result);
+
+#endif // SERVO_CAL_H
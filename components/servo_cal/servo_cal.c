@@ -0,0 +1,286 @@
+#include "servo_cal.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "nvs.h"
+#include <string.h>
+
+static const char *TAG = "servo_cal";
+
+#define CAL_MAGIC   0x5343 // "CS"
+#define CAL_VERSION 2 // 2: travel_ms added
+
+// NVS blob: the table framed by a header and a checksum over both
+typedef struct {
+    uint16_t magic;
+    uint8_t version;
+    uint8_t reserved;
+    servo_cal_t cal;
+    uint32_t crc;
+} cal_record_t;
+
+static bool pulse_ok(uint16_t pulse_us) {
+    return pulse_us >= 500 && pulse_us <= 2500;
+}
+
+static bool entry_ok(const servo_cal_entry_t *entry) {
+    return (entry->pulse_off_us == 0 && entry->pulse_on_us == 0) ||
+           (pulse_ok(entry->pulse_off_us) && pulse_ok(entry->pulse_on_us));
+}
+
+// CRC-32 (IEEE 802.3, reflected), bitwise: the blob is read once per boot
+static uint32_t crc32(const void *data, size_t len) {
+    const uint8_t *p = data;
+    uint32_t crc = 0xFFFFFFFF;
+    while (len--) {
+        crc ^= *p++;
+        for (int bit = 0; bit < 8; bit++) crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+    }
+    return ~crc;
+}
+
+esp_err_t servo_cal_init(servo_cal_t *cal, size_t num_controllers, uint16_t pulse_off_us, uint16_t pulse_on_us) {
+    const servo_cal_entry_t entry = {pulse_off_us, pulse_on_us, 0};
+    if (!cal || num_controllers > SERVO_CAL_MAX_CONTROLLERS || !entry_ok(&entry)) return ESP_ERR_INVALID_ARG;
+
+    memset(cal, 0, sizeof(*cal));
+    cal->num_controllers = num_controllers;
+    for (size_t c = 0; c < num_controllers; c++) {
+        for (int ch = 0; ch < PCA9685_CHANNEL_COUNT; ch++) cal->entries[c][ch] = entry;
+    }
+    return ESP_OK;
+}
+
+esp_err_t servo_cal_set(servo_cal_t *cal, size_t controller, pca9685_channel_t channel,
+                        uint16_t pulse_off_us, uint16_t pulse_on_us) {
+    servo_cal_entry_t entry = {pulse_off_us, pulse_on_us, 0};
+    if (!cal || controller >= cal->num_controllers || channel >= PCA9685_CHANNEL_COUNT || !entry_ok(&entry)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (pulse_off_us) entry.travel_ms = cal->entries[controller][channel].travel_ms;
+    cal->entries[controller][channel] = entry;
+    return ESP_OK;
+}
+
+esp_err_t servo_cal_set_travel(servo_cal_t *cal, size_t controller, pca9685_channel_t channel, uint16_t travel_ms) {
+    if (!cal || controller >= cal->num_controllers || channel >= PCA9685_CHANNEL_COUNT) return ESP_ERR_INVALID_ARG;
+    servo_cal_entry_t *entry = &cal->entries[controller][channel];
+    if (!entry->pulse_off_us) return ESP_ERR_INVALID_STATE;
+    entry->travel_ms = travel_ms;
+    return ESP_OK;
+}
+
+const servo_cal_entry_t *servo_cal_get(const servo_cal_t *cal, size_t controller, pca9685_channel_t channel) {
+    if (!cal || controller >= cal->num_controllers || channel >= PCA9685_CHANNEL_COUNT) return NULL;
+    const servo_cal_entry_t *entry = &cal->entries[controller][channel];
+    return entry->pulse_off_us ? entry : NULL;
+}
+
+esp_err_t servo_cal_load(servo_cal_t *cal, const char *nvs_namespace) {
+    if (!cal || !nvs_namespace) return ESP_ERR_INVALID_ARG;
+
+    nvs_handle_t nvs;
+    esp_err_t ret = nvs_open(nvs_namespace, NVS_READONLY, &nvs);
+    if (ret == ESP_ERR_NVS_NOT_FOUND) return ESP_ERR_NOT_FOUND; // namespace never written
+    if (ret != ESP_OK) return ret;
+    cal_record_t record;
+    size_t len = sizeof(record);
+    ret = nvs_get_blob(nvs, SERVO_CAL_NVS_KEY, &record, &len);
+    nvs_close(nvs);
+    if (ret == ESP_ERR_NVS_NOT_FOUND) return ESP_ERR_NOT_FOUND;
+    // A blob of another size is another layout: too long does not fit the buffer
+    if (ret == ESP_ERR_NVS_INVALID_LENGTH) return ESP_ERR_INVALID_VERSION;
+    if (ret != ESP_OK) return ret;
+    if (len != sizeof(record) || record.magic != CAL_MAGIC || record.version != CAL_VERSION) {
+        return ESP_ERR_INVALID_VERSION;
+    }
+
+    if (crc32(&record, offsetof(cal_record_t, crc)) != record.crc ||
+        record.cal.num_controllers > SERVO_CAL_MAX_CONTROLLERS) {
+        ESP_LOGW(TAG, "Stored calibration is corrupt");
+        return ESP_ERR_INVALID_CRC;
+    }
+    for (size_t c = 0; c < record.cal.num_controllers; c++) {
+        for (int ch = 0; ch < PCA9685_CHANNEL_COUNT; ch++) {
+            if (!entry_ok(&record.cal.entries[c][ch])) return ESP_ERR_INVALID_CRC;
+        }
+    }
+    *cal = record.cal;
+    return ESP_OK;
+}
+
+esp_err_t servo_cal_save(const servo_cal_t *cal, const char *nvs_namespace) {
+    if (!cal || !nvs_namespace) return ESP_ERR_INVALID_ARG;
+
+    cal_record_t record;
+    memset(&record, 0, sizeof(record)); // padding too, it is covered by the CRC
+    record.magic = CAL_MAGIC;
+    record.version = CAL_VERSION;
+    record.cal = *cal;
+    record.crc = crc32(&record, offsetof(cal_record_t, crc));
+
+    nvs_handle_t nvs;
+    esp_err_t ret = nvs_open(nvs_namespace, NVS_READWRITE, &nvs);
+    if (ret != ESP_OK) return ret;
+    ret = nvs_set_blob(nvs, SERVO_CAL_NVS_KEY, &record, sizeof(record));
+    if (ret == ESP_OK) ret = nvs_commit(nvs);
+    nvs_close(nvs);
+    if (ret == ESP_OK) ESP_LOGI(TAG, "Calibration of %u controller(s) saved", cal->num_controllers);
+    return ret;
+}
+
+#define SWEEP_POLL_MS 5 // swing timing resolution
+
+static void sweep_wait(uint32_t ms) {
+    vTaskDelay(ms ? (ms + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS : 0);
+}
+
+// Commands pulse_us and times the swing there: from the command until the current, having
+// risen above the drive threshold, falls back below half of it
+static esp_err_t sweep_travel(pca9685_dev_t *dev, pca9685_channel_t channel, const servo_cal_sweep_config_t *cfg,
+                              uint32_t rest_ma, uint16_t pulse_us, uint16_t *travel_ms) {
+    esp_err_t ret = pca9685_set_servo_pulse(dev, channel, pulse_us);
+    if (ret != ESP_OK) return ret;
+    int64_t start = esp_timer_get_time();
+    int64_t deadline = start + (int64_t)cfg->timeout_ms * 1000;
+    bool driven = false;
+    while (esp_timer_get_time() < deadline) {
+        sweep_wait(SWEEP_POLL_MS);
+        uint32_t ma;
+        ret = cfg->sense(cfg->sense_ctx, &ma);
+        if (ret != ESP_OK) return ret;
+        if (ma > rest_ma + cfg->drive_ma) {
+            driven = true;
+        } else if (driven && ma < rest_ma + cfg->drive_ma / 2) {
+            *travel_ms = (esp_timer_get_time() - start) / 1000;
+            return ESP_OK;
+        }
+    }
+    return driven ? ESP_ERR_TIMEOUT : ESP_ERR_NOT_FOUND;
+}
+
+// Steps from mid_us towards nominal_us and search_us past it. Returns the endpoint to use
+// and whether a stop set it.
+static esp_err_t sweep_endpoint(pca9685_dev_t *dev, pca9685_channel_t channel, const servo_cal_sweep_config_t *cfg,
+                                uint32_t rest_ma, uint16_t mid_us, uint16_t nominal_us, uint16_t *endpoint_us,
+                                bool *stop) {
+    int dir = nominal_us > mid_us ? 1 : -1;
+    int limit = nominal_us + dir * cfg->search_us;
+    if (limit < 500) limit = 500;
+    if (limit > 2500) limit = 2500;
+
+    *endpoint_us = nominal_us;
+    *stop = false;
+    for (int pulse = mid_us + dir * cfg->step_us; dir * (pulse - limit) <= 0; pulse += dir * cfg->step_us) {
+        esp_err_t ret = pca9685_set_servo_pulse(dev, channel, pulse);
+        if (ret != ESP_OK) return ret;
+        // Two reads a step apart: a servo still catching up has stopped drawing by the second
+        bool held = true;
+        for (int read = 0; read < 2 && held; read++) {
+            sweep_wait(cfg->step_ms);
+            uint32_t ma;
+            ret = cfg->sense(cfg->sense_ctx, &ma);
+            if (ret != ESP_OK) return ret;
+            held = ma > rest_ma + cfg->drive_ma;
+        }
+        if (!held) continue;
+
+        int endpoint = pulse - dir * cfg->margin_us;
+        if (dir * (endpoint - mid_us) <= 0) endpoint = mid_us + dir * cfg->step_us;
+        *endpoint_us = endpoint;
+        *stop = true;
+        break;
+    }
+    // Back to mid-travel, off the stop
+    uint16_t ignored;
+    esp_err_t ret = sweep_travel(dev, channel, cfg, rest_ma, mid_us, &ignored);
+    return ret == ESP_ERR_NOT_FOUND ? ESP_OK : ret; // a step short of mid may not register
+}
+
+// The sweep proper; servo_cal_sweep unpowers the channel whatever it returns
+static esp_err_t sweep(pca9685_dev_t *dev, pca9685_channel_t channel, const servo_cal_sweep_config_t *cfg,
+                       servo_cal_sweep_result_t *result) {
+    uint16_t mid_us = (cfg->pulse_off_us + cfg->pulse_on_us) / 2;
+
+    // Unpowered first: the current of everything but this servo
+    esp_err_t ret = pca9685_set_duty(dev, channel, 0);
+    if (ret != ESP_OK) return ret;
+    sweep_wait(cfg->step_ms);
+    ret = cfg->sense(cfg->sense_ctx, &result->idle_ma);
+    if (ret != ESP_OK) return ret;
+
+    // Centre from wherever the servo stood, then take the holding current as the base
+    ret = pca9685_set_servo_pulse(dev, channel, mid_us);
+    if (ret != ESP_OK) return ret;
+    sweep_wait(cfg->timeout_ms);
+    ret = cfg->sense(cfg->sense_ctx, &result->rest_ma);
+    if (ret != ESP_OK) return ret;
+
+    // A swing halfway to the off endpoint, clear of any stop, tells whether a servo is there
+    uint16_t travel_ms;
+    ret = sweep_travel(dev, channel, cfg, result->rest_ma, (mid_us + cfg->pulse_off_us) / 2, &travel_ms);
+    if (ret == ESP_OK) ret = sweep_travel(dev, channel, cfg, result->rest_ma, mid_us, &travel_ms);
+    if (ret != ESP_OK) return ret;
+
+    ret = sweep_endpoint(dev, channel, cfg, result->rest_ma, mid_us, cfg->pulse_off_us, &result->pulse_off_us,
+                         &result->stop_off);
+    if (ret != ESP_OK) return ret;
+    ret = sweep_endpoint(dev, channel, cfg, result->rest_ma, mid_us, cfg->pulse_on_us, &result->pulse_on_us,
+                         &result->stop_on);
+    if (ret != ESP_OK) return ret;
+
+    // Full swings between the endpoints found, the slower direction counts
+    ret = sweep_travel(dev, channel, cfg, result->rest_ma, result->pulse_off_us, &travel_ms);
+    if (ret != ESP_OK) return ret;
+    for (int swing = 0; swing < 2; swing++) {
+        uint16_t to_us = swing ? result->pulse_off_us : result->pulse_on_us;
+        ret = sweep_travel(dev, channel, cfg, result->rest_ma, to_us, &travel_ms);
+        if (ret != ESP_OK) return ret;
+        if (travel_ms > result->travel_ms) result->travel_ms = travel_ms;
+    }
+    return ESP_OK;
+}
+
+// The caller's sense callback, keeping the highest current read
+typedef struct {
+    const servo_cal_sweep_config_t *cfg;
+    uint32_t peak_ma;
+} sense_peak_t;
+
+static esp_err_t sense_peak(void *ctx, uint32_t *current_ma) {
+    sense_peak_t *peak = ctx;
+    esp_err_t ret = peak->cfg->sense(peak->cfg->sense_ctx, current_ma);
+    if (ret == ESP_OK && *current_ma > peak->peak_ma) peak->peak_ma = *current_ma;
+    return ret;
+}
+
+esp_err_t servo_cal_sweep(pca9685_dev_t *dev, pca9685_channel_t channel, const servo_cal_sweep_config_t *cfg,
+                          servo_cal_sweep_result_t *result) {
+    if (!dev || !cfg || !cfg->sense || !result || channel >= PCA9685_CHANNEL_COUNT || !cfg->step_us ||
+        !pulse_ok(cfg->pulse_off_us) || !pulse_ok(cfg->pulse_on_us) || cfg->pulse_off_us == cfg->pulse_on_us) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(result, 0, sizeof(*result));
+
+    sense_peak_t peak = {.cfg = cfg};
+    servo_cal_sweep_config_t traced = *cfg;
+    traced.sense = sense_peak;
+    traced.sense_ctx = &peak;
+    esp_err_t ret = sweep(dev, channel, &traced, result);
+    result->peak_ma = peak.peak_ma;
+    // A floating sense input can wander past the thresholds; a servo that moved drew well
+    // above the unpowered current at least once
+    if (ret == ESP_OK && result->peak_ma < result->idle_ma + SERVO_CAL_SWEEP_PEAK_FACTOR * cfg->drive_ma) {
+        ESP_LOGW(TAG, "Channel %d: current peaked at %lu mA, %lu mA unpowered; not a servo's", channel,
+                 (unsigned long)result->peak_ma, (unsigned long)result->idle_ma);
+        ret = ESP_ERR_INVALID_RESPONSE;
+    }
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "Channel %d: %u-%u us%s%s, swing %u ms", channel, result->pulse_off_us, result->pulse_on_us,
+                 result->stop_off ? ", off at a stop" : "", result->stop_on ? ", on at a stop" : "",
+                 result->travel_ms);
+    }
+    pca9685_set_duty(dev, channel, 0);
+    return ret;
+}
@@ -0,0 +1,352 @@
+#ifndef SERVO_MOTION_H
+#define SERVO_MOTION_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "pca9685.h"
+#include "pca9685_array.h"
+
+/*
+ * Servo motion engine.
+ *
+ * Instead of jumping a servo to its new pulse (a loud, high-current snap), a move is
+ * spread over a number of 20 ms ticks along an easing profile. Each tick stages the
+ * interpolated duty of the channels in motion only and sends them with one
+ * pca9685_array_commit, so a tick costs at most one LEDn write per moving servo on the
+ * bus and O(moving servos) CPU; idle servos cost nothing.
+ *
+ * A power budget caps how many servos move at once: further moves wait in a FIFO and
+ * start as soon as a slot frees. As every move takes the same travel time, filling each
+ * freed slot immediately is also the fastest schedule within the cap:
+ * ceil(moves / max_moving) travel times for a frame started from rest.
+ *
+ * A display is static most of the time. With idle_off_ms set, once every servo has been at
+ * rest that long their pulses are switched fully off (no holding current, no buzz);
+ * servo_motion_hold powers them again where they were, e.g. just ahead of the next change.
+ *
+ * A frame known in advance can be made to land at a set time: moves issued after
+ * servo_motion_defer wait, and servo_motion_land_at launches them on the tick that lets the
+ * last servo settle at the target, from the budget schedule and each servo's settle time
+ * (how long it trails its last pulse). The error of each landing is kept in the stats.
+ */
+
+#define SERVO_MOTION_TICK_HZ 50                          /**< One tick per servo PWM period */
+#define SERVO_MOTION_TICK_MS (1000 / SERVO_MOTION_TICK_HZ)
+#ifndef SERVO_MOTION_MAX_CONTROLLERS
+#define SERVO_MOTION_MAX_CONTROLLERS 16                  /**< Sizes the per-servo track table */
+#endif
+/** Tick task stack: the tick, pca9685_array's burst packing (~820 B), the I2C driver and an
+ *  error log on top of the task frame. final_clock logs what is left of it. */
+#define SERVO_MOTION_STACK_SIZE 4608
+
+/**
+ * @brief Position over normalized time of a move.
+ */
+typedef enum {
+    SERVO_MOTION_LINEAR = 0, /**< Constant speed; abrupt start and stop */
+    SERVO_MOTION_COSINE,     /**< Half cosine: zero speed at both ends */
+    SERVO_MOTION_S_CURVE,    /**< Quintic smoothstep: zero speed and acceleration at both ends */
+} servo_motion_profile_t;
+
+/**
+ * @brief Engine configuration.
+ */
+typedef struct {
+    pca9685_dev_t *const *controllers;  /**< Initialized PCA9685s, frequency set */
+    size_t num_controllers;
+    servo_motion_profile_t profile;
+    uint16_t duration_ms;               /**< Travel time of every move, rounded up to whole ticks;
+                                             0 = jump (no budget applied) */
+    uint16_t max_moving;                /**< Servos allowed in motion at once, 0 = no limit */
+    uint16_t move_current_ma;           /**< Modeled supply current of a servo in motion */
+    uint16_t hold_current_ma;           /**< Modeled supply current of a powered servo at rest */
+    uint16_t idle_off_ms;               /**< Rest time after which the pulses are switched off until
+                                             the next move or servo_motion_hold; 0 = always hold */
+    uint16_t settle_ms;                 /**< Time a servo trails its last pulse until it stops at the
+                                             target, for every servo until servo_motion_set_settle */
+} servo_motion_config_t;
+
+/**
+ * @brief Modeled cost of the moves in progress (servo_motion_estimate) or of a frame
+ *        started from rest (servo_motion_plan).
+ */
+typedef struct {
+    uint16_t moving;          /**< Servos in motion now */
+    uint16_t pending;         /**< Servos waiting for a slot */
+    uint16_t peak_moving;     /**< Most servos in motion at once until all have arrived */
+    uint32_t peak_current_ma; /**< peak_moving in motion, every other powered servo holding */
+    uint32_t total_ms;        /**< Until the last servo arrives */
+} servo_motion_estimate_t;
+
+/**
+ * @brief Counters, cleared by servo_motion_reset_stats.
+ */
+typedef struct {
+    uint32_t ticks;           /**< Ticks run */
+    uint32_t busy_ticks;      /**< Ticks with at least one servo in motion */
+    uint32_t moves;           /**< Moves started */
+    uint16_t max_moving;      /**< Most servos in motion during one tick */
+    uint32_t max_tick_us;     /**< Longest tick, staging and I2C included */
+    uint32_t overruns;        /**< Ticks that started late because the previous one ran long */
+    uint32_t commit_errors;   /**< Failed commits; the servos are resent next tick */
+    uint32_t idle_offs;       /**< Times the idle servos were switched off */
+    uint64_t servo_ticks;     /**< Servos with a pulse, summed over ticks */
+    uint64_t off_ticks;       /**< Of those, switched off while idle */
+    uint32_t landings;        /**< Frames launched by servo_motion_land_at that have landed */
+    int32_t last_landing_us;  /**< Landing error of the last: last servo settled minus target */
+    uint32_t max_landing_us;  /**< Largest landing error either way */
+    uint32_t last_lead_ms;    /**< Lead the last frame was launched with */
+} servo_motion_stats_t;
+
+/**
+ * @brief Holding energy saved by switching idle servos off, from servo_motion_stats_t.
+ */
+typedef struct {
+    float off_pct;            /**< Share of servo time without a holding pulse */
+    float hold_mah;           /**< Charge drawn at hold_current_ma by the servos with a pulse on */
+    float saved_mah;          /**< Charge holding would have drawn while switched off */
+} servo_motion_energy_t;
+
+/**
+ * @brief Progress of one servo's current move.
+ */
+typedef struct {
+    uint16_t from;     /**< Duty at the start of the move */
+    uint16_t to;       /**< Target duty */
+    uint16_t elapsed;  /**< Ticks done */
+    uint16_t ticks;    /**< Ticks in the move */
+} servo_motion_track_t;
+
+/**
+ * @brief Engine state. Treat as opaque.
+ */
+typedef struct {
+    pca9685_array_t array;
+    servo_motion_profile_t profile;
+    uint16_t move_ticks;
+    uint16_t max_moving;
+    uint16_t move_current_ma;
+    uint16_t hold_current_ma;
+    uint16_t idle_off_ticks;
+    uint16_t idle_ticks;      /**< Ticks at rest, up to idle_off_ticks */
+    uint16_t num_pulses;      /**< Servos with a pulse, recounted when recount is set */
+    uint16_t num_off;         /**< Of those, switched off */
+    bool recount;
+    servo_motion_track_t tracks[SERVO_MOTION_MAX_CONTROLLERS][PCA9685_CHANNEL_COUNT];
+    uint16_t moving[SERVO_MOTION_MAX_CONTROLLERS];  /**< Bit n: channel n in motion */
+    uint16_t pending[SERVO_MOTION_MAX_CONTROLLERS]; /**< Bit n: channel n waiting for a slot */
+    uint16_t num_moving;
+    uint16_t queue[SERVO_MOTION_MAX_CONTROLLERS * PCA9685_CHANNEL_COUNT]; /**< FIFO of pending servos */
+    uint16_t queue_head;
+    uint16_t queue_count;
+    uint16_t settle_ms[SERVO_MOTION_MAX_CONTROLLERS][PCA9685_CHANNEL_COUNT];
+    bool deferred;            /**< Queued moves wait for the launch */
+    int64_t launch_us;        /**< esp_timer time of the launch, 0 = not scheduled */
+    int64_t land_at_us;       /**< Target of the frame launched or scheduled, 0 = none */
+    int64_t landed_us;        /**< Latest settle time of that frame's servos so far */
+    SemaphoreHandle_t lock;
+    StaticSemaphore_t lock_buf;
+    TaskHandle_t task;
+    servo_motion_stats_t stats;
+} servo_motion_t;
+
+/**
+ * @brief Set up an engine. Its controllers must only be written through it from then on.
+ *
+ * @param motion Engine state to initialize.
+ * @param cfg Configuration (copied, the controller list too).
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG on a NULL pointer, an unknown profile, or more than
+ *       SERVO_MOTION_MAX_CONTROLLERS controllers; see also pca9685_array_init.
+ */
+esp_err_t servo_motion_init(servo_motion_t *motion, const servo_motion_config_t *cfg);
+
+/**
+ * @brief Start the tick task (every SERVO_MOTION_TICK_MS, vTaskDelayUntil paced).
+ *
+ * @param motion Initialized engine.
+ * @param task_priority FreeRTOS priority of the task; above the application's tasks.
+ * @param core Core to pin the task to, or tskNO_AFFINITY.
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_STATE if the task already runs.
+ *     - ESP_ERR_NO_MEM if the task cannot be created.
+ */
+esp_err_t servo_motion_start(servo_motion_t *motion, UBaseType_t task_priority, BaseType_t core);
+
+/**
+ * @brief Move a servo to a duty over the configured duration.
+ *
+ * A servo already in motion turns around from where it is, keeping its slot; a waiting
+ * one just gets the new target. Otherwise the move waits for a slot of the power budget.
+ * A servo whose position is not known (never driven since pca9685_init) jumps to the
+ * target when its move starts and holds the slot for the travel time.
+ *
+ * @param motion Initialized engine.
+ * @param dev One of the engine's controllers.
+ * @param channel Channel on dev.
+ * @param duty Target OFF count (0-4095).
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if dev is not one of the engine's controllers, or channel or
+ *       duty is out of range.
+ */
+esp_err_t servo_motion_move(servo_motion_t *motion, pca9685_dev_t *dev, pca9685_channel_t channel,
+                            uint16_t duty);
+
+/**
+ * @brief Take a servo as standing at a duty already: the pulse goes out with the next tick
+ *        and nothing moves, e.g. to restore a frame the servos were left at.
+ *
+ * @param motion Initialized engine.
+ * @param dev One of the engine's controllers.
+ * @param channel Channel on dev.
+ * @param duty OFF count (0-4095) of the position.
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if dev is not one of the engine's controllers, or channel or
+ *       duty is out of range.
+ *     - ESP_ERR_INVALID_STATE if the servo is in motion or waiting for a slot.
+ */
+esp_err_t servo_motion_place(servo_motion_t *motion, pca9685_dev_t *dev, pca9685_channel_t channel,
+                             uint16_t duty);
+
+/**
+ * @brief Advance every move by one tick and send the servos in motion.
+ *
+ * Called by the tick task; call it directly (every SERVO_MOTION_TICK_MS) when no task
+ * was started.
+ *
+ * @return
+ *     - ESP_OK on success, including when nothing moves.
+ *     - The error of pca9685_array_commit; the servos stay staged and go out next tick.
+ */
+esp_err_t servo_motion_tick(servo_motion_t *motion);
+
+/**
+ * @brief Power the servos switched off while idle again, at their last position.
+ *
+ * The pulses go out with the next tick and the rest time starts over: call it less than
+ * idle_off_ms before a change, early enough for servos pushed off position while unpowered
+ * to get back. Moves power their own servo anyway.
+ *
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if motion is NULL.
+ */
+esp_err_t servo_motion_hold(servo_motion_t *motion);
+
+/**
+ * @brief Run pca9685_check on every controller of the engine, between two ticks.
+ *
+ * A chip found reset is restored at once from its shadow, so the servos in motion and the
+ * switched-off ones come back exactly as the engine left them; the others are not written.
+ *
+ * @param motion Initialized engine.
+ * @param spot_led Also compare one LEDn channel per controller, see pca9685_check.
+ * @param repaired Out: controllers found reset or mismatched and rewritten (may be NULL).
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if motion is NULL.
+ *     - The first error of pca9685_check; the remaining controllers are still checked.
+ */
+esp_err_t servo_motion_check(servo_motion_t *motion, bool spot_led, size_t *repaired);
+
+/**
+ * @brief Set how long a servo trails its last pulse before it stops at the target.
+ *
+ * @param motion Initialized engine.
+ * @param dev One of the engine's controllers.
+ * @param channel Channel on dev.
+ * @param settle_ms Settle time, measured for that servo (see set_servo_zero).
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if dev is not one of the engine's controllers or channel is out of range.
+ */
+esp_err_t servo_motion_set_settle(servo_motion_t *motion, pca9685_dev_t *dev, pca9685_channel_t channel,
+                                  uint16_t settle_ms);
+
+/**
+ * @brief Hold back the moves issued from now on until servo_motion_land_at launches them.
+ *
+ * Moves of servos already in motion still take effect at once.
+ *
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if motion is NULL.
+ */
+esp_err_t servo_motion_defer(servo_motion_t *motion);
+
+/**
+ * @brief Launch the held back frame so that its last servo settles at land_at_us.
+ *
+ * The waiting moves are reordered longest settle time first, then the lead is modeled like
+ * servo_motion_estimate plus each servo's settle time after its last tick. The frame starts
+ * on the tick nearest land_at_us minus the lead, at once if that has passed. Moves issued
+ * before the launch join the frame without changing the lead.
+ *
+ * @param motion Initialized engine.
+ * @param land_at_us Landing target, in esp_timer_get_time time.
+ * @param lead_ms Out: the modeled lead (may be NULL); 0 when nothing was held back.
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if motion is NULL.
+ *     - ESP_ERR_INVALID_STATE if servo_motion_defer was not called.
+ */
+esp_err_t servo_motion_land_at(servo_motion_t *motion, int64_t land_at_us, uint32_t *lead_ms);
+
+/**
+ * @brief Number of servos not at their target yet: in motion or waiting for a slot.
+ */
+size_t servo_motion_moving(servo_motion_t *motion);
+
+/**
+ * @brief Model the moves in progress: when the last servo arrives and the peak current
+ *        on the way, with the configured budget.
+ *
+ * @param motion Initialized engine.
+ * @param est Out: the estimate. Powered servos are the channels with a pulse not switched off.
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if a pointer is NULL.
+ */
+esp_err_t servo_motion_estimate(servo_motion_t *motion, servo_motion_estimate_t *est);
+
+/**
+ * @brief Model a frame of moves started from rest, e.g. to tune max_moving and the travel
+ *        time against a supply before running it.
+ *
+ * @param cfg Engine configuration to model (controllers are not used).
+ * @param moves Servos that move in the frame.
+ * @param powered Servos powered in total, moving ones included.
+ * @param est Out: the estimate.
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if a pointer is NULL or moves exceeds powered.
+ */
+esp_err_t servo_motion_plan(const servo_motion_config_t *cfg, size_t moves, size_t powered,
+                            servo_motion_estimate_t *est);
+
+/**
+ * @brief Holding energy with and without switching idle servos off, since the stats were cleared.
+ *
+ * @param motion Initialized engine.
+ * @param energy Out: the report, from the tick counters and hold_current_ma.
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if a pointer is NULL.
+ */
+esp_err_t servo_motion_energy(servo_motion_t *motion, servo_motion_energy_t *energy);
+
+/**
+ * @brief Clear motion->stats.
+ */
+void servo_motion_reset_stats(servo_motion_t *motion);
+
+#endif // SERVO_MOTION_H
@@ -0,0 +1,465 @@
+#include "servo_motion.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "servo_motion";
+
+esp_err_t servo_motion_init(servo_motion_t *motion, const servo_motion_config_t *cfg) {
+    if (!motion || !cfg || cfg->num_controllers > SERVO_MOTION_MAX_CONTROLLERS ||
+        cfg->profile > SERVO_MOTION_S_CURVE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(motion, 0, sizeof(*motion));
+    esp_err_t ret = pca9685_array_init(&motion->array, cfg->controllers, cfg->num_controllers);
+    if (ret != ESP_OK) return ret;
+    motion->profile = cfg->profile;
+    motion->move_ticks = (cfg->duration_ms + SERVO_MOTION_TICK_MS - 1) / SERVO_MOTION_TICK_MS;
+    motion->max_moving = cfg->max_moving;
+    motion->move_current_ma = cfg->move_current_ma;
+    motion->hold_current_ma = cfg->hold_current_ma;
+    motion->idle_off_ticks = (cfg->idle_off_ms + SERVO_MOTION_TICK_MS - 1) / SERVO_MOTION_TICK_MS;
+    motion->recount = true;
+    for (size_t c = 0; c < SERVO_MOTION_MAX_CONTROLLERS; c++) {
+        for (int ch = 0; ch < PCA9685_CHANNEL_COUNT; ch++) motion->settle_ms[c][ch] = cfg->settle_ms;
+    }
+    motion->lock = xSemaphoreCreateMutexStatic(&motion->lock_buf);
+    return ESP_OK;
+}
+
+static void motion_task(void *param) {
+    servo_motion_t *motion = param;
+    TickType_t last_wake = xTaskGetTickCount();
+    while (1) {
+        // pdFALSE: the wake time had already passed, i.e. the previous tick ran long
+        if (xTaskDelayUntil(&last_wake, pdMS_TO_TICKS(SERVO_MOTION_TICK_MS)) == pdFALSE) {
+            motion->stats.overruns++;
+        }
+        servo_motion_tick(motion);
+    }
+}
+
+esp_err_t servo_motion_start(servo_motion_t *motion, UBaseType_t task_priority, BaseType_t core) {
+    if (!motion) return ESP_ERR_INVALID_ARG;
+    if (motion->task) return ESP_ERR_INVALID_STATE;
+    if (xTaskCreatePinnedToCore(motion_task, "servo_motion", SERVO_MOTION_STACK_SIZE, motion,
+                                task_priority, &motion->task, core) != pdPASS) {
+        motion->task = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "Tick task started (%d Hz, %u tick moves)", SERVO_MOTION_TICK_HZ, motion->move_ticks);
+    return ESP_OK;
+}
+
+static int controller_index(const servo_motion_t *motion, const pca9685_dev_t *dev) {
+    for (size_t i = 0; i < motion->array.num_controllers; i++) {
+        if (motion->array.controllers[i] == dev) return i;
+    }
+    return -1;
+}
+
+esp_err_t servo_motion_move(servo_motion_t *motion, pca9685_dev_t *dev, pca9685_channel_t channel,
+                            uint16_t duty) {
+    if (!motion || channel >= PCA9685_CHANNEL_COUNT || duty > 4095) return ESP_ERR_INVALID_ARG;
+    int c = controller_index(motion, dev);
+    if (c < 0) return ESP_ERR_INVALID_ARG;
+
+    xSemaphoreTake(motion->lock, portMAX_DELAY);
+    servo_motion_track_t *track = &motion->tracks[c][channel];
+    uint16_t bit = 1u << channel;
+    // In motion: the last staged duty is where it is now
+    uint16_t from = pca9685_get_duty(dev, channel);
+
+    esp_err_t ret = ESP_OK;
+    motion->recount = true;
+    if (motion->move_ticks == 0) {
+        ret = pca9685_stage_duty_range(dev, channel, &duty, 1);
+    } else if (motion->moving[c] & bit) {
+        // Turn around from here within the slot it already holds
+        track->from = from ? from : duty;
+        track->to = duty;
+        track->elapsed = 0;
+        motion->stats.moves++;
+    } else if (motion->pending[c] & bit) {
+        track->to = duty;
+    } else if (from == duty) {
+        ret = pca9685_stage_duty_range(dev, channel, &duty, 1);
+    } else {
+        track->to = duty;
+        motion->pending[c] |= bit;
+        uint16_t tail = (motion->queue_head + motion->queue_count) % (SERVO_MOTION_MAX_CONTROLLERS * PCA9685_CHANNEL_COUNT);
+        motion->queue[tail] = c * PCA9685_CHANNEL_COUNT + channel;
+        motion->queue_count++;
+    }
+    xSemaphoreGive(motion->lock);
+    return ret;
+}
+
+esp_err_t servo_motion_place(servo_motion_t *motion, pca9685_dev_t *dev, pca9685_channel_t channel,
+                             uint16_t duty) {
+    if (!motion || channel >= PCA9685_CHANNEL_COUNT || duty > 4095) return ESP_ERR_INVALID_ARG;
+    int c = controller_index(motion, dev);
+    if (c < 0) return ESP_ERR_INVALID_ARG;
+
+    xSemaphoreTake(motion->lock, portMAX_DELAY);
+    esp_err_t ret = ESP_ERR_INVALID_STATE;
+    if (!((motion->moving[c] | motion->pending[c]) & (1u << channel))) {
+        ret = pca9685_stage_duty_range(dev, channel, &duty, 1);
+        motion->recount = true;
+    }
+    xSemaphoreGive(motion->lock);
+    return ret;
+}
+
+// Start waiting moves in FIFO order while the budget has free slots
+static void admit_pending(servo_motion_t *motion) {
+    while (!motion->deferred && motion->queue_count && (!motion->max_moving || motion->num_moving < motion->max_moving)) {
+        uint16_t servo = motion->queue[motion->queue_head];
+        motion->queue_head = (motion->queue_head + 1) % (SERVO_MOTION_MAX_CONTROLLERS * PCA9685_CHANNEL_COUNT);
+        motion->queue_count--;
+
+        int c = servo / PCA9685_CHANNEL_COUNT;
+        int ch = servo % PCA9685_CHANNEL_COUNT;
+        pca9685_dev_t *dev = motion->array.controllers[c];
+        servo_motion_track_t *track = &motion->tracks[c][ch];
+        motion->pending[c] &= ~(1u << ch);
+        motion->recount = true;
+        uint16_t from = pca9685_get_duty(dev, ch);
+        if (from == track->to) {
+            // Retargeted back to where it is while waiting
+            pca9685_stage_duty_range(dev, ch, &track->to, 1);
+            continue;
+        }
+        // Unknown position: jump, but hold the slot while the servo travels
+        track->from = from ? from : track->to;
+        track->elapsed = 0;
+        track->ticks = motion->move_ticks;
+        motion->moving[c] |= 1u << ch;
+        motion->num_moving++;
+        motion->stats.moves++;
+    }
+}
+
+// Switch every servo with a pulse off (idle) or back on
+static void stage_full_off(servo_motion_t *motion, bool full_off) {
+    for (size_t c = 0; c < motion->array.num_controllers; c++) {
+        pca9685_stage_full_off(motion->array.controllers[c], 0xFFFF, full_off);
+    }
+    motion->recount = true;
+}
+
+static void count_pulses(servo_motion_t *motion) {
+    motion->num_pulses = 0;
+    motion->num_off = 0;
+    for (size_t c = 0; c < motion->array.num_controllers; c++) {
+        uint16_t off;
+        motion->num_pulses += __builtin_popcount(pca9685_pulse_mask(motion->array.controllers[c], &off));
+        motion->num_off += __builtin_popcount(off);
+    }
+    motion->recount = false;
+}
+
+static float ease(servo_motion_profile_t profile, float p) {
+    switch (profile) {
+    case SERVO_MOTION_COSINE:
+        return 0.5f - 0.5f * cosf((float)M_PI * p);
+    case SERVO_MOTION_S_CURVE:
+        return p * p * p * (p * (6.0f * p - 15.0f) + 10.0f);
+    default:
+        return p;
+    }
+}
+
+esp_err_t servo_motion_tick(servo_motion_t *motion) {
+    if (!motion) return ESP_ERR_INVALID_ARG;
+    int64_t start = esp_timer_get_time();
+
+    xSemaphoreTake(motion->lock, portMAX_DELAY);
+    // The tick nearest the launch time starts the held back frame
+    if (motion->deferred && motion->launch_us && start >= motion->launch_us - SERVO_MOTION_TICK_MS * 500) {
+        motion->deferred = false;
+        motion->launch_us = 0;
+    }
+    admit_pending(motion);
+    uint16_t moving = 0;
+    uint16_t settling = 0;
+    bool arrived = false;
+    for (size_t c = 0; c < motion->array.num_controllers; c++) {
+        pca9685_dev_t *dev = motion->array.controllers[c];
+        for (uint16_t bits = motion->moving[c]; bits; bits &= bits - 1) {
+            int ch = __builtin_ctz(bits);
+            servo_motion_track_t *track = &motion->tracks[c][ch];
+            uint16_t duty = track->to;
+            if (++track->elapsed < track->ticks) {
+                float e = ease(motion->profile, (float)track->elapsed / track->ticks);
+                duty = track->from + (int)lroundf(((int)track->to - (int)track->from) * e);
+            } else {
+                motion->moving[c] &= ~(1u << ch);
+                motion->num_moving--;
+                if (motion->settle_ms[c][ch] > settling) settling = motion->settle_ms[c][ch];
+                arrived = true;
+            }
+            pca9685_stage_duty_range(dev, ch, &duty, 1);
+            moving++;
+        }
+    }
+    if (moving || motion->queue_count) {
+        motion->idle_ticks = 0;
+    } else if (motion->idle_off_ticks && motion->idle_ticks < motion->idle_off_ticks &&
+               ++motion->idle_ticks == motion->idle_off_ticks) {
+        stage_full_off(motion, true);
+        motion->stats.idle_offs++;
+    }
+    // Only the channels staged above (or left over from a failed commit) are dirty
+    esp_err_t ret = pca9685_array_commit(&motion->array);
+    if (motion->land_at_us && !motion->deferred) {
+        // Servos that got their last pulse now stop settle_ms after it went out
+        if (arrived) {
+            int64_t landed = esp_timer_get_time() + settling * 1000;
+            if (landed > motion->landed_us) motion->landed_us = landed;
+        }
+        if (!motion->num_moving && !motion->queue_count && !motion->landed_us) {
+            motion->land_at_us = 0; // retargeted back while waiting: nothing moved
+        } else if (!motion->num_moving && !motion->queue_count) {
+            int64_t error = motion->landed_us - motion->land_at_us;
+            motion->stats.landings++;
+            motion->stats.last_landing_us = (int32_t)error;
+            if ((uint64_t)llabs(error) > motion->stats.max_landing_us) motion->stats.max_landing_us = llabs(error);
+            motion->land_at_us = 0;
+        }
+    }
+    if (motion->recount) count_pulses(motion);
+    motion->stats.servo_ticks += motion->num_pulses;
+    motion->stats.off_ticks += motion->num_off;
+    xSemaphoreGive(motion->lock);
+
+    motion->stats.ticks++;
+    if (moving) motion->stats.busy_ticks++;
+    if (moving > motion->stats.max_moving) motion->stats.max_moving = moving;
+    if (ret != ESP_OK) motion->stats.commit_errors++;
+    uint32_t elapsed_us = (uint32_t)(esp_timer_get_time() - start);
+    if (elapsed_us > motion->stats.max_tick_us) motion->stats.max_tick_us = elapsed_us;
+    return ret;
+}
+
+esp_err_t servo_motion_hold(servo_motion_t *motion) {
+    if (!motion) return ESP_ERR_INVALID_ARG;
+    xSemaphoreTake(motion->lock, portMAX_DELAY);
+    stage_full_off(motion, false);
+    motion->idle_ticks = 0;
+    xSemaphoreGive(motion->lock);
+    return ESP_OK;
+}
+
+esp_err_t servo_motion_check(servo_motion_t *motion, bool spot_led, size_t *repaired) {
+    if (repaired) *repaired = 0;
+    if (!motion) return ESP_ERR_INVALID_ARG;
+
+    esp_err_t first_err = ESP_OK;
+    xSemaphoreTake(motion->lock, portMAX_DELAY);
+    for (size_t c = 0; c < motion->array.num_controllers; c++) {
+        pca9685_check_result_t result;
+        esp_err_t ret = pca9685_check(motion->array.controllers[c], spot_led, &result);
+        if (ret != ESP_OK && first_err == ESP_OK) first_err = ret;
+        if (result != PCA9685_CHECK_OK && repaired) (*repaired)++;
+    }
+    xSemaphoreGive(motion->lock);
+    return first_err;
+}
+
+esp_err_t servo_motion_set_settle(servo_motion_t *motion, pca9685_dev_t *dev, pca9685_channel_t channel,
+                                  uint16_t settle_ms) {
+    if (!motion || channel >= PCA9685_CHANNEL_COUNT) return ESP_ERR_INVALID_ARG;
+    int c = controller_index(motion, dev);
+    if (c < 0) return ESP_ERR_INVALID_ARG;
+    motion->settle_ms[c][channel] = settle_ms;
+    return ESP_OK;
+}
+
+esp_err_t servo_motion_defer(servo_motion_t *motion) {
+    if (!motion) return ESP_ERR_INVALID_ARG;
+    xSemaphoreTake(motion->lock, portMAX_DELAY);
+    motion->deferred = true;
+    motion->launch_us = 0;
+    xSemaphoreGive(motion->lock);
+    return ESP_OK;
+}
+
+static uint16_t queued_settle(const servo_motion_t *motion, uint16_t servo) {
+    return motion->settle_ms[servo / PCA9685_CHANNEL_COUNT][servo % PCA9685_CHANNEL_COUNT];
+}
+
+// Longest settle time first, so the slow servos take the early slots; stable otherwise
+static void sort_queue(servo_motion_t *motion) {
+    const size_t size = SERVO_MOTION_MAX_CONTROLLERS * PCA9685_CHANNEL_COUNT;
+    uint16_t servos[SERVO_MOTION_MAX_CONTROLLERS * PCA9685_CHANNEL_COUNT];
+    for (size_t i = 0; i < motion->queue_count; i++) {
+        uint16_t servo = motion->queue[(motion->queue_head + i) % size];
+        size_t pos = i;
+        while (pos > 0 && queued_settle(motion, servos[pos - 1]) < queued_settle(motion, servo)) {
+            servos[pos] = servos[pos - 1];
+            pos--;
+        }
+        servos[pos] = servo;
+    }
+    for (size_t i = 0; i < motion->queue_count; i++) motion->queue[(motion->queue_head + i) % size] = servos[i];
+}
+
+// Launch to landing of the queued moves: the servos in motion keep their slots until they
+// arrive, each queued one takes the earliest free slot and gets its last pulse on the
+// tick before that slot frees again, then settles
+static uint32_t frame_lead_ms(const servo_motion_t *motion) {
+    uint16_t free_at[SERVO_MOTION_MAX_CONTROLLERS * PCA9685_CHANNEL_COUNT];
+    size_t slots = motion->max_moving ? motion->max_moving : motion->num_moving + motion->queue_count;
+    if (slots < motion->num_moving) slots = motion->num_moving;
+    size_t n = 0;
+    for (size_t c = 0; c < motion->array.num_controllers; c++) {
+        for (uint16_t bits = motion->moving[c]; bits; bits &= bits - 1) {
+            const servo_motion_track_t *track = &motion->tracks[c][__builtin_ctz(bits)];
+            free_at[n++] = track->ticks - track->elapsed;
+        }
+    }
+    while (n < slots && n < sizeof(free_at) / sizeof(free_at[0])) free_at[n++] = 0;
+
+    uint32_t lead = 0;
+    for (size_t i = 0; i < motion->queue_count; i++) {
+        size_t slot = 0;
+        for (size_t j = 1; j < n; j++) {
+            if (free_at[j] < free_at[slot]) slot = j;
+        }
+        free_at[slot] += motion->move_ticks;
+        uint16_t servo = motion->queue[(motion->queue_head + i) % (SERVO_MOTION_MAX_CONTROLLERS * PCA9685_CHANNEL_COUNT)];
+        uint32_t landing = (free_at[slot] - 1) * SERVO_MOTION_TICK_MS + queued_settle(motion, servo);
+        if (landing > lead) lead = landing;
+    }
+    return lead;
+}
+
+esp_err_t servo_motion_land_at(servo_motion_t *motion, int64_t land_at_us, uint32_t *lead_ms) {
+    if (lead_ms) *lead_ms = 0;
+    if (!motion) return ESP_ERR_INVALID_ARG;
+
+    xSemaphoreTake(motion->lock, portMAX_DELAY);
+    if (!motion->deferred) {
+        xSemaphoreGive(motion->lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+    uint32_t lead = 0;
+    if (motion->queue_count && motion->move_ticks) {
+        sort_queue(motion);
+        lead = frame_lead_ms(motion);
+        motion->launch_us = land_at_us - (int64_t)lead * 1000;
+        motion->land_at_us = land_at_us;
+        motion->landed_us = 0;
+        motion->stats.last_lead_ms = lead;
+    } else {
+        // Nothing to land
+        motion->deferred = false;
+    }
+    xSemaphoreGive(motion->lock);
+    if (lead_ms) *lead_ms = lead;
+    return ESP_OK;
+}
+
+size_t servo_motion_moving(servo_motion_t *motion) {
+    if (!motion) return 0;
+    xSemaphoreTake(motion->lock, portMAX_DELAY);
+    size_t count = motion->num_moving + motion->queue_count;
+    xSemaphoreGive(motion->lock);
+    return count;
+}
+
+// Slots of the budget become free after busy_ticks (servos already moving) or at once;
+// each pending move takes the earliest free slot for move_ticks
+static void model(uint16_t max_moving, uint16_t move_ticks, uint16_t move_ma, uint16_t hold_ma,
+                  const uint16_t *busy_ticks, size_t busy, size_t pending, size_t powered,
+                  servo_motion_estimate_t *est) {
+    size_t slots = max_moving ? max_moving : busy + pending;
+    if (slots < busy) slots = busy;
+
+    uint32_t total = 0;
+    for (size_t i = 0; i < busy; i++) {
+        if (busy_ticks[i] > total) total = busy_ticks[i];
+    }
+    if (pending) {
+        // Slot j frees at free_at(j), sorted ascending: the busy ones by remaining time
+        // after the idle ones. Pending move i lands in slot i % slots on round i / slots.
+        uint16_t free_at[SERVO_MOTION_MAX_CONTROLLERS * PCA9685_CHANNEL_COUNT];
+        size_t n = 0;
+        for (size_t j = busy; j < slots && n < sizeof(free_at) / sizeof(free_at[0]); j++) free_at[n++] = 0;
+        for (size_t i = 0; i < busy; i++) {
+            size_t pos = n++;
+            while (pos > 0 && free_at[pos - 1] > busy_ticks[i]) {
+                free_at[pos] = free_at[pos - 1];
+                pos--;
+            }
+            free_at[pos] = busy_ticks[i];
+        }
+        for (size_t j = 0; j < n && j < pending; j++) {
+            uint32_t rounds = (pending - j + n - 1) / n;
+            uint32_t end = free_at[j] + rounds * move_ticks;
+            if (end > total) total = end;
+        }
+    }
+
+    size_t in_motion = busy + pending;
+    est->moving = busy;
+    est->pending = pending;
+    est->peak_moving = in_motion < slots ? in_motion : slots;
+    if (powered < est->peak_moving) powered = est->peak_moving;
+    est->peak_current_ma = (uint32_t)est->peak_moving * move_ma + (uint32_t)(powered - est->peak_moving) * hold_ma;
+    est->total_ms = total * SERVO_MOTION_TICK_MS;
+}
+
+esp_err_t servo_motion_estimate(servo_motion_t *motion, servo_motion_estimate_t *est) {
+    if (!motion || !est) return ESP_ERR_INVALID_ARG;
+
+    uint16_t busy_ticks[SERVO_MOTION_MAX_CONTROLLERS * PCA9685_CHANNEL_COUNT];
+    size_t busy = 0;
+    size_t powered = 0;
+    xSemaphoreTake(motion->lock, portMAX_DELAY);
+    for (size_t c = 0; c < motion->array.num_controllers; c++) {
+        const pca9685_dev_t *dev = motion->array.controllers[c];
+        for (int ch = 0; ch < PCA9685_CHANNEL_COUNT; ch++) {
+            const servo_motion_track_t *track = &motion->tracks[c][ch];
+            if (motion->moving[c] & (1u << ch)) {
+                busy_ticks[busy++] = track->ticks - track->elapsed;
+            }
+        }
+        uint16_t off;
+        uint16_t on = pca9685_pulse_mask(dev, &off) & ~off;
+        powered += __builtin_popcount(on | motion->pending[c]);
+    }
+    model(motion->max_moving, motion->move_ticks, motion->move_current_ma, motion->hold_current_ma,
+          busy_ticks, busy, motion->queue_count, powered, est);
+    xSemaphoreGive(motion->lock);
+    return ESP_OK;
+}
+
+esp_err_t servo_motion_plan(const servo_motion_config_t *cfg, size_t moves, size_t powered,
+                            servo_motion_estimate_t *est) {
+    if (!cfg || !est || moves > powered) return ESP_ERR_INVALID_ARG;
+    uint16_t move_ticks = (cfg->duration_ms + SERVO_MOTION_TICK_MS - 1) / SERVO_MOTION_TICK_MS;
+    model(cfg->max_moving, move_ticks, cfg->move_current_ma, cfg->hold_current_ma, NULL, 0, moves, powered, est);
+    return ESP_OK;
+}
+
+esp_err_t servo_motion_energy(servo_motion_t *motion, servo_motion_energy_t *energy) {
+    if (!motion || !energy) return ESP_ERR_INVALID_ARG;
+
+    // servo-ticks -> mAh: one tick is SERVO_MOTION_TICK_MS of hold_current_ma
+    float tick_mah = motion->hold_current_ma * (SERVO_MOTION_TICK_MS / 3600000.0f);
+    uint64_t servo_ticks = motion->stats.servo_ticks;
+    uint64_t off_ticks = motion->stats.off_ticks;
+    energy->off_pct = servo_ticks ? 100.0f * off_ticks / servo_ticks : 0;
+    energy->hold_mah = (servo_ticks - off_ticks) * tick_mah;
+    energy->saved_mah = off_ticks * tick_mah;
+    return ESP_OK;
+}
+
+void servo_motion_reset_stats(servo_motion_t *motion) {
+    if (motion) memset(&motion->stats, 0, sizeof(motion->stats));
+}
@@ -0,0 +1,187 @@
+#ifndef TIME_SERVICE_H
+#define TIME_SERVICE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+#include <sys/time.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "rtc_tick.h"
+
+/*
+ * Time service: the one owner of the RTC.
+ *
+ * The RTC time is loaded into the system clock at start, so gettimeofday/localtime_r serve
+ * the time from then on with microsecond resolution and no bus traffic. Every resync_s the
+ * RTC is read again right at an SQW edge, where its second has just begun, and the system
+ * clock is corrected: offsets up to TIME_SERVICE_SLEW_MAX_US are slewed out with adjtime
+ * (no second skipped or repeated), larger ones stepped. The offsets found give the system
+ * clock's drift against the RTC. Without the SQW pin only whole seconds can be compared.
+ *
+ * Its task wakes on each second (SQW edge, or the system clock's second), keeps the
+ * current time in a snapshot that any task reads without a lock (time_service_get), and
+ * tells subscribed tasks what changed:
+ * the TIME_EVENT_* bits a subscriber asked for are OR-ed into its task notification value
+ * (eSetBits). A consumer blocks in xTaskNotifyWait and wakes only for the changes it
+ * draws, e.g. the servo digits each minute and the LCD date once a day. A larger unit
+ * changing changes the smaller ones too: a new day also sets HOUR, MINUTE and SECOND.
+ */
+
+#define TIME_EVENT_SECOND (1 << 0)
+#define TIME_EVENT_MINUTE (1 << 1)
+#define TIME_EVENT_HOUR   (1 << 2)
+#define TIME_EVENT_DAY    (1 << 3)
+#define TIME_EVENT_ALL    (TIME_EVENT_SECOND | TIME_EVENT_MINUTE | TIME_EVENT_HOUR | TIME_EVENT_DAY)
+
+#define TIME_SERVICE_MAX_SUBSCRIBERS 8
+#define TIME_SERVICE_STACK_SIZE 3072     /**< Service task stack, the RTC read runs on it */
+#define TIME_SERVICE_SLEW_MAX_US 500000  /**< Larger offsets from the RTC are stepped, not slewed */
+
+/**
+ * @brief Service configuration.
+ */
+typedef struct {
+    rtc_tick_config_t tick;              /**< RTC and SQW pin, see rtc_tick_init */
+    uint32_t resync_s;                   /**< Interval of system clock corrections from the RTC,
+                                              0 = only the alignment at start */
+} time_service_config_t;
+
+/**
+ * @brief A task and the events it is notified of.
+ */
+typedef struct {
+    TaskHandle_t task;
+    uint32_t events;                     /**< TIME_EVENT_* mask */
+} time_service_subscriber_t;
+
+/**
+ * @brief Counters, cleared by time_service_reset_stats.
+ */
+typedef struct {
+    uint32_t updates;                    /**< Times published */
+    uint32_t seconds;                    /**< Updates per event, in TIME_EVENT_* bit order */
+    uint32_t minutes;
+    uint32_t hours;
+    uint32_t days;
+    uint32_t notifications;              /**< Task notifications sent */
+    uint32_t read_errors;                /**< RTC reads failed; retried on the next second */
+    uint32_t resyncs;                    /**< System clock compared with the RTC */
+    uint32_t steps;                      /**< Of those, set with settimeofday */
+    uint32_t slews;                      /**< Of those, corrected with adjtime */
+    int32_t last_offset_us;              /**< RTC minus system time at the last resync */
+    uint32_t max_offset_us;              /**< Largest offset found after the alignment at start */
+    float drift_ppm;                     /**< System clock rate against the RTC over the last
+                                              interval (positive: fast) */
+} time_service_stats_t;
+
+/**
+ * @brief Service state. Treat as opaque; tick.stats may be read for the RTC side.
+ */
+typedef struct {
+    rtc_tick_t tick;
+    uint32_t resync_s;
+    bool aligned;                        /**< Sub-second set at an SQW edge */
+    int64_t synced_at_us;                /**< esp_timer time of the last correction */
+    volatile uint32_t seq;               /**< Odd while the snapshot is written */
+    struct tm time;                      /**< Snapshot, see time_service_get */
+    bool valid;                          /**< Snapshot published */
+    bool clock_set;                      /**< System clock set from the RTC */
+    time_service_subscriber_t subscribers[TIME_SERVICE_MAX_SUBSCRIBERS];
+    size_t num_subscribers;
+    SemaphoreHandle_t lock;              /**< Guards the subscriber list */
+    StaticSemaphore_t lock_buf;
+    TaskHandle_t task;
+    time_service_stats_t stats;
+} time_service_t;
+
+/**
+ * @brief Set up the service and its RTC tick, set the system clock from the RTC and
+ *        publish that time.
+ *
+ * The RTC gives whole seconds here; the first update aligns the sub-second at an SQW edge.
+ *
+ * @param svc Service state to initialize; must stay valid while it runs.
+ * @param cfg Configuration (copied).
+ * @return
+ *     - ESP_OK on success, also if the RTC could not be read (the next update retries)
+ *       or its square wave could not be started (the service polls it then).
+ *     - ESP_ERR_INVALID_ARG if a pointer is NULL.
+ */
+esp_err_t time_service_init(time_service_t *svc, const time_service_config_t *cfg);
+
+/**
+ * @brief Start the service task, which runs time_service_update in a loop.
+ *
+ * @param svc Initialized service.
+ * @param task_priority FreeRTOS priority; above the consumers, so they see each second at once.
+ * @param core Core to pin the task to, or tskNO_AFFINITY.
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_STATE if the task already runs.
+ *     - ESP_ERR_NO_MEM if the task cannot be created.
+ */
+esp_err_t time_service_start(time_service_t *svc, UBaseType_t task_priority, BaseType_t core);
+
+/**
+ * @brief Wait for the next second, resync the system clock when due, publish the second
+ *        and notify the subscribers of what changed.
+ *
+ * Called by the service task; call it directly in a loop when no task was started.
+ *
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if svc is NULL.
+ *     - ESP_ERR_INVALID_STATE while the system clock has never been set (RTC unreadable).
+ *     - The error of the resync's RTC read; the system clock keeps running meanwhile.
+ */
+esp_err_t time_service_update(time_service_t *svc);
+
+/**
+ * @brief Notify a task of the given changes from now on.
+ *
+ * A task already subscribed gets the new mask. If the time is known, the task is notified
+ * of all its events right away, so it can draw the current time without a special case.
+ *
+ * @param svc Initialized service.
+ * @param task Task to notify.
+ * @param events TIME_EVENT_* mask.
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if svc or task is NULL or events has no TIME_EVENT_* bit.
+ *     - ESP_ERR_NO_MEM if TIME_SERVICE_MAX_SUBSCRIBERS tasks are subscribed.
+ */
+esp_err_t time_service_subscribe(time_service_t *svc, TaskHandle_t task, uint32_t events);
+
+/**
+ * @brief Stop notifying a task.
+ *
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if svc is NULL.
+ *     - ESP_ERR_NOT_FOUND if the task is not subscribed.
+ */
+esp_err_t time_service_unsubscribe(time_service_t *svc, TaskHandle_t task);
+
+/**
+ * @brief Copy the second last published. Never blocks: a copy overlapping an update is retried.
+ *
+ * For sub-second time use gettimeofday once the service is initialized.
+ *
+ * @param svc Initialized service.
+ * @param time Out: the local time of the last update.
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if a pointer is NULL.
+ *     - ESP_ERR_INVALID_STATE if the system clock has not been set from the RTC yet.
+ */
+esp_err_t time_service_get(const time_service_t *svc, struct tm *time);
+
+/**
+ * @brief Clear svc->stats.
+ */
+void time_service_reset_stats(time_service_t *svc);
+
+#endif // TIME_SERVICE_H
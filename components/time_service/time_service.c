@@ -0,0 +1,238 @@
+#include "time_service.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "time_service";
+
+// Seqlock writer: readers retry a copy that saw an odd or changed sequence number
+static void publish(time_service_t *svc, const struct tm *time) {
+    uint32_t seq = svc->seq;
+    __atomic_store_n(&svc->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    svc->time = *time;
+    svc->valid = true;
+    __atomic_store_n(&svc->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+static uint32_t changes(const struct tm *from, const struct tm *to) {
+    if (from->tm_mday != to->tm_mday || from->tm_mon != to->tm_mon || from->tm_year != to->tm_year) {
+        return TIME_EVENT_ALL;
+    }
+    if (from->tm_hour != to->tm_hour) return TIME_EVENT_HOUR | TIME_EVENT_MINUTE | TIME_EVENT_SECOND;
+    if (from->tm_min != to->tm_min) return TIME_EVENT_MINUTE | TIME_EVENT_SECOND;
+    if (from->tm_sec != to->tm_sec) return TIME_EVENT_SECOND;
+    return 0;
+}
+
+static void notify(time_service_t *svc, uint32_t events) {
+    xSemaphoreTake(svc->lock, portMAX_DELAY);
+    for (size_t i = 0; i < svc->num_subscribers; i++) {
+        uint32_t bits = svc->subscribers[i].events & events;
+        if (!bits) continue;
+        xTaskNotify(svc->subscribers[i].task, bits, eSetBits);
+        svc->stats.notifications++;
+    }
+    xSemaphoreGive(svc->lock);
+}
+
+static void set_clock(int64_t us) {
+    struct timeval tv = {.tv_sec = us / 1000000, .tv_usec = us % 1000000};
+    settimeofday(&tv, NULL);
+}
+
+// The RTC keeps local time, as do the tm structs published
+static int64_t rtc_to_us(const struct tm *time) {
+    struct tm copy = *time;
+    copy.tm_isdst = -1; // not kept by the RTC
+    return (int64_t)mktime(&copy) * 1000000;
+}
+
+// Reads the RTC and corrects the system clock. edge_us is the esp_timer time of the SQW edge
+// just taken, where the RTC's second began; NULL when only whole seconds can be compared.
+static esp_err_t resync(time_service_t *svc, const int64_t *edge_us) {
+    struct tm rtc_time;
+    esp_err_t ret = rtc_tick_read(&svc->tick, &rtc_time);
+    if (ret != ESP_OK) {
+        svc->stats.read_errors++;
+        return ret;
+    }
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    int64_t timer_us = esp_timer_get_time();
+    int64_t rtc_us = rtc_to_us(&rtc_time);
+    if (edge_us) {
+        rtc_us += timer_us - *edge_us;
+    } else if (svc->clock_set) {
+        rtc_us += now.tv_usec; // sub-second unknown: taken as right
+    }
+
+    int64_t offset = rtc_us - ((int64_t)now.tv_sec * 1000000 + now.tv_usec);
+    bool align = edge_us && !svc->aligned;
+    if (!svc->clock_set || align || llabs(offset) > TIME_SERVICE_SLEW_MAX_US) {
+        set_clock(rtc_us);
+        if (svc->clock_set) svc->stats.steps++;
+    } else if (offset) {
+        struct timeval delta = {.tv_sec = offset / 1000000, .tv_usec = offset % 1000000};
+        adjtime(&delta, NULL);
+        svc->stats.slews++;
+    }
+
+    if (svc->clock_set) {
+        svc->stats.resyncs++;
+        svc->stats.last_offset_us = offset;
+        // Offsets before the alignment are whole seconds, not drift
+        if (svc->aligned) {
+            if ((uint64_t)llabs(offset) > svc->stats.max_offset_us) svc->stats.max_offset_us = llabs(offset);
+            svc->stats.drift_ppm = -(float)offset * 1e6f / (float)(timer_us - svc->synced_at_us);
+        }
+        ESP_LOGI(TAG, "System clock %s by %lld us", offset > 0 ? "behind the RTC" : "ahead of the RTC",
+                 llabs(offset));
+    }
+    if (edge_us) svc->aligned = true;
+    svc->synced_at_us = timer_us;
+    svc->clock_set = true;
+    return ESP_OK;
+}
+
+esp_err_t time_service_init(time_service_t *svc, const time_service_config_t *cfg) {
+    if (!svc || !cfg) return ESP_ERR_INVALID_ARG;
+
+    memset(svc, 0, sizeof(*svc));
+    svc->resync_s = cfg->resync_s;
+    svc->lock = xSemaphoreCreateMutexStatic(&svc->lock_buf);
+    esp_err_t ret = rtc_tick_init(&svc->tick, &cfg->tick);
+    if (ret != ESP_OK) return ret;
+
+    // rtc_tick_init has read the RTC already: whole seconds now, the sub-second at the first edge
+    if (svc->tick.valid) {
+        set_clock(rtc_to_us(&svc->tick.time));
+        svc->synced_at_us = esp_timer_get_time();
+        svc->clock_set = true;
+        publish(svc, &svc->tick.time);
+    }
+    return ESP_OK;
+}
+
+static void service_task(void *param) {
+    time_service_t *svc = param;
+    while (1) {
+        time_service_update(svc);
+    }
+}
+
+esp_err_t time_service_start(time_service_t *svc, UBaseType_t task_priority, BaseType_t core) {
+    if (!svc) return ESP_ERR_INVALID_ARG;
+    if (svc->task) return ESP_ERR_INVALID_STATE;
+    if (xTaskCreatePinnedToCore(service_task, "time_service", TIME_SERVICE_STACK_SIZE, svc,
+                                task_priority, &svc->task, core) != pdPASS) {
+        svc->task = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "Service task started (%s)",
+             svc->tick.cfg.sqw_gpio == GPIO_NUM_NC ? "polling the RTC" : "SQW ticks");
+    return ESP_OK;
+}
+
+esp_err_t time_service_update(time_service_t *svc) {
+    if (!svc) return ESP_ERR_INVALID_ARG;
+
+    bool sqw = svc->tick.cfg.sqw_gpio != GPIO_NUM_NC;
+    int64_t edge_us;
+    bool edge = false;
+    if (sqw) {
+        // A missing edge costs a late second; the system clock keeps the time meanwhile
+        edge = rtc_tick_wait_edge(&svc->tick, pdMS_TO_TICKS(RTC_TICK_TIMEOUT_MS), &edge_us) == ESP_OK;
+    } else {
+        // Just past the system clock's next second
+        struct timeval now;
+        gettimeofday(&now, NULL);
+        uint32_t wait_us = svc->clock_set ? 1000000 - now.tv_usec : 1000000;
+        vTaskDelay((wait_us + portTICK_PERIOD_MS * 1000 - 1) / (portTICK_PERIOD_MS * 1000));
+    }
+
+    // Drift is only measured at an edge; without the pin, whole seconds are all there is
+    bool measurable = edge || !sqw;
+    bool due = svc->resync_s && esp_timer_get_time() - svc->synced_at_us >= (int64_t)svc->resync_s * 1000000;
+    if (!svc->clock_set || (edge && !svc->aligned) || (measurable && due)) {
+        esp_err_t ret = resync(svc, edge ? &edge_us : NULL);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to read time from DS1307: %s", esp_err_to_name(ret));
+            if (!svc->clock_set) return ret;
+        }
+    }
+
+    // At an edge the system clock may be a hair behind the RTC: take the nearest second
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    time_t sec = now.tv_sec + (edge && now.tv_usec >= 500000);
+    struct tm time;
+    localtime_r(&sec, &time);
+
+    uint32_t events = svc->valid ? changes(&svc->time, &time) : TIME_EVENT_ALL;
+    publish(svc, &time);
+    svc->stats.updates++;
+    if (events & TIME_EVENT_SECOND) svc->stats.seconds++;
+    if (events & TIME_EVENT_MINUTE) svc->stats.minutes++;
+    if (events & TIME_EVENT_HOUR) svc->stats.hours++;
+    if (events & TIME_EVENT_DAY) svc->stats.days++;
+    if (events) notify(svc, events);
+    return ESP_OK;
+}
+
+esp_err_t time_service_subscribe(time_service_t *svc, TaskHandle_t task, uint32_t events) {
+    if (!svc || !task || !(events & TIME_EVENT_ALL)) return ESP_ERR_INVALID_ARG;
+    events &= TIME_EVENT_ALL;
+
+    xSemaphoreTake(svc->lock, portMAX_DELAY);
+    size_t i = 0;
+    while (i < svc->num_subscribers && svc->subscribers[i].task != task) i++;
+    if (i == TIME_SERVICE_MAX_SUBSCRIBERS) {
+        xSemaphoreGive(svc->lock);
+        return ESP_ERR_NO_MEM;
+    }
+    if (i == svc->num_subscribers) svc->num_subscribers++;
+    svc->subscribers[i] = (time_service_subscriber_t){task, events};
+    xSemaphoreGive(svc->lock);
+
+    if (svc->valid) {
+        xTaskNotify(task, events, eSetBits);
+        svc->stats.notifications++;
+    }
+    return ESP_OK;
+}
+
+esp_err_t time_service_unsubscribe(time_service_t *svc, TaskHandle_t task) {
+    if (!svc) return ESP_ERR_INVALID_ARG;
+
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    xSemaphoreTake(svc->lock, portMAX_DELAY);
+    for (size_t i = 0; i < svc->num_subscribers; i++) {
+        if (svc->subscribers[i].task != task) continue;
+        svc->subscribers[i] = svc->subscribers[--svc->num_subscribers];
+        ret = ESP_OK;
+        break;
+    }
+    xSemaphoreGive(svc->lock);
+    return ret;
+}
+
+esp_err_t time_service_get(const time_service_t *svc, struct tm *time) {
+    if (!svc || !time) return ESP_ERR_INVALID_ARG;
+
+    uint32_t seq;
+    bool valid = false;
+    do {
+        seq = __atomic_load_n(&svc->seq, __ATOMIC_ACQUIRE);
+        if (seq & 1) continue;
+        *time = svc->time;
+        valid = svc->valid;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((seq & 1) || __atomic_load_n(&svc->seq, __ATOMIC_RELAXED) != seq);
+    return valid ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+void time_service_reset_stats(time_service_t *svc) {
+    if (svc) memset(&svc->stats, 0, sizeof(svc->stats));
+}
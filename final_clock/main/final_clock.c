@@ -4,11 +4,21 @@
 #include <freertos/task.h>
 #include <esp_log.h>
 #include <esp_err.h>
+#include <esp_timer.h>
 #include <time.h>
+#include <sys/time.h>
 #include <string.h>
 #include "ds1307.h"
 #include "pca9685.h"
 #include "HD44780.h"
+#include "segment_display.h"
+#include "i2c_bus.h"
+#include "i2c_exec.h"
+#include "time_service.h"
+#include "servo_cal.h"
+#include "frame_store.h"
+#include "fast_boot.h"
+#include "nvs_flash.h"
 #include "freertos/portmacro.h"
 #include "sdkconfig.h"
 #include <driver/i2c.h>
@@ -17,6 +27,37 @@
 #define SDA_GPIO 21
 #define SCL_GPIO 22
 #define I2C_PORT I2C_NUM_0
+#define SDA2_GPIO 25   // Second controller, only wired in the split layouts
+#define SCL2_GPIO 26
+#define I2C_PORT2 I2C_NUM_1
+// DS1307 SQW/OUT, ticking the main loop once a second; GPIO_NUM_NC polls the RTC instead
+#define SQW_GPIO GPIO_NUM_27
+// The ESP32 keeps the time in its system clock, corrected from the RTC this often
+#define RTC_RESYNC_S 3600
+
+// Bus layout: which hardware I2C controller each device sits on
+#define BUS_LAYOUT_SINGLE       0 // everything on I2C_PORT
+#define BUS_LAYOUT_SPLIT_PCA    1 // PCA1 + LCD + RTC on I2C_PORT, PCA2 on I2C_PORT2
+#define BUS_LAYOUT_SPLIT_PERIPH 2 // both PCAs on I2C_PORT, LCD + RTC on I2C_PORT2
+#ifndef BUS_LAYOUT
+#define BUS_LAYOUT BUS_LAYOUT_SINGLE
+#endif
+
+#if BUS_LAYOUT == BUS_LAYOUT_SPLIT_PCA
+#define PCA1_PORT   I2C_PORT
+#define PCA2_PORT   I2C_PORT2
+#define PERIPH_PORT I2C_PORT
+#elif BUS_LAYOUT == BUS_LAYOUT_SPLIT_PERIPH
+#define PCA1_PORT   I2C_PORT
+#define PCA2_PORT   I2C_PORT
+#define PERIPH_PORT I2C_PORT2
+#else
+#define PCA1_PORT   I2C_PORT
+#define PCA2_PORT   I2C_PORT
+#define PERIPH_PORT I2C_PORT
+#endif
+#define PORT_SDA(port) ((port) == I2C_PORT ? SDA_GPIO : SDA2_GPIO)
+#define PORT_SCL(port) ((port) == I2C_PORT ? SCL_GPIO : SCL2_GPIO)
 
 // LCD Configuration
 #define LCD_ADDR 0x27  // Common I2C address for PCF8574
@@ -27,14 +68,56 @@
 #define PCA1_ADDR 0x40  // First controller (digits 1-2)
 #define PCA2_ADDR 0x41  // Second controller (digits 3-4)
 
-// Segment to servo mapping (7 servos per digit)
-#define DIGIT1_SEGMENTS {0, 1, 2, 3, 4, 5, 6}    // First digit (PCA1)
-#define DIGIT2_SEGMENTS {7, 8, 9, 10, 11, 12, 13} // Second digit (PCA1)
-#define DIGIT3_SEGMENTS {0, 1, 2, 3, 4, 5, 6}    // Third digit (PCA2)
-#define DIGIT4_SEGMENTS {7, 8, 9, 10, 11, 12, 13} // Fourth digit (PCA2)
+// Segment to servo mapping (7 consecutive servos per digit, segment A first)
+#define DIGIT1_FIRST_CHANNEL PCA9685_CHANNEL_0   // First digit (PCA1, channels 0-6)
+#define DIGIT2_FIRST_CHANNEL PCA9685_CHANNEL_7   // Second digit (PCA1, channels 7-13)
+#define DIGIT3_FIRST_CHANNEL PCA9685_CHANNEL_0   // Third digit (PCA2, channels 0-6)
+#define DIGIT4_FIRST_CHANNEL PCA9685_CHANNEL_7   // Fourth digit (PCA2, channels 7-13)
+
+// Servo calibration: the defaults for servos without a per-channel entry in NVS
+#define SERVO_FREQ_HZ 50
+#define PULSE_0DEG 660   // 0 degrees posiidf.tion
+#define PULSE_90DEG 1500 // 90 degrees position
+#define NVS_NAMESPACE "clock"
+
+// Segment flips are eased over FLIP_TIME_MS by the motion engine's 50 Hz task;
+// 0 snaps them, sent as one frame per second from the main loop
+#define FLIP_TIME_MS 400
+#define FLIP_PROFILE SERVO_MOTION_S_CURVE
+// Power budget: at most FLIP_MAX_MOVING servos travel at once, the rest wait their turn.
+// Supply current per servo (typical SG90 figures, measure your own) for the estimate log.
+#define FLIP_MAX_MOVING 8
+#define SERVO_MOVE_MA 250
+#define SERVO_HOLD_MA 10
+// Holding pulses are switched off IDLE_OFF_MS after a flip and back on HOLD_AHEAD_S
+// before the next minute (must be below IDLE_OFF_MS); 0 holds all the time
+#define IDLE_OFF_MS 3000
+#define HOLD_AHEAD_S 2
+// The next minute's digits are staged LAND_AHEAD_S early and launched so the last segment
+// settles on the minute boundary (0 flips at the change). SERVO_SETTLE_MS is how long a
+// servo trails its last pulse; the lead must fit in LAND_AHEAD_S, or the flip lands late.
+#define LAND_AHEAD_S 2
+#define SERVO_SETTLE_MS 120
+
+// Segment A-G channels of each digit, left to right; controller 0 = PCA1, 1 = PCA2
+static const segment_channel_t digit_map[4][7] = {
+    SEGMENT_DIGIT_CHANNELS(0, DIGIT1_FIRST_CHANNEL),
+    SEGMENT_DIGIT_CHANNELS(0, DIGIT2_FIRST_CHANNEL),
+    SEGMENT_DIGIT_CHANNELS(1, DIGIT3_FIRST_CHANNEL),
+    SEGMENT_DIGIT_CHANNELS(1, DIGIT4_FIRST_CHANNEL),
+};
 
 static const char *TAG = "final_clock";
 static i2c_dev_t dev;
+static i2c_bus_client_t rtc_client, nvram_client;
+static time_service_t time_svc;
+static servo_cal_t servo_cal;
+static frame_store_t frame_store;
+static pca9685_dev_t pca1, pca2;
+static segment_display_frame_t saved_frame;
+static esp_err_t saved_frame_err;
+static fast_boot_t boot;
+static volatile bool date_shown;
 
 // Day names
 const char *day_names[7] = {
@@ -42,132 +125,347 @@ const char *day_names[7] = {
     "Wednesday", "Thursday", "Friday", "Saturday"
 };
 
-// 7-segment patterns (common cathode)
-const uint8_t digit_patterns[10] = {
-    0x3F, // 0 - ABCDEF
-    0x06, // 1 - BC
-    0x5B, // 2 - ABGED
-    0x4F, // 3 - ABGCD
-    0x66, // 4 - FBGC
-    0x6D, // 5 - AFGCD
-    0x7D, // 6 - AFGECD
-    0x07, // 7 - ABC
-    0x7F, // 8 - ABCDEFG
-    0x6F  // 9 - ABCDFG
-};
+// Write date and day to the LCD, padded to full width so no clear (and flicker) is needed
+void show_date(const struct tm *time) {
+    char date_str[LCD_COLS + 1];
+    char line[LCD_COLS + 1];
 
-void set_digit(pca9685_dev_t *pca, const uint8_t segments[7], uint8_t digit, 
-               uint16_t pulse_0deg, uint16_t pulse_90deg) {
-    uint8_t pattern = digit_patterns[digit % 10];
-    for (int seg = 0; seg < 7; seg++) {
-        uint16_t pulse = (pattern & (1 << seg)) ? pulse_90deg : pulse_0deg;
-        pca9685_set_servo_pulse(pca, segments[seg], pulse);
-    }
+    strftime(date_str, sizeof(date_str), "Date: %d/%m", time);
+    snprintf(line, sizeof(line), "%-*s", LCD_COLS, date_str);
+    LCD_setCursor(0, 0);
+    LCD_writeStr(line);
+
+    snprintf(line, sizeof(line), "%-*s", LCD_COLS, day_names[time->tm_wday]);
+    LCD_setCursor(0, 1);
+    LCD_writeStr(line);
+}
+
+// Stage all 4 digits; every changed segment on both controllers flips together
+static void set_digits(segment_display_t *display, const struct tm *time) {
+    segment_display_set_digit(display, 0, time->tm_hour / 10);
+    segment_display_set_digit(display, 1, time->tm_hour % 10);
+    segment_display_set_digit(display, 2, time->tm_min / 10);
+    segment_display_set_digit(display, 3, time->tm_min % 10);
 }
 
-void clock_display_task(void *param) {
-    char date_str[16];
-    char day_str[10];
-    
+// The LCD shows only the date and weekday, so it is redrawn when the day changes (and once
+// when subscribing); the redraw goes out at low priority behind the servo frames
+static void lcd_task(void *param) {
+    static i2c_batch_t lcd_batch;
+    ESP_ERROR_CHECK(time_service_subscribe(&time_svc, xTaskGetCurrentTaskHandle(), TIME_EVENT_DAY));
     while (1) {
+        uint32_t events = 0;
+        xTaskNotifyWait(0, TIME_EVENT_ALL, &events, portMAX_DELAY);
         struct tm time;
-        if (ds1307_get_time(&dev, &time) == ESP_OK) {
-            // Format date and day
-            strftime(date_str, sizeof(date_str), "Date: %d/%m", &time);
-            strncpy(day_str, day_names[time.tm_wday], sizeof(day_str)-1);
-            day_str[sizeof(day_str)-1] = '\0';
-            
-            // Update LCD display
-            LCD_clearScreen();
-            LCD_setCursor(0, 0);
-            LCD_writeStr(date_str);
-            LCD_setCursor(0, 1);
-            LCD_writeStr(day_str);
+        if (time_service_get(&time_svc, &time) != ESP_OK) continue;
+
+        i2c_batch_begin(&lcd_batch);
+        LCD_setBatch(&lcd_batch);
+        show_date(&time);
+        LCD_setBatch(NULL);
+        esp_err_t err = i2c_exec_run(PERIPH_PORT, &lcd_batch, I2C_EXEC_PRIO_LOW);
+        if (err != ESP_OK) ESP_LOGE(TAG, "LCD redraw failed: %s", esp_err_to_name(err));
+        if (!date_shown) {
+            fast_boot_mark(&boot, "date shown");
+            date_shown = true;
         }
-        vTaskDelay(1000 / portTICK_PERIOD_MS);
     }
 }
 
-void app_main(void) {
-    // Configure I2C
-    i2c_config_t conf = {
-        .mode = I2C_MODE_MASTER,
-        .sda_io_num = SDA_GPIO,
-        .scl_io_num = SCL_GPIO,
-        .sda_pullup_en = GPIO_PULLUP_ENABLE,
-        .scl_pullup_en = GPIO_PULLUP_ENABLE,
-        .master.clk_speed = 100000
-    };
-    ESP_ERROR_CHECK(i2c_param_config(I2C_PORT, &conf));
-    ESP_ERROR_CHECK(i2c_driver_install(I2C_PORT, conf.mode, 0, 0, 0));
-    ESP_LOGI(TAG, "I2C bus initialized");
-    vTaskDelay(500 / portTICK_PERIOD_MS);
-
-    // Initialize LCD
-    ESP_LOGI(TAG, "Initializing LCD...");
-    LCD_init(LCD_ADDR, SDA_GPIO, SCL_GPIO, LCD_COLS, LCD_ROWS);
-    LCD_clearScreen();
+// Bring-up steps, run concurrently by fast_boot_run. Per-servo calibration lives in NVS;
+// servos without it take PULSE_0DEG/PULSE_90DEG.
+static esp_err_t nvs_step(void *ctx) {
+    esp_err_t err = nvs_flash_init();
+    if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        err = nvs_flash_erase();
+        if (err == ESP_OK) err = nvs_flash_init();
+    }
+    if (err != ESP_OK) return err;
+    esp_err_t cal_err = servo_cal_load(&servo_cal, NVS_NAMESPACE);
+    if (cal_err == ESP_OK) {
+        ESP_LOGI(TAG, "Servo calibration loaded from NVS");
+        return ESP_OK;
+    }
+    if (cal_err != ESP_ERR_NOT_FOUND) ESP_LOGW(TAG, "Servo calibration unusable: %s", esp_err_to_name(cal_err));
+    return servo_cal_init(&servo_cal, 0, 0, 0);
+}
+
+// The LCD's reset waits leave the bus to the other steps
+static esp_err_t lcd_step(void *ctx) {
+    LCD_initOnPort(PERIPH_PORT, LCD_ADDR, PORT_SDA(PERIPH_PORT), PORT_SCL(PERIPH_PORT), LCD_COLS, LCD_ROWS);
     LCD_writeStr("Clock Starting...");
-    vTaskDelay(100 / portTICK_PERIOD_MS);
+    return ESP_OK;
+}
 
-    // Initialize DS1307 RTC
-    ESP_LOGI(TAG, "Initializing DS1307...");
-    esp_err_t rtc_err = ds1307_init_desc(&dev, I2C_PORT, SDA_GPIO, SCL_GPIO);
+// Both controllers asleep to awake at SERVO_FREQ_HZ, one transaction each
+static esp_err_t pca_step(void *ctx) {
+    esp_err_t err = pca9685_init_frequency(&pca1, PCA1_PORT, PCA1_ADDR, SERVO_FREQ_HZ);
+    if (err != ESP_OK) return err;
+    return pca9685_init_frequency(&pca2, PCA2_PORT, PCA2_ADDR, SERVO_FREQ_HZ);
+}
+
+// The time service owns the RTC: it loads it into the system clock, wakes on each second
+// edge of the SQW pin, reads the chip only to resync, and notifies each display of the
+// changes it shows. The frame the servos were left at comes from the same chip's NVRAM.
+static esp_err_t rtc_step(void *ctx) {
+    i2c_bus_acquire(&rtc_client, portMAX_DELAY);
+    esp_err_t rtc_err = ds1307_init_desc(&dev, PERIPH_PORT, PORT_SDA(PERIPH_PORT), PORT_SCL(PERIPH_PORT));
+    i2c_bus_release(&rtc_client);
     if (rtc_err != ESP_OK) {
         ESP_LOGE(TAG, "DS1307 init failed: %s", esp_err_to_name(rtc_err));
     } else {
         ESP_LOGI(TAG, "DS1307 initialized successfully");
     }
-    vTaskDelay(500 / portTICK_PERIOD_MS);
-
-    // Initialize PCA9685 controllers
-    ESP_LOGI(TAG, "Initializing PCA9685 controllers...");
-    pca9685_dev_t pca1, pca2;
-
-    // First PCA (digits 1-2)
-    ESP_ERROR_CHECK(pca9685_init(&pca1, I2C_PORT, PCA1_ADDR));
-    ESP_ERROR_CHECK(pca9685_set_frequency(&pca1, 50));
-    ESP_LOGI(TAG, "PCA9685 @ 0x%02X initialized (digits 1-2)", PCA1_ADDR);
-    
-    // Second PCA (digits 3-4)
-    ESP_ERROR_CHECK(pca9685_init(&pca2, I2C_PORT, PCA2_ADDR));
-    ESP_ERROR_CHECK(pca9685_set_frequency(&pca2, 50));
-    ESP_LOGI(TAG, "PCA9685 @ 0x%02X initialized (digits 3-4)", PCA2_ADDR);
-    
-    vTaskDelay(500 / portTICK_PERIOD_MS);
-
-    const uint16_t pulse_0deg = 660;  // 0 degrees posiidf.tion
-    const uint16_t pulse_90deg = 1500; // 90 degrees position
-    
-    // Segment mappings for each digit
-    const uint8_t digit1_segments[7] = DIGIT1_SEGMENTS;
-    const uint8_t digit2_segments[7] = DIGIT2_SEGMENTS;
-    const uint8_t digit3_segments[7] = DIGIT3_SEGMENTS;
-    const uint8_t digit4_segments[7] = DIGIT4_SEGMENTS;
-
-    // Create clock display task
-    xTaskCreate(&clock_display_task, "Clock Display", 2048, NULL, 5, NULL);
+    esp_err_t err = frame_store_init(&frame_store, &dev, &nvram_client);
+    saved_frame_err = err == ESP_OK ? frame_store_load(&frame_store, &saved_frame) : err;
+    // RTC trouble is logged, never fatal: without SQW the service polls the chip, and a
+    // failed read is retried by the next update
+    const time_service_config_t time_cfg = {
+        .tick = {.rtc = &dev, .bus = &rtc_client, .sqw_gpio = SQW_GPIO},
+        .resync_s = RTC_RESYNC_S,
+    };
+    err = time_service_init(&time_svc, &time_cfg);
+    if (err != ESP_OK) ESP_LOGE(TAG, "Time service init failed: %s", esp_err_to_name(err));
+    return ESP_OK;
+}
+
+// A servo whose swing, timed by set_servo_zero, is slower than the flip trails the eased
+// pulse by the difference; a snapped one (FLIP_TIME_MS 0) by the whole swing
+static void apply_servo_travel(servo_motion_t *motion, pca9685_dev_t *const controllers[2]) {
+    for (size_t c = 0; c < 2; c++) {
+        for (int ch = 0; ch < PCA9685_CHANNEL_COUNT; ch++) {
+            const servo_cal_entry_t *entry = servo_cal_get(&servo_cal, c, ch);
+            if (!entry || !entry->travel_ms || entry->travel_ms <= FLIP_TIME_MS + SERVO_SETTLE_MS) continue;
+            servo_motion_set_settle(motion, controllers[c], ch, entry->travel_ms - FLIP_TIME_MS);
+        }
+    }
+}
+
+void app_main(void) {
+    // Configure I2C: the single init point for the port(s) shared by LCD, RTC and PCA9685s
+    ESP_ERROR_CHECK(i2c_bus_init(I2C_PORT, SDA_GPIO, SCL_GPIO, 100000));
+    if (BUS_LAYOUT != BUS_LAYOUT_SINGLE) {
+        ESP_ERROR_CHECK(i2c_bus_init(I2C_PORT2, SDA2_GPIO, SCL2_GPIO, 100000));
+    }
+    ESP_ERROR_CHECK(i2c_bus_client_init(&rtc_client, PERIPH_PORT, "ds1307"));
+    ESP_ERROR_CHECK(i2c_bus_client_init(&nvram_client, PERIPH_PORT, "ds1307 nvram"));
+    ESP_LOGI(TAG, "I2C bus initialized (layout %d)", BUS_LAYOUT);
+
+    // NVS, LCD, PCA9685s and RTC come up at once: each step on its own task, with only the
+    // datasheet waits, so the LCD's reset delays overlap the other devices' transfers
+    ESP_ERROR_CHECK(fast_boot_init(&boot));
+    const fast_boot_step_t bring_up[] = {
+        {"nvs", nvs_step, NULL},
+        {"lcd", lcd_step, NULL},
+        {"pca9685", pca_step, NULL},
+        {"ds1307", rtc_step, NULL},
+    };
+    ESP_ERROR_CHECK(fast_boot_run(&boot, bring_up, sizeof(bring_up) / sizeof(bring_up[0]), 5));
+    ESP_LOGI(TAG, "PCA9685 @ 0x%02X and 0x%02X at %.2f Hz", PCA1_ADDR, PCA2_ADDR, pca1.pwm_freq_hz);
+
+    int phase = fast_boot_begin(&boot, "display");
+    // The display owns the segment state: only segments that change get staged
+    pca9685_dev_t *const controllers[] = {&pca1, &pca2};
+    static servo_motion_t motion;
+    const servo_motion_config_t motion_cfg = {
+        .controllers = controllers,
+        .num_controllers = 2,
+        .profile = FLIP_PROFILE,
+        .duration_ms = FLIP_TIME_MS,
+        .max_moving = FLIP_MAX_MOVING,
+        .move_current_ma = SERVO_MOVE_MA,
+        .hold_current_ma = SERVO_HOLD_MA,
+        .idle_off_ms = IDLE_OFF_MS,
+        .settle_ms = SERVO_SETTLE_MS,
+    };
+    ESP_ERROR_CHECK(servo_motion_init(&motion, &motion_cfg));
+    apply_servo_travel(&motion, controllers);
+    // Spread the 28 pulses over the 20 ms period instead of all rising at count 0
+    ESP_ERROR_CHECK(pca9685_array_stagger(&motion.array));
+    const segment_display_config_t display_cfg = {
+        .controllers = controllers,
+        .num_controllers = 2,
+        .digits = digit_map,
+        .num_digits = 4,
+        .pulse_off_us = PULSE_0DEG,
+        .pulse_on_us = PULSE_90DEG,
+        .cal = &servo_cal,
+        .motion = FLIP_TIME_MS ? &motion : NULL,
+    };
+    static segment_display_t display;
+    ESP_ERROR_CHECK(segment_display_init(&display, &display_cfg));
+
+    // After a reset the servos still stand at the frame saved in the RTC's NVRAM: take it as
+    // shown, so they get their pulses back without moving and the first minute only flips
+    // what changed. Without a valid record every segment is driven at the first minute.
+    segment_display_frame_t frame = saved_frame;
+    esp_err_t frame_err = saved_frame_err;
+    if (frame_err == ESP_OK) frame_err = segment_display_restore(&display, &frame);
+    if (frame_err == ESP_OK) {
+        ESP_LOGI(TAG, "Display frame restored from the RTC NVRAM");
+    } else if (frame_err != ESP_ERR_NOT_FOUND) {
+        ESP_LOGW(TAG, "Stored display frame unusable: %s", esp_err_to_name(frame_err));
+    }
+    fast_boot_end(&boot, phase, ESP_OK);
+    phase = fast_boot_begin(&boot, "tasks");
 
+    // Bus-owner task per controller: servo frames go out at high priority, LCD redraws at
+    // low priority. With two controllers the executors sit on separate cores, so both
+    // halves of the display refresh in parallel.
+    ESP_ERROR_CHECK(i2c_exec_start(I2C_PORT, 10, 0));
+    if (BUS_LAYOUT != BUS_LAYOUT_SINGLE) {
+        ESP_ERROR_CHECK(i2c_exec_start(I2C_PORT2, 10, 1));
+    }
+    if (FLIP_TIME_MS) {
+        // Above the executors: a tick is a few bytes and must not wait behind an LCD redraw
+        ESP_ERROR_CHECK(servo_motion_start(&motion, 11, 1));
+    }
+    static i2c_batch_t servo_batch, servo_batch2;
+    static i2c_exec_req_t servo_req2;
+    i2c_exec_req_init(&servo_req2);
+
+    ESP_ERROR_CHECK(time_service_start(&time_svc, 9, 0));
+    if (xTaskCreatePinnedToCore(lcd_task, "lcd", 3072, NULL, 1, NULL, 0) != pdPASS) {
+        ESP_LOGE(TAG, "Cannot start the LCD task");
+    }
+    fast_boot_end(&boot, phase, ESP_OK);
+
+    // This task drives the digits on minute changes; it also wakes each second to power the
+    // servos ahead of the next minute and to check the PCA9685 registers
+    ESP_ERROR_CHECK(time_service_subscribe(&time_svc, xTaskGetCurrentTaskHandle(),
+                                           TIME_EVENT_SECOND | TIME_EVENT_MINUTE));
+    int held_min = -1, landed_min = -1;
+    bool digits_shown = false, boot_logged = false;
     while (1) {
+        uint32_t events = 0;
+        xTaskNotifyWait(0, TIME_EVENT_ALL, &events, portMAX_DELAY);
         struct tm time;
-        if (ds1307_get_time(&dev, &time) == ESP_OK) {
-            // Extract digits from time
-            uint8_t hour_tens = time.tm_hour / 10;
-            uint8_t hour_units = time.tm_hour % 10;
-            uint8_t min_tens = time.tm_min / 10;
-            uint8_t min_units = time.tm_min % 10;
+        if (time_service_get(&time_svc, &time) != ESP_OK) continue;
 
+        if (events & TIME_EVENT_MINUTE) {
             ESP_LOGI(TAG, "Time: %02d:%02d", time.tm_hour, time.tm_min);
-            
-            // Update all 4 digits
-            set_digit(&pca1, digit1_segments, hour_tens, pulse_0deg, pulse_90deg);
-            set_digit(&pca1, digit2_segments, hour_units, pulse_0deg, pulse_90deg);
-            set_digit(&pca2, digit3_segments, min_tens, pulse_0deg, pulse_90deg);
-            set_digit(&pca2, digit4_segments, min_units, pulse_0deg, pulse_90deg);
-        } else {
-            ESP_LOGE(TAG, "Failed to read time from DS1307");
+
+            // Launched ahead already unless the clock just started or jumped: nothing left to stage then
+            set_digits(&display, &time);
+
+            if (FLIP_TIME_MS) {
+                // The motion task sends the flips, FLIP_MAX_MOVING at a time
+                servo_motion_estimate_t est;
+                if (servo_motion_estimate(&motion, &est) == ESP_OK && (est.moving || est.pending)) {
+                    ESP_LOGI(TAG, "Flipping %u segments: %lu ms, peak %lu mA",
+                             est.moving + est.pending, (unsigned long)est.total_ms,
+                             (unsigned long)est.peak_current_ma);
+                }
+            } else if (PCA1_PORT == PCA2_PORT) {
+                // One frame, one STOP: both controllers latch together
+                i2c_batch_begin(&servo_batch);
+                segment_display_queue(&display, PCA1_PORT, &servo_batch);
+                i2c_exec_run(PCA1_PORT, &servo_batch, I2C_EXEC_PRIO_HIGH);
+            } else {
+                // Each half on its own controller, started back to back and run in parallel
+                i2c_batch_begin(&servo_batch);
+                i2c_batch_begin(&servo_batch2);
+                segment_display_queue(&display, PCA1_PORT, &servo_batch);
+                segment_display_queue(&display, PCA2_PORT, &servo_batch2);
+                bool second = i2c_exec_submit(PCA2_PORT, &servo_batch2, I2C_EXEC_PRIO_HIGH, &servo_req2) == ESP_OK;
+                i2c_exec_run(PCA1_PORT, &servo_batch, I2C_EXEC_PRIO_HIGH);
+                if (second) i2c_exec_wait(&servo_req2, portMAX_DELAY);
+            }
+
+            if (!digits_shown) {
+                // Boot only: follow the first flips tick by tick to time the first right display
+                while (FLIP_TIME_MS && servo_motion_moving(&motion)) vTaskDelay(1);
+                fast_boot_mark(&boot, "digits shown");
+                digits_shown = true;
+            }
+
+            // Unchanged segments never reach the bus; report the savings and bus usage once a minute
+            ESP_LOGI(TAG, "Servo writes issued/suppressed: PCA1 %lu/%lu, PCA2 %lu/%lu",
+                     (unsigned long)pca1.stats.writes_issued, (unsigned long)pca1.stats.writes_suppressed,
+                     (unsigned long)pca2.stats.writes_issued, (unsigned long)pca2.stats.writes_suppressed);
+            ESP_LOGI(TAG, "Register checks: %lu, resets restored: %lu, LEDn mismatches: %lu",
+                     (unsigned long)(pca1.stats.checks + pca2.stats.checks),
+                     (unsigned long)(pca1.stats.resets_detected + pca2.stats.resets_detected),
+                     (unsigned long)(pca1.stats.led_mismatches + pca2.stats.led_mismatches));
+            if (FLIP_TIME_MS) {
+                ESP_LOGI(TAG, "Motion: %lu moves, max %u moving, max tick %lu us, %lu overruns",
+                         (unsigned long)motion.stats.moves, motion.stats.max_moving,
+                         (unsigned long)motion.stats.max_tick_us, (unsigned long)motion.stats.overruns);
+                servo_motion_energy_t energy;
+                servo_motion_energy(&motion, &energy);
+                ESP_LOGI(TAG, "Idle servos off %.1f%% of the time: %.1f mAh held, %.1f mAh saved",
+                         energy.off_pct, energy.hold_mah, energy.saved_mah);
+                ESP_LOGI(TAG, "Landings: %lu, last %+ld us from the minute (lead %lu ms), max %lu us",
+                         (unsigned long)motion.stats.landings, (long)motion.stats.last_landing_us,
+                         (unsigned long)motion.stats.last_lead_ms, (unsigned long)motion.stats.max_landing_us);
+            }
+            const rtc_tick_stats_t *rtc_stats = &time_svc.tick.stats;
+            const time_service_stats_t *clock_stats = &time_svc.stats;
+            ESP_LOGI(TAG, "RTC: %lu reads, %lu SQW edges, %lu timeouts, %lu frames saved to NVRAM",
+                     (unsigned long)rtc_stats->rtc_reads, (unsigned long)rtc_stats->edges,
+                     (unsigned long)rtc_stats->timeouts, (unsigned long)frame_store.stats.saves);
+            ESP_LOGI(TAG, "System clock: %lu resyncs (%lu slewed, %lu stepped), last offset %ld us, "
+                     "max %lu us, drift %.1f ppm", (unsigned long)clock_stats->resyncs,
+                     (unsigned long)clock_stats->slews, (unsigned long)clock_stats->steps,
+                     (long)clock_stats->last_offset_us, (unsigned long)clock_stats->max_offset_us,
+                     clock_stats->drift_ppm);
+            i2c_bus_log_stats(I2C_PORT);
+            if (BUS_LAYOUT != BUS_LAYOUT_SINGLE) i2c_bus_log_stats(I2C_PORT2);
+            // Least stack left so far, to keep the task stack sizes honest
+            ESP_LOGI(TAG, "Stack headroom: servo_motion %u, i2c_exec %u/%u bytes",
+                     motion.task ? (unsigned)uxTaskGetStackHighWaterMark(motion.task) : 0,
+                     (unsigned)uxTaskGetStackHighWaterMark(i2c_exec_task(I2C_PORT)),
+                     i2c_exec_task(I2C_PORT2) ? (unsigned)uxTaskGetStackHighWaterMark(i2c_exec_task(I2C_PORT2)) : 0);
+        }
+
+        if (digits_shown && date_shown && !boot_logged) {
+            fast_boot_log(&boot);
+            int64_t shown_us = fast_boot_phase_end(&boot, "digits shown");
+            int64_t date_us = fast_boot_phase_end(&boot, "date shown");
+            ESP_LOGI(TAG, "Display correct %.1f ms after the application start",
+                     (shown_us > date_us ? shown_us : date_us) / 1000.0f);
+            boot_logged = true;
+        }
+
+        if (FLIP_TIME_MS && IDLE_OFF_MS && time.tm_sec >= 60 - HOLD_AHEAD_S && held_min != time.tm_min) {
+            // Servos take hold at their positions before the next minute moves them
+            servo_motion_hold(&motion);
+            held_min = time.tm_min;
+        }
+
+        if (FLIP_TIME_MS && LAND_AHEAD_S && time.tm_sec >= 60 - LAND_AHEAD_S && landed_min != time.tm_min) {
+            // The boundary in esp_timer time, which the motion task runs on (time zones are
+            // whole minutes, so the next UTC minute is the next local one)
+            struct timeval now;
+            gettimeofday(&now, NULL);
+            int64_t timer_now = esp_timer_get_time();
+            time_t next = now.tv_sec - now.tv_sec % 60 + 60;
+            int64_t land_at = timer_now + (int64_t)(next - now.tv_sec) * 1000000 - now.tv_usec;
+            struct tm next_time;
+            localtime_r(&next, &next_time);
+
+            servo_motion_defer(&motion);
+            set_digits(&display, &next_time);
+            uint32_t lead_ms;
+            if (servo_motion_land_at(&motion, land_at, &lead_ms) == ESP_OK && lead_ms) {
+                ESP_LOGI(TAG, "%02d:%02d launches %lu ms ahead of the minute", next_time.tm_hour,
+                         next_time.tm_min, (unsigned long)lead_ms);
+            }
+            landed_min = time.tm_min;
+        }
+
+        // Once the servos stand at a new frame, keep it for the next boot (skipped when unchanged)
+        if ((!FLIP_TIME_MS || servo_motion_moving(&motion) == 0) &&
+            segment_display_get_frame(&display, &frame) == ESP_OK) {
+            esp_err_t err = frame_store_save(&frame_store, &frame);
+            if (err != ESP_OK) ESP_LOGE(TAG, "Saving the display frame failed: %s", esp_err_to_name(err));
+        }
+
+        // Unchanged segments are never rewritten, so a PCA9685 that browned out would stay
+        // blank: read back its configuration and one channel each second, restore it if lost
+        size_t repaired;
+        if (servo_motion_check(&motion, true, &repaired) == ESP_OK && repaired) {
+            ESP_LOGW(TAG, "Restored %u servo controller(s)", (unsigned)repaired);
         }
-        
-        vTaskDelay(1000 / portTICK_PERIOD_MS);
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,155 @@
+// Scaling benchmark for large servo arrays: modeled time of a full-array frame (every
+// servo moves) as PCA9685s are added, at 400 kHz and 1 MHz, for three ways of sending it:
+//   per_servo  pca9685_set_servo_pulse per servo (the old servo_test loop)
+//   per_chip   stage a controller, pca9685_commit it, next controller
+//   array      pca9685_array_stage_pulses over the whole array, one pca9685_array_commit
+// Prints JSON on stdout and a table on stderr; exits non-zero if a model shows the wrong pulse.
+// --txn-overhead-us adds a fixed cost per transaction (driver setup, measured on the target).
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "driver/i2c.h"
+#include "esp_log.h"
+#include "pca9685.h"
+#include "pca9685_array.h"
+#include "sim_bus.h"
+#include "sim_pca9685.h"
+
+#define I2C_PORT I2C_NUM_0
+#define MAX_SERVOS (PCA9685_ARRAY_MAX_CONTROLLERS * PCA9685_CHANNEL_COUNT)
+
+typedef enum { PER_SERVO, PER_CHIP, ARRAY, NUM_STRATEGIES } strategy_t;
+static const char *strategy_names[NUM_STRATEGIES] = {"per_servo", "per_chip", "array"};
+
+typedef struct {
+    unsigned transactions;
+    unsigned bytes;
+    double bus_time_us;
+} frame_cost_t;
+
+static sim_pca9685_t sim_chips[PCA9685_ARRAY_MAX_CONTROLLERS];
+static pca9685_dev_t chips[PCA9685_ARRAY_MAX_CONTROLLERS];
+static pca9685_array_t array;
+static uint16_t frame_a[MAX_SERVOS], frame_b[MAX_SERVOS], uniform_a[MAX_SERVOS], uniform_b[MAX_SERVOS];
+static int failures;
+
+// 0x40-0x7F without the LED All Call address every PCA9685 answers to after power-up
+static uint8_t chip_addr(size_t i) {
+    uint8_t addr = 0x40 + i;
+    return addr >= 0x70 ? addr + 1 : addr;
+}
+
+static void send(strategy_t strategy, size_t num_chips, const uint16_t *pulses) {
+    switch (strategy) {
+    case PER_SERVO:
+        for (size_t s = 0; s < num_chips * PCA9685_CHANNEL_COUNT; s++) {
+            pca9685_set_servo_pulse(&chips[s / PCA9685_CHANNEL_COUNT], s % PCA9685_CHANNEL_COUNT, pulses[s]);
+        }
+        break;
+    case PER_CHIP:
+        for (size_t c = 0; c < num_chips; c++) {
+            pca9685_set_servo_pulses(&chips[c], PCA9685_CHANNEL_0, &pulses[c * PCA9685_CHANNEL_COUNT],
+                                     PCA9685_CHANNEL_COUNT);
+        }
+        break;
+    default:
+        pca9685_array_stage_pulses(&array, 0, pulses, num_chips * PCA9685_CHANNEL_COUNT);
+        if (pca9685_array_commit(&array) != ESP_OK) {
+            failures++;
+            fprintf(stderr, "FAIL: pca9685_array_commit with %u controllers\n", (unsigned)num_chips);
+        }
+        break;
+    }
+}
+
+static void check_pulses(size_t num_chips, const uint16_t *pulses) {
+    for (size_t s = 0; s < num_chips * PCA9685_CHANNEL_COUNT; s++) {
+        int actual = (int)sim_pca9685_pulse_us(&sim_chips[s / PCA9685_CHANNEL_COUNT], s % PCA9685_CHANNEL_COUNT);
+        // one count at 50 Hz is 4.88 us
+        if (actual < pulses[s] - 5 || actual > pulses[s] + 5) {
+            failures++;
+            fprintf(stderr, "FAIL: servo %u shows %d us, expected %u us\n", (unsigned)s, actual, pulses[s]);
+            return;
+        }
+    }
+}
+
+// Cost of going from `from` to `to` on the first num_chips controllers
+static frame_cost_t measure(strategy_t strategy, size_t num_chips, const uint16_t *from, const uint16_t *to) {
+    send(ARRAY, num_chips, from);
+    sim_bus_reset_stats(I2C_PORT);
+    send(strategy, num_chips, to);
+    const sim_bus_stats_t *stats = sim_bus_get_stats(I2C_PORT);
+    frame_cost_t cost = {stats->transactions, stats->bytes, stats->bus_time_ns / 1000.0};
+    check_pulses(num_chips, to);
+    return cost;
+}
+
+int main(int argc, char **argv) {
+    double txn_overhead_us = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--txn-overhead-us") == 0 && i + 1 < argc) {
+            txn_overhead_us = atof(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [--txn-overhead-us US]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    sim_log_level = ESP_LOG_ERROR;
+    sim_bus_reset();
+    sim_bus_set_txn_overhead_ns((uint32_t)(txn_overhead_us * 1000));
+    for (size_t i = 0; i < PCA9685_ARRAY_MAX_CONTROLLERS; i++) {
+        sim_pca9685_init(&sim_chips[i], chip_addr(i));
+        sim_bus_attach(I2C_PORT, &sim_chips[i].dev);
+    }
+    ESP_ERROR_CHECK(i2c_bus_init(I2C_PORT, GPIO_NUM_21, GPIO_NUM_22, 1000000));
+    pca9685_dev_t *controllers[PCA9685_ARRAY_MAX_CONTROLLERS];
+    for (size_t i = 0; i < PCA9685_ARRAY_MAX_CONTROLLERS; i++) {
+        ESP_ERROR_CHECK(pca9685_init(&chips[i], I2C_PORT, chip_addr(i)));
+        ESP_ERROR_CHECK(pca9685_set_frequency(&chips[i], 50));
+        controllers[i] = &chips[i];
+    }
+
+    // Distinct frames move every servo to a different angle; uniform frames move them all alike
+    for (size_t s = 0; s < MAX_SERVOS; s++) {
+        frame_a[s] = 1000 + (s * 37) % 1000;
+        frame_b[s] = frame_a[s] + 500;
+        uniform_a[s] = 1000;
+        uniform_b[s] = 2000;
+    }
+
+    static const uint32_t speeds[] = {400000, 1000000};
+    static const size_t sizes[] = {1, 2, 4, 8, 16, 32, PCA9685_ARRAY_MAX_CONTROLLERS};
+    printf("{\n  \"frames\": [\n");
+    bool first = true;
+    for (size_t k = 0; k < sizeof(speeds) / sizeof(speeds[0]); k++) {
+        sim_bus_set_clock(I2C_PORT, speeds[k]);
+        fprintf(stderr, "%lu Hz, full-array frame (bus ms / transactions)\n", (unsigned long)speeds[k]);
+        fprintf(stderr, "  chips servos   per_servo        per_chip         array            array uniform\n");
+        for (size_t n = 0; n < sizeof(sizes) / sizeof(sizes[0]); n++) {
+            size_t num_chips = sizes[n];
+            ESP_ERROR_CHECK(pca9685_array_init(&array, controllers, num_chips));
+            fprintf(stderr, "  %5u %6u", (unsigned)num_chips, (unsigned)(num_chips * PCA9685_CHANNEL_COUNT));
+
+            for (int f = 0; f <= NUM_STRATEGIES; f++) {
+                bool uniform = f == NUM_STRATEGIES;
+                strategy_t strategy = uniform ? ARRAY : (strategy_t)f;
+                frame_cost_t cost = uniform ? measure(ARRAY, num_chips, uniform_a, uniform_b)
+                                            : measure(strategy, num_chips, frame_a, frame_b);
+                printf("%s    {\"clk_hz\": %lu, \"controllers\": %u, \"frame\": \"%s\", \"strategy\": \"%s\", "
+                       "\"transactions\": %u, \"bytes\": %u, \"bus_time_us\": %.1f}",
+                       first ? "" : ",\n", (unsigned long)speeds[k], (unsigned)num_chips,
+                       uniform ? "uniform" : "distinct", strategy_names[strategy], cost.transactions,
+                       cost.bytes, cost.bus_time_us);
+                first = false;
+                fprintf(stderr, "   %7.2f / %-5u", cost.bus_time_us / 1000.0, cost.transactions);
+            }
+            fprintf(stderr, "\n");
+        }
+    }
+    printf("\n  ]\n}\n");
+
+    if (failures) fprintf(stderr, "%d check(s) failed\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,400 @@
+// I2C cost benchmark: runs the clock's driver operations against the simulated bus and
+// reports transactions, bytes, modeled time and host CPU time per operation as JSON.
+// With a baseline, any operation that needs more transactions, bytes or modeled time
+// than recorded fails the run.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "driver/i2c.h"
+#include "esp_log.h"
+#include "pca9685.h"
+#include "segment_display.h"
+#include "servo_motion.h"
+#include "HD44780.h"
+#include "ds1307.h"
+#include "i2c_bus.h"
+#include "i2c_batch.h"
+#include "sim_bus.h"
+#include "sim_pca9685.h"
+#include "sim_ds1307.h"
+#include "sim_hd44780.h"
+
+#ifndef I2C_BENCH_BASELINE
+#define I2C_BENCH_BASELINE "baseline.json"
+#endif
+
+#define I2C_PORT I2C_NUM_0
+#define CLK_HZ 100000
+#define LCD_ADDR 0x27
+#define LCD_COLS 16
+#define LCD_ROWS 2
+#define PCA1_ADDR 0x40
+#define PCA2_ADDR 0x41
+#define PULSE_0DEG 660
+#define PULSE_90DEG 1500
+
+#define CPU_ITERATIONS 200
+#define MAX_OPS 16
+#define TOLERANCE 1.005 // modeled times are deterministic; allow rounding only
+
+typedef struct {
+    const char *name;
+    void (*setup)(void);    // brings the devices to the starting state, not measured
+    void (*run)(void);
+} bench_op_t;
+
+typedef struct {
+    char name[64];
+    unsigned transactions;
+    unsigned bytes;
+    double bus_time_us;     // wire time on the simulated bus
+    double elapsed_us;      // virtual time including the drivers' delays
+    double cpu_time_us;     // host CPU per call, driver and device models together
+} bench_result_t;
+
+static const segment_plan_digit_t plan = SEGMENT_PLAN_DIGIT(PCA9685_CHANNEL_0, PULSE_0DEG, PULSE_90DEG,
+                                                           SEGMENT_PLAN_PRESCALE(50));
+
+static const segment_channel_t digit_map[4][7] = {
+    SEGMENT_DIGIT_CHANNELS(0, PCA9685_CHANNEL_0),
+    SEGMENT_DIGIT_CHANNELS(0, PCA9685_CHANNEL_7),
+    SEGMENT_DIGIT_CHANNELS(1, PCA9685_CHANNEL_0),
+    SEGMENT_DIGIT_CHANNELS(1, PCA9685_CHANNEL_7),
+};
+
+static sim_pca9685_t sim_pca1, sim_pca2;
+static sim_ds1307_t sim_rtc;
+static sim_hd44780_t sim_lcd;
+static pca9685_dev_t pca1, pca2;
+static segment_display_t display;
+static servo_motion_t motion;
+static segment_display_t eased;
+static i2c_dev_t rtc;
+static i2c_bus_client_t rtc_client;
+static i2c_batch_t batch;
+static char date_line[] = "Date: 17/10     ";
+
+static void no_setup(void) {}
+
+static void show_1_on_pca1(void) {
+    segment_set_digit(&pca1, PCA9685_CHANNEL_0, 1, PULSE_0DEG, PULSE_90DEG);
+    pca9685_commit(&pca1);
+}
+
+static void show_8_on_pca1(void) {
+    segment_set_digit(&pca1, PCA9685_CHANNEL_0, 8, PULSE_0DEG, PULSE_90DEG);
+    pca9685_commit(&pca1);
+}
+
+static void invalidate_both(void) {
+    pca9685_invalidate_shadow(&pca1);
+    pca9685_invalidate_shadow(&pca2);
+}
+
+static void show_0959(void) {
+    static const uint8_t digits[4] = {0, 9, 5, 9};
+    for (int pos = 0; pos < 4; pos++) segment_display_set_digit(&display, pos, digits[pos]);
+    segment_display_commit(&display);
+}
+
+static void home_cursor(void) {
+    LCD_setCursor(0, 0);
+}
+
+// 1 -> 8: segments A and D-G move, written as two register runs
+static void run_set_digit(void) {
+    segment_set_digit(&pca1, PCA9685_CHANNEL_0, 8, PULSE_0DEG, PULSE_90DEG);
+    pca9685_commit(&pca1);
+}
+
+// set_digit's 1 -> 8 from the compile-time plan
+static void run_segment_plan_stage(void) {
+    segment_plan_stage(&pca1, &plan, 8);
+    pca9685_commit(&pca1);
+}
+
+// 8 -> 0: only segment G moves
+static void run_set_digit_one_segment(void) {
+    segment_set_digit(&pca1, PCA9685_CHANNEL_0, 0, PULSE_0DEG, PULSE_90DEG);
+    pca9685_commit(&pca1);
+}
+
+// final_clock's servo frame from unknown chip state (as after a re-init): all 16
+// channels of both controllers, one STOP
+static void run_frame(void) {
+    segment_set_digit(&pca1, PCA9685_CHANNEL_0, 1, PULSE_0DEG, PULSE_90DEG);
+    segment_set_digit(&pca1, PCA9685_CHANNEL_7, 2, PULSE_0DEG, PULSE_90DEG);
+    segment_set_digit(&pca2, PCA9685_CHANNEL_0, 3, PULSE_0DEG, PULSE_90DEG);
+    segment_set_digit(&pca2, PCA9685_CHANNEL_7, 4, PULSE_0DEG, PULSE_90DEG);
+    pca9685_dev_t *const devs[] = {&pca1, &pca2};
+    pca9685_commit_frame(devs, 2);
+}
+
+// final_clock's 09:59 -> 10:00 through the display engine: 11 segments over both
+// controllers, one frame
+static void run_display_rollover(void) {
+    segment_display_set_digit(&display, 0, 1);
+    segment_display_set_digit(&display, 1, 0);
+    segment_display_set_digit(&display, 2, 0);
+    segment_display_set_digit(&display, 3, 0);
+    segment_display_commit(&display);
+}
+
+// Halfway through an eased 09:59 -> 10:00 (400 ms S-curve)
+static void eased_rollover_halfway(void) {
+    static const uint8_t from[4] = {0, 9, 5, 9}, to[4] = {1, 0, 0, 0};
+    for (int pos = 0; pos < 4; pos++) segment_display_set_digit(&eased, pos, from[pos]);
+    while (servo_motion_moving(&motion)) servo_motion_tick(&motion);
+    for (int pos = 0; pos < 4; pos++) segment_display_set_digit(&eased, pos, to[pos]);
+    for (int tick = 0; tick < 9; tick++) servo_motion_tick(&motion);
+}
+
+// One motion tick: the 11 servos in motion, nothing else
+static void run_motion_tick(void) {
+    servo_motion_tick(&motion);
+}
+
+static void run_set_frequency(void) {
+    pca9685_set_frequency(&pca1, 50);
+}
+
+static void run_init_frequency(void) {
+    pca9685_init_frequency(&pca2, I2C_PORT, PCA2_ADDR, 50);
+}
+
+static void run_check(void) {
+    pca9685_check(&pca1, true, NULL);
+}
+
+static void run_lcd_write_str(void) {
+    LCD_writeStr(date_line);
+}
+
+static void run_lcd_write_str_batched(void) {
+    i2c_batch_begin(&batch);
+    LCD_setBatch(&batch);
+    LCD_setCursor(0, 0);
+    LCD_writeStr(date_line);
+    LCD_setBatch(NULL);
+    i2c_batch_submit(&batch, I2C_PORT, pdMS_TO_TICKS(1000));
+}
+
+static void run_lcd_clear(void) {
+    LCD_clearScreen();
+}
+
+static void run_ds1307_get_time(void) {
+    struct tm time;
+    i2c_bus_acquire(&rtc_client, pdMS_TO_TICKS(1000));
+    ds1307_get_time(&rtc, &time);
+    i2c_bus_release(&rtc_client);
+}
+
+static const bench_op_t ops[] = {
+    {"set_digit", show_1_on_pca1, run_set_digit},
+    {"segment_plan_stage", show_1_on_pca1, run_segment_plan_stage},
+    {"set_digit_one_segment", show_8_on_pca1, run_set_digit_one_segment},
+    {"servo_frame_full", invalidate_both, run_frame},
+    {"segment_display_rollover", show_0959, run_display_rollover},
+    {"servo_motion_tick", eased_rollover_halfway, run_motion_tick},
+    {"pca9685_set_frequency", no_setup, run_set_frequency},
+    {"pca9685_init_frequency", no_setup, run_init_frequency},
+    {"pca9685_check", no_setup, run_check},
+    {"LCD_writeStr", home_cursor, run_lcd_write_str},
+    {"LCD_writeStr_batched", no_setup, run_lcd_write_str_batched},
+    {"LCD_clearScreen", no_setup, run_lcd_clear},
+    {"ds1307_get_time", no_setup, run_ds1307_get_time},
+};
+#define NUM_OPS (sizeof(ops) / sizeof(ops[0]))
+
+static double cpu_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void measure(const bench_op_t *op, bench_result_t *res) {
+    memset(res, 0, sizeof(*res));
+    snprintf(res->name, sizeof(res->name), "%s", op->name);
+
+    op->setup();
+    sim_bus_reset_stats(I2C_PORT);
+    uint64_t start_ns = sim_clock_ns();
+    op->run();
+    const sim_bus_stats_t *stats = sim_bus_get_stats(I2C_PORT);
+    res->transactions = stats->transactions;
+    res->bytes = stats->bytes;
+    res->bus_time_us = stats->bus_time_ns / 1000.0;
+    res->elapsed_us = (sim_clock_ns() - start_ns) / 1000.0;
+
+    double cpu_us = 0;
+    for (int i = 0; i < CPU_ITERATIONS; i++) {
+        op->setup();
+        double t0 = cpu_now_us();
+        op->run();
+        cpu_us += cpu_now_us() - t0;
+    }
+    res->cpu_time_us = cpu_us / CPU_ITERATIONS;
+}
+
+static void write_json(FILE *f, const bench_result_t *results, size_t count) {
+    fprintf(f, "{\n  \"clock_hz\": %d,\n  \"operations\": [\n", CLK_HZ);
+    for (size_t i = 0; i < count; i++) {
+        const bench_result_t *r = &results[i];
+        fprintf(f, "    {\"name\": \"%s\", \"transactions\": %u, \"bytes\": %u, "
+                   "\"bus_time_us\": %.1f, \"elapsed_us\": %.1f, \"cpu_time_us\": %.3f}%s\n",
+                r->name, r->transactions, r->bytes, r->bus_time_us, r->elapsed_us,
+                r->cpu_time_us, i + 1 < count ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+}
+
+// Reads the format write_json produces: one operation per line
+static size_t read_baseline(const char *path, bench_result_t *results, size_t max) {
+    FILE *f = fopen(path, "r");
+    if (!f) return 0;
+    char line[512];
+    size_t count = 0;
+    while (count < max && fgets(line, sizeof(line), f)) {
+        bench_result_t *r = &results[count];
+        if (sscanf(line, " {\"name\": \"%63[^\"]\", \"transactions\": %u, \"bytes\": %u, "
+                         "\"bus_time_us\": %lf, \"elapsed_us\": %lf, \"cpu_time_us\": %lf",
+                   r->name, &r->transactions, &r->bytes, &r->bus_time_us, &r->elapsed_us,
+                   &r->cpu_time_us) == 6) {
+            count++;
+        }
+    }
+    fclose(f);
+    return count;
+}
+
+static int compare(const bench_result_t *results, size_t count, const bench_result_t *base,
+                   size_t base_count, double cpu_tolerance) {
+    int regressions = 0;
+    for (size_t i = 0; i < count; i++) {
+        const bench_result_t *r = &results[i];
+        const bench_result_t *b = NULL;
+        for (size_t j = 0; j < base_count; j++) {
+            if (strcmp(base[j].name, r->name) == 0) b = &base[j];
+        }
+        // Nothing to compare against is a failure too: re-record the baseline with the new op
+        if (!b) {
+            fprintf(stderr, "%-24s MISSING     not in baseline\n", r->name);
+            regressions++;
+            continue;
+        }
+
+        bool worse = r->transactions > b->transactions || r->bytes > b->bytes ||
+                     r->bus_time_us > b->bus_time_us * TOLERANCE + 0.1 ||
+                     r->elapsed_us > b->elapsed_us * TOLERANCE + 0.1 ||
+                     (cpu_tolerance > 0 && r->cpu_time_us > b->cpu_time_us * cpu_tolerance);
+        fprintf(stderr, "%-24s %s  txn %u/%u  bytes %u/%u  bus %.1f/%.1f us  elapsed %.1f/%.1f us  cpu %.3f/%.3f us\n",
+                r->name, worse ? "REGRESSION" : "ok        ", r->transactions, b->transactions,
+                r->bytes, b->bytes, r->bus_time_us, b->bus_time_us, r->elapsed_us, b->elapsed_us,
+                r->cpu_time_us, b->cpu_time_us);
+        if (worse) regressions++;
+    }
+    return regressions;
+}
+
+static void setup_devices(void) {
+    struct tm start = {.tm_year = 126, .tm_mon = 9, .tm_mday = 17, .tm_hour = 9, .tm_min = 59};
+    sim_log_level = ESP_LOG_ERROR;
+    sim_bus_reset();
+    sim_pca9685_init(&sim_pca1, PCA1_ADDR);
+    sim_pca9685_init(&sim_pca2, PCA2_ADDR);
+    sim_ds1307_init(&sim_rtc, SIM_DS1307_ADDR, timegm(&start));
+    sim_hd44780_init(&sim_lcd, LCD_ADDR);
+    sim_bus_attach(I2C_PORT, &sim_pca1.dev);
+    sim_bus_attach(I2C_PORT, &sim_pca2.dev);
+    sim_bus_attach(I2C_PORT, &sim_rtc.dev);
+    sim_bus_attach(I2C_PORT, &sim_lcd.dev);
+
+    ESP_ERROR_CHECK(i2c_bus_init(I2C_PORT, GPIO_NUM_21, GPIO_NUM_22, CLK_HZ));
+    ESP_ERROR_CHECK(i2c_bus_client_init(&rtc_client, I2C_PORT, "ds1307"));
+    ESP_ERROR_CHECK(ds1307_init_desc(&rtc, I2C_PORT, GPIO_NUM_21, GPIO_NUM_22));
+    LCD_initOnPort(I2C_PORT, LCD_ADDR, GPIO_NUM_21, GPIO_NUM_22, LCD_COLS, LCD_ROWS);
+    ESP_ERROR_CHECK(pca9685_init(&pca1, I2C_PORT, PCA1_ADDR));
+    ESP_ERROR_CHECK(pca9685_set_frequency(&pca1, 50));
+    ESP_ERROR_CHECK(pca9685_init(&pca2, I2C_PORT, PCA2_ADDR));
+    ESP_ERROR_CHECK(pca9685_set_frequency(&pca2, 50));
+    static pca9685_dev_t *const controllers[] = {&pca1, &pca2};
+    const segment_display_config_t display_cfg = {
+        .controllers = controllers,
+        .num_controllers = 2,
+        .digits = digit_map,
+        .num_digits = 4,
+        .pulse_off_us = PULSE_0DEG,
+        .pulse_on_us = PULSE_90DEG,
+    };
+    ESP_ERROR_CHECK(segment_display_init(&display, &display_cfg));
+    const servo_motion_config_t motion_cfg = {
+        .controllers = controllers,
+        .num_controllers = 2,
+        .profile = SERVO_MOTION_S_CURVE,
+        .duration_ms = 400,
+    };
+    ESP_ERROR_CHECK(servo_motion_init(&motion, &motion_cfg));
+    segment_display_config_t eased_cfg = display_cfg;
+    eased_cfg.motion = &motion;
+    ESP_ERROR_CHECK(segment_display_init(&eased, &eased_cfg));
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [--baseline FILE] [--write-baseline] [--cpu-tolerance RATIO]\n"
+                    "  --baseline FILE        baseline to compare with (default %s)\n"
+                    "  --write-baseline       record this run as the baseline instead\n"
+                    "  --cpu-tolerance RATIO  also fail if CPU time exceeds baseline x RATIO\n",
+            prog, I2C_BENCH_BASELINE);
+}
+
+int main(int argc, char **argv) {
+    const char *baseline = I2C_BENCH_BASELINE;
+    bool write_baseline = false;
+    double cpu_tolerance = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baseline = argv[++i];
+        } else if (strcmp(argv[i], "--write-baseline") == 0) {
+            write_baseline = true;
+        } else if (strcmp(argv[i], "--cpu-tolerance") == 0 && i + 1 < argc) {
+            cpu_tolerance = atof(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    setup_devices();
+    bench_result_t results[NUM_OPS];
+    for (size_t i = 0; i < NUM_OPS; i++) measure(&ops[i], &results[i]);
+    write_json(stdout, results, NUM_OPS);
+
+    if (sim_lcd.timing_violations) {
+        fprintf(stderr, "HD44780 timing violations: %lu\n", (unsigned long)sim_lcd.timing_violations);
+        return 1;
+    }
+
+    if (write_baseline) {
+        FILE *f = fopen(baseline, "w");
+        if (!f) {
+            perror(baseline);
+            return 2;
+        }
+        write_json(f, results, NUM_OPS);
+        fclose(f);
+        fprintf(stderr, "Baseline written to %s\n", baseline);
+        return 0;
+    }
+
+    bench_result_t base[MAX_OPS];
+    size_t base_count = read_baseline(baseline, base, MAX_OPS);
+    if (!base_count) {
+        fprintf(stderr, "No baseline in %s (run with --write-baseline to record one)\n", baseline);
+        return 2;
+    }
+    int regressions = compare(results, NUM_OPS, base, base_count, cpu_tolerance);
+    if (regressions) fprintf(stderr, "%d operation(s) regressed against or missing from %s\n", regressions, baseline);
+    return regressions ? 1 : 0;
+}
@@ -0,0 +1,360 @@
+// Boot checks: warm boot from the stored calibration, fast boot and servo auto-calibration
+
+#include "host_sim.h"
+
+// Each of the 28 segment servos at its own calibrated pulse for the digits shown
+static void check_calibrated(const servo_cal_t *cal, const uint8_t *digits) {
+    for (int pos = 0; pos < 4; pos++) {
+        for (int seg = 0; seg < 7; seg++) {
+            const segment_channel_t *ch = &digit_map[pos][seg];
+            const servo_cal_entry_t *entry = servo_cal_get(cal, ch->controller, ch->channel);
+            bool on = segment_digit_patterns[digits[pos]] & (1 << seg);
+            int expected = on ? entry->pulse_on_us : entry->pulse_off_us;
+            int actual = (int)sim_pca9685_pulse_us(ch->controller ? &sim_pca2 : &sim_pca1, ch->channel);
+            CHECK(actual >= expected - 5 && actual <= expected + 5, "digit %d seg %d: %d us, calibrated %d us",
+                  pos, seg, actual, expected);
+        }
+    }
+}
+
+// Per-servo calibration in NVS and the last frame in the DS1307's NVRAM: 10:00 is shown
+// with its own pulse per servo and saved, then the ESP32 "resets" (controllers
+// re-initialized, engine and display started afresh). Restoring must put every pulse back
+// without a single move, the next minute must only move the 4 segments that change, and
+// corrupted records must be refused.
+void check_warm_boot(void) {
+    CHECK(nvs_flash_init() == ESP_OK, "nvs_flash_init");
+    static servo_cal_t cal, loaded;
+    CHECK(servo_cal_load(&loaded, "clock") == ESP_ERR_NOT_FOUND, "calibration found before any save");
+    servo_cal_init(&cal, 2, PULSE_0DEG, PULSE_90DEG);
+    for (int c = 0; c < 2; c++) {
+        for (int ch = 0; ch < 14; ch++) {
+            servo_cal_set(&cal, c, ch, PULSE_0DEG - 20 + 3 * (c * 14 + ch), PULSE_90DEG + 30 - 2 * (c * 14 + ch));
+        }
+    }
+    CHECK(servo_cal_save(&cal, "clock") == ESP_OK, "servo_cal_save");
+
+    pca9685_dev_t *const controllers[] = {&pca1, &pca2};
+    const servo_motion_config_t motion_cfg = {
+        .controllers = controllers,
+        .num_controllers = 2,
+        .profile = SERVO_MOTION_S_CURVE,
+        .duration_ms = 400,
+        .max_moving = 8,
+    };
+    static servo_motion_t motion;
+    static segment_display_t shown;
+    segment_display_config_t cfg = display.cfg;
+    cfg.motion = &motion;
+    cfg.cal = &cal;
+    CHECK(servo_motion_init(&motion, &motion_cfg) == ESP_OK, "servo_motion_init (warm boot)");
+    CHECK(segment_display_init(&shown, &cfg) == ESP_OK, "segment_display_init (calibrated)");
+    static const uint8_t ten[4] = {1, 0, 0, 0};
+    for (int pos = 0; pos < 4; pos++) segment_display_set_digit(&shown, pos, ten[pos]);
+    for (int tick = 0; servo_motion_moving(&motion) && tick < 200; tick++) servo_motion_tick(&motion);
+    check_calibrated(&cal, ten);
+
+    static frame_store_t store;
+    segment_display_frame_t frame, restored;
+    CHECK(frame_store_init(&store, &rtc, &rtc_client) == ESP_OK, "frame_store_init");
+    CHECK(frame_store_load(&store, &restored) == ESP_ERR_NOT_FOUND, "frame found in blank NVRAM");
+    CHECK(segment_display_get_frame(&shown, &frame) == ESP_OK, "segment_display_get_frame");
+    sim_bus_reset_stats(I2C_PORT);
+    CHECK(frame_store_save(&store, &frame) == ESP_OK, "frame_store_save");
+    uint32_t save_bytes = sim_bus_get_stats(I2C_PORT)->bytes;
+    sim_bus_reset_stats(I2C_PORT);
+    frame_store_save(&store, &frame);
+    CHECK(store.stats.saves == 1 && store.stats.unchanged == 1 && sim_bus_get_stats(I2C_PORT)->bytes == 0,
+          "saving an unchanged frame: %lu saves, %lu skipped", (unsigned long)store.stats.saves,
+          (unsigned long)store.stats.unchanged);
+
+    // Reset: the chips start over with every output off, the servos stay where they are
+    CHECK(pca9685_init(&pca1, I2C_PORT, PCA1_ADDR) == ESP_OK, "pca9685_init 0x%02X", PCA1_ADDR);
+    CHECK(pca9685_set_frequency(&pca1, SERVO_FREQ_HZ) == ESP_OK, "pca9685_set_frequency 0x%02X", PCA1_ADDR);
+    CHECK(pca9685_init(&pca2, I2C_PORT, PCA2_ADDR) == ESP_OK, "pca9685_init 0x%02X", PCA2_ADDR);
+    CHECK(pca9685_set_frequency(&pca2, SERVO_FREQ_HZ) == ESP_OK, "pca9685_set_frequency 0x%02X", PCA2_ADDR);
+    CHECK(segments_pulsing() == 0, "%d segments pulsing after the reset", segments_pulsing());
+    memset(&loaded, 0, sizeof(loaded));
+    CHECK(servo_cal_load(&loaded, "clock") == ESP_OK, "servo_cal_load");
+    CHECK(!memcmp(&loaded, &cal, sizeof(cal)), "loaded calibration differs from the saved one");
+    cfg.cal = &loaded;
+    CHECK(servo_motion_init(&motion, &motion_cfg) == ESP_OK, "servo_motion_init (after reset)");
+    CHECK(segment_display_init(&shown, &cfg) == ESP_OK, "segment_display_init (after reset)");
+    frame_store_init(&store, &rtc, &rtc_client);
+    sim_bus_reset_stats(I2C_PORT);
+    CHECK(frame_store_load(&store, &restored) == ESP_OK, "frame_store_load");
+    uint32_t load_bytes = sim_bus_get_stats(I2C_PORT)->bytes;
+    CHECK(!memcmp(&restored, &frame, sizeof(frame)), "restored frame differs from the saved one");
+    CHECK(segment_display_restore(&shown, &restored) == ESP_OK, "segment_display_restore");
+    sim_bus_reset_stats(I2C_PORT);
+    servo_motion_tick(&motion);
+    uint32_t restore_bytes = sim_bus_get_stats(I2C_PORT)->bytes;
+    CHECK(motion.stats.moves == 0 && servo_motion_moving(&motion) == 0, "restoring moved %lu servos",
+          (unsigned long)motion.stats.moves);
+    CHECK(segments_pulsing() == 28, "%d segments pulsing after the restore", segments_pulsing());
+    check_calibrated(&loaded, ten);
+
+    static const uint8_t ten_one[4] = {1, 0, 0, 1};
+    for (int pos = 0; pos < 4; pos++) segment_display_set_digit(&shown, pos, ten_one[pos]);
+    size_t moving = servo_motion_moving(&motion);
+    CHECK(moving == 4, "10:00 -> 10:01 after the restore moves %u servos, expected 4", (unsigned)moving);
+    for (int tick = 0; servo_motion_moving(&motion) && tick < 200; tick++) servo_motion_tick(&motion);
+    check_calibrated(&loaded, ten_one);
+
+    // A flipped bit in either store is caught
+    sim_rtc.regs[SIM_DS1307_RAM_BASE + FRAME_STORE_RAM_OFFSET + 5] ^= 0x10;
+    CHECK(frame_store_load(&store, &restored) == ESP_ERR_INVALID_CRC, "corrupt frame not refused");
+    nvs_handle_t nvs;
+    uint8_t blob[512];
+    size_t len = sizeof(blob);
+    nvs_open("clock", NVS_READWRITE, &nvs);
+    nvs_get_blob(nvs, SERVO_CAL_NVS_KEY, blob, &len);
+    blob[len / 2] ^= 0x01;
+    nvs_set_blob(nvs, SERVO_CAL_NVS_KEY, blob, len);
+    nvs_close(nvs);
+    CHECK(servo_cal_load(&loaded, "clock") == ESP_ERR_INVALID_CRC, "corrupt calibration not refused");
+    printf("  frame record: %lu bytes to save, %lu to load; restore: %lu bytes, 0 moves; "
+           "calibration blob %u bytes\n", (unsigned long)save_bytes, (unsigned long)load_bytes,
+           (unsigned long)restore_bytes, (unsigned)len);
+}
+
+static bool all_outputs_off(const sim_pca9685_t *chip) {
+    for (int ch = 0; ch < 16; ch++) {
+        if (sim_pca9685_high_counts(chip, ch)) return false;
+    }
+    return true;
+}
+
+static esp_err_t boot_lcd(void *ctx) {
+    (void)ctx;
+    LCD_initOnPort(I2C_PORT, LCD_ADDR, GPIO_NUM_21, GPIO_NUM_22, LCD_COLS, LCD_ROWS);
+    return ESP_OK;
+}
+
+static esp_err_t boot_pca(void *ctx) {
+    (void)ctx;
+    esp_err_t err = pca9685_init_frequency(&pca1, I2C_PORT, PCA1_ADDR, SERVO_FREQ_HZ);
+    if (err != ESP_OK) return err;
+    return pca9685_init_frequency(&pca2, I2C_PORT, PCA2_ADDR, SERVO_FREQ_HZ);
+}
+
+static esp_err_t boot_rtc(void *ctx) {
+    struct tm *time = ctx;
+    return rtc_get_time(time);
+}
+
+void check_fast_boot(void) {
+    // Warm: the chips run at 200 Hz with pulses out, as an earlier boot may leave them
+    CHECK(pca9685_set_frequency(&pca1, 200) == ESP_OK, "pca9685_set_frequency 200 Hz");
+    uint32_t ignored = sim_pca1.prescale_ignored + sim_pca2.prescale_ignored;
+    sim_bus_reset_stats(I2C_PORT);
+    CHECK(pca9685_init_frequency(&pca1, I2C_PORT, PCA1_ADDR, SERVO_FREQ_HZ) == ESP_OK, "pca9685_init_frequency (warm)");
+    CHECK(pca9685_init_frequency(&pca2, I2C_PORT, PCA2_ADDR, SERVO_FREQ_HZ) == ESP_OK, "pca9685_init_frequency (warm)");
+    print_stats("2x one-burst, warm");
+    CHECK(sim_pca1.prescale_ignored + sim_pca2.prescale_ignored == ignored, "PRE_SCALE written while awake");
+
+    for (int cold = 0; cold < 2; cold++) {
+        const sim_pca9685_t *chips[] = {&sim_pca1, &sim_pca2};
+        for (int i = 0; i < 2; i++) {
+            const sim_pca9685_t *chip = chips[i];
+            float freq = sim_pca9685_frequency(chip);
+            CHECK(sim_pca9685_awake(chip), "PCA9685 %d left asleep", i + 1);
+            CHECK(freq > 49.5f && freq < 50.5f, "PWM frequency %.2f Hz", freq);
+            CHECK(all_outputs_off(chip), "PCA9685 %d has outputs on after the init", i + 1);
+            CHECK(chip->regs[0x01] == 0x04, "MODE2 0x%02X, expected OUTDRV", chip->regs[0x01]);
+        }
+        CHECK(pca1.shadow_valid == 0xFFFF && pca1.prescale == sim_pca1.regs[0xFE], "driver state after the init");
+        pca9685_check_result_t result;
+        CHECK(pca9685_check(&pca1, true, &result) == ESP_OK && result == PCA9685_CHECK_OK,
+              "register check after the one-burst init");
+        if (cold) break;
+
+        // Cold: power-on defaults (asleep, 200 Hz, every output full off)
+        sim_pca9685_power_on_reset(&sim_pca1);
+        sim_pca9685_power_on_reset(&sim_pca2);
+        sim_bus_reset_stats(I2C_PORT);
+        CHECK(pca9685_init_frequency(&pca1, I2C_PORT, PCA1_ADDR, SERVO_FREQ_HZ) == ESP_OK, "pca9685_init_frequency (cold)");
+        CHECK(pca9685_init_frequency(&pca2, I2C_PORT, PCA2_ADDR, SERVO_FREQ_HZ) == ESP_OK, "pca9685_init_frequency (cold)");
+        print_stats("2x one-burst, cold");
+    }
+    CHECK(pca9685_init_frequency(&pca3, I2C_PORT, 0x7E, SERVO_FREQ_HZ) != ESP_OK, "missing PCA9685 not reported");
+
+    // The orchestrator: single-threaded here, so the steps run one after another on the
+    // caller, but each is timed on the timeline all the same
+    static fast_boot_t boot;
+    struct tm time;
+    const fast_boot_step_t steps[] = {
+        {"lcd", boot_lcd, NULL},
+        {"pca9685", boot_pca, NULL},
+        {"ds1307", boot_rtc, &time},
+    };
+    uint32_t violations = sim_lcd.timing_violations;
+    CHECK(fast_boot_init(&boot) == ESP_OK, "fast_boot_init");
+    int64_t start = esp_timer_get_time();
+    sim_bus_reset_stats(I2C_PORT);
+    CHECK(fast_boot_run(&boot, steps, 3, 5) == ESP_OK, "fast_boot_run");
+    fast_boot_mark(&boot, "devices up");
+    int64_t took = esp_timer_get_time() - start;
+    print_stats("LCD + 2x PCA9685 + RTC");
+    CHECK(boot.num_phases == 4, "%lu phases recorded, expected 4", (unsigned long)boot.num_phases);
+    for (int i = 0; i < 3; i++) {
+        CHECK(fast_boot_phase_end(&boot, steps[i].name) > 0, "no end recorded for %s", steps[i].name);
+    }
+    CHECK(fast_boot_phase_end(&boot, "devices up") == start + took, "mark at the wrong time");
+    CHECK(sim_lcd.four_bit && sim_lcd.two_line && sim_lcd.display_on, "LCD not in 4-bit, 2-line, display on");
+    CHECK(sim_lcd.timing_violations == violations, "%lu HD44780 timing violations",
+          (unsigned long)(sim_lcd.timing_violations - violations));
+    CHECK(sim_pca9685_awake(&sim_pca1) && sim_pca9685_awake(&sim_pca2), "PCA9685 left asleep");
+    printf("  timeline:");
+    for (uint32_t i = 0; i < boot.num_phases; i++) {
+        const fast_boot_phase_t *phase = &boot.phases[i];
+        printf(" %s %.1f ms%s", phase->name, (phase->end_us - phase->start_us) / 1000.0,
+               i + 1 < boot.num_phases ? "," : "");
+    }
+    printf("; bring-up %.1f ms of virtual time\n", took / 1000.0);
+}
+
+// A hobby servo on a PCA9685 channel, seen only through its supply current as on the clock:
+// it turns towards its pulse at a fixed speed until a mechanical stop holds it, and draws
+// the holding current at rest, more in motion and the stall current against a stop
+typedef struct {
+    const sim_pca9685_t *chip;
+    uint8_t channel;
+    uint16_t stop_lo_us, stop_hi_us; // mechanical stops, as the pulses that reach them
+    float us_per_ms;                 // turning speed
+    float pos_us;
+    uint32_t pulse_us;               // pulse followed since at_ns
+    uint64_t at_ns;
+} sim_servo_t;
+
+#define SIM_SERVO_DEADBAND_US 4u
+
+static float servo_target(const sim_servo_t *servo, uint32_t pulse_us) {
+    if (pulse_us < servo->stop_lo_us) return servo->stop_lo_us;
+    if (pulse_us > servo->stop_hi_us) return servo->stop_hi_us;
+    return pulse_us;
+}
+
+static void servo_follow(sim_servo_t *servo, uint64_t until_ns) {
+    if (servo->pulse_us) {
+        float target = servo_target(servo, servo->pulse_us);
+        float step = servo->us_per_ms * (until_ns - servo->at_ns) / 1e6f;
+        if (servo->pos_us < target - step) servo->pos_us += step;
+        else if (servo->pos_us > target + step) servo->pos_us -= step;
+        else servo->pos_us = target;
+    }
+    servo->at_ns = until_ns;
+}
+
+static esp_err_t servo_current(void *ctx, uint32_t *current_ma) {
+    sim_servo_t *servo = ctx;
+    // The pulse changed at the latest latch, if after the last read
+    uint32_t pulse = sim_pca9685_pulse_us(servo->chip, servo->channel);
+    if (pulse != servo->pulse_us && servo->chip->latched_at_ns > servo->at_ns) {
+        servo_follow(servo, servo->chip->latched_at_ns);
+        servo->pulse_us = pulse;
+    }
+    servo_follow(servo, sim_clock_ns());
+    servo->pulse_us = pulse;
+
+    float target = servo_target(servo, pulse);
+    bool moving = pulse && servo->pos_us != target;
+    bool stalled = pulse && !moving && (pulse + SIM_SERVO_DEADBAND_US < servo->stop_lo_us ||
+                                        pulse > servo->stop_hi_us + SIM_SERVO_DEADBAND_US);
+    *current_ma = 20 + (pulse ? 10 : 0) + (moving ? 250 : 0) + (stalled ? 600 : 0);
+    return ESP_OK;
+}
+
+// Auto-calibration: a servo whose 0 degree stop lies inside the nominal swing (it would
+// stall at rest) and whose 90 degree stop lies just past it gets endpoints just short of
+// both, one with stops out of reach keeps the nominal ones, the swing is timed, and an
+// empty channel is told apart. The results must survive NVS.
+// An ADC pin without the shunt amplifier: the first read high, then 0 and 70 mA in turn
+static esp_err_t floating_current(void *ctx, uint32_t *current_ma) {
+    uint32_t *reads = ctx;
+    uint32_t n = (*reads)++;
+    *current_ma = n == 0 ? 100 : n % 2 ? 0 : 70;
+    return ESP_OK;
+}
+
+void check_servo_sweep(void) {
+    static sim_servo_t servos[2] = {
+        {.chip = &sim_pca1, .channel = 3, .stop_lo_us = 700, .stop_hi_us = 1560, .us_per_ms = 6.7f},
+        {.chip = &sim_pca1, .channel = 4, .stop_lo_us = 300, .stop_hi_us = 1900, .us_per_ms = 4.0f},
+    };
+    servo_cal_sweep_config_t cfg = {
+        .pulse_off_us = PULSE_0DEG,
+        .pulse_on_us = PULSE_90DEG,
+        .search_us = 300,
+        .step_us = 10,
+        .step_ms = 40,
+        .drive_ma = 60,
+        .margin_us = 30,
+        .timeout_ms = 1500,
+    };
+    static servo_cal_t cal, loaded;
+    servo_cal_init(&cal, 2, 0, 0);
+    servo_cal_sweep_result_t results[2];
+    for (int i = 0; i < 2; i++) {
+        sim_servo_t *servo = &servos[i];
+        servo->pos_us = 1200;
+        servo->at_ns = sim_clock_ns();
+        cfg.sense = servo_current;
+        cfg.sense_ctx = servo;
+        servo_cal_sweep_result_t *r = &results[i];
+        int64_t start = esp_timer_get_time();
+        esp_err_t err = servo_cal_sweep(&pca1, servo->channel, &cfg, r);
+        CHECK(err == ESP_OK, "servo_cal_sweep channel %u: %s", servo->channel, esp_err_to_name(err));
+        CHECK(sim_pca9685_pulse_us(&sim_pca1, servo->channel) == 0, "channel %u left powered", servo->channel);
+
+        uint16_t off_lo = PULSE_0DEG, off_hi = PULSE_0DEG, on_lo = PULSE_90DEG, on_hi = PULSE_90DEG;
+        if (servo->stop_lo_us > PULSE_0DEG - cfg.search_us) {
+            off_lo = servo->stop_lo_us;
+            off_hi = servo->stop_lo_us + cfg.margin_us + cfg.step_us;
+        }
+        if (servo->stop_hi_us < PULSE_90DEG + cfg.search_us) {
+            on_lo = servo->stop_hi_us - cfg.margin_us - cfg.step_us;
+            on_hi = servo->stop_hi_us;
+        }
+        CHECK(r->pulse_off_us >= off_lo && r->pulse_off_us <= off_hi, "channel %u: 0 degrees at %u us, expected %u-%u",
+              servo->channel, r->pulse_off_us, off_lo, off_hi);
+        CHECK(r->pulse_on_us >= on_lo && r->pulse_on_us <= on_hi, "channel %u: 90 degrees at %u us, expected %u-%u",
+              servo->channel, r->pulse_on_us, on_lo, on_hi);
+        CHECK(r->stop_off == (off_lo != PULSE_0DEG) && r->stop_on == (on_lo != PULSE_90DEG),
+              "channel %u: stops reported wrongly", servo->channel);
+        // Read every 10 ms tick: the swing is timed to within two of them
+        float swing = (r->pulse_on_us - r->pulse_off_us) / servo->us_per_ms;
+        CHECK(r->travel_ms >= swing && r->travel_ms <= swing + 20, "channel %u: swing %u ms, expected %.0f",
+              servo->channel, r->travel_ms, swing);
+        servo_cal_set(&cal, 0, servo->channel, r->pulse_off_us, r->pulse_on_us);
+        servo_cal_set_travel(&cal, 0, servo->channel, r->travel_ms);
+        printf("  channel %u: %u-%u us (stops at %u/%u), swing %u ms, %.1f s of sweeping\n", servo->channel,
+               r->pulse_off_us, r->pulse_on_us, servo->stop_lo_us, servo->stop_hi_us, r->travel_ms,
+               (esp_timer_get_time() - start) / 1e6);
+    }
+
+    // Nothing on channel 5: the current never moves
+    cfg.sense_ctx = &servos[0];
+    servo_cal_sweep_result_t empty;
+    esp_err_t err = servo_cal_sweep(&pca1, PCA9685_CHANNEL_5, &cfg, &empty);
+    CHECK(err == ESP_ERR_NOT_FOUND, "empty channel: %s", esp_err_to_name(err));
+
+    // A floating sense input: high once, then flickering past the drive threshold. The
+    // sweep runs through, but the current never rose clearly above the unpowered one.
+    static uint32_t floating_reads;
+    floating_reads = 0;
+    cfg.sense = floating_current;
+    cfg.sense_ctx = &floating_reads;
+    err = servo_cal_sweep(&pca1, PCA9685_CHANNEL_5, &cfg, &empty);
+    CHECK(err == ESP_ERR_INVALID_RESPONSE, "floating sense input: %s, peak %lu mA, idle %lu mA",
+          esp_err_to_name(err), (unsigned long)empty.peak_ma, (unsigned long)empty.idle_ma);
+
+    // New pulses keep the swing; the table round-trips through NVS
+    servo_cal_set(&cal, 0, servos[1].channel, results[1].pulse_off_us, results[1].pulse_on_us);
+    CHECK(servo_cal_get(&cal, 0, servos[1].channel)->travel_ms == results[1].travel_ms, "servo_cal_set lost the swing");
+    CHECK(servo_cal_set_travel(&cal, 0, PCA9685_CHANNEL_5, 100) == ESP_ERR_INVALID_STATE,
+          "swing set for an uncalibrated servo");
+    CHECK(servo_cal_save(&cal, "clock") == ESP_OK, "servo_cal_save");
+    CHECK(servo_cal_load(&loaded, "clock") == ESP_OK, "servo_cal_load");
+    CHECK(!memcmp(&loaded, &cal, sizeof(cal)), "loaded calibration differs from the saved one");
+}
@@ -0,0 +1,111 @@
+// Bus checks: phase-staggered pulses and register scrubbing
+
+#include "host_sim.h"
+
+static void print_load(const char *label, const sim_pca9685_load_t *load) {
+    printf("  %-12s peak %2u, mean %5.2f, rms %5.2f pulses high; %2u with drifting oscillators\n", label,
+           load->peak, load->mean, load->rms, load->peak_drifted);
+}
+
+// 10:00 with every pulse starting at count 0, then staggered over the period: the pulse
+// lengths must not change while the peak of concurrent pulses drops
+void check_phase_stagger(void) {
+    const sim_pca9685_t *const sims[] = {&sim_pca1, &sim_pca2};
+    pca9685_dev_t *const controllers[] = {&pca1, &pca2};
+    static pca9685_array_t array;
+    CHECK(pca9685_array_init(&array, controllers, 2) == ESP_OK, "pca9685_array_init");
+
+    segment_display_invalidate(&display);
+    segment_display_set_digit(&display, 0, 1);
+    for (int pos = 1; pos < 4; pos++) segment_display_set_digit(&display, pos, 0);
+    CHECK(segment_display_commit(&display) == ESP_OK, "segment_display_commit");
+    int powered = 0;
+    for (int ch = 0; ch < PCA9685_CHANNEL_COUNT; ch++) {
+        powered += (sim_pca9685_high_counts(&sim_pca1, ch) != 0) + (sim_pca9685_high_counts(&sim_pca2, ch) != 0);
+    }
+    sim_pca9685_load_t aligned, staggered;
+    sim_pca9685_load(sims, 2, &aligned);
+    print_load("aligned", &aligned);
+    CHECK(aligned.peak == powered, "%u pulses high at once with aligned starts, expected %d", aligned.peak, powered);
+
+    sim_bus_reset_stats(I2C_PORT);
+    CHECK(pca9685_array_stagger(&array) == ESP_OK, "pca9685_array_stagger");
+    CHECK(pca9685_array_commit(&array) == ESP_OK, "pca9685_array_commit");
+    print_stats("stagger");
+    static const uint8_t digits[4] = {1, 0, 0, 0};
+    for (int pos = 0; pos < 4; pos++) check_digit(pos < 2 ? &sim_pca1 : &sim_pca2, (pos % 2) * 7, digits[pos]);
+    sim_pca9685_load(sims, 2, &staggered);
+    print_load("staggered", &staggered);
+    CHECK(staggered.peak * 4 <= aligned.peak, "staggered peak %u, aligned %u", staggered.peak, aligned.peak);
+    CHECK(staggered.peak_drifted * 2 <= aligned.peak_drifted, "staggered drift bound %u, aligned %u",
+          staggered.peak_drifted, aligned.peak_drifted);
+    CHECK(staggered.rms < aligned.rms, "staggered rms %.2f, aligned %.2f", staggered.rms, aligned.rms);
+
+    // Re-staging a digit keeps each channel's phase
+    segment_display_set_digit(&display, 3, 1);
+    CHECK(segment_display_commit(&display) == ESP_OK, "segment_display_commit");
+    check_digit(&sim_pca2, 7, 1);
+    for (int ch = 0; ch < PCA9685_CHANNEL_COUNT; ch++) {
+        CHECK(pca2.led_on[ch] == (pca9685_get_duty(&pca2, ch) ? pca2.phase[ch] : 0), "PCA2 ch%d starts at %u", ch,
+              pca2.led_on[ch]);
+    }
+}
+
+// LEDn registers of a model against the driver's shadow
+static bool chip_matches_shadow(const sim_pca9685_t *chip, const pca9685_dev_t *dev) {
+    for (int ch = 0; ch < PCA9685_CHANNEL_COUNT; ch++) {
+        const uint8_t *r = &chip->regs[0x06 + 4 * ch];
+        if ((r[0] | ((r[1] & 0x1F) << 8)) != dev->led_on[ch] || (r[2] | ((r[3] & 0x1F) << 8)) != dev->led_off[ch]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Healthy chips read back clean; a browned-out chip is re-initialized and rewritten from
+// its shadow alone, and a corrupted LEDn register is found by the rotating spot read
+void check_scrub(void) {
+    pca9685_check_result_t result;
+    int bytes[2];
+    for (int spot = 0; spot < 2; spot++) {
+        for (int i = 0; i < PCA9685_CHANNEL_COUNT; i++) {
+            sim_bus_reset_stats(I2C_PORT);
+            CHECK(pca9685_check(&pca1, spot, &result) == ESP_OK && result == PCA9685_CHECK_OK,
+                  "healthy 0x%02X: check %d found %d", PCA1_ADDR, i, result);
+            bytes[spot] = sim_bus_get_stats(I2C_PORT)->bytes;
+        }
+    }
+    printf("  check: %d bytes, %d with a spot-read channel\n", bytes[0], bytes[1]);
+
+    sim_pca9685_power_on_reset(&sim_pca2);
+    CHECK(sim_pca9685_high_counts(&sim_pca2, 0) == 0 && !sim_pca9685_awake(&sim_pca2), "PCA2 model did not reset");
+    uint32_t pca1_bytes = sim_pca1.dev.bytes;
+    sim_bus_reset_stats(I2C_PORT);
+    CHECK(pca9685_check(&pca1, false, &result) == ESP_OK && result == PCA9685_CHECK_OK, "0x%02X after PCA2 reset: %d",
+          PCA1_ADDR, result);
+    CHECK(pca9685_check(&pca2, false, &result) == ESP_OK && result == PCA9685_CHECK_RESET,
+          "0x%02X reset not detected: %d", PCA2_ADDR, result);
+    print_stats("reset found + restored");
+    CHECK(sim_pca1.dev.bytes - pca1_bytes == 4, "PCA1 exchanged %lu bytes, only its check expected",
+          (unsigned long)(sim_pca1.dev.bytes - pca1_bytes));
+    float freq = sim_pca9685_frequency(&sim_pca2);
+    CHECK(sim_pca9685_awake(&sim_pca2) && freq > 49.5f && freq < 50.5f, "PCA2 restored at %.2f Hz", freq);
+    CHECK(chip_matches_shadow(&sim_pca2, &pca2), "PCA2 LEDn registers differ from the shadow after restore");
+    check_digit(&sim_pca2, 0, 0);
+    check_digit(&sim_pca2, 7, 1);
+    CHECK(pca9685_check(&pca2, true, &result) == ESP_OK && result == PCA9685_CHECK_OK, "0x%02X after restore: %d",
+          PCA2_ADDR, result);
+
+    // A flipped bit in one OFF register; the rotating spot read reaches it within 16 checks
+    sim_pca1.regs[0x06 + 4 * 9 + 2] ^= 0x10;
+    int found = -1;
+    for (int i = 0; i < PCA9685_CHANNEL_COUNT && found < 0; i++) {
+        CHECK(pca9685_check(&pca1, true, &result) == ESP_OK, "pca9685_check");
+        if (result == PCA9685_CHECK_LED_MISMATCH) found = i;
+    }
+    CHECK(found >= 0, "corrupted LED9_OFF_L not found by 16 spot checks");
+    CHECK(chip_matches_shadow(&sim_pca1, &pca1), "PCA1 LEDn registers differ from the shadow after rewrite");
+    printf("  corrupted channel found after %d spot checks; resets %lu, mismatches %lu\n", found + 1,
+           (unsigned long)(pca1.stats.resets_detected + pca2.stats.resets_detected),
+           (unsigned long)(pca1.stats.led_mismatches + pca2.stats.led_mismatches));
+}
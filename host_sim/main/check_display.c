@@ -0,0 +1,164 @@
+// Display checks: the per-digit frame plans and six digits over three controllers
+
+#include "host_sim.h"
+
+static const segment_plan_digit_t digit_plans[4] = {
+    SEGMENT_PLAN_DIGIT(PCA9685_CHANNEL_0, PULSE_0DEG, PULSE_90DEG, SEGMENT_PLAN_PRESCALE(SERVO_FREQ_HZ)),
+    SEGMENT_PLAN_DIGIT(PCA9685_CHANNEL_7, PULSE_0DEG, PULSE_90DEG, SEGMENT_PLAN_PRESCALE(SERVO_FREQ_HZ)),
+    SEGMENT_PLAN_DIGIT(PCA9685_CHANNEL_0, PULSE_0DEG, PULSE_90DEG, SEGMENT_PLAN_PRESCALE(SERVO_FREQ_HZ)),
+    SEGMENT_PLAN_DIGIT(PCA9685_CHANNEL_7, PULSE_0DEG, PULSE_90DEG, SEGMENT_PLAN_PRESCALE(SERVO_FREQ_HZ)),
+};
+
+// HH:MM:SS over three controllers, the colons on PCA1/PCA2's spare channel 14
+static const segment_channel_t hms_map[6][7] = {
+    SEGMENT_DIGIT_CHANNELS(0, PCA9685_CHANNEL_0),
+    SEGMENT_DIGIT_CHANNELS(0, PCA9685_CHANNEL_7),
+    SEGMENT_DIGIT_CHANNELS(1, PCA9685_CHANNEL_0),
+    SEGMENT_DIGIT_CHANNELS(1, PCA9685_CHANNEL_7),
+    SEGMENT_DIGIT_CHANNELS(2, PCA9685_CHANNEL_0),
+    SEGMENT_DIGIT_CHANNELS(2, PCA9685_CHANNEL_7),
+};
+static const segment_channel_t hms_colons[2] = {{0, PCA9685_CHANNEL_14}, {1, PCA9685_CHANNEL_14}};
+
+// The compile-time plans must stage exactly what the runtime pulse conversion stages
+void check_plans(void) {
+    for (int pos = 0; pos < 4; pos++) {
+        const segment_plan_digit_t *plan = &digit_plans[pos];
+        for (uint8_t digit = 0; digit < 10; digit++) {
+            segment_set_digit(&pca1, plan->first_channel, digit, PULSE_0DEG, PULSE_90DEG);
+            for (int seg = 0; seg < 7; seg++) {
+                uint16_t runtime = pca9685_get_duty(&pca1, plan->first_channel + seg);
+                CHECK(plan->duty[digit][seg] == runtime, "plan %d digit %d seg %d: %u counts, runtime %u",
+                      pos, digit, seg, plan->duty[digit][seg], runtime);
+            }
+        }
+    }
+    CHECK(pca1.prescale == digit_plans[0].prescale, "prescale %u, plans built for %u",
+          pca1.prescale, digit_plans[0].prescale);
+    pca9685_invalidate_shadow(&pca1);
+}
+
+static int popcount7(uint8_t bits) {
+    int n = 0;
+    for (; bits; bits &= bits - 1) n++;
+    return n;
+}
+
+// HH:MM:SS with blinking colons on three controllers: every second only the segments
+// that differ from the previous second may be staged and sent
+void check_six_digits(time_t start) {
+    pca9685_dev_t *const controllers[] = {&pca1, &pca2, &pca3};
+    const segment_display_config_t cfg = {
+        .controllers = controllers,
+        .num_controllers = 3,
+        .digits = hms_map,
+        .num_digits = 6,
+        .colons = hms_colons,
+        .num_colons = 2,
+        .pulse_off_us = PULSE_0DEG,
+        .pulse_on_us = PULSE_90DEG,
+    };
+    static segment_display_t hms;
+    CHECK(segment_display_init(&hms, &cfg) == ESP_OK, "segment_display_init (6 digits)");
+    i2c_bus_set_clock(I2C_PORT, 400000);
+
+    uint8_t shown[6] = {0};
+    bool colon_shown = false;
+    for (int tick = 0; tick < 4; tick++) {
+        time_t now = start + tick;
+        struct tm t;
+        gmtime_r(&now, &t);
+        const uint8_t digits[6] = {t.tm_hour / 10, t.tm_hour % 10, t.tm_min / 10, t.tm_min % 10,
+                                   t.tm_sec / 10, t.tm_sec % 10};
+        bool colon = t.tm_sec % 2 == 0;
+
+        uint32_t staged = hms.segments_staged;
+        int expected = tick == 0 ? 6 * 7 + 2 : colon != colon_shown ? 2 : 0;
+        for (int pos = 0; pos < 6; pos++) {
+            if (tick > 0) {
+                expected += popcount7(segment_digit_patterns[digits[pos]] ^ segment_digit_patterns[shown[pos]]);
+            }
+            segment_display_set_digit(&hms, pos, digits[pos]);
+            shown[pos] = digits[pos];
+        }
+        segment_display_set_colon(&hms, 0, colon);
+        segment_display_set_colon(&hms, 1, colon);
+        colon_shown = colon;
+
+        staged = hms.segments_staged - staged;
+        CHECK((int)staged == expected, "%lu segments staged, %d changed", (unsigned long)staged, expected);
+
+        sim_bus_reset_stats(I2C_PORT);
+        CHECK(segment_display_commit(&hms) == ESP_OK, "segment_display_commit");
+        char label[32];
+        snprintf(label, sizeof(label), "%02d:%02d:%02d (%2d segs)", t.tm_hour, t.tm_min, t.tm_sec, expected);
+        print_stats(label);
+        // Worst case every moved segment is its own write: address, register, 4 LEDn bytes
+        const sim_bus_stats_t *st = sim_bus_get_stats(I2C_PORT);
+        CHECK(st->bytes <= (uint32_t)expected * 6, "%lu bytes for %d changed segments",
+              (unsigned long)st->bytes, expected);
+
+        const sim_pca9685_t *chips[3] = {&sim_pca1, &sim_pca2, &sim_pca3};
+        for (int pos = 0; pos < 6; pos++) check_digit(chips[pos / 2], (pos % 2) * 7, digits[pos]);
+        for (int c = 0; c < 2; c++) {
+            int actual = (int)sim_pca9685_pulse_us(chips[c], 14);
+            int want = colon ? PULSE_90DEG : PULSE_0DEG;
+            CHECK(actual >= want - 5 && actual <= want + 5, "colon %d: %d us, expected %d us", c, actual, want);
+        }
+    }
+}
+
+// 16 digits on ten controllers of the second port: more bursts than a batch has callbacks
+// and, from 1s to 8s, more register runs than it has segments. The commit must split
+// the frame instead of failing it, and nothing may stay dirty afterwards.
+void check_many_controllers(void) {
+    enum { CHIPS = 10, DIGITS = 16 };
+    static sim_pca9685_t sims[CHIPS];
+    static pca9685_dev_t devs[CHIPS];
+    pca9685_dev_t *controllers[CHIPS];
+    static segment_channel_t map[DIGITS][7];
+    for (int c = 0; c < CHIPS; c++) {
+        sim_pca9685_init(&sims[c], 0x50 + c);
+        sim_bus_attach(I2C_NUM_1, &sims[c].dev);
+        controllers[c] = &devs[c];
+    }
+    CHECK(i2c_bus_init(I2C_NUM_1, GPIO_NUM_25, GPIO_NUM_26, 400000) == ESP_OK, "i2c_bus_init port 1");
+    for (int c = 0; c < CHIPS; c++) {
+        CHECK(pca9685_init_frequency(&devs[c], I2C_NUM_1, 0x50 + c, SERVO_FREQ_HZ) == ESP_OK,
+              "pca9685_init_frequency 0x%02X", 0x50 + c);
+    }
+    // Digits on channels 0-6 of every chip, then on channels 8-14 of the first six
+    for (int d = 0; d < DIGITS; d++) {
+        for (int seg = 0; seg < 7; seg++) {
+            map[d][seg].controller = d % CHIPS;
+            map[d][seg].channel = (d / CHIPS) * 8 + seg;
+        }
+    }
+    const segment_display_config_t cfg = {
+        .controllers = controllers,
+        .num_controllers = CHIPS,
+        .digits = map,
+        .num_digits = DIGITS,
+        .pulse_off_us = PULSE_0DEG,
+        .pulse_on_us = PULSE_90DEG,
+    };
+    static segment_display_t wide;
+    CHECK(segment_display_init(&wide, &cfg) == ESP_OK, "segment_display_init (10 controllers)");
+
+    static const uint8_t frames[] = {1, 8, 8};
+    for (size_t f = 0; f < sizeof(frames); f++) {
+        for (int d = 0; d < DIGITS; d++) segment_display_set_digit(&wide, d, frames[f]);
+        sim_bus_reset_stats(I2C_NUM_1);
+        CHECK(segment_display_commit(&wide) == ESP_OK, "segment_display_commit, all %ds", frames[f]);
+        const sim_bus_stats_t *st = sim_bus_get_stats(I2C_NUM_1);
+        printf("  all %ds: %lu transaction(s), %lu bytes\n", frames[f], (unsigned long)st->transactions,
+               (unsigned long)st->bytes);
+        if (f < 2) CHECK(st->transactions >= 2, "%lu transaction(s) for the frame", (unsigned long)st->transactions);
+        else CHECK(st->transactions == 0, "%lu transaction(s) for an unchanged frame", (unsigned long)st->transactions);
+        for (int c = 0; c < CHIPS; c++) {
+            CHECK((devs[c].shadow_valid & 0xFFFF) == 0xFFFF, "0x%02X: channels 0x%04X left dirty",
+                  devs[c].i2c_addr, ~devs[c].shadow_valid & 0xFFFF);
+        }
+        for (int d = 0; d < DIGITS; d++) check_digit(&sims[d % CHIPS], (d / CHIPS) * 8, frames[f]);
+    }
+}
@@ -0,0 +1,303 @@
+// Motion checks: eased flips, the power budget, idle switch-off and landing on a target time
+
+#include "host_sim.h"
+
+// 09:59 -> 10:00 eased over 400 ms with each profile: every tick may only write the
+// servos in motion, segment A of the first digit must travel monotonically, and all
+// segments must have arrived when the move time is up
+void check_motion(void) {
+    static const char *names[] = {"linear", "cosine", "s-curve"};
+    pca9685_dev_t *const controllers[] = {&pca1, &pca2};
+    for (servo_motion_profile_t profile = SERVO_MOTION_LINEAR; profile <= SERVO_MOTION_S_CURVE; profile++) {
+        static servo_motion_t motion;
+        const servo_motion_config_t motion_cfg = {
+            .controllers = controllers,
+            .num_controllers = 2,
+            .profile = profile,
+            .duration_ms = 400,
+        };
+        CHECK(servo_motion_init(&motion, &motion_cfg) == ESP_OK, "servo_motion_init");
+        segment_display_config_t cfg = display.cfg;
+        cfg.motion = &motion;
+        static segment_display_t eased;
+        CHECK(segment_display_init(&eased, &cfg) == ESP_OK, "segment_display_init (motion)");
+
+        static const uint8_t from[4] = {0, 9, 5, 9}, to[4] = {1, 0, 0, 0};
+        for (int pos = 0; pos < 4; pos++) segment_display_set_digit(&eased, pos, from[pos]);
+        for (int tick = 0; tick < 25; tick++) servo_motion_tick(&motion);
+        CHECK(servo_motion_moving(&motion) == 0, "%s: 09:59 not settled", names[profile]);
+
+        for (int pos = 0; pos < 4; pos++) segment_display_set_digit(&eased, pos, to[pos]);
+        size_t moving = servo_motion_moving(&motion);
+        CHECK(moving == 11, "%s: %u servos moving for 09:59 -> 10:00, expected 11", names[profile],
+              (unsigned)moving);
+
+        int last = (int)sim_pca9685_pulse_us(&sim_pca1, 0);
+        int first_step = 0, max_step = 0, ticks = 0, max_bytes = 0;
+        while (servo_motion_moving(&motion) && ticks < 50) {
+            moving = servo_motion_moving(&motion);
+            uint32_t issued = pca1.stats.writes_issued + pca2.stats.writes_issued;
+            sim_bus_reset_stats(I2C_PORT);
+            CHECK(servo_motion_tick(&motion) == ESP_OK, "servo_motion_tick");
+            vTaskDelay(pdMS_TO_TICKS(SERVO_MOTION_TICK_MS));
+            ticks++;
+
+            const sim_bus_stats_t *st = sim_bus_get_stats(I2C_PORT);
+            issued = pca1.stats.writes_issued + pca2.stats.writes_issued - issued;
+            CHECK(issued <= moving, "%s tick %d: %lu channels written, %u moving", names[profile], ticks,
+                  (unsigned long)issued, (unsigned)moving);
+            if ((int)st->bytes > max_bytes) max_bytes = st->bytes;
+
+            int now = (int)sim_pca9685_pulse_us(&sim_pca1, 0);
+            CHECK(now <= last, "%s tick %d: segment A went back from %d to %d us", names[profile], ticks, last, now);
+            if (ticks == 1) first_step = last - now;
+            if (last - now > max_step) max_step = last - now;
+            last = now;
+        }
+        CHECK(ticks == 400 / SERVO_MOTION_TICK_MS, "%s: settled after %d ticks", names[profile], ticks);
+        check_digit(&sim_pca1, 0, 1);
+        check_digit(&sim_pca1, 7, 0);
+        check_digit(&sim_pca2, 0, 0);
+        check_digit(&sim_pca2, 7, 0);
+
+        sim_bus_reset_stats(I2C_PORT);
+        servo_motion_tick(&motion);
+        CHECK(sim_bus_get_stats(I2C_PORT)->bytes == 0, "%s: idle tick used the bus", names[profile]);
+        printf("  %-8s %2d ticks, first step %3d us, peak step %3d us, max %3d bytes/tick\n", names[profile],
+               ticks, first_step, max_step, max_bytes);
+        if (profile != SERVO_MOTION_LINEAR) {
+            CHECK(first_step < (PULSE_90DEG - PULSE_0DEG) / ticks, "%s: first step %d us is not eased",
+                  names[profile], first_step);
+        }
+    }
+    pca9685_invalidate_shadow(&pca1);
+    pca9685_invalidate_shadow(&pca2);
+}
+
+// Moves until every servo has arrived, checking the budget on every tick; returns the ticks taken
+static int run_budgeted(servo_motion_t *motion, uint16_t max_moving) {
+    int ticks = 0;
+    servo_motion_estimate_t est;
+    while (servo_motion_moving(motion) && ticks < 1000) {
+        servo_motion_tick(motion);
+        ticks++;
+        servo_motion_estimate(motion, &est);
+        CHECK(est.moving <= max_moving, "tick %d: %u servos moving, budget %u", ticks, est.moving, max_moving);
+    }
+    return ticks;
+}
+
+// 09:59 -> 10:00 and the power-up frame with at most 4 servos moving: the schedule must
+// take exactly the modeled time and never exceed the budget
+void check_power_budget(void) {
+    pca9685_dev_t *const controllers[] = {&pca1, &pca2};
+    servo_motion_config_t motion_cfg = {
+        .controllers = controllers,
+        .num_controllers = 2,
+        .profile = SERVO_MOTION_S_CURVE,
+        .duration_ms = 400,
+        .max_moving = 4,
+        .move_current_ma = 250,
+        .hold_current_ma = 10,
+    };
+
+    printf("  plans for 400 ms travel, 250 mA moving, 10 mA holding:\n");
+    printf("    max_moving  09:59->10:00 (11 of 28)   power-up (28 of 28)\n");
+    static const uint16_t budgets[] = {1, 2, 4, 7, 0};
+    for (size_t i = 0; i < sizeof(budgets) / sizeof(budgets[0]); i++) {
+        servo_motion_config_t cfg = motion_cfg;
+        cfg.max_moving = budgets[i];
+        servo_motion_estimate_t flip, boot;
+        servo_motion_plan(&cfg, 11, 28, &flip);
+        servo_motion_plan(&cfg, 28, 28, &boot);
+        char label[8];
+        snprintf(label, sizeof(label), budgets[i] ? "%u" : "none", budgets[i]);
+        printf("    %10s  %5lu ms %5lu mA          %5lu ms %5lu mA\n", label, (unsigned long)flip.total_ms,
+               (unsigned long)flip.peak_current_ma, (unsigned long)boot.total_ms, (unsigned long)boot.peak_current_ma);
+    }
+
+    static servo_motion_t motion;
+    CHECK(servo_motion_init(&motion, &motion_cfg) == ESP_OK, "servo_motion_init (budget)");
+    segment_display_config_t cfg = display.cfg;
+    cfg.motion = &motion;
+    static segment_display_t budgeted;
+    CHECK(segment_display_init(&budgeted, &cfg) == ESP_OK, "segment_display_init (budget)");
+
+    // Power-up: no servo has a known position, all 28 take a slot
+    for (int ch = 0; ch < PCA9685_CHANNEL_COUNT; ch++) {
+        pca1.led_off[ch] = 0;
+        pca2.led_off[ch] = 0;
+    }
+    pca9685_invalidate_shadow(&pca1);
+    pca9685_invalidate_shadow(&pca2);
+    static const uint8_t from[4] = {0, 9, 5, 9}, to[4] = {1, 0, 0, 0};
+    for (int pos = 0; pos < 4; pos++) segment_display_set_digit(&budgeted, pos, from[pos]);
+    servo_motion_estimate_t est, plan;
+    servo_motion_estimate(&motion, &est);
+    servo_motion_plan(&motion_cfg, 28, 28, &plan);
+    CHECK(est.total_ms == plan.total_ms && est.peak_current_ma == plan.peak_current_ma,
+          "power-up estimate %lu ms %lu mA, plan %lu ms %lu mA", (unsigned long)est.total_ms,
+          (unsigned long)est.peak_current_ma, (unsigned long)plan.total_ms, (unsigned long)plan.peak_current_ma);
+    int boot_ticks = run_budgeted(&motion, 4);
+    CHECK(boot_ticks * SERVO_MOTION_TICK_MS == (int)plan.total_ms, "power-up took %d ms, modeled %lu ms",
+          boot_ticks * SERVO_MOTION_TICK_MS, (unsigned long)plan.total_ms);
+
+    for (int pos = 0; pos < 4; pos++) segment_display_set_digit(&budgeted, pos, to[pos]);
+    servo_motion_estimate(&motion, &est);
+    servo_motion_plan(&motion_cfg, 11, 28, &plan);
+    CHECK(est.total_ms == plan.total_ms && est.peak_current_ma == plan.peak_current_ma,
+          "flip estimate %lu ms %lu mA, plan %lu ms %lu mA", (unsigned long)est.total_ms,
+          (unsigned long)est.peak_current_ma, (unsigned long)plan.total_ms, (unsigned long)plan.peak_current_ma);
+    int ticks = run_budgeted(&motion, 4);
+    CHECK(ticks * SERVO_MOTION_TICK_MS == (int)plan.total_ms, "flip took %d ms, modeled %lu ms",
+          ticks * SERVO_MOTION_TICK_MS, (unsigned long)plan.total_ms);
+    CHECK(motion.stats.max_moving == 4, "at most %u servos moved at once, budget 4", motion.stats.max_moving);
+    check_digit(&sim_pca1, 0, 1);
+    check_digit(&sim_pca1, 7, 0);
+    check_digit(&sim_pca2, 0, 0);
+    check_digit(&sim_pca2, 7, 0);
+    printf("  budget 4: power-up %d ms, 09:59 -> 10:00 %d ms\n", boot_ticks * SERVO_MOTION_TICK_MS,
+           ticks * SERVO_MOTION_TICK_MS);
+}
+
+// A minute of the eased clock with idle switch-off: the pulses go off once the servos have
+// rested idle_off_ms, come back at the same positions on servo_motion_hold ahead of the
+// change, and go off again after it
+void check_idle_off(void) {
+    pca9685_dev_t *const controllers[] = {&pca1, &pca2};
+    const servo_motion_config_t motion_cfg = {
+        .controllers = controllers,
+        .num_controllers = 2,
+        .profile = SERVO_MOTION_S_CURVE,
+        .duration_ms = 400,
+        .hold_current_ma = 10,
+        .idle_off_ms = 2000,
+    };
+    const int idle_ticks = 2000 / SERVO_MOTION_TICK_MS;
+    static servo_motion_t motion;
+    CHECK(servo_motion_init(&motion, &motion_cfg) == ESP_OK, "servo_motion_init (idle off)");
+    segment_display_config_t cfg = display.cfg;
+    cfg.motion = &motion;
+    static segment_display_t idle;
+    CHECK(segment_display_init(&idle, &cfg) == ESP_OK, "segment_display_init (idle off)");
+
+    static const uint8_t from[4] = {0, 9, 5, 9}, to[4] = {1, 0, 0, 0};
+    for (int pos = 0; pos < 4; pos++) segment_display_set_digit(&idle, pos, from[pos]);
+    int ticks = 0;
+    while (servo_motion_moving(&motion) && ticks < 100) {
+        servo_motion_tick(&motion);
+        ticks++;
+    }
+    servo_motion_reset_stats(&motion);
+
+    // From 09:59:00 to 10:00 and on until the servos are switched off again; hold at :59,
+    // less than idle_off_ms ahead of the change
+    const int hold_tick = 59 * SERVO_MOTION_TICK_HZ, change_tick = 60 * SERVO_MOTION_TICK_HZ;
+    int off_at = -1, bytes_off = 0;
+    for (int tick = 0; motion.stats.idle_offs < 2 && tick < 2 * change_tick; tick++) {
+        if (tick == hold_tick) {
+            CHECK(segments_pulsing() == 0, "%d segments still pulsing at :59", segments_pulsing());
+            servo_motion_hold(&motion);
+        }
+        if (tick == change_tick) {
+            for (int pos = 0; pos < 4; pos++) segment_display_set_digit(&idle, pos, to[pos]);
+        }
+        sim_bus_reset_stats(I2C_PORT);
+        servo_motion_tick(&motion);
+        uint32_t bytes = sim_bus_get_stats(I2C_PORT)->bytes;
+        if (off_at < 0 && segments_pulsing() == 0) {
+            off_at = tick;
+            bytes_off = bytes;
+        }
+        if (tick == hold_tick) {
+            CHECK(segments_pulsing() == 28, "%d segments pulsing after servo_motion_hold", segments_pulsing());
+            check_digit(&sim_pca1, 0, from[0]);
+            check_digit(&sim_pca2, 7, from[3]);
+        } else if (tick > hold_tick && tick < change_tick) {
+            CHECK(bytes == 0, "tick %d: holding used the bus", tick);
+        }
+    }
+    CHECK(off_at == idle_ticks - 1, "pulses off after %d ticks at rest, expected %d", off_at + 1, idle_ticks);
+    CHECK(motion.stats.idle_offs == 2, "switched off %lu times, expected 2", (unsigned long)motion.stats.idle_offs);
+    CHECK(segments_pulsing() == 0, "%d segments pulsing after 10:00 settled", segments_pulsing());
+    for (int pos = 0; pos < 4; pos++) {
+        for (int seg = 0; seg < 7; seg++) {
+            pca9685_dev_t *dev = pos < 2 ? &pca1 : &pca2;
+            CHECK(pca9685_get_duty(dev, (pos % 2) * 7 + seg), "digit %d seg %d lost its position", pos, seg);
+        }
+    }
+    servo_motion_hold(&motion);
+    servo_motion_tick(&motion);
+    for (int pos = 0; pos < 4; pos++) check_digit(pos < 2 ? &sim_pca1 : &sim_pca2, (pos % 2) * 7, to[pos]);
+
+    servo_motion_energy_t energy;
+    servo_motion_energy(&motion, &energy);
+    printf("  switch-off after %d ms at rest: %d bytes; pulses off %.1f%% of the time, "
+           "%.3f mAh held, %.3f mAh saved at 10 mA per servo\n", idle_ticks * SERVO_MOTION_TICK_MS, bytes_off,
+           energy.off_pct, energy.hold_mah, energy.saved_mah);
+    CHECK(energy.off_pct > 85.0f, "pulses off only %.1f%% of the time", energy.off_pct);
+}
+
+// 09:59 -> 10:00 with at most 4 servos moving, launched ahead so the last servo settles at
+// an off-grid target: segment A of the first digit settles 300 ms after its last pulse, the
+// rest 100 ms. Nothing may move before the launch tick, the slow servo must go first, and
+// the last servo must land within half a tick (plus the commit) of the target.
+void check_landing(void) {
+    pca9685_dev_t *const controllers[] = {&pca1, &pca2};
+    const servo_motion_config_t motion_cfg = {
+        .controllers = controllers,
+        .num_controllers = 2,
+        .profile = SERVO_MOTION_S_CURVE,
+        .duration_ms = 400,
+        .max_moving = 4,
+        .settle_ms = 100,
+    };
+    static servo_motion_t motion;
+    CHECK(servo_motion_init(&motion, &motion_cfg) == ESP_OK, "servo_motion_init (landing)");
+    servo_motion_set_settle(&motion, &pca1, PCA9685_CHANNEL_0, 300);
+    segment_display_config_t cfg = display.cfg;
+    cfg.motion = &motion;
+    static segment_display_t landing;
+    CHECK(segment_display_init(&landing, &cfg) == ESP_OK, "segment_display_init (landing)");
+
+    static const uint8_t from[4] = {0, 9, 5, 9}, to[4] = {1, 0, 0, 0};
+    for (int pos = 0; pos < 4; pos++) segment_display_set_digit(&landing, pos, from[pos]);
+    for (int tick = 0; servo_motion_moving(&motion) && tick < 200; tick++) servo_motion_tick(&motion);
+    servo_motion_reset_stats(&motion);
+
+    // 11 moves in 3 rounds of 20 ticks: the last one gets its pulse on tick 59, 100 ms to settle
+    const uint32_t expected_lead = (3 * 20 - 1) * SERVO_MOTION_TICK_MS + 100;
+    int64_t land_at = esp_timer_get_time() + 3007000;
+    CHECK(servo_motion_defer(&motion) == ESP_OK, "servo_motion_defer");
+    for (int pos = 0; pos < 4; pos++) segment_display_set_digit(&landing, pos, to[pos]);
+    uint32_t lead;
+    CHECK(servo_motion_land_at(&motion, land_at, &lead) == ESP_OK, "servo_motion_land_at");
+    CHECK(lead == expected_lead, "lead %lu ms, expected %lu ms", (unsigned long)lead, (unsigned long)expected_lead);
+
+    int64_t launched = 0;
+    int ticks = 0;
+    TickType_t wake = xTaskGetTickCount();
+    while (motion.stats.landings == 0 && ticks < 500) {
+        int64_t now = esp_timer_get_time();
+        servo_motion_tick(&motion);
+        ticks++;
+        if (!launched && motion.stats.moves) {
+            launched = now;
+            CHECK(motion.moving[0] & (1u << PCA9685_CHANNEL_0), "segment A of the first digit not moved first");
+        }
+        xTaskDelayUntil(&wake, pdMS_TO_TICKS(SERVO_MOTION_TICK_MS));
+    }
+    int64_t launch_at = land_at - (int64_t)lead * 1000;
+    CHECK(motion.stats.landings == 1, "%lu landings", (unsigned long)motion.stats.landings);
+    CHECK(llabs(launched - launch_at) <= SERVO_MOTION_TICK_MS * 500, "launched %lld us from the launch time",
+          (long long)(launched - launch_at));
+    int32_t error = motion.stats.last_landing_us;
+    CHECK(abs(error) <= SERVO_MOTION_TICK_MS * 500 + 2000, "landed %ld us from the target", (long)error);
+    for (int pos = 0; pos < 4; pos++) check_digit(pos < 2 ? &sim_pca1 : &sim_pca2, (pos % 2) * 7, to[pos]);
+
+    // The minute handler staging the same digits again finds nothing to move
+    for (int pos = 0; pos < 4; pos++) segment_display_set_digit(&landing, pos, to[pos]);
+    CHECK(servo_motion_moving(&motion) == 0, "restaging the landed frame moved servos");
+    printf("  lead %lu ms, launched %+lld us from the launch time, landed %+ld us from the target\n",
+           (unsigned long)lead, (long long)(launched - launch_at), (long)error);
+}
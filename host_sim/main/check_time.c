@@ -0,0 +1,192 @@
+// Time checks: second ticks, the time service and the system clock kept from the RTC
+
+#include "host_sim.h"
+
+static bool rtc_sqw_level(const void *ctx) {
+    return sim_ds1307_sqw_level(ctx);
+}
+
+// Two minute rollovers on SQW edges: every second is counted right, the RTC is read only at
+// start and at the rollovers, and a dead SQW pin degrades to reading it after the timeout
+void check_second_tick(time_t start) {
+    sim_ds1307_set_time(&sim_rtc, start - 3);
+    sim_gpio_connect(SQW_GPIO, rtc_sqw_level, &sim_rtc);
+    static rtc_tick_t tick;
+    const rtc_tick_config_t cfg = {.rtc = &rtc, .bus = &rtc_client, .sqw_gpio = SQW_GPIO};
+    CHECK(rtc_tick_init(&tick, &cfg) == ESP_OK, "rtc_tick_init");
+    CHECK(tick.valid && tick.stats.rtc_reads == 1, "first read: valid %d, %lu reads", tick.valid,
+          (unsigned long)tick.stats.rtc_reads);
+
+    const int seconds = 120;
+    int wrong = 0;
+    uint64_t worst_ns = 0;
+    sim_bus_reset_stats(I2C_PORT);
+    for (int i = 0; i < seconds; i++) {
+        struct tm time;
+        CHECK(rtc_tick_wait(&tick, &time) == ESP_OK, "rtc_tick_wait %d", i);
+        time_t now = sim_ds1307_now(&sim_rtc);
+        struct tm expect;
+        gmtime_r(&now, &expect);
+        if (time.tm_hour != expect.tm_hour || time.tm_min != expect.tm_min || time.tm_sec != expect.tm_sec) wrong++;
+        // Since the second began on the RTC's divider
+        uint64_t late_ns = (sim_clock_ns() - sim_rtc.base_ns) % 1000000000ULL;
+        if (late_ns > worst_ns) worst_ns = late_ns;
+    }
+    CHECK(wrong == 0, "%d of %d ticks returned a time other than the RTC's", wrong, seconds);
+    CHECK(tick.stats.edges == (uint32_t)seconds && tick.stats.rtc_reads == 3 && tick.stats.resyncs == 0,
+          "%lu edges, %lu RTC reads, %lu resyncs; expected %d, 3, 0", (unsigned long)tick.stats.edges,
+          (unsigned long)tick.stats.rtc_reads, (unsigned long)tick.stats.resyncs, seconds);
+    CHECK(worst_ns < 1000000, "a tick returned %.2f ms into the second", worst_ns / 1e6);
+    printf("  %d s: %lu RTC reads instead of %d (%lu bytes at the rollovers); returned <= %.2f ms after "
+           "the second, max edge latency %lu us\n", seconds, (unsigned long)tick.stats.rtc_reads, seconds,
+           (unsigned long)sim_bus_get_stats(I2C_PORT)->bytes, worst_ns / 1e6,
+           (unsigned long)tick.stats.max_latency_us);
+
+    // SQW/OUT no longer reaching the pin
+    sim_gpio_connect(SQW_GPIO, NULL, NULL);
+    struct tm time;
+    uint64_t before = sim_clock_ns();
+    CHECK(rtc_tick_wait(&tick, &time) == ESP_OK && tick.stats.timeouts == 1, "no fallback read without edges");
+    uint64_t waited_ms = (sim_clock_ns() - before) / 1000000;
+    time_t now = sim_ds1307_now(&sim_rtc);
+    struct tm expect;
+    gmtime_r(&now, &expect);
+    CHECK(waited_ms >= RTC_TICK_TIMEOUT_MS && time.tm_min == expect.tm_min && time.tm_sec == expect.tm_sec,
+          "fallback after %lu ms read %02d:%02d", (unsigned long)waited_ms, time.tm_min, time.tm_sec);
+    printf("  dead SQW pin: RTC read after %lu ms\n", (unsigned long)waited_ms);
+
+    CHECK(rtc_tick_deinit(&tick) == ESP_OK && !(sim_rtc.regs[0x07] & 0x10), "square wave still enabled");
+
+    // A DS1307 that NACKs: the square wave cannot be started, so the tick polls instead of failing
+    static i2c_dev_t absent;
+    static rtc_tick_t polled;
+    absent = rtc;
+    absent.addr = 0x6F;
+    const rtc_tick_config_t absent_cfg = {.rtc = &absent, .bus = &rtc_client, .sqw_gpio = SQW_GPIO};
+    CHECK(rtc_tick_init(&polled, &absent_cfg) == ESP_OK && polled.cfg.sqw_gpio == GPIO_NUM_NC && !polled.valid,
+          "absent DS1307: rtc_tick_init did not fall back to polling");
+    printf("  absent DS1307: polling the RTC, no square wave\n");
+}
+
+// Across midnight: the snapshot follows the RTC every second while a subscriber to minutes
+// and days is notified only at 00:00 and 00:01, with the day bit once
+void check_time_service(void) {
+    struct tm late = {.tm_year = 126, .tm_mon = 9, .tm_mday = 17, .tm_hour = 23, .tm_min = 59, .tm_sec = 30};
+    sim_ds1307_set_time(&sim_rtc, timegm(&late));
+    sim_gpio_connect(SQW_GPIO, rtc_sqw_level, &sim_rtc);
+    static time_service_t svc;
+    const time_service_config_t cfg = {.tick = {.rtc = &rtc, .bus = &rtc_client, .sqw_gpio = SQW_GPIO}};
+    CHECK(time_service_init(&svc, &cfg) == ESP_OK, "time_service_init");
+
+    // The host shim has one notification value, standing for the display task
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    uint32_t events = 0;
+    xTaskNotifyWait(0, TIME_EVENT_ALL, &events, 0);
+    CHECK(time_service_subscribe(&svc, self, TIME_EVENT_MINUTE | TIME_EVENT_DAY) == ESP_OK, "subscribe");
+    CHECK(xTaskNotifyWait(0, TIME_EVENT_ALL, &events, 0) == pdTRUE && events == (TIME_EVENT_MINUTE | TIME_EVENT_DAY),
+          "subscribing did not deliver the current time: 0x%lx", (unsigned long)events);
+
+    const int seconds = 100;
+    int wrong = 0, wakeups = 0, minute_events = 0, day_events = 0;
+    for (int i = 0; i < seconds; i++) {
+        CHECK(time_service_update(&svc) == ESP_OK, "time_service_update %d", i);
+        struct tm time, expect;
+        CHECK(time_service_get(&svc, &time) == ESP_OK, "time_service_get");
+        time_t now = sim_ds1307_now(&sim_rtc);
+        gmtime_r(&now, &expect);
+        if (time.tm_mday != expect.tm_mday || time.tm_hour != expect.tm_hour || time.tm_min != expect.tm_min ||
+            time.tm_sec != expect.tm_sec) {
+            wrong++;
+        }
+        if (xTaskNotifyWait(0, TIME_EVENT_ALL, &events, 0) == pdTRUE) {
+            wakeups++;
+            CHECK(!(events & ~(TIME_EVENT_MINUTE | TIME_EVENT_DAY)), "notified of unsubscribed events 0x%lx",
+                  (unsigned long)events);
+            CHECK(time.tm_sec == 0, "woken at %02d:%02d:%02d", time.tm_hour, time.tm_min, time.tm_sec);
+            if (events & TIME_EVENT_MINUTE) minute_events++;
+            if (events & TIME_EVENT_DAY) {
+                day_events++;
+                CHECK(time.tm_mday == 18 && time.tm_wday == 0, "day event on day %d, weekday %d", time.tm_mday,
+                      time.tm_wday);
+            }
+        }
+    }
+    CHECK(wrong == 0, "%d of %d snapshots differed from the RTC", wrong, seconds);
+    CHECK(wakeups == 2 && minute_events == 2 && day_events == 1, "%d wakeups, %d minute and %d day events; "
+          "expected 2, 2, 1", wakeups, minute_events, day_events);
+    CHECK(svc.stats.seconds == (uint32_t)seconds && svc.stats.minutes == 2 && svc.stats.hours == 1 &&
+          svc.stats.days == 1, "published %lu s, %lu min, %lu h, %lu d", (unsigned long)svc.stats.seconds,
+          (unsigned long)svc.stats.minutes, (unsigned long)svc.stats.hours, (unsigned long)svc.stats.days);
+    CHECK(svc.tick.stats.rtc_reads == 2, "%lu RTC reads, expected the one at start and the alignment",
+          (unsigned long)svc.tick.stats.rtc_reads);
+    printf("  %d s across midnight: subscriber woken %d times (%d day change), %lu RTC reads\n", seconds, wakeups,
+           day_events, (unsigned long)svc.tick.stats.rtc_reads);
+
+    CHECK(time_service_unsubscribe(&svc, self) == ESP_OK, "unsubscribe");
+    CHECK(time_service_unsubscribe(&svc, self) == ESP_ERR_NOT_FOUND, "unsubscribed twice");
+    CHECK(rtc_tick_deinit(&svc.tick) == ESP_OK, "rtc_tick_deinit");
+    sim_gpio_connect(SQW_GPIO, NULL, NULL);
+}
+
+// RTC time at the virtual clock's now, to the microsecond
+static int64_t rtc_now_us(void) {
+    return (int64_t)sim_rtc.base * 1000000 + (int64_t)((sim_clock_ns() - sim_rtc.base_ns) / 1000);
+}
+
+// A quarter of an hour with the system clock running 40 ppm fast: seconds come from the system clock,
+// the RTC is read only at the resyncs, and the slewed clock stays within the drift of one
+// interval of the RTC without repeating or skipping a second
+void check_timekeeping(time_t start) {
+    const int32_t drift_ppm = 40;
+    const uint32_t resync_s = 150;
+    const int seconds = 900;
+    sim_ds1307_set_time(&sim_rtc, start);
+    sim_gpio_connect(SQW_GPIO, rtc_sqw_level, &sim_rtc);
+    sim_sysclock_set_drift_ppm(drift_ppm);
+    static time_service_t svc;
+    const time_service_config_t cfg = {
+        .tick = {.rtc = &rtc, .bus = &rtc_client, .sqw_gpio = SQW_GPIO},
+        .resync_s = resync_s,
+    };
+    CHECK(time_service_init(&svc, &cfg) == ESP_OK, "time_service_init");
+
+    int wrong = 0, repeated = 0;
+    int64_t worst_us = 0;
+    time_t last = 0;
+    sim_bus_reset_stats(I2C_PORT);
+    for (int i = 0; i < seconds; i++) {
+        CHECK(time_service_update(&svc) == ESP_OK, "time_service_update %d", i);
+        struct tm time, expect;
+        time_service_get(&svc, &time);
+        time_t rtc_now = sim_ds1307_now(&sim_rtc);
+        gmtime_r(&rtc_now, &expect);
+        if (time.tm_min != expect.tm_min || time.tm_sec != expect.tm_sec) wrong++;
+        time_t published = timegm(&time);
+        if (published == last) repeated++;
+        last = published;
+        if (i < 2) continue; // before the alignment at the first edge
+        struct timeval now;
+        gettimeofday(&now, NULL);
+        int64_t error_us = (int64_t)now.tv_sec * 1000000 + now.tv_usec - rtc_now_us();
+        if (llabs(error_us) > worst_us) worst_us = llabs(error_us);
+    }
+    uint32_t reads = svc.tick.stats.rtc_reads;
+    uint32_t expected_reads = 2 + seconds / resync_s - 1; // start, alignment, then every resync_s
+    CHECK(wrong == 0 && repeated == 0, "%d seconds published off the RTC, %d repeated", wrong, repeated);
+    CHECK(reads <= expected_reads + 1, "%lu RTC reads in %d s, expected about %lu", (unsigned long)reads, seconds,
+          (unsigned long)expected_reads);
+    // 40 ppm over 150 s is 6 ms; slewed out at 1/64 within a second
+    CHECK(worst_us < drift_ppm * resync_s + 2000, "system clock %lld us off the RTC", (long long)worst_us);
+    CHECK(svc.stats.drift_ppm > drift_ppm - 2 && svc.stats.drift_ppm < drift_ppm + 2 && svc.stats.slews > 0,
+          "drift measured %.1f ppm with %lu slews, expected %d", svc.stats.drift_ppm,
+          (unsigned long)svc.stats.slews, (int)drift_ppm);
+    printf("  %d s at +%d ppm, resync every %lu s: %lu RTC reads (%lu bytes) instead of %d, system clock within "
+           "%.2f ms of the RTC, drift measured %.1f ppm (%lu steps, %lu slews)\n", seconds, (int)drift_ppm,
+           (unsigned long)resync_s, (unsigned long)reads, (unsigned long)sim_bus_get_stats(I2C_PORT)->bytes,
+           seconds, worst_us / 1000.0, svc.stats.drift_ppm, (unsigned long)svc.stats.steps,
+           (unsigned long)svc.stats.slews);
+
+    CHECK(rtc_tick_deinit(&svc.tick) == ESP_OK, "rtc_tick_deinit");
+    sim_gpio_connect(SQW_GPIO, NULL, NULL);
+    sim_sysclock_set_drift_ppm(0);
+}
@@ -0,0 +1,255 @@
+// Runs the clock's refresh path (PCA9685 frame, batched LCD redraw, RTC read) against
+// the simulated bus and checks what the device models end up showing; main runs the
+// scenarios, which live in one check_<area>.c file per area
+#include "host_sim.h"
+
+// final_clock's layout: HH on PCA1, MM on PCA2
+const segment_channel_t digit_map[4][7] = {
+    SEGMENT_DIGIT_CHANNELS(0, PCA9685_CHANNEL_0),
+    SEGMENT_DIGIT_CHANNELS(0, PCA9685_CHANNEL_7),
+    SEGMENT_DIGIT_CHANNELS(1, PCA9685_CHANNEL_0),
+    SEGMENT_DIGIT_CHANNELS(1, PCA9685_CHANNEL_7),
+};
+
+static const char *day_names[7] = {
+    "Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday"
+};
+
+sim_pca9685_t sim_pca1, sim_pca2, sim_pca3;
+sim_ds1307_t sim_rtc;
+sim_hd44780_t sim_lcd;
+pca9685_dev_t pca1, pca2, pca3;
+segment_display_t display;
+i2c_dev_t rtc;
+i2c_bus_client_t rtc_client;
+int failures;
+
+// As in final_clock: i2cdev does its own transactions, so take the shared bus lock here
+esp_err_t rtc_get_time(struct tm *time) {
+    esp_err_t err = i2c_bus_acquire(&rtc_client, pdMS_TO_TICKS(1000));
+    if (err != ESP_OK) return err;
+    err = ds1307_get_time(&rtc, time);
+    i2c_bus_release(&rtc_client);
+    return err;
+}
+
+static void show_date(const struct tm *time) {
+    char date_str[LCD_COLS + 1];
+    char line[LCD_COLS + 1];
+
+    strftime(date_str, sizeof(date_str), "Date: %d/%m", time);
+    snprintf(line, sizeof(line), "%-*s", LCD_COLS, date_str);
+    LCD_setCursor(0, 0);
+    LCD_writeStr(line);
+
+    snprintf(line, sizeof(line), "%-*s", LCD_COLS, day_names[time->tm_wday]);
+    LCD_setCursor(0, 1);
+    LCD_writeStr(line);
+}
+
+// One pass of final_clock's main loop, run inline instead of through the executors
+esp_err_t refresh(struct tm *time) {
+    esp_err_t err = rtc_get_time(time);
+    if (err != ESP_OK) return err;
+
+    segment_display_set_digit(&display, 0, time->tm_hour / 10);
+    segment_display_set_digit(&display, 1, time->tm_hour % 10);
+    segment_display_set_digit(&display, 2, time->tm_min / 10);
+    segment_display_set_digit(&display, 3, time->tm_min % 10);
+
+    static i2c_batch_t servo_batch, lcd_batch;
+    i2c_batch_begin(&servo_batch);
+    segment_display_queue(&display, I2C_PORT, &servo_batch);
+    err = i2c_batch_submit(&servo_batch, I2C_PORT, pdMS_TO_TICKS(1000));
+    if (err != ESP_OK) return err;
+
+    i2c_batch_begin(&lcd_batch);
+    LCD_setBatch(&lcd_batch);
+    show_date(time);
+    LCD_setBatch(NULL);
+    return i2c_batch_submit(&lcd_batch, I2C_PORT, pdMS_TO_TICKS(1000));
+}
+
+void check_digit(const sim_pca9685_t *chip, uint8_t first_channel, uint8_t digit) {
+    uint8_t pattern = segment_digit_patterns[digit];
+    for (int seg = 0; seg < 7; seg++) {
+        int expected = (pattern & (1 << seg)) ? PULSE_90DEG : PULSE_0DEG;
+        int actual = (int)sim_pca9685_pulse_us(chip, first_channel + seg);
+        // one count at 50 Hz is 4.88 us
+        CHECK(actual >= expected - 5 && actual <= expected + 5,
+              "0x%02X ch%d: %d us, expected %d us for digit %d", chip->dev.addr,
+              first_channel + seg, actual, expected, digit);
+    }
+}
+
+void check_display(const struct tm *time) {
+    check_digit(&sim_pca1, 0, time->tm_hour / 10);
+    check_digit(&sim_pca1, 7, time->tm_hour % 10);
+    check_digit(&sim_pca2, 0, time->tm_min / 10);
+    check_digit(&sim_pca2, 7, time->tm_min % 10);
+
+    char row[LCD_COLS + 1], expected[LCD_COLS + 1], date_str[LCD_COLS + 1];
+    strftime(date_str, sizeof(date_str), "Date: %d/%m", time);
+    snprintf(expected, sizeof(expected), "%-*s", LCD_COLS, date_str);
+    sim_hd44780_read_row(&sim_lcd, 0, row, LCD_COLS);
+    CHECK(strcmp(row, expected) == 0, "LCD row 0 \"%s\", expected \"%s\"", row, expected);
+    snprintf(expected, sizeof(expected), "%-*s", LCD_COLS, day_names[time->tm_wday]);
+    sim_hd44780_read_row(&sim_lcd, 1, row, LCD_COLS);
+    CHECK(strcmp(row, expected) == 0, "LCD row 1 \"%s\", expected \"%s\"", row, expected);
+}
+
+void print_stats(const char *label) {
+    const sim_bus_stats_t *s = sim_bus_get_stats(I2C_PORT);
+    printf("  %-22s %4lu txn %4lu starts %5lu bytes %9.1f us on the wire\n", label,
+           (unsigned long)s->transactions, (unsigned long)s->starts, (unsigned long)s->bytes,
+           s->bus_time_ns / 1000.0);
+}
+
+// Pulses of the 28 segment channels as the chips output them
+int segments_pulsing(void) {
+    int count = 0;
+    for (int pos = 0; pos < 4; pos++) {
+        const sim_pca9685_t *chip = pos < 2 ? &sim_pca1 : &sim_pca2;
+        for (int seg = 0; seg < 7; seg++) count += sim_pca9685_high_counts(chip, (pos % 2) * 7 + seg) != 0;
+    }
+    return count;
+}
+
+int main(void) {
+    // 2026-10-17 09:59:58 UTC, a Saturday: the next refresh after two seconds rolls three digits
+    struct tm start = {.tm_year = 126, .tm_mon = 9, .tm_mday = 17, .tm_hour = 9, .tm_min = 59, .tm_sec = 58};
+    // The DS1307 keeps local time; the checks compare against it as UTC
+    setenv("TZ", "UTC0", 1);
+    tzset();
+    sim_bus_reset();
+    sim_pca9685_init(&sim_pca1, PCA1_ADDR);
+    sim_pca9685_init(&sim_pca2, PCA2_ADDR);
+    sim_pca9685_init(&sim_pca3, PCA3_ADDR);
+    sim_ds1307_init(&sim_rtc, SIM_DS1307_ADDR, timegm(&start));
+    sim_hd44780_init(&sim_lcd, LCD_ADDR);
+    sim_bus_attach(I2C_PORT, &sim_pca1.dev);
+    sim_bus_attach(I2C_PORT, &sim_pca2.dev);
+    sim_bus_attach(I2C_PORT, &sim_pca3.dev);
+    sim_bus_attach(I2C_PORT, &sim_rtc.dev);
+    sim_bus_attach(I2C_PORT, &sim_lcd.dev);
+
+    printf("Bring-up at %d Hz\n", SIM_BUS_DEFAULT_CLK_HZ);
+    static i2c_bus_client_t early_client;
+    CHECK(i2c_bus_client_init(&early_client, I2C_PORT, "early") == ESP_ERR_INVALID_STATE &&
+          i2c_bus_default_client(I2C_PORT) == NULL, "port usable before i2c_bus_init");
+    CHECK(i2c_bus_init(I2C_PORT, GPIO_NUM_21, GPIO_NUM_22, SIM_BUS_DEFAULT_CLK_HZ) == ESP_OK, "i2c_bus_init");
+    i2c_bus_client_init(&rtc_client, I2C_PORT, "ds1307");
+    CHECK(ds1307_init_desc(&rtc, I2C_PORT, GPIO_NUM_21, GPIO_NUM_22) == ESP_OK, "ds1307_init_desc");
+
+    sim_bus_reset_stats(I2C_PORT);
+    LCD_initOnPort(I2C_PORT, LCD_ADDR, GPIO_NUM_21, GPIO_NUM_22, LCD_COLS, LCD_ROWS);
+    print_stats("LCD_init");
+    CHECK(sim_lcd.four_bit && sim_lcd.two_line && sim_lcd.display_on, "LCD not in 4-bit, 2-line, display on");
+
+    sim_bus_reset_stats(I2C_PORT);
+    CHECK(pca9685_init(&pca1, I2C_PORT, PCA1_ADDR) == ESP_OK, "pca9685_init 0x%02X", PCA1_ADDR);
+    CHECK(pca9685_set_frequency(&pca1, SERVO_FREQ_HZ) == ESP_OK, "pca9685_set_frequency 0x%02X", PCA1_ADDR);
+    CHECK(pca9685_init(&pca2, I2C_PORT, PCA2_ADDR) == ESP_OK, "pca9685_init 0x%02X", PCA2_ADDR);
+    CHECK(pca9685_set_frequency(&pca2, SERVO_FREQ_HZ) == ESP_OK, "pca9685_set_frequency 0x%02X", PCA2_ADDR);
+    print_stats("2x PCA9685 init + 50Hz");
+    CHECK(sim_pca9685_awake(&sim_pca1) && sim_pca9685_awake(&sim_pca2), "PCA9685 left asleep");
+    CHECK(sim_pca1.prescale_ignored == 0 && sim_pca2.prescale_ignored == 0, "PRE_SCALE written while awake");
+    float freq = sim_pca9685_frequency(&sim_pca1);
+    CHECK(freq > 49.5f && freq < 50.5f, "PWM frequency %.2f Hz", freq);
+    check_plans();
+
+    pca9685_dev_t *const controllers[] = {&pca1, &pca2};
+    const segment_display_config_t display_cfg = {
+        .controllers = controllers,
+        .num_controllers = 2,
+        .digits = digit_map,
+        .num_digits = 4,
+        .pulse_off_us = PULSE_0DEG,
+        .pulse_on_us = PULSE_90DEG,
+    };
+    CHECK(segment_display_init(&display, &display_cfg) == ESP_OK, "segment_display_init");
+
+    printf("Refresh cost by bus speed\n");
+    static const uint32_t speeds[] = {100000, 400000, 1000000};
+    for (size_t i = 0; i < sizeof(speeds) / sizeof(speeds[0]); i++) {
+        CHECK(i2c_bus_set_clock(I2C_PORT, speeds[i]) == ESP_OK, "i2c_bus_set_clock %lu Hz", (unsigned long)speeds[i]);
+        printf(" %lu Hz\n", (unsigned long)speeds[i]);
+
+        // Full redraw from unknown state, then the minute rollover 09:59 -> 10:00
+        struct tm time;
+        pca9685_invalidate_shadow(&pca1);
+        pca9685_invalidate_shadow(&pca2);
+        segment_display_invalidate(&display);
+        sim_ds1307_set_time(&sim_rtc, timegm(&start));
+        uint32_t violations = sim_lcd.timing_violations;
+
+        sim_bus_reset_stats(I2C_PORT);
+        CHECK(refresh(&time) == ESP_OK, "refresh");
+        print_stats("full refresh");
+        check_display(&time);
+        CHECK(sim_pca1.latched_at_ns == sim_pca2.latched_at_ns, "PCA outputs did not latch on one STOP");
+
+        vTaskDelay(pdMS_TO_TICKS(2000));
+        sim_bus_reset_stats(I2C_PORT);
+        CHECK(refresh(&time) == ESP_OK, "refresh");
+        print_stats("09:59 -> 10:00");
+        CHECK(time.tm_hour == 10 && time.tm_min == 0, "RTC read %02d:%02d, expected 10:00", time.tm_hour, time.tm_min);
+        check_display(&time);
+
+        sim_bus_reset_stats(I2C_PORT);
+        CHECK(refresh(&time) == ESP_OK, "refresh");
+        print_stats("unchanged minute");
+        check_display(&time);
+
+        printf("  HD44780 timing violations: %lu\n", (unsigned long)(sim_lcd.timing_violations - violations));
+        CHECK(sim_lcd.timing_violations == violations, "%lu HD44780 timing violations at %lu Hz",
+              (unsigned long)(sim_lcd.timing_violations - violations), (unsigned long)speeds[i]);
+    }
+
+    printf("Eased flips at 400000 Hz, 400 ms\n");
+    check_motion();
+
+    printf("Power-budgeted flips\n");
+    check_power_budget();
+
+    printf("Idle switch-off over one minute\n");
+    check_idle_off();
+
+    printf("Flips landing on a target time\n");
+    check_landing();
+
+    printf("Six digits, three controllers at 400000 Hz\n");
+    CHECK(pca9685_init(&pca3, I2C_PORT, PCA3_ADDR) == ESP_OK, "pca9685_init 0x%02X", PCA3_ADDR);
+    CHECK(pca9685_set_frequency(&pca3, SERVO_FREQ_HZ) == ESP_OK, "pca9685_set_frequency 0x%02X", PCA3_ADDR);
+    check_six_digits(timegm(&start));
+
+    printf("Display over ten controllers, frames split across batches\n");
+    check_many_controllers();
+
+    printf("Phase-staggered pulses, 10:00 on two controllers\n");
+    check_phase_stagger();
+
+    printf("Register scrubbing\n");
+    check_scrub();
+
+    printf("Second ticks from the DS1307 square wave\n");
+    check_second_tick(timegm(&start));
+
+    printf("Time service publishing to subscribers\n");
+    check_time_service();
+
+    printf("System clock kept from the RTC\n");
+    check_timekeeping(timegm(&start));
+
+    printf("Warm boot from the stored calibration and frame\n");
+    check_warm_boot();
+
+    printf("Fast boot: one-burst PCA9685 init, timed bring-up\n");
+    check_fast_boot();
+
+    printf("Servo auto-calibration from the supply current\n");
+    check_servo_sweep();
+
+    printf(failures ? "%d check(s) failed\n" : "All checks passed\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,97 @@
+// Shared state and helpers of the host_sim checks, one check_<area>.c file per area
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+#include "driver/i2c.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "pca9685.h"
+#include "segment_display.h"
+#include "servo_motion.h"
+#include "ds1307.h"
+#include "HD44780.h"
+#include "i2c_bus.h"
+#include "i2c_batch.h"
+#include "rtc_tick.h"
+#include "time_service.h"
+#include "servo_cal.h"
+#include "frame_store.h"
+#include "fast_boot.h"
+#include "nvs.h"
+#include "nvs_flash.h"
+#include "sim_bus.h"
+#include "sim_pca9685.h"
+#include "sim_ds1307.h"
+#include "sim_hd44780.h"
+#include "sim_gpio.h"
+#include "sim_sysclock.h"
+
+#define I2C_PORT I2C_NUM_0
+#define LCD_ADDR 0x27
+#define LCD_COLS 16
+#define LCD_ROWS 2
+#define PCA1_ADDR 0x40
+#define PCA2_ADDR 0x41
+#define PCA3_ADDR 0x42
+#define SQW_GPIO GPIO_NUM_27
+
+#define SERVO_FREQ_HZ 50
+#define PULSE_0DEG 660
+#define PULSE_90DEG 1500
+
+// final_clock's layout: HH on PCA1, MM on PCA2
+extern const segment_channel_t digit_map[4][7];
+
+extern sim_pca9685_t sim_pca1, sim_pca2, sim_pca3;
+extern sim_ds1307_t sim_rtc;
+extern sim_hd44780_t sim_lcd;
+extern pca9685_dev_t pca1, pca2, pca3;
+extern segment_display_t display;
+extern i2c_dev_t rtc;
+extern i2c_bus_client_t rtc_client;
+extern int failures;
+
+#define CHECK(cond, ...) do {                   \
+        if (!(cond)) {                          \
+            failures++;                         \
+            printf("FAIL: " __VA_ARGS__);       \
+            printf("\n");                       \
+        }                                       \
+    } while (0)
+
+// host_sim.c
+esp_err_t rtc_get_time(struct tm *time);
+esp_err_t refresh(struct tm *time);
+void check_digit(const sim_pca9685_t *chip, uint8_t first_channel, uint8_t digit);
+void check_display(const struct tm *time);
+void print_stats(const char *label);
+int segments_pulsing(void);
+
+// check_display.c
+void check_plans(void);
+void check_six_digits(time_t start);
+void check_many_controllers(void);
+
+// check_motion.c
+void check_motion(void);
+void check_power_budget(void);
+void check_idle_off(void);
+void check_landing(void);
+
+// check_bus.c
+void check_phase_stagger(void);
+void check_scrub(void);
+
+// check_time.c
+void check_second_tick(time_t start);
+void check_time_service(void);
+void check_timekeeping(time_t start);
+
+// check_boot.c
+void check_warm_boot(void);
+void check_fast_boot(void);
+void check_servo_sweep(void);
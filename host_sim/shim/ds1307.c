@@ -0,0 +1,168 @@
+// DS1307 driver stand-in for host builds, see ds1307.h
+#include "ds1307.h"
+#include <string.h>
+
+#define DS1307_ADDR 0x68
+#define RAM_SIZE 56
+
+#define TIME_REG    0
+#define CONTROL_REG 7
+#define RAM_REG     8
+
+#define CH_BIT     0x80
+#define HOUR12_BIT 0x40
+#define PM_BIT     0x20
+#define SQWE_BIT   0x10
+#define OUT_BIT    0x80
+#define RS_MASK    0x03
+
+#define CHECK_ARG(x) do { if (!(x)) return ESP_ERR_INVALID_ARG; } while (0)
+
+static uint8_t bcd2dec(uint8_t val) { return (val >> 4) * 10 + (val & 0x0F); }
+static uint8_t dec2bcd(uint8_t val) { return ((val / 10) << 4) + (val % 10); }
+
+// i2c_dev_read_reg: register pointer, repeated START, read
+static esp_err_t read_reg(i2c_dev_t *dev, uint8_t reg, uint8_t *data, size_t len) {
+    xSemaphoreTake(dev->mutex, portMAX_DELAY);
+    esp_err_t err = i2c_master_write_read_device(dev->port, dev->addr, &reg, 1, data, len,
+                                                 dev->timeout_ticks);
+    xSemaphoreGive(dev->mutex);
+    return err;
+}
+
+// i2c_dev_write_reg: register pointer and data in one write
+static esp_err_t write_reg(i2c_dev_t *dev, uint8_t reg, const uint8_t *data, size_t len) {
+    uint8_t buf[1 + RAM_SIZE];
+    if (len > RAM_SIZE) return ESP_ERR_INVALID_SIZE;
+    buf[0] = reg;
+    memcpy(buf + 1, data, len);
+    xSemaphoreTake(dev->mutex, portMAX_DELAY);
+    esp_err_t err = i2c_master_write_to_device(dev->port, dev->addr, buf, len + 1, dev->timeout_ticks);
+    xSemaphoreGive(dev->mutex);
+    return err;
+}
+
+static esp_err_t update_reg(i2c_dev_t *dev, uint8_t reg, uint8_t mask, uint8_t val) {
+    uint8_t old;
+    esp_err_t err = read_reg(dev, reg, &old, 1);
+    if (err != ESP_OK) return err;
+    uint8_t buf = (old & ~mask) | val;
+    return write_reg(dev, reg, &buf, 1);
+}
+
+esp_err_t ds1307_init_desc(i2c_dev_t *dev, i2c_port_t port, gpio_num_t sda_gpio, gpio_num_t scl_gpio) {
+    CHECK_ARG(dev);
+    memset(dev, 0, sizeof(*dev));
+    dev->port = port;
+    dev->addr = DS1307_ADDR;
+    dev->cfg.sda_io_num = sda_gpio;
+    dev->cfg.scl_io_num = scl_gpio;
+    dev->timeout_ticks = pdMS_TO_TICKS(1000);
+    dev->mutex = xSemaphoreCreateMutexStatic(&dev->mutex_buf);
+    return ESP_OK;
+}
+
+esp_err_t ds1307_free_desc(i2c_dev_t *dev) {
+    CHECK_ARG(dev);
+    dev->mutex = NULL;
+    return ESP_OK;
+}
+
+esp_err_t ds1307_start(i2c_dev_t *dev, bool start) {
+    CHECK_ARG(dev);
+    return update_reg(dev, TIME_REG, CH_BIT, start ? 0 : CH_BIT);
+}
+
+esp_err_t ds1307_is_running(i2c_dev_t *dev, bool *running) {
+    CHECK_ARG(dev && running);
+    uint8_t val;
+    esp_err_t err = read_reg(dev, TIME_REG, &val, 1);
+    if (err == ESP_OK) *running = !(val & CH_BIT);
+    return err;
+}
+
+esp_err_t ds1307_get_time(i2c_dev_t *dev, struct tm *time) {
+    CHECK_ARG(dev && time);
+    uint8_t buf[7];
+    esp_err_t err = read_reg(dev, TIME_REG, buf, sizeof(buf));
+    if (err != ESP_OK) return err;
+
+    time->tm_sec = bcd2dec(buf[0] & ~CH_BIT);
+    time->tm_min = bcd2dec(buf[1]);
+    if (buf[2] & HOUR12_BIT) {
+        time->tm_hour = bcd2dec(buf[2] & 0x1F) - 1; // 12-hour mode
+        if (buf[2] & PM_BIT) time->tm_hour += 12;
+    } else {
+        time->tm_hour = bcd2dec(buf[2]);
+    }
+    time->tm_wday = bcd2dec(buf[3]) - 1;
+    time->tm_mday = bcd2dec(buf[4]);
+    time->tm_mon = bcd2dec(buf[5]) - 1;
+    time->tm_year = bcd2dec(buf[6]) + 2000 - 1900;
+    return ESP_OK;
+}
+
+esp_err_t ds1307_set_time(i2c_dev_t *dev, const struct tm *time) {
+    CHECK_ARG(dev && time);
+    uint8_t buf[7] = {
+        dec2bcd(time->tm_sec),
+        dec2bcd(time->tm_min),
+        dec2bcd(time->tm_hour),
+        dec2bcd(time->tm_wday + 1),
+        dec2bcd(time->tm_mday),
+        dec2bcd(time->tm_mon + 1),
+        dec2bcd(time->tm_year - (2000 - 1900))
+    };
+    return write_reg(dev, TIME_REG, buf, sizeof(buf));
+}
+
+esp_err_t ds1307_enable_squarewave(i2c_dev_t *dev, bool enable) {
+    CHECK_ARG(dev);
+    return update_reg(dev, CONTROL_REG, SQWE_BIT, enable ? SQWE_BIT : 0);
+}
+
+esp_err_t ds1307_is_squarewave_enabled(i2c_dev_t *dev, bool *sqw_en) {
+    CHECK_ARG(dev && sqw_en);
+    uint8_t val;
+    esp_err_t err = read_reg(dev, CONTROL_REG, &val, 1);
+    if (err == ESP_OK) *sqw_en = val & SQWE_BIT;
+    return err;
+}
+
+esp_err_t ds1307_set_squarewave_freq(i2c_dev_t *dev, ds1307_squarewave_freq_t freq) {
+    CHECK_ARG(dev);
+    return update_reg(dev, CONTROL_REG, RS_MASK, freq);
+}
+
+esp_err_t ds1307_get_squarewave_freq(i2c_dev_t *dev, ds1307_squarewave_freq_t *sqw_freq) {
+    CHECK_ARG(dev && sqw_freq);
+    uint8_t val;
+    esp_err_t err = read_reg(dev, CONTROL_REG, &val, 1);
+    if (err == ESP_OK) *sqw_freq = val & RS_MASK;
+    return err;
+}
+
+esp_err_t ds1307_get_output(i2c_dev_t *dev, bool *out) {
+    CHECK_ARG(dev && out);
+    uint8_t val;
+    esp_err_t err = read_reg(dev, CONTROL_REG, &val, 1);
+    if (err == ESP_OK) *out = val & OUT_BIT;
+    return err;
+}
+
+esp_err_t ds1307_set_output(i2c_dev_t *dev, bool value) {
+    CHECK_ARG(dev);
+    return update_reg(dev, CONTROL_REG, OUT_BIT, value ? OUT_BIT : 0);
+}
+
+esp_err_t ds1307_read_ram(i2c_dev_t *dev, uint8_t offset, uint8_t *buf, uint8_t len) {
+    CHECK_ARG(dev && buf);
+    if (offset + len > RAM_SIZE) return ESP_ERR_NO_MEM;
+    return read_reg(dev, RAM_REG + offset, buf, len);
+}
+
+esp_err_t ds1307_write_ram(i2c_dev_t *dev, uint8_t offset, uint8_t *buf, uint8_t len) {
+    CHECK_ARG(dev && buf);
+    if (offset + len > RAM_SIZE) return ESP_ERR_NO_MEM;
+    return write_reg(dev, RAM_REG + offset, buf, len);
+}
@@ -0,0 +1,131 @@
+// esp_log, esp_err, esp_timer, ROM delay and GPIO calls for host builds
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "rom/ets_sys.h"
+#include "driver/gpio.h"
+#include "sim_bus.h"
+#include "sim_gpio.h"
+#include <stdarg.h>
+#include <stdio.h>
+
+esp_log_level_t sim_log_level = ESP_LOG_WARN;
+
+void sim_log(esp_log_level_t level, const char *tag, const char *fmt, ...) {
+    static const char letters[] = "NEWIDV";
+    if (level > sim_log_level) return;
+    va_list args;
+    va_start(args, fmt);
+    fprintf(stderr, "%c (%llu) %s: ", letters[level],
+            (unsigned long long)(sim_clock_ns() / 1000000ULL), tag);
+    vfprintf(stderr, fmt, args);
+    fputc('\n', stderr);
+    va_end(args);
+}
+
+const char *esp_err_to_name(esp_err_t code) {
+    switch (code) {
+    case ESP_OK: return "ESP_OK";
+    case ESP_FAIL: return "ESP_FAIL";
+    case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+    case ESP_ERR_INVALID_RESPONSE: return "ESP_ERR_INVALID_RESPONSE";
+    case ESP_ERR_INVALID_CRC: return "ESP_ERR_INVALID_CRC";
+    case ESP_ERR_INVALID_VERSION: return "ESP_ERR_INVALID_VERSION";
+    default: return "UNKNOWN ERROR";
+    }
+}
+
+int64_t esp_timer_get_time(void) {
+    return (int64_t)(sim_clock_ns() / 1000ULL);
+}
+
+void ets_delay_us(uint32_t us) {
+    sim_clock_advance_ns((uint64_t)us * 1000ULL);
+}
+
+typedef struct {
+    sim_gpio_level_fn level;
+    const void *ctx;
+    gpio_int_type_t intr_type;
+    gpio_isr_t isr;
+    void *isr_arg;
+    bool last;
+} sim_pin_t;
+
+static sim_pin_t pins[GPIO_NUM_MAX];
+
+static bool pin_ok(gpio_num_t gpio_num) {
+    return gpio_num >= 0 && gpio_num < GPIO_NUM_MAX;
+}
+
+static bool pin_level(const sim_pin_t *pin) {
+    return pin->level && pin->level(pin->ctx);
+}
+
+esp_err_t gpio_config(const gpio_config_t *config) {
+    if (!config) return ESP_ERR_INVALID_ARG;
+    for (int i = 0; i < GPIO_NUM_MAX; i++) {
+        if (config->pin_bit_mask & (1ULL << i)) pins[i].intr_type = config->intr_type;
+    }
+    return ESP_OK;
+}
+
+esp_err_t gpio_install_isr_service(int intr_alloc_flags) {
+    (void)intr_alloc_flags;
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_add(gpio_num_t gpio_num, gpio_isr_t isr_handler, void *args) {
+    if (!pin_ok(gpio_num)) return ESP_ERR_INVALID_ARG;
+    pins[gpio_num].isr = isr_handler;
+    pins[gpio_num].isr_arg = args;
+    pins[gpio_num].last = pin_level(&pins[gpio_num]);
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_remove(gpio_num_t gpio_num) {
+    if (!pin_ok(gpio_num)) return ESP_ERR_INVALID_ARG;
+    pins[gpio_num].isr = NULL;
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio_num) {
+    return pin_ok(gpio_num) && pin_level(&pins[gpio_num]);
+}
+
+void sim_gpio_connect(gpio_num_t gpio_num, sim_gpio_level_fn level, const void *ctx) {
+    if (!pin_ok(gpio_num)) return;
+    pins[gpio_num].level = level;
+    pins[gpio_num].ctx = ctx;
+    pins[gpio_num].last = pin_level(&pins[gpio_num]);
+}
+
+static bool pin_armed(const sim_pin_t *pin) {
+    return pin->level && pin->isr && pin->intr_type != GPIO_INTR_DISABLE;
+}
+
+bool sim_gpio_armed(void) {
+    for (int i = 0; i < GPIO_NUM_MAX; i++) {
+        if (pin_armed(&pins[i])) return true;
+    }
+    return false;
+}
+
+void sim_gpio_poll(void) {
+    for (int i = 0; i < GPIO_NUM_MAX; i++) {
+        sim_pin_t *pin = &pins[i];
+        if (!pin_armed(pin)) continue;
+        bool level = pin_level(pin);
+        if (level == pin->last) continue;
+        pin->last = level;
+        if (pin->intr_type == GPIO_INTR_ANYEDGE || (pin->intr_type == GPIO_INTR_POSEDGE) == level) {
+            pin->isr(pin->isr_arg);
+        }
+    }
+}
@@ -0,0 +1,221 @@
+// FreeRTOS for host builds: one thread, time kept by the simulator's virtual clock.
+// Blocking calls that cannot be satisfied let their timeout elapse and fail, unless a
+// simulated GPIO interrupt gives the semaphore waited on meanwhile.
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
+#include "sim_bus.h"
+#include "sim_gpio.h"
+#include "esp_log.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "freertos_sim";
+
+#define TICK_NS (1000000000ULL / configTICK_RATE_HZ)
+
+static uint32_t notify_value;
+
+static void elapse(TickType_t ticks) {
+    if (ticks != portMAX_DELAY) sim_clock_advance_ns((uint64_t)ticks * TICK_NS);
+}
+
+// Lets up to ticks pass like elapse, but with GPIO interrupts armed in SIM_GPIO_POLL_NS
+// steps, running their ISRs; returns early once one made *wake nonzero
+static bool elapse_until(const int *wake, TickType_t ticks) {
+    if (!sim_gpio_armed()) {
+        elapse(ticks);
+        return false;
+    }
+    uint64_t end = ticks == portMAX_DELAY ? UINT64_MAX : sim_clock_ns() + (uint64_t)ticks * TICK_NS;
+    while (sim_clock_ns() < end) {
+        uint64_t step = end - sim_clock_ns();
+        sim_clock_advance_ns(step < SIM_GPIO_POLL_NS ? step : SIM_GPIO_POLL_NS);
+        sim_gpio_poll();
+        if (wake && *wake) return true;
+    }
+    return false;
+}
+
+void vTaskDelay(TickType_t ticks) {
+    elapse_until(NULL, ticks);
+}
+
+TickType_t xTaskGetTickCount(void) {
+    return (TickType_t)(sim_clock_ns() / TICK_NS);
+}
+
+BaseType_t xTaskDelayUntil(TickType_t *previous_wake, TickType_t increment) {
+    TickType_t wake = *previous_wake + increment;
+    TickType_t now = xTaskGetTickCount();
+    *previous_wake = wake;
+    if ((int32_t)(wake - now) <= 0) return pdFALSE;
+    elapse_until(NULL, wake - now);
+    return pdTRUE;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_depth,
+                                   void *param, UBaseType_t priority, TaskHandle_t *created,
+                                   BaseType_t core) {
+    (void)fn; (void)stack_depth; (void)param; (void)priority; (void)core;
+    ESP_LOGE(TAG, "%s: tasks are not supported in the host simulation", name);
+    if (created) *created = NULL;
+    return pdFAIL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack_depth, void *param,
+                       UBaseType_t priority, TaskHandle_t *created) {
+    return xTaskCreatePinnedToCore(fn, name, stack_depth, param, priority, created, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    (void)task;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+    return &notify_value;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action) {
+    (void)task;
+    switch (action) {
+    case eSetBits: notify_value |= value; break;
+    case eIncrement: notify_value++; break;
+    case eSetValueWithOverwrite:
+    case eSetValueWithoutOverwrite: notify_value = value; break;
+    default: break;
+    }
+    return pdPASS;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    return xTaskNotify(task, 0, eIncrement);
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait) {
+    uint32_t value = notify_value;
+    if (!value) {
+        elapse(ticks_to_wait);
+        return 0;
+    }
+    notify_value = clear_on_exit ? 0 : value - 1;
+    return value;
+}
+
+BaseType_t xTaskNotifyWait(uint32_t clear_on_entry, uint32_t clear_on_exit, uint32_t *value,
+                           TickType_t ticks_to_wait) {
+    notify_value &= ~clear_on_entry;
+    if (!notify_value) {
+        elapse(ticks_to_wait);
+        return pdFALSE;
+    }
+    if (value) *value = notify_value;
+    notify_value &= ~clear_on_exit;
+    return pdTRUE;
+}
+
+static SemaphoreHandle_t init_sem(StaticSemaphore_t *buffer, int count, int max_count) {
+    if (!buffer) return NULL;
+    buffer->count = count;
+    buffer->max_count = max_count;
+    return buffer;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buffer) {
+    return init_sem(buffer, 1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t *buffer) {
+    return init_sem(buffer, 0, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+    return init_sem(malloc(sizeof(StaticSemaphore_t)), 1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void) {
+    return init_sem(malloc(sizeof(StaticSemaphore_t)), 0, 1);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks_to_wait) {
+    if (!sem) return pdFALSE;
+    if (sem->count > 0) {
+        sem->count--;
+        return pdTRUE;
+    }
+    if (!elapse_until(&sem->count, ticks_to_wait)) return pdFALSE;
+    sem->count--;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+    if (!sem || sem->count >= sem->max_count) return pdFALSE;
+    sem->count++;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t *woken) {
+    if (woken) *woken = pdFALSE;
+    return xSemaphoreGive(sem);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem) {
+    (void)sem; // static and heap semaphores are indistinguishable here, so never freed
+}
+
+QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t item_size, uint8_t *storage,
+                                 StaticQueue_t *buffer) {
+    if (!buffer || !storage || !length) return NULL;
+    memset(buffer, 0, sizeof(*buffer));
+    buffer->storage = storage;
+    buffer->item_size = item_size;
+    buffer->length = length;
+    return buffer;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+    uint8_t *storage = malloc((size_t)length * item_size);
+    StaticQueue_t *buffer = malloc(sizeof(StaticQueue_t));
+    QueueHandle_t queue = xQueueCreateStatic(length, item_size, storage, buffer);
+    if (!queue) {
+        free(storage);
+        free(buffer);
+    }
+    return queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks_to_wait) {
+    if (!queue) return pdFALSE;
+    if (queue->count == queue->length) {
+        elapse(ticks_to_wait);
+        return pdFALSE;
+    }
+    size_t tail = (queue->head + queue->count) % queue->length;
+    memcpy((uint8_t *)queue->storage + tail * queue->item_size, item, queue->item_size);
+    queue->count++;
+    return pdTRUE;
+}
+
+BaseType_t xQueueOverwrite(QueueHandle_t queue, const void *item) {
+    if (!queue) return pdFALSE;
+    queue->head = 0;
+    queue->count = 0;
+    return xQueueSend(queue, item, 0);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks_to_wait) {
+    if (!queue) return pdFALSE;
+    if (!queue->count) {
+        elapse(ticks_to_wait);
+        return pdFALSE;
+    }
+    memcpy(item, (uint8_t *)queue->storage + queue->head * queue->item_size, queue->item_size);
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    return queue ? (UBaseType_t)queue->count : 0;
+}
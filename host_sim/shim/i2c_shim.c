@@ -0,0 +1,210 @@
+// driver/i2c.h for host builds: command links are recorded like the IDF driver does and
+// executed against the simulated bus when i2c_master_cmd_begin is called
+#include "driver/i2c.h"
+#include "sim_bus.h"
+#include "esp_log.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "i2c_sim";
+
+typedef enum { OP_START, OP_WRITE, OP_READ, OP_STOP } op_type_t;
+
+typedef struct {
+    op_type_t type;
+    uint8_t byte;           // single byte writes are stored inline
+    bool ack_en;            // writes: check the receiver's ACK
+    i2c_ack_type_t ack;     // reads: what the master answers
+    const uint8_t *data;    // NULL for an inline byte
+    uint8_t *rdata;
+    size_t len;
+} op_t;
+
+typedef struct {
+    op_t *ops;
+    size_t num_ops;
+    size_t max_ops;
+    bool heap;
+} link_t;
+
+_Static_assert(sizeof(op_t) <= I2C_INTERNAL_STRUCT_SIZE, "op_t must fit a link slot");
+_Static_assert(sizeof(link_t) + 8 <= 2 * I2C_INTERNAL_STRUCT_SIZE, "link_t must fit the header");
+
+static bool installed[I2C_NUM_MAX];
+
+esp_err_t i2c_param_config(i2c_port_t i2c_num, const i2c_config_t *i2c_conf) {
+    if (i2c_num < 0 || i2c_num >= I2C_NUM_MAX || !i2c_conf) return ESP_ERR_INVALID_ARG;
+    if (i2c_conf->mode == I2C_MODE_MASTER) sim_bus_set_clock(i2c_num, i2c_conf->master.clk_speed);
+    return ESP_OK;
+}
+
+esp_err_t i2c_driver_install(i2c_port_t i2c_num, i2c_mode_t mode, size_t slv_rx_buf_len,
+                             size_t slv_tx_buf_len, int intr_alloc_flags) {
+    (void)mode; (void)slv_rx_buf_len; (void)slv_tx_buf_len; (void)intr_alloc_flags;
+    if (i2c_num < 0 || i2c_num >= I2C_NUM_MAX) return ESP_ERR_INVALID_ARG;
+    if (installed[i2c_num]) {
+        ESP_LOGE(TAG, "i2c driver install error");
+        return ESP_FAIL;
+    }
+    installed[i2c_num] = true;
+    return ESP_OK;
+}
+
+esp_err_t i2c_driver_delete(i2c_port_t i2c_num) {
+    if (i2c_num < 0 || i2c_num >= I2C_NUM_MAX || !installed[i2c_num]) return ESP_ERR_INVALID_ARG;
+    installed[i2c_num] = false;
+    return ESP_OK;
+}
+
+i2c_cmd_handle_t i2c_cmd_link_create_static(uint8_t *buffer, uint32_t size) {
+    uintptr_t base = ((uintptr_t)buffer + 7) & ~(uintptr_t)7;
+    size_t pad = base - (uintptr_t)buffer;
+    if (!buffer || size < pad + sizeof(link_t) + sizeof(op_t)) return NULL;
+
+    link_t *link = (link_t *)base;
+    memset(link, 0, sizeof(*link));
+    link->ops = (op_t *)(base + sizeof(link_t));
+    link->max_ops = (size - pad - sizeof(link_t)) / sizeof(op_t);
+    return link;
+}
+
+i2c_cmd_handle_t i2c_cmd_link_create(void) {
+    link_t *link = calloc(1, sizeof(link_t));
+    if (link) link->heap = true;
+    return link;
+}
+
+void i2c_cmd_link_delete_static(i2c_cmd_handle_t cmd_handle) {
+    (void)cmd_handle;
+}
+
+void i2c_cmd_link_delete(i2c_cmd_handle_t cmd_handle) {
+    link_t *link = cmd_handle;
+    if (!link || !link->heap) return;
+    free(link->ops);
+    free(link);
+}
+
+static esp_err_t append(i2c_cmd_handle_t cmd_handle, const op_t *op) {
+    link_t *link = cmd_handle;
+    if (!link) return ESP_ERR_INVALID_ARG;
+    if (link->num_ops == link->max_ops) {
+        if (!link->heap) return ESP_ERR_NO_MEM;
+        size_t max = link->max_ops ? link->max_ops * 2 : 8;
+        op_t *ops = realloc(link->ops, max * sizeof(op_t));
+        if (!ops) return ESP_ERR_NO_MEM;
+        link->ops = ops;
+        link->max_ops = max;
+    }
+    link->ops[link->num_ops++] = *op;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_start(i2c_cmd_handle_t cmd_handle) {
+    return append(cmd_handle, &(op_t){.type = OP_START});
+}
+
+esp_err_t i2c_master_stop(i2c_cmd_handle_t cmd_handle) {
+    return append(cmd_handle, &(op_t){.type = OP_STOP});
+}
+
+esp_err_t i2c_master_write_byte(i2c_cmd_handle_t cmd_handle, uint8_t data, bool ack_en) {
+    return append(cmd_handle, &(op_t){.type = OP_WRITE, .byte = data, .ack_en = ack_en, .len = 1});
+}
+
+esp_err_t i2c_master_write(i2c_cmd_handle_t cmd_handle, const uint8_t *data, size_t data_len,
+                           bool ack_en) {
+    if (!data || !data_len) return ESP_ERR_INVALID_ARG;
+    return append(cmd_handle, &(op_t){.type = OP_WRITE, .data = data, .ack_en = ack_en, .len = data_len});
+}
+
+esp_err_t i2c_master_read_byte(i2c_cmd_handle_t cmd_handle, uint8_t *data, i2c_ack_type_t ack) {
+    if (!data || ack == I2C_MASTER_LAST_NACK) return ESP_ERR_INVALID_ARG;
+    return append(cmd_handle, &(op_t){.type = OP_READ, .rdata = data, .ack = ack, .len = 1});
+}
+
+esp_err_t i2c_master_read(i2c_cmd_handle_t cmd_handle, uint8_t *data, size_t data_len,
+                          i2c_ack_type_t ack) {
+    if (!data || !data_len) return ESP_ERR_INVALID_ARG;
+    return append(cmd_handle, &(op_t){.type = OP_READ, .rdata = data, .ack = ack, .len = data_len});
+}
+
+esp_err_t i2c_master_cmd_begin(i2c_port_t i2c_num, i2c_cmd_handle_t cmd_handle,
+                               TickType_t ticks_to_wait) {
+    (void)ticks_to_wait;
+    link_t *link = cmd_handle;
+    if (i2c_num < 0 || i2c_num >= I2C_NUM_MAX || !link) return ESP_ERR_INVALID_ARG;
+    if (!installed[i2c_num]) {
+        ESP_LOGE(TAG, "i2c driver not installed");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    sim_bus_transaction(i2c_num);
+    for (size_t i = 0; i < link->num_ops; i++) {
+        const op_t *op = &link->ops[i];
+        switch (op->type) {
+        case OP_START:
+            sim_bus_start(i2c_num);
+            break;
+        case OP_STOP:
+            sim_bus_stop(i2c_num);
+            break;
+        case OP_WRITE:
+            for (size_t n = 0; n < op->len; n++) {
+                bool ack = sim_bus_write(i2c_num, op->data ? op->data[n] : op->byte);
+                if (!ack && op->ack_en) {
+                    // the controller stops on a missing ACK, as the hardware FSM does
+                    sim_bus_stop(i2c_num);
+                    return ESP_FAIL;
+                }
+            }
+            break;
+        case OP_READ:
+            for (size_t n = 0; n < op->len; n++) {
+                bool last = n + 1 == op->len;
+                bool ack = op->ack == I2C_MASTER_ACK || (op->ack == I2C_MASTER_LAST_NACK && !last);
+                op->rdata[n] = sim_bus_read(i2c_num, ack);
+            }
+            break;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_write_to_device(i2c_port_t i2c_num, uint8_t device_address,
+                                     const uint8_t *write_buffer, size_t write_size,
+                                     TickType_t ticks_to_wait) {
+    return i2c_master_write_read_device(i2c_num, device_address, write_buffer, write_size,
+                                        NULL, 0, ticks_to_wait);
+}
+
+esp_err_t i2c_master_read_from_device(i2c_port_t i2c_num, uint8_t device_address,
+                                      uint8_t *read_buffer, size_t read_size,
+                                      TickType_t ticks_to_wait) {
+    return i2c_master_write_read_device(i2c_num, device_address, NULL, 0,
+                                        read_buffer, read_size, ticks_to_wait);
+}
+
+esp_err_t i2c_master_write_read_device(i2c_port_t i2c_num, uint8_t device_address,
+                                       const uint8_t *write_buffer, size_t write_size,
+                                       uint8_t *read_buffer, size_t read_size,
+                                       TickType_t ticks_to_wait) {
+    uint8_t buffer[I2C_LINK_RECOMMENDED_SIZE(2)] = {0};
+    i2c_cmd_handle_t handle = i2c_cmd_link_create_static(buffer, sizeof(buffer));
+    esp_err_t err = ESP_OK;
+
+    if (write_size) {
+        err = i2c_master_start(handle);
+        if (err == ESP_OK) err = i2c_master_write_byte(handle, device_address << 1 | I2C_MASTER_WRITE, true);
+        if (err == ESP_OK) err = i2c_master_write(handle, write_buffer, write_size, true);
+    }
+    if (err == ESP_OK && read_size) {
+        err = i2c_master_start(handle);
+        if (err == ESP_OK) err = i2c_master_write_byte(handle, device_address << 1 | I2C_MASTER_READ, true);
+        if (err == ESP_OK) err = i2c_master_read(handle, read_buffer, read_size, I2C_MASTER_LAST_NACK);
+    }
+    if (err == ESP_OK) err = i2c_master_stop(handle);
+    if (err == ESP_OK) err = i2c_master_cmd_begin(i2c_num, handle, ticks_to_wait);
+    i2c_cmd_link_delete_static(handle);
+    return err;
+}
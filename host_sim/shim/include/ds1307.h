@@ -0,0 +1,39 @@
+// Host build stand-in for the esp-idf-ds1307 driver (an unvendored submodule): same API,
+// same register transfers as the i2cdev-based driver, issued through the driver/i2c.h shim
+#pragma once
+
+#include <time.h>
+#include <stdbool.h>
+#include "driver/i2c.h"
+#include "freertos/semphr.h"
+
+typedef struct {
+    i2c_port_t port;
+    i2c_config_t cfg;
+    uint8_t addr;
+    SemaphoreHandle_t mutex;
+    StaticSemaphore_t mutex_buf;
+    uint32_t timeout_ticks;
+} i2c_dev_t;
+
+typedef enum {
+    DS1307_1HZ = 0,
+    DS1307_4096HZ,
+    DS1307_8192HZ,
+    DS1307_32768HZ
+} ds1307_squarewave_freq_t;
+
+esp_err_t ds1307_init_desc(i2c_dev_t *dev, i2c_port_t port, gpio_num_t sda_gpio, gpio_num_t scl_gpio);
+esp_err_t ds1307_free_desc(i2c_dev_t *dev);
+esp_err_t ds1307_start(i2c_dev_t *dev, bool start);
+esp_err_t ds1307_is_running(i2c_dev_t *dev, bool *running);
+esp_err_t ds1307_get_time(i2c_dev_t *dev, struct tm *time);
+esp_err_t ds1307_set_time(i2c_dev_t *dev, const struct tm *time);
+esp_err_t ds1307_enable_squarewave(i2c_dev_t *dev, bool enable);
+esp_err_t ds1307_is_squarewave_enabled(i2c_dev_t *dev, bool *sqw_en);
+esp_err_t ds1307_set_squarewave_freq(i2c_dev_t *dev, ds1307_squarewave_freq_t freq);
+esp_err_t ds1307_get_squarewave_freq(i2c_dev_t *dev, ds1307_squarewave_freq_t *sqw_freq);
+esp_err_t ds1307_get_output(i2c_dev_t *dev, bool *out);
+esp_err_t ds1307_set_output(i2c_dev_t *dev, bool value);
+esp_err_t ds1307_read_ram(i2c_dev_t *dev, uint8_t offset, uint8_t *buf, uint8_t len);
+esp_err_t ds1307_write_ram(i2c_dev_t *dev, uint8_t offset, uint8_t *buf, uint8_t len);
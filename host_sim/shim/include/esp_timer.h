@@ -0,0 +1,6 @@
+// Host build shim: esp_timer_get_time reads the simulator's virtual clock
+#pragma once
+
+#include <stdint.h>
+
+int64_t esp_timer_get_time(void);
@@ -0,0 +1,49 @@
+// Host build shim: FreeRTOS types for a single-threaded simulation. Time only moves
+// through the virtual clock (vTaskDelay, ets_delay_us, bus transfers).
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t StackType_t;
+
+#define pdTRUE  1
+#define pdFALSE 0
+#define pdPASS  pdTRUE
+#define pdFAIL  pdFALSE
+
+#define configTICK_RATE_HZ   100
+#define configMAX_PRIORITIES 25
+#define portMAX_DELAY        ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS   ((TickType_t)1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms)    ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000U))
+#define pdTICKS_TO_MS(ticks) ((uint32_t)(((uint64_t)(ticks) * 1000U) / configTICK_RATE_HZ))
+#define tskNO_AFFINITY       0x7FFFFFFF
+
+#define IRAM_ATTR
+#define portYIELD_FROM_ISR(...) ((void)0)
+
+typedef struct {
+    int unused;
+} portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0}
+#define portENTER_CRITICAL(mux)     ((void)(mux))
+#define portEXIT_CRITICAL(mux)      ((void)(mux))
+#define portENTER_CRITICAL_ISR(mux) ((void)(mux))
+#define portEXIT_CRITICAL_ISR(mux)  ((void)(mux))
+
+typedef struct {
+    int count;
+    int max_count;
+} StaticSemaphore_t;
+
+typedef struct {
+    void *storage;
+    size_t item_size;
+    size_t length;
+    size_t head;
+    size_t count;
+} StaticQueue_t;
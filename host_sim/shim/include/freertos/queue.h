@@ -0,0 +1,14 @@
+// Host build shim: ring-buffer queues without blocking (single-threaded simulation)
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+typedef StaticQueue_t *QueueHandle_t;
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size);
+QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t item_size, uint8_t *storage,
+                                 StaticQueue_t *buffer);
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks_to_wait);
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks_to_wait);
+BaseType_t xQueueOverwrite(QueueHandle_t queue, const void *item);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
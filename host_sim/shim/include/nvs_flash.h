@@ -0,0 +1,7 @@
+// Host build shim: NVS partition setup; the store is RAM, erased with the process
+#pragma once
+
+#include "nvs.h"
+
+esp_err_t nvs_flash_init(void);
+esp_err_t nvs_flash_erase(void);
@@ -0,0 +1,6 @@
+// Host build shim: busy waits advance the virtual clock
+#pragma once
+
+#include <stdint.h>
+
+void ets_delay_us(uint32_t us);
@@ -0,0 +1,5 @@
+// Host build shim: the configuration values the components read
+#pragma once
+
+#define CONFIG_FREERTOS_HZ 100
+#define CONFIG_IDF_TARGET "linux"
@@ -0,0 +1,116 @@
+// NVS for host builds: a few blobs per namespace in RAM, with the IDF's error codes
+#include "nvs.h"
+#include "nvs_flash.h"
+#include <stdbool.h>
+#include <string.h>
+
+#define MAX_NAMESPACES 4
+#define MAX_ENTRIES    16
+#define MAX_BLOB       512
+#define MAX_NAME       16 // NVS keys and namespaces are at most 15 characters
+
+typedef struct {
+    char ns[MAX_NAME];
+    char key[MAX_NAME];
+    uint8_t data[MAX_BLOB];
+    size_t len;
+} entry_t;
+
+static bool initialized;
+static char namespaces[MAX_NAMESPACES][MAX_NAME];
+static bool writable[MAX_NAMESPACES];
+static entry_t entries[MAX_ENTRIES];
+static size_t num_entries;
+
+esp_err_t nvs_flash_init(void) {
+    initialized = true;
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void) {
+    num_entries = 0;
+    memset(namespaces, 0, sizeof(namespaces));
+    return ESP_OK;
+}
+
+static bool has_entries(const char *ns) {
+    for (size_t i = 0; i < num_entries; i++) {
+        if (!strcmp(entries[i].ns, ns)) return true;
+    }
+    return false;
+}
+
+// Handles are namespace slot + 1; a read-only open of an unknown namespace fails like the IDF's
+esp_err_t nvs_open(const char *name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle) {
+    if (!initialized) return ESP_ERR_NVS_NOT_INITIALIZED;
+    if (!name || !out_handle || strlen(name) >= MAX_NAME) return ESP_ERR_INVALID_ARG;
+    if (open_mode == NVS_READONLY && !has_entries(name)) return ESP_ERR_NVS_NOT_FOUND;
+    for (size_t i = 0; i < MAX_NAMESPACES; i++) {
+        if (!namespaces[i][0]) strcpy(namespaces[i], name);
+        if (strcmp(namespaces[i], name)) continue;
+        writable[i] = open_mode == NVS_READWRITE;
+        *out_handle = i + 1;
+        return ESP_OK;
+    }
+    return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+}
+
+void nvs_close(nvs_handle_t handle) {
+    (void)handle;
+}
+
+static entry_t *find(nvs_handle_t handle, const char *key) {
+    for (size_t i = 0; i < num_entries; i++) {
+        if (!strcmp(entries[i].ns, namespaces[handle - 1]) && !strcmp(entries[i].key, key)) return &entries[i];
+    }
+    return NULL;
+}
+
+static bool valid(nvs_handle_t handle) {
+    return handle >= 1 && handle <= MAX_NAMESPACES && namespaces[handle - 1][0];
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length) {
+    if (!valid(handle)) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (!key || !length) return ESP_ERR_INVALID_ARG;
+    const entry_t *e = find(handle, key);
+    if (!e) return ESP_ERR_NVS_NOT_FOUND;
+    if (!out_value) {
+        *length = e->len; // size query
+        return ESP_OK;
+    }
+    if (*length < e->len) return ESP_ERR_NVS_INVALID_LENGTH;
+    memcpy(out_value, e->data, e->len);
+    *length = e->len;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length) {
+    if (!valid(handle)) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (!writable[handle - 1]) return ESP_ERR_NVS_READ_ONLY;
+    if (!key || !value || strlen(key) >= MAX_NAME) return ESP_ERR_INVALID_ARG;
+    if (length > MAX_BLOB) return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    entry_t *e = find(handle, key);
+    if (!e) {
+        if (num_entries == MAX_ENTRIES) return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+        e = &entries[num_entries++];
+        strcpy(e->ns, namespaces[handle - 1]);
+        strcpy(e->key, key);
+    }
+    memcpy(e->data, value, length);
+    e->len = length;
+    return ESP_OK;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key) {
+    if (!valid(handle)) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (!writable[handle - 1]) return ESP_ERR_NVS_READ_ONLY;
+    entry_t *e = key ? find(handle, key) : NULL;
+    if (!e) return ESP_ERR_NVS_NOT_FOUND;
+    *e = entries[--num_entries];
+    return ESP_OK;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+    return valid(handle) ? ESP_OK : ESP_ERR_NVS_INVALID_HANDLE;
+}
@@ -0,0 +1,67 @@
+// gettimeofday, settimeofday and adjtime for host builds: the system clock of the simulated
+// ESP32, kept on the virtual clock. Defined here, they take precedence over the host's.
+#include <sys/time.h>
+#include <stddef.h>
+#include "sim_bus.h"
+#include "sim_sysclock.h"
+
+static int64_t sys_us;        // system time at last_ns, microseconds since the epoch
+static int64_t carry_ns;      // below a microsecond, not in sys_us yet
+static uint64_t last_ns;
+static int64_t slew_us;       // adjtime correction still to apply
+static int32_t drift_ppm;
+
+static void advance(void) {
+    uint64_t now = sim_clock_ns();
+    if (now < last_ns) last_ns = now; // sim_bus_reset restarted the virtual clock
+    int64_t elapsed_ns = now - last_ns;
+    last_ns = now;
+
+    int64_t ns = elapsed_ns + elapsed_ns * drift_ppm / 1000000 + carry_ns;
+    sys_us += ns / 1000;
+    carry_ns = ns % 1000;
+
+    int64_t step = elapsed_ns / 1000 / SIM_SYSCLOCK_SLEW_DIV;
+    if (slew_us > 0) {
+        if (step > slew_us) step = slew_us;
+        sys_us += step;
+        slew_us -= step;
+    } else if (slew_us < 0) {
+        if (step > -slew_us) step = -slew_us;
+        sys_us -= step;
+        slew_us += step;
+    }
+}
+
+void sim_sysclock_set_drift_ppm(int32_t ppm) {
+    advance();
+    drift_ppm = ppm;
+}
+
+int gettimeofday(struct timeval *restrict tv, void *restrict tz) {
+    (void)tz;
+    advance();
+    tv->tv_sec = sys_us / 1000000;
+    tv->tv_usec = sys_us % 1000000;
+    return 0;
+}
+
+int settimeofday(const struct timeval *tv, const struct timezone *tz) {
+    (void)tz;
+    if (!tv) return -1;
+    advance();
+    sys_us = (int64_t)tv->tv_sec * 1000000 + tv->tv_usec;
+    carry_ns = 0;
+    slew_us = 0;
+    return 0;
+}
+
+int adjtime(const struct timeval *delta, struct timeval *olddelta) {
+    advance();
+    if (olddelta) {
+        olddelta->tv_sec = slew_us / 1000000;
+        olddelta->tv_usec = slew_us % 1000000;
+    }
+    if (delta) slew_us = (int64_t)delta->tv_sec * 1000000 + delta->tv_usec;
+    return 0;
+}
@@ -0,0 +1,85 @@
+#ifndef SIM_BUS_H
+#define SIM_BUS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "driver/i2c.h"
+
+/*
+ * Simulated I2C buses for host builds.
+ *
+ * The driver/i2c.h shim executes command links here: every START, byte and STOP is
+ * routed to the device models attached to the port and charged to a virtual clock at
+ * the port's SCL rate (set by i2c_param_config, so i2c_bus_init(..., 400000) models a
+ * 400 kHz bus). vTaskDelay, ets_delay_us and esp_timer_get_time use the same clock.
+ */
+
+typedef struct sim_device sim_device_t;
+
+typedef struct {
+    void (*start)(sim_device_t *dev, bool read);     // addressed after a (repeated) START
+    bool (*write)(sim_device_t *dev, uint8_t data);  // data byte from the master, return ACK
+    uint8_t (*read)(sim_device_t *dev);              // data byte to the master
+    void (*stop)(sim_device_t *dev);                 // STOP on the bus, seen by every device
+} sim_device_ops_t;
+
+struct sim_device {
+    const sim_device_ops_t *ops;
+    const char *name;
+    uint8_t addr;
+    uint32_t selects;       // times addressed
+    uint32_t bytes;         // data bytes exchanged, address bytes not included
+    sim_device_t *next;
+};
+
+typedef struct {
+    uint32_t transactions;  // i2c_master_cmd_begin calls
+    uint32_t starts;        // START and repeated START conditions
+    uint32_t stops;
+    uint32_t bytes;         // bytes on the wire, address bytes included
+    uint32_t nacks;
+    uint64_t bus_time_ns;   // modeled wire time plus per-transaction overhead
+} sim_bus_stats_t;
+
+#define SIM_BUS_DEFAULT_CLK_HZ 100000
+
+/**
+ * @brief Attach a device model to a port; it answers from now on
+ */
+void sim_bus_attach(i2c_port_t port, sim_device_t *dev);
+
+/**
+ * @brief Detach every device, reset bus state, statistics and the virtual clock
+ *        (SCL rates set by the driver are kept)
+ */
+void sim_bus_reset(void);
+
+/**
+ * @brief Override the SCL rate of a port (normally taken from i2c_param_config)
+ */
+void sim_bus_set_clock(i2c_port_t port, uint32_t clk_hz);
+uint32_t sim_bus_get_clock(i2c_port_t port);
+
+/**
+ * @brief Fixed cost charged per i2c_master_cmd_begin, modeling driver and ISR time
+ *        (default 0: wire time only)
+ */
+void sim_bus_set_txn_overhead_ns(uint32_t ns);
+
+const sim_bus_stats_t *sim_bus_get_stats(i2c_port_t port);
+void sim_bus_reset_stats(i2c_port_t port);
+
+/**
+ * @brief Virtual clock, nanoseconds since sim_bus_reset
+ */
+uint64_t sim_clock_ns(void);
+void sim_clock_advance_ns(uint64_t ns);
+
+// Bus primitives used by the driver/i2c.h shim
+void sim_bus_transaction(i2c_port_t port);
+void sim_bus_start(i2c_port_t port);
+bool sim_bus_write(i2c_port_t port, uint8_t data);   // first byte after START is the address
+uint8_t sim_bus_read(i2c_port_t port, bool ack);
+void sim_bus_stop(i2c_port_t port);
+
+#endif // SIM_BUS_H
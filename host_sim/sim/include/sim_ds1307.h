@@ -0,0 +1,52 @@
+#ifndef SIM_DS1307_H
+#define SIM_DS1307_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include "sim_bus.h"
+
+/*
+ * DS1307 model: BCD time registers 0x00-0x06 counted from the virtual clock, control
+ * register 0x07 and 56 bytes of NVRAM (0x08-0x3F). Like the chip, time registers are
+ * copied to a read buffer on START, the register pointer wraps from 0x3F to 0x00,
+ * writing seconds resets the sub-second divider and CH (seconds bit 7) halts the clock.
+ */
+
+#define SIM_DS1307_ADDR     0x68
+#define SIM_DS1307_RAM_BASE 0x08
+#define SIM_DS1307_RAM_SIZE 56
+
+typedef struct {
+    sim_device_t dev;
+    uint8_t regs[64];         // time registers hold the buffered copy
+    uint8_t ptr;
+    bool ptr_pending;
+    bool time_written;        // time registers written in this transfer
+    bool halted;
+    time_t base;              // calendar time at base_ns
+    uint64_t base_ns;
+} sim_ds1307_t;
+
+/**
+ * @brief Attachable model, running from the given UTC calendar time
+ */
+void sim_ds1307_init(sim_ds1307_t *chip, uint8_t addr, time_t start);
+
+/**
+ * @brief Set the time as if written over I2C: running, sub-second divider restarted
+ */
+void sim_ds1307_set_time(sim_ds1307_t *chip, time_t now);
+
+/**
+ * @brief Current time kept by the model (frozen while CH is set)
+ */
+time_t sim_ds1307_now(const sim_ds1307_t *chip);
+
+/**
+ * @brief Level of the SQW/OUT pin now, per the control register (1 Hz: falls as the
+ *        seconds register advances, rises half a second later)
+ */
+bool sim_ds1307_sqw_level(const sim_ds1307_t *chip);
+
+#endif // SIM_DS1307_H
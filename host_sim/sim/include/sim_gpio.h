@@ -0,0 +1,33 @@
+#ifndef SIM_GPIO_H
+#define SIM_GPIO_H
+
+#include <stdbool.h>
+#include "driver/gpio.h"
+
+/*
+ * GPIO inputs driven by device models. A connected pin reads the model's output level;
+ * with an ISR attached and an edge interrupt configured, sim_gpio_poll runs the ISR for
+ * each matching edge since the previous poll. The FreeRTOS shim polls while blocking
+ * calls let time pass, in SIM_GPIO_POLL_NS steps, so an ISR can end a wait early.
+ */
+
+#define SIM_GPIO_POLL_NS 100000ULL
+
+typedef bool (*sim_gpio_level_fn)(const void *ctx);
+
+/**
+ * @brief Drive a pin from a model output (NULL level: disconnected, reads 0)
+ */
+void sim_gpio_connect(gpio_num_t gpio_num, sim_gpio_level_fn level, const void *ctx);
+
+/**
+ * @brief Whether any connected pin has an ISR and an edge interrupt set up
+ */
+bool sim_gpio_armed(void);
+
+/**
+ * @brief Sample the connected pins now and run the ISRs of the edges found
+ */
+void sim_gpio_poll(void);
+
+#endif // SIM_GPIO_H
@@ -0,0 +1,50 @@
+#ifndef SIM_HD44780_H
+#define SIM_HD44780_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "sim_bus.h"
+
+/*
+ * PCF8574 backpack driving an HD44780 in 4-bit mode (P0 = RS, P1 = RW, P2 = E,
+ * P3 = backlight, P4-P7 = D4-D7). Nibbles are taken on the falling edge of E. The
+ * controller starts in 8-bit mode, honors function set, clear, home, entry mode,
+ * display control and DDRAM addressing, and tracks instruction execution time:
+ * anything clocked in while the previous instruction is still executing is counted
+ * in timing_violations (and executed anyway, so the text stays comparable). Execution
+ * times scale with osc_hz, which starts at the slowest oscillator the datasheet allows.
+ */
+
+#define SIM_HD44780_OSC_SLOW_HZ 190000 // slowest HD44780 oscillator
+#define SIM_HD44780_OSC_TYP_HZ  270000 // typical, the datasheet's execution times
+
+typedef struct {
+    sim_device_t dev;
+    uint8_t port;               // PCF8574 output latch
+    bool four_bit;
+    bool have_high_nibble;
+    uint8_t high_nibble;
+    bool high_nibble_late;      // first nibble arrived while busy
+    bool two_line;
+    bool display_on;
+    bool increment;
+    uint8_t ac;                 // DDRAM address counter
+    uint8_t ddram[128];
+    uint32_t osc_hz;            // oscillator, sets the execution times
+    uint64_t busy_until_ns;
+    uint32_t instructions;
+    uint32_t chars;
+    uint32_t timing_violations;
+} sim_hd44780_t;
+
+void sim_hd44780_init(sim_hd44780_t *lcd, uint8_t addr);
+
+/**
+ * @brief Copy the characters of display row (0-3) into buf and NUL-terminate it
+ */
+void sim_hd44780_read_row(const sim_hd44780_t *lcd, uint8_t row, char *buf, size_t cols);
+
+bool sim_hd44780_backlight(const sim_hd44780_t *lcd);
+
+#endif // SIM_HD44780_H
@@ -0,0 +1,70 @@
+#ifndef SIM_PCA9685_H
+#define SIM_PCA9685_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "sim_bus.h"
+
+/*
+ * PCA9685 register model: MODE1 (AI, SLEEP, RESTART), MODE2 (OCH), PRE_SCALE (only
+ * writable while asleep), LEDn and ALL_LED registers with auto-increment. Outputs
+ * follow the registers on STOP (OCH = 0) or on each ACK (OCH = 1), as on the chip.
+ */
+
+typedef struct {
+    sim_device_t dev;
+    uint8_t regs[256];
+    uint8_t ptr;
+    bool ptr_pending;           // next written byte is the register pointer
+    bool dirty;                 // LED registers changed since the outputs last followed
+    uint16_t out_on[16];        // output state as latched, including full-on/off bits
+    uint16_t out_off[16];
+    uint32_t latches;           // times the outputs changed
+    uint64_t latched_at_ns;     // virtual time of the last output change
+    uint32_t prescale_ignored;  // PRE_SCALE writes dropped because SLEEP was clear
+} sim_pca9685_t;
+
+void sim_pca9685_init(sim_pca9685_t *chip, uint8_t addr);
+
+/**
+ * @brief Brown-out: every register back to its power-on value, outputs off, still on the bus
+ */
+void sim_pca9685_power_on_reset(sim_pca9685_t *chip);
+
+/**
+ * @brief PWM frequency of the internal 25 MHz oscillator with the current PRE_SCALE
+ */
+float sim_pca9685_frequency(const sim_pca9685_t *chip);
+
+/**
+ * @brief Whether the oscillator runs (MODE1 SLEEP clear)
+ */
+bool sim_pca9685_awake(const sim_pca9685_t *chip);
+
+/**
+ * @brief High time of a channel's latched output in counts (0..4096), 0 when full-off
+ */
+uint16_t sim_pca9685_high_counts(const sim_pca9685_t *chip, uint8_t channel);
+
+/**
+ * @brief High time of a channel's latched output in microseconds, 0 when asleep or off
+ */
+uint32_t sim_pca9685_pulse_us(const sim_pca9685_t *chip, uint8_t channel);
+
+/**
+ * @brief Outputs high at once over a PWM period, the supply's view of a set of chips
+ */
+typedef struct {
+    uint16_t peak;          // most outputs high at the same count, chip periods aligned
+    float mean;             // average outputs high
+    float rms;              // root mean square of the outputs high over the period
+    uint16_t peak_drifted;  // bound for any alignment of the chips (own oscillators): sum of per-chip peaks
+} sim_pca9685_load_t;
+
+/**
+ * @brief Model the concurrent pulses of the latched outputs of count chips, asleep chips ignored
+ */
+void sim_pca9685_load(const sim_pca9685_t *const *chips, size_t count, sim_pca9685_load_t *load);
+
+#endif // SIM_PCA9685_H
@@ -0,0 +1,20 @@
+#ifndef SIM_SYSCLOCK_H
+#define SIM_SYSCLOCK_H
+
+#include <stdint.h>
+
+/*
+ * System clock behind gettimeofday, settimeofday and adjtime in host builds, in place of
+ * the host's. It runs off the virtual clock with a settable rate error (the ESP32's
+ * crystal against the DS1307's) and applies an adjtime correction like ESP-IDF's newlib:
+ * running 1/64 fast or slow until the correction is in.
+ */
+
+#define SIM_SYSCLOCK_SLEW_DIV 64
+
+/**
+ * @brief Rate error of the system clock from now on, in ppm (positive: runs fast)
+ */
+void sim_sysclock_set_drift_ppm(int32_t ppm);
+
+#endif // SIM_SYSCLOCK_H
@@ -0,0 +1,148 @@
+#include "sim_bus.h"
+#include <string.h>
+
+typedef struct {
+    sim_device_t *devices;
+    sim_device_t *selected;     // addressed device of the current transfer, NULL on NACK
+    bool addressing;            // next written byte is an address byte
+    bool active;                // between START and STOP
+    uint32_t clk_hz;
+    sim_bus_stats_t stats;
+} sim_port_t;
+
+static sim_port_t ports[I2C_NUM_MAX];
+static uint64_t clock_ns;
+static uint32_t txn_overhead_ns;
+
+static sim_port_t *get_port(i2c_port_t port) {
+    if (port < 0 || port >= I2C_NUM_MAX) return NULL;
+    sim_port_t *p = &ports[port];
+    if (!p->clk_hz) p->clk_hz = SIM_BUS_DEFAULT_CLK_HZ;
+    return p;
+}
+
+// Charge SCL periods to the virtual clock and the port's bus time
+static void charge_bits(sim_port_t *p, uint32_t bits) {
+    uint64_t ns = (uint64_t)bits * 1000000000ULL / p->clk_hz;
+    clock_ns += ns;
+    p->stats.bus_time_ns += ns;
+}
+
+void sim_bus_attach(i2c_port_t port, sim_device_t *dev) {
+    sim_port_t *p = get_port(port);
+    if (!p || !dev) return;
+    dev->next = p->devices;
+    p->devices = dev;
+}
+
+void sim_bus_reset(void) {
+    for (int i = 0; i < I2C_NUM_MAX; i++) {
+        uint32_t clk_hz = ports[i].clk_hz; // configured by the driver, survives like the hardware
+        memset(&ports[i], 0, sizeof(ports[i]));
+        ports[i].clk_hz = clk_hz;
+    }
+    clock_ns = 0;
+    txn_overhead_ns = 0;
+}
+
+void sim_bus_set_clock(i2c_port_t port, uint32_t clk_hz) {
+    sim_port_t *p = get_port(port);
+    if (p && clk_hz) p->clk_hz = clk_hz;
+}
+
+uint32_t sim_bus_get_clock(i2c_port_t port) {
+    sim_port_t *p = get_port(port);
+    return p ? p->clk_hz : 0;
+}
+
+void sim_bus_set_txn_overhead_ns(uint32_t ns) {
+    txn_overhead_ns = ns;
+}
+
+const sim_bus_stats_t *sim_bus_get_stats(i2c_port_t port) {
+    sim_port_t *p = get_port(port);
+    return p ? &p->stats : NULL;
+}
+
+void sim_bus_reset_stats(i2c_port_t port) {
+    sim_port_t *p = get_port(port);
+    if (p) memset(&p->stats, 0, sizeof(p->stats));
+}
+
+uint64_t sim_clock_ns(void) {
+    return clock_ns;
+}
+
+void sim_clock_advance_ns(uint64_t ns) {
+    clock_ns += ns;
+}
+
+void sim_bus_transaction(i2c_port_t port) {
+    sim_port_t *p = get_port(port);
+    if (!p) return;
+    p->stats.transactions++;
+    clock_ns += txn_overhead_ns;
+    p->stats.bus_time_ns += txn_overhead_ns;
+}
+
+void sim_bus_start(i2c_port_t port) {
+    sim_port_t *p = get_port(port);
+    if (!p) return;
+    p->stats.starts++;
+    charge_bits(p, 1);
+    p->selected = NULL;
+    p->addressing = true;
+    p->active = true;
+}
+
+bool sim_bus_write(i2c_port_t port, uint8_t data) {
+    sim_port_t *p = get_port(port);
+    if (!p) return false;
+    p->stats.bytes++;
+    charge_bits(p, 9); // eight data bits and the ACK slot; the receiver acts on the ACK
+
+    if (p->addressing) {
+        p->addressing = false;
+        for (sim_device_t *d = p->devices; d; d = d->next) {
+            if (d->addr == (data >> 1)) {
+                p->selected = d;
+                d->selects++;
+                if (d->ops->start) d->ops->start(d, data & 1);
+                return true;
+            }
+        }
+        p->stats.nacks++;
+        return false;
+    }
+
+    sim_device_t *d = p->selected;
+    bool ack = d && d->ops->write && d->ops->write(d, data);
+    if (d) d->bytes++;
+    if (!ack) p->stats.nacks++;
+    return ack;
+}
+
+uint8_t sim_bus_read(i2c_port_t port, bool ack) {
+    (void)ack;
+    sim_port_t *p = get_port(port);
+    if (!p) return 0xFF;
+    p->stats.bytes++;
+    charge_bits(p, 9);
+
+    sim_device_t *d = p->selected;
+    if (!d || !d->ops->read) return 0xFF; // released SDA reads as ones
+    d->bytes++;
+    return d->ops->read(d);
+}
+
+void sim_bus_stop(i2c_port_t port) {
+    sim_port_t *p = get_port(port);
+    if (!p || !p->active) return;
+    p->stats.stops++;
+    charge_bits(p, 1);
+    p->active = false;
+    p->selected = NULL;
+    for (sim_device_t *d = p->devices; d; d = d->next) {
+        if (d->ops->stop) d->ops->stop(d);
+    }
+}
@@ -0,0 +1,134 @@
+#define _DEFAULT_SOURCE // timegm, gmtime_r
+#include "sim_ds1307.h"
+#include <string.h>
+
+#define REG_SECONDS 0x00
+#define REG_HOURS   0x02
+#define REG_CONTROL 0x07
+#define NUM_TIME_REGS 7
+
+#define SECONDS_CH    0x80
+#define HOURS_12H     0x40
+#define HOURS_PM      0x20
+#define CONTROL_OUT   0x80
+#define CONTROL_SQWE  0x10
+
+static uint8_t to_bcd(int v) { return (uint8_t)(((v / 10) << 4) | (v % 10)); }
+static int from_bcd(uint8_t v) { return (v >> 4) * 10 + (v & 0x0F); }
+
+static uint64_t elapsed_ns(const sim_ds1307_t *chip) {
+    return sim_clock_ns() - chip->base_ns;
+}
+
+time_t sim_ds1307_now(const sim_ds1307_t *chip) {
+    if (chip->halted) return chip->base;
+    return chip->base + (time_t)(elapsed_ns(chip) / 1000000000ULL);
+}
+
+// Copy the running time into the user buffer, as the chip does on every START
+static void sync_buffer(sim_ds1307_t *chip) {
+    time_t now = sim_ds1307_now(chip);
+    struct tm tm;
+    gmtime_r(&now, &tm);
+    bool mode12 = chip->regs[REG_HOURS] & HOURS_12H;
+
+    chip->regs[0] = to_bcd(tm.tm_sec) | (chip->halted ? SECONDS_CH : 0);
+    chip->regs[1] = to_bcd(tm.tm_min);
+    if (mode12) {
+        int h = tm.tm_hour % 12 == 0 ? 12 : tm.tm_hour % 12;
+        chip->regs[2] = HOURS_12H | (tm.tm_hour >= 12 ? HOURS_PM : 0) | to_bcd(h);
+    } else {
+        chip->regs[2] = to_bcd(tm.tm_hour);
+    }
+    chip->regs[3] = (uint8_t)(tm.tm_wday + 1);
+    chip->regs[4] = to_bcd(tm.tm_mday);
+    chip->regs[5] = to_bcd(tm.tm_mon + 1);
+    chip->regs[6] = to_bcd(tm.tm_year % 100);
+}
+
+// Written time registers take effect together; any time write restarts the divider
+static void apply_buffer(sim_ds1307_t *chip) {
+    struct tm tm = {0};
+    uint8_t h = chip->regs[2];
+    tm.tm_sec = from_bcd(chip->regs[0] & 0x7F);
+    tm.tm_min = from_bcd(chip->regs[1] & 0x7F);
+    if (h & HOURS_12H) {
+        tm.tm_hour = from_bcd(h & 0x1F) % 12 + ((h & HOURS_PM) ? 12 : 0);
+    } else {
+        tm.tm_hour = from_bcd(h & 0x3F);
+    }
+    tm.tm_mday = from_bcd(chip->regs[4] & 0x3F);
+    tm.tm_mon = from_bcd(chip->regs[5] & 0x1F) - 1;
+    tm.tm_year = from_bcd(chip->regs[6]) + 100;
+
+    chip->base = timegm(&tm);
+    chip->base_ns = sim_clock_ns();
+    chip->halted = chip->regs[0] & SECONDS_CH;
+}
+
+static void rtc_start(sim_device_t *dev, bool read) {
+    sim_ds1307_t *chip = (sim_ds1307_t *)dev;
+    chip->ptr_pending = !read;
+    sync_buffer(chip);
+}
+
+static bool rtc_write(sim_device_t *dev, uint8_t data) {
+    sim_ds1307_t *chip = (sim_ds1307_t *)dev;
+    if (chip->ptr_pending) {
+        chip->ptr = data & 0x3F;
+        chip->ptr_pending = false;
+        return true;
+    }
+    chip->regs[chip->ptr] = data;
+    if (chip->ptr < NUM_TIME_REGS) chip->time_written = true;
+    chip->ptr = (chip->ptr + 1) & 0x3F;
+    return true;
+}
+
+static uint8_t rtc_read(sim_device_t *dev) {
+    sim_ds1307_t *chip = (sim_ds1307_t *)dev;
+    uint8_t data = chip->regs[chip->ptr];
+    chip->ptr = (chip->ptr + 1) & 0x3F;
+    return data;
+}
+
+static void rtc_stop(sim_device_t *dev) {
+    sim_ds1307_t *chip = (sim_ds1307_t *)dev;
+    chip->ptr_pending = false;
+    if (chip->time_written) {
+        chip->time_written = false;
+        apply_buffer(chip);
+    }
+}
+
+static const sim_device_ops_t rtc_ops = {
+    .start = rtc_start,
+    .write = rtc_write,
+    .read = rtc_read,
+    .stop = rtc_stop,
+};
+
+void sim_ds1307_init(sim_ds1307_t *chip, uint8_t addr, time_t start) {
+    memset(chip, 0, sizeof(*chip));
+    chip->dev.ops = &rtc_ops;
+    chip->dev.name = "ds1307";
+    chip->dev.addr = addr;
+    chip->regs[REG_CONTROL] = CONTROL_OUT; // SQW/OUT disabled, pin high
+    sim_ds1307_set_time(chip, start);
+}
+
+void sim_ds1307_set_time(sim_ds1307_t *chip, time_t now) {
+    chip->base = now;
+    chip->base_ns = sim_clock_ns();
+    chip->halted = false;
+    sync_buffer(chip);
+}
+
+bool sim_ds1307_sqw_level(const sim_ds1307_t *chip) {
+    uint8_t ctrl = chip->regs[REG_CONTROL];
+    if (!(ctrl & CONTROL_SQWE) || chip->halted) return ctrl & CONTROL_OUT;
+
+    static const uint32_t rate_hz[4] = {1, 4096, 8192, 32768};
+    uint64_t period_ns = 1000000000ULL / rate_hz[ctrl & 0x03];
+    return (elapsed_ns(chip) % period_ns) >= period_ns / 2;
+}
@@ -0,0 +1,129 @@
+#include "sim_hd44780.h"
+#include <string.h>
+
+#define PIN_RS 0x01
+#define PIN_E  0x04
+#define PIN_BL 0x08
+
+// Execution times at the nominal 270 kHz oscillator (datasheet table 6); they scale with
+// the oscillator period, see exec_time
+#define EXEC_NS       37000ULL
+#define EXEC_WRITE_NS 41000ULL    // data write, including the address counter update
+#define EXEC_LONG_NS  1520000ULL  // clear display, return home
+#define EXEC_OSC_HZ   270000ULL
+
+static uint64_t exec_time(const sim_hd44780_t *lcd, uint64_t nominal_ns) {
+    return (nominal_ns * EXEC_OSC_HZ + lcd->osc_hz - 1) / lcd->osc_hz;
+}
+
+static void advance_ac(sim_hd44780_t *lcd) {
+    if (lcd->two_line) {
+        // two lines of 40 characters at 0x00-0x27 and 0x40-0x67
+        if (lcd->increment) lcd->ac = lcd->ac == 0x27 ? 0x40 : lcd->ac == 0x67 ? 0x00 : lcd->ac + 1;
+        else lcd->ac = lcd->ac == 0x00 ? 0x67 : lcd->ac == 0x40 ? 0x27 : lcd->ac - 1;
+    } else {
+        if (lcd->increment) lcd->ac = lcd->ac == 0x4F ? 0x00 : lcd->ac + 1;
+        else lcd->ac = lcd->ac == 0x00 ? 0x4F : lcd->ac - 1;
+    }
+}
+
+static void execute(sim_hd44780_t *lcd, bool rs, uint8_t data, bool violated) {
+    uint64_t exec_ns = EXEC_NS;
+    if (violated) lcd->timing_violations++;
+
+    if (rs) {
+        lcd->ddram[lcd->ac & 0x7F] = data;
+        advance_ac(lcd);
+        lcd->chars++;
+        exec_ns = EXEC_WRITE_NS;
+    } else {
+        lcd->instructions++;
+        if (data & 0x80) {
+            lcd->ac = data & 0x7F;
+        } else if (data & 0x40) {
+            // CGRAM address: custom characters are not modeled
+        } else if (data & 0x20) {
+            lcd->four_bit = !(data & 0x10);
+            lcd->two_line = data & 0x08;
+            lcd->have_high_nibble = false;
+        } else if (data & 0x10) {
+            // cursor/display shift: not modeled
+        } else if (data & 0x08) {
+            lcd->display_on = data & 0x04;
+        } else if (data & 0x04) {
+            lcd->increment = data & 0x02;
+        } else if (data & 0x02) {
+            lcd->ac = 0;
+            exec_ns = EXEC_LONG_NS;
+        } else if (data & 0x01) {
+            memset(lcd->ddram, ' ', sizeof(lcd->ddram));
+            lcd->ac = 0;
+            lcd->increment = true;
+            exec_ns = EXEC_LONG_NS;
+        }
+    }
+    lcd->busy_until_ns = sim_clock_ns() + exec_time(lcd, exec_ns);
+}
+
+// Falling edge of E: the controller samples RS and D4-D7
+static void clock_nibble(sim_hd44780_t *lcd, uint8_t lines) {
+    bool rs = lines & PIN_RS;
+    uint8_t nibble = lines >> 4;
+    bool busy = sim_clock_ns() < lcd->busy_until_ns;
+
+    if (!lcd->four_bit) {
+        // 8-bit mode: D0-D3 are not wired to the PCF8574 and read as zero
+        execute(lcd, rs, (uint8_t)(nibble << 4), busy);
+        return;
+    }
+    if (!lcd->have_high_nibble) {
+        lcd->have_high_nibble = true;
+        lcd->high_nibble = nibble;
+        lcd->high_nibble_late = busy;
+        return;
+    }
+    lcd->have_high_nibble = false;
+    execute(lcd, rs, (uint8_t)((lcd->high_nibble << 4) | nibble), busy || lcd->high_nibble_late);
+}
+
+static bool lcd_write(sim_device_t *dev, uint8_t data) {
+    sim_hd44780_t *lcd = (sim_hd44780_t *)dev;
+    uint8_t prev = lcd->port;
+    lcd->port = data;
+    if ((prev & PIN_E) && !(data & PIN_E)) clock_nibble(lcd, prev);
+    return true;
+}
+
+static uint8_t lcd_read(sim_device_t *dev) {
+    // quasi-bidirectional port: reads back the latch
+    return ((sim_hd44780_t *)dev)->port;
+}
+
+static const sim_device_ops_t lcd_ops = {
+    .write = lcd_write,
+    .read = lcd_read,
+};
+
+void sim_hd44780_init(sim_hd44780_t *lcd, uint8_t addr) {
+    memset(lcd, 0, sizeof(*lcd));
+    lcd->dev.ops = &lcd_ops;
+    lcd->dev.name = "hd44780";
+    lcd->dev.addr = addr;
+    lcd->port = 0xFF; // PCF8574 powers up with all pins high
+    lcd->increment = true;
+    lcd->osc_hz = SIM_HD44780_OSC_SLOW_HZ;
+    memset(lcd->ddram, ' ', sizeof(lcd->ddram));
+}
+
+void sim_hd44780_read_row(const sim_hd44780_t *lcd, uint8_t row, char *buf, size_t cols) {
+    static const uint8_t row_offsets[4] = {0x00, 0x40, 0x14, 0x54};
+    size_t i = 0;
+    for (; row < 4 && i < cols; i++) {
+        buf[i] = (char)lcd->ddram[(row_offsets[row] + i) & 0x7F];
+    }
+    buf[i] = '\0';
+}
+
+bool sim_hd44780_backlight(const sim_hd44780_t *lcd) {
+    return lcd->port & PIN_BL;
+}
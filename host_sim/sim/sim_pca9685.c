@@ -0,0 +1,197 @@
+#include "sim_pca9685.h"
+#include <math.h>
+#include <string.h>
+
+#define REG_MODE1     0x00
+#define REG_MODE2     0x01
+#define REG_LED0      0x06
+#define REG_LED15_END 0x45
+#define REG_ALL_LED   0xFA
+#define REG_PRE_SCALE 0xFE
+
+#define MODE1_RESTART 0x80
+#define MODE1_AI      0x20
+#define MODE1_SLEEP   0x10
+#define MODE2_OCH     0x08
+#define LED_FULL      0x10 // bit 4 of LEDn_ON_H / LEDn_OFF_H
+
+#define OSC_HZ 25000000.0f
+
+static void latch_outputs(sim_pca9685_t *chip) {
+    bool changed = false;
+    for (int ch = 0; ch < 16; ch++) {
+        const uint8_t *r = &chip->regs[REG_LED0 + 4 * ch];
+        uint16_t on = r[0] | ((r[1] & 0x1F) << 8);
+        uint16_t off = r[2] | ((r[3] & 0x1F) << 8);
+        if (on != chip->out_on[ch] || off != chip->out_off[ch]) changed = true;
+        chip->out_on[ch] = on;
+        chip->out_off[ch] = off;
+    }
+    chip->dirty = false;
+    if (changed) {
+        chip->latches++;
+        chip->latched_at_ns = sim_clock_ns();
+    }
+}
+
+// Datasheet 7.3: auto-increment runs 0x00-0x45 and 0xFA-0xFE, both rolling over to MODE1
+static void advance_ptr(sim_pca9685_t *chip) {
+    if (!(chip->regs[REG_MODE1] & MODE1_AI)) return;
+    if (chip->ptr == REG_LED15_END || chip->ptr >= REG_PRE_SCALE) chip->ptr = REG_MODE1;
+    else chip->ptr++;
+}
+
+static void pca_start(sim_device_t *dev, bool read) {
+    sim_pca9685_t *chip = (sim_pca9685_t *)dev;
+    chip->ptr_pending = !read;
+}
+
+static bool pca_write(sim_device_t *dev, uint8_t data) {
+    sim_pca9685_t *chip = (sim_pca9685_t *)dev;
+    if (chip->ptr_pending) {
+        chip->ptr = data;
+        chip->ptr_pending = false;
+        return true;
+    }
+
+    uint8_t reg = chip->ptr;
+    if (reg == REG_MODE1) {
+        data &= ~MODE1_RESTART; // writing 1 clears RESTART
+        chip->regs[reg] = data;
+    } else if (reg == REG_PRE_SCALE) {
+        if (chip->regs[REG_MODE1] & MODE1_SLEEP) {
+            chip->regs[reg] = data < 3 ? 3 : data;
+        } else {
+            chip->prescale_ignored++;
+        }
+    } else if (reg >= REG_ALL_LED && reg < REG_PRE_SCALE) {
+        for (int ch = 0; ch < 16; ch++) {
+            chip->regs[REG_LED0 + 4 * ch + (reg - REG_ALL_LED)] = data;
+        }
+        chip->dirty = true;
+    } else {
+        chip->regs[reg] = data;
+        if (reg >= REG_LED0 && reg <= REG_LED15_END) chip->dirty = true;
+    }
+
+    if (chip->dirty && (chip->regs[REG_MODE2] & MODE2_OCH)) latch_outputs(chip);
+    advance_ptr(chip);
+    return true;
+}
+
+static uint8_t pca_read(sim_device_t *dev) {
+    sim_pca9685_t *chip = (sim_pca9685_t *)dev;
+    uint8_t reg = chip->ptr;
+    // ALL_LED registers are write-only and read back as zero
+    uint8_t data = (reg >= REG_ALL_LED && reg < REG_PRE_SCALE) ? 0 : chip->regs[reg];
+    advance_ptr(chip);
+    return data;
+}
+
+static void pca_stop(sim_device_t *dev) {
+    sim_pca9685_t *chip = (sim_pca9685_t *)dev;
+    chip->ptr_pending = false;
+    if (chip->dirty && !(chip->regs[REG_MODE2] & MODE2_OCH)) latch_outputs(chip);
+}
+
+static const sim_device_ops_t pca_ops = {
+    .start = pca_start,
+    .write = pca_write,
+    .read = pca_read,
+    .stop = pca_stop,
+};
+
+void sim_pca9685_init(sim_pca9685_t *chip, uint8_t addr) {
+    memset(chip, 0, sizeof(*chip));
+    chip->dev.ops = &pca_ops;
+    chip->dev.name = "pca9685";
+    chip->dev.addr = addr;
+    sim_pca9685_power_on_reset(chip);
+    chip->latches = 0;
+}
+
+void sim_pca9685_power_on_reset(sim_pca9685_t *chip) {
+    memset(chip->regs, 0, sizeof(chip->regs));
+    chip->ptr = 0;
+    chip->ptr_pending = false;
+
+    // Power-on reset values (datasheet table 4)
+    chip->regs[REG_MODE1] = MODE1_SLEEP | 0x01; // ALLCALL
+    chip->regs[REG_MODE2] = 0x04;                // OUTDRV
+    chip->regs[0x02] = 0xE2;                     // SUBADR1-3, ALLCALLADR
+    chip->regs[0x03] = 0xE4;
+    chip->regs[0x04] = 0xE8;
+    chip->regs[0x05] = 0xE0;
+    for (int ch = 0; ch < 16; ch++) chip->regs[REG_LED0 + 4 * ch + 3] = LED_FULL;
+    chip->regs[REG_PRE_SCALE] = 0x1E;            // 200 Hz
+    latch_outputs(chip);
+}
+
+float sim_pca9685_frequency(const sim_pca9685_t *chip) {
+    return OSC_HZ / (4096.0f * (chip->regs[REG_PRE_SCALE] + 1));
+}
+
+bool sim_pca9685_awake(const sim_pca9685_t *chip) {
+    return !(chip->regs[REG_MODE1] & MODE1_SLEEP);
+}
+
+uint16_t sim_pca9685_high_counts(const sim_pca9685_t *chip, uint8_t channel) {
+    if (channel >= 16) return 0;
+    uint16_t on = chip->out_on[channel];
+    uint16_t off = chip->out_off[channel];
+    if (off & 0x1000) return 0;     // full off wins over full on
+    if (on & 0x1000) return 4096;
+    return (uint16_t)((off - on) & 0x0FFF);
+}
+
+uint32_t sim_pca9685_pulse_us(const sim_pca9685_t *chip, uint8_t channel) {
+    if (!sim_pca9685_awake(chip)) return 0;
+    // one count lasts (PRE_SCALE + 1) oscillator periods of 40 ns
+    uint32_t counts = sim_pca9685_high_counts(chip, channel);
+    return (counts * (chip->regs[REG_PRE_SCALE] + 1u) + 12u) / 25u;
+}
+
+void sim_pca9685_load(const sim_pca9685_t *const *chips, size_t count, sim_pca9685_load_t *load) {
+    static uint16_t total[4096];
+    memset(total, 0, sizeof(total));
+    memset(load, 0, sizeof(*load));
+
+    for (size_t i = 0; i < count; i++) {
+        const sim_pca9685_t *chip = chips[i];
+        if (!sim_pca9685_awake(chip)) continue;
+
+        // +1 where a pulse rises, -1 where it falls, wrapping past count 4095
+        int16_t edges[4097] = {0};
+        for (uint8_t ch = 0; ch < 16; ch++) {
+            uint16_t high = sim_pca9685_high_counts(chip, ch);
+            if (high == 0) continue;
+            uint16_t rise = (chip->out_on[ch] & 0x1000) ? 0 : chip->out_on[ch] & 0x0FFF;
+            uint32_t fall = rise + high;
+            edges[rise]++;
+            if (fall <= 4096) {
+                edges[fall]--;
+            } else {
+                edges[4096]--;
+                edges[0]++;
+                edges[fall - 4096]--;
+            }
+        }
+        uint16_t chip_peak = 0;
+        int high = 0;
+        for (int t = 0; t < 4096; t++) {
+            high += edges[t];
+            total[t] += high;
+            if (high > chip_peak) chip_peak = high;
+        }
+        load->peak_drifted += chip_peak;
+    }
+
+    double sum = 0, sum_sq = 0;
+    for (int t = 0; t < 4096; t++) {
+        if (total[t] > load->peak) load->peak = total[t];
+        sum += total[t];
+        sum_sq += (double)total[t] * total[t];
+    }
+    load->mean = sum / 4096;
+    load->rms = sqrt(sum_sq / 4096);
+}
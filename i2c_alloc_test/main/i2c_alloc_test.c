@@ -0,0 +1,83 @@
+#include <stdio.h>
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_log.h>
+#include <esp_err.h>
+#include <esp_heap_trace.h>
+#include <driver/i2c.h>
+#include "pca9685.h"
+#include "HD44780.h"
+#include "i2c_bus.h"
+#include "i2c_batch.h"
+
+// Same wiring as final_clock
+#define SDA_GPIO 21
+#define SCL_GPIO 22
+#define I2C_PORT I2C_NUM_0
+#define LCD_ADDR 0x27
+#define PCA1_ADDR 0x40
+#define PCA2_ADDR 0x41
+#define REFRESHES 20
+#define NUM_RECORDS 100
+
+static const char *TAG = "i2c_alloc_test";
+static heap_trace_record_t trace_records[NUM_RECORDS];
+static pca9685_dev_t pca1, pca2;
+static i2c_batch_t batch;
+
+// One final_clock style refresh: stage 4 digits, send both PCAs and two LCD lines in one batch
+static void refresh(int n) {
+    uint16_t pulses[7];
+    for (int seg = 0; seg < 7; seg++) {
+        pulses[seg] = ((n + seg) & 1) ? 1500 : 660;
+    }
+    pca9685_stage_servo_pulses(&pca1, PCA9685_CHANNEL_0, pulses, 7);
+    pca9685_stage_servo_pulses(&pca1, PCA9685_CHANNEL_7, pulses, 7);
+    pca9685_stage_servo_pulses(&pca2, PCA9685_CHANNEL_0, pulses, 7);
+    pca9685_stage_servo_pulses(&pca2, PCA9685_CHANNEL_7, pulses, 7);
+
+    char line[17];
+    snprintf(line, sizeof(line), "Refresh %-8d", n);
+    ESP_ERROR_CHECK(i2c_batch_begin(&batch));
+    pca9685_queue(&pca1, &batch);
+    pca9685_queue(&pca2, &batch);
+    LCD_setBatch(&batch);
+    LCD_setCursor(0, 0);
+    LCD_writeStr(line);
+    LCD_setBatch(NULL);
+    ESP_ERROR_CHECK(i2c_batch_submit(&batch, I2C_PORT, pdMS_TO_TICKS(100)));
+
+    // Direct (unbatched) paths as well
+    pca9685_set_servo_pulse(&pca1, PCA9685_CHANNEL_15, (n & 1) ? 1500 : 660);
+    LCD_setCursor(0, 1);
+    LCD_writeChar('0' + n % 10);
+}
+
+void app_main(void) {
+    ESP_ERROR_CHECK(i2c_bus_init(I2C_PORT, SDA_GPIO, SCL_GPIO, 100000));
+
+    LCD_init(LCD_ADDR, SDA_GPIO, SCL_GPIO, 16, 2);
+    ESP_ERROR_CHECK(pca9685_init(&pca1, I2C_PORT, PCA1_ADDR));
+    ESP_ERROR_CHECK(pca9685_set_frequency(&pca1, 50));
+    ESP_ERROR_CHECK(pca9685_init(&pca2, I2C_PORT, PCA2_ADDR));
+    ESP_ERROR_CHECK(pca9685_set_frequency(&pca2, 50));
+    ESP_ERROR_CHECK(heap_trace_init_standalone(trace_records, NUM_RECORDS));
+
+    // Warm-up pass: lets one-time lazy allocations (stdio buffers, log locks) happen first
+    refresh(0);
+
+    ESP_ERROR_CHECK(heap_trace_start(HEAP_TRACE_ALL));
+    for (int n = 1; n <= REFRESHES; n++) {
+        refresh(n);
+    }
+    ESP_ERROR_CHECK(heap_trace_stop());
+
+    size_t allocs = heap_trace_get_count();
+    if (allocs == 0) {
+        ESP_LOGI(TAG, "PASS: %d refreshes, 0 heap allocations", REFRESHES);
+    } else {
+        ESP_LOGE(TAG, "FAIL: %d refreshes made %u heap allocation(s)", REFRESHES, (unsigned)allocs);
+        heap_trace_dump();
+    }
+}
@@ -2,45 +2,44 @@
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <driver/i2c.h>
+#include "i2c_bus.h"
 #include "pca9685.h"
+#include "pca9685_array.h"
+#include "servo_motion.h"
 
 #define I2C_MASTER_SCL_IO           22      // GPIO for I2C SCL
 #define I2C_MASTER_SDA_IO           21      // GPIO for I2C SDA
 #define I2C_MASTER_FREQ_HZ          400000  // I2C master clock frequency
 #define I2C_MASTER_NUM              I2C_NUM_0
-#define NUM_SERVOS                  32      // Total number of servos to control
+#define NUM_CONTROLLERS             2       // PCA9685s at 0x40, 0x41, ...
+#define NUM_SERVOS                  (NUM_CONTROLLERS * 16) // Total number of servos to control
+#define TRAVEL_MS                   500     // 0-180 degree travel of the all-together moves
+#define MAX_MOVING                  8       // Servos allowed to travel at once
+#define SERVO_MOVE_MA               250     // Supply current of a travelling servo (measure yours)
+#define SERVO_HOLD_MA               10      // Supply current of a servo holding still
 
 // Test patterns for servos
 typedef enum {
     PATTERN_SEQUENTIAL,   // Move one servo at a time
     PATTERN_WAVE,         // Create a wave-like motion
-    PATTERN_ALL_TOGETHER  // Move all servos together
+    PATTERN_ALL_TOGETHER  // Move all servos, at most MAX_MOVING at a time
 } test_pattern_t;
 
 void init_i2c(void) {
-    i2c_config_t conf = {
-        .mode = I2C_MODE_MASTER,
-        .sda_io_num = I2C_MASTER_SDA_IO,
-        .scl_io_num = I2C_MASTER_SCL_IO,
-        .sda_pullup_en = GPIO_PULLUP_ENABLE,
-        .scl_pullup_en = GPIO_PULLUP_ENABLE,
-        .master.clk_speed = I2C_MASTER_FREQ_HZ
-    };
-
-    ESP_ERROR_CHECK(i2c_param_config(I2C_MASTER_NUM, &conf));
-    ESP_ERROR_CHECK(i2c_driver_install(I2C_MASTER_NUM, conf.mode, 0, 0, 0));
+    ESP_ERROR_CHECK(i2c_bus_init(I2C_MASTER_NUM, I2C_MASTER_SDA_IO, I2C_MASTER_SCL_IO, I2C_MASTER_FREQ_HZ));
 }
 
-// Function to move a single servo
-void move_servo(pca9685_dev_t *dev, uint8_t servo_num, uint16_t pulse_width) {
+// Stage a servo by its global number; pca9685_array_commit sends it
+void move_servo(pca9685_array_t *servos, uint16_t servo_num, uint16_t pulse_width) {
     if (servo_num < NUM_SERVOS) {
-        ESP_ERROR_CHECK(pca9685_set_servo_pulse(dev, servo_num % 16, pulse_width));
+        ESP_ERROR_CHECK(pca9685_array_stage_pulses(servos, servo_num, &pulse_width, 1));
     }
 }
 
 // Function to run a specific test pattern
-void run_test_pattern(pca9685_dev_t *dev, test_pattern_t pattern) {
+void run_test_pattern(servo_motion_t *motion, test_pattern_t pattern) {
     const uint16_t positions[] = {500, 1500, 2500}; // 0°, 90°, 180°
+    pca9685_array_t *servos = &motion->array;
     
     switch (pattern) {
         case PATTERN_SEQUENTIAL:
@@ -48,7 +47,8 @@ void run_test_pattern(pca9685_dev_t *dev, test_pattern_t pattern) {
             for (int pos = 0; pos < 3; pos++) {
                 for (int servo = 0; servo < NUM_SERVOS; servo++) {
                     printf("Moving servo %d to position %d\n", servo, pos);
-                    move_servo(dev, servo, positions[pos]);
+                    move_servo(servos, servo, positions[pos]);
+                    ESP_ERROR_CHECK(pca9685_array_commit(servos));
                     vTaskDelay(pdMS_TO_TICKS(200));
                 }
             }
@@ -60,8 +60,10 @@ void run_test_pattern(pca9685_dev_t *dev, test_pattern_t pattern) {
                 for (int pos = 0; pos < 3; pos++) {
                     for (int servo = 0; servo < NUM_SERVOS; servo++) {
                         int wave_pos = (pos + servo) % 3;
-                        move_servo(dev, servo, positions[wave_pos]);
+                        move_servo(servos, servo, positions[wave_pos]);
                     }
+                    // The whole wave step in one frame
+                    ESP_ERROR_CHECK(pca9685_array_commit(servos));
                     vTaskDelay(pdMS_TO_TICKS(500));
                 }
             }
@@ -70,10 +72,23 @@ void run_test_pattern(pca9685_dev_t *dev, test_pattern_t pattern) {
         case PATTERN_ALL_TOGETHER:
             printf("Running all-together pattern test...\n");
             for (int pos = 0; pos < 3; pos++) {
-                printf("Moving all servos to position %d\n", pos);
+                // The motion engine starts each servo as soon as the power budget has room
                 for (int servo = 0; servo < NUM_SERVOS; servo++) {
-                    move_servo(dev, servo, positions[pos]);
-                    vTaskDelay(pdMS_TO_TICKS(10)); // Small delay to prevent power spike
+                    pca9685_channel_t channel;
+                    pca9685_dev_t *dev = pca9685_array_locate(servos, servo, &channel);
+                    uint16_t duty;
+                    ESP_ERROR_CHECK(pca9685_pulse_to_duty(dev, positions[pos], &duty));
+                    ESP_ERROR_CHECK(servo_motion_move(motion, dev, channel, duty));
+                }
+                servo_motion_estimate_t est;
+                servo_motion_estimate(motion, &est);
+                printf("Moving all servos to position %d: %u waiting, %lu ms, peak %lu mA\n", pos,
+                       est.pending, (unsigned long)est.total_ms, (unsigned long)est.peak_current_ma);
+
+                TickType_t last_wake = xTaskGetTickCount();
+                while (servo_motion_moving(motion)) {
+                    ESP_ERROR_CHECK(servo_motion_tick(motion));
+                    vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(SERVO_MOTION_TICK_MS));
                 }
                 vTaskDelay(pdMS_TO_TICKS(1000));
             }
@@ -85,29 +100,51 @@ void app_main(void) {
     // Initialize I2C
     init_i2c();
 
-    // Initialize PCA9685
-    pca9685_dev_t dev;
-    ESP_ERROR_CHECK(pca9685_init(&dev, I2C_MASTER_NUM, PCA9685_DEFAULT_ADDRESS));
-    
-    // Set PWM frequency to 50Hz (standard for servos)
-    ESP_ERROR_CHECK(pca9685_set_frequency(&dev, 50));
+    // Initialize the PCA9685s, servo n is channel n % 16 of controller n / 16
+    static pca9685_dev_t devs[NUM_CONTROLLERS];
+    pca9685_dev_t *controllers[NUM_CONTROLLERS];
+    for (int i = 0; i < NUM_CONTROLLERS; i++) {
+        ESP_ERROR_CHECK(pca9685_init(&devs[i], I2C_MASTER_NUM, PCA9685_DEFAULT_ADDRESS + i));
+
+        // Set PWM frequency to 50Hz (standard for servos)
+        ESP_ERROR_CHECK(pca9685_set_frequency(&devs[i], 50));
+        controllers[i] = &devs[i];
+    }
+    // The engine's array addresses the servos of every pattern; it is ticked from here
+    static servo_motion_t motion;
+    const servo_motion_config_t motion_cfg = {
+        .controllers = controllers,
+        .num_controllers = NUM_CONTROLLERS,
+        .profile = SERVO_MOTION_S_CURVE,
+        .duration_ms = TRAVEL_MS,
+        .max_moving = MAX_MOVING,
+        .move_current_ma = SERVO_MOVE_MA,
+        .hold_current_ma = SERVO_HOLD_MA,
+    };
+    ESP_ERROR_CHECK(servo_motion_init(&motion, &motion_cfg));
+    // Pulse starts spread over the period: no instant with every servo drawing current
+    ESP_ERROR_CHECK(pca9685_array_stagger(&motion.array));
 
-    printf("PCA9685 initialized. Starting servo test patterns...\n");
+    servo_motion_estimate_t plan;
+    servo_motion_plan(&motion_cfg, NUM_SERVOS, NUM_SERVOS, &plan);
+    printf("PCA9685 initialized. All-together moves: %lu ms, peak %lu mA with %d moving at once\n",
+           (unsigned long)plan.total_ms, (unsigned long)plan.peak_current_ma, MAX_MOVING);
+    printf("Starting servo test patterns...\n");
 
     while (1) {
         // Run each test pattern
         printf("\n=== Starting new test cycle ===\n");
         
         // Pattern 1: Sequential movement
-        run_test_pattern(&dev, PATTERN_SEQUENTIAL);
+        run_test_pattern(&motion, PATTERN_SEQUENTIAL);
         vTaskDelay(pdMS_TO_TICKS(2000));
         
         // Pattern 2: Wave pattern
-        run_test_pattern(&dev, PATTERN_WAVE);
+        run_test_pattern(&motion, PATTERN_WAVE);
         vTaskDelay(pdMS_TO_TICKS(2000));
         
         // Pattern 3: All servos together
-        run_test_pattern(&dev, PATTERN_ALL_TOGETHER);
+        run_test_pattern(&motion, PATTERN_ALL_TOGETHER);
         vTaskDelay(pdMS_TO_TICKS(2000));
         
         printf("Test cycle completed. Starting next cycle...\n\n");
@@ -3,7 +3,11 @@
 #include <freertos/task.h>
 #include <esp_log.h>
 #include <esp_err.h>
+#include <esp_adc/adc_oneshot.h>
+#include "i2c_bus.h"
 #include "pca9685.h"
+#include "servo_cal.h"
+#include "nvs_flash.h"
 
 #define SDA_GPIO 21
 #define SCL_GPIO 22
@@ -12,68 +16,154 @@
 #define PCA2_ADDR 0x41
 #define SERVOS_PER_PCA 16
 #define TOTAL_SERVOS 32  // 16 per PCA * 2 controllers
+#define SERVO_FREQ_HZ 50
+
+// Nominal endpoints, the ones final_clock uses for servos without calibration
+#define PULSE_0DEG 660
+#define PULSE_90DEG 1500
+#define NVS_NAMESPACE "clock" // final_clock's
+
+// 0: only drive every servo to 0 then 90 degrees, for fitting the segments.
+// 1: sweep every servo and store its endpoints and swing time for final_clock. Needs the
+//    current shunt amplifier below; without it the ADC pin floats.
+#define CALIBRATE 0
+// Servo supply current, as a shunt amplifier's output on an ADC1 pin. Only differences
+// are used, so the ADC's offset and gain errors do no harm.
+#define CURRENT_ADC_CHANNEL ADC_CHANNEL_6 // GPIO34
+#define CURRENT_MV_PER_A 1000
+#define CURRENT_SAMPLES 16
+// Sweep: 10 us steps, each given 40 ms; 60 mA over the holding current means driving
+#define SWEEP_SEARCH_US 300
+#define SWEEP_STEP_US 10
+#define SWEEP_STEP_MS 40
+#define SWEEP_DRIVE_MA 60
+#define SWEEP_MARGIN_US 30
+#define SWEEP_TIMEOUT_MS 1500
 
 static const char *TAG = "servo_reset";
 
-void app_main(void)
+static esp_err_t read_current(void *ctx, uint32_t *current_ma)
 {
-    // Configure I2C
-    i2c_config_t conf = {
-        .mode = I2C_MODE_MASTER,
-        .sda_io_num = SDA_GPIO,
-        .scl_io_num = SCL_GPIO,
-        .sda_pullup_en = GPIO_PULLUP_ENABLE,
-        .scl_pullup_en = GPIO_PULLUP_ENABLE,
-        .master.clk_speed = 400000
-    };
-    ESP_ERROR_CHECK(i2c_param_config(I2C_PORT, &conf));
-    ESP_ERROR_CHECK(i2c_driver_install(I2C_PORT, conf.mode, 0, 0, 0));
-    ESP_LOGI(TAG, "I2C bus initialized");
-    vTaskDelay(500 / portTICK_PERIOD_MS);
-
-    // Initialize PCA9685 controllers
-    pca9685_dev_t pca1, pca2;
-    
-    // First PCA at 0x40
-    ESP_ERROR_CHECK(pca9685_init(&pca1, I2C_PORT, PCA1_ADDR));
-    ESP_ERROR_CHECK(pca9685_set_frequency(&pca1, 50));
-    ESP_LOGI(TAG, "PCA9685 @ 0x%02X initialized", PCA1_ADDR);
-    
-    // Second PCA at 0x41
-    ESP_ERROR_CHECK(pca9685_init(&pca2, I2C_PORT, PCA2_ADDR));
-    ESP_ERROR_CHECK(pca9685_set_frequency(&pca2, 50));
-    ESP_LOGI(TAG, "PCA9685 @ 0x%02X initialized", PCA2_ADDR);
-    
-    vTaskDelay(500 / portTICK_PERIOD_MS);
-
-    // Set all servos to 0 degrees (500µs pulse)
-    const uint16_t pulse_0deg = 670;
-    const uint16_t pulse_90deg = 1500;
-
-    ESP_LOGI(TAG, "Resetting all 32 servos to 0 degrees");
-    
-    // Reset first PCA (channels 0-15)
-    for (int ch = 0; ch < SERVOS_PER_PCA; ch++) {
-        pca9685_set_servo_pulse(&pca1, ch, pulse_0deg);
+    adc_oneshot_unit_handle_t adc = ctx;
+    int sum = 0;
+    for (int i = 0; i < CURRENT_SAMPLES; i++) {
+        int raw;
+        esp_err_t ret = adc_oneshot_read(adc, CURRENT_ADC_CHANNEL, &raw);
+        if (ret != ESP_OK) return ret;
+        sum += raw;
     }
-    
-    // Reset second PCA (channels 16-31)
-    for (int ch = 0; ch < SERVOS_PER_PCA; ch++) {
-        pca9685_set_servo_pulse(&pca2, ch, pulse_0deg);
+    // 11 dB attenuation: about 3100 mV full scale
+    uint32_t mv = (uint32_t)sum * 3100 / (4095 * CURRENT_SAMPLES);
+    *current_ma = mv * 1000 / CURRENT_MV_PER_A;
+    return ESP_OK;
+}
+
+static void zero_servos(pca9685_dev_t *controllers[2])
+{
+    ESP_LOGI(TAG, "Resetting all %d servos to 0 degrees", TOTAL_SERVOS);
+    for (int c = 0; c < 2; c++) {
+        for (int ch = 0; ch < SERVOS_PER_PCA; ch++) pca9685_set_servo_pulse(controllers[c], ch, PULSE_0DEG);
     }
     vTaskDelay(5000 / portTICK_PERIOD_MS);
 
-    for (int ch = 0; ch < SERVOS_PER_PCA; ch++) {
-        pca9685_set_servo_pulse(&pca1, ch, pulse_90deg);
+    for (int c = 0; c < 2; c++) {
+        for (int ch = 0; ch < SERVOS_PER_PCA; ch++) pca9685_set_servo_pulse(controllers[c], ch, PULSE_90DEG);
     }
-    
-    // Reset second PCA (channels 16-31)
-    for (int ch = 0; ch < SERVOS_PER_PCA; ch++) {
-        pca9685_set_servo_pulse(&pca2, ch, pulse_90deg);
+    ESP_LOGI(TAG, "All %d servos reset to 0 to 90 deg successfully", TOTAL_SERVOS);
+}
+
+// One servo at a time, the others unpowered, so the supply current is that servo's alone.
+// Channels without a servo are left uncalibrated; earlier entries of failed ones are kept.
+static void calibrate_servos(pca9685_dev_t *controllers[2])
+{
+    adc_oneshot_unit_handle_t adc;
+    const adc_oneshot_unit_init_cfg_t adc_cfg = {.unit_id = ADC_UNIT_1};
+    ESP_ERROR_CHECK(adc_oneshot_new_unit(&adc_cfg, &adc));
+    const adc_oneshot_chan_cfg_t chan_cfg = {.atten = ADC_ATTEN_DB_11, .bitwidth = ADC_BITWIDTH_DEFAULT};
+    ESP_ERROR_CHECK(adc_oneshot_config_channel(adc, CURRENT_ADC_CHANNEL, &chan_cfg));
+
+    static servo_cal_t cal;
+    esp_err_t err = servo_cal_load(&cal, NVS_NAMESPACE);
+    if (err != ESP_OK || cal.num_controllers < 2) ESP_ERROR_CHECK(servo_cal_init(&cal, 2, 0, 0));
+
+    for (int c = 0; c < 2; c++) {
+        for (int ch = 0; ch < SERVOS_PER_PCA; ch++) pca9685_set_duty(controllers[c], ch, 0);
     }
 
-    ESP_LOGI(TAG, "All 32 servos reset to 0 to 90 deg successfully");
-    // while (1) {
-    //     vTaskDelay(1000 / portTICK_PERIOD_MS);
-    // }
-}
\ No newline at end of file
+    const servo_cal_sweep_config_t sweep_cfg = {
+        .sense = read_current,
+        .sense_ctx = adc,
+        .pulse_off_us = PULSE_0DEG,
+        .pulse_on_us = PULSE_90DEG,
+        .search_us = SWEEP_SEARCH_US,
+        .step_us = SWEEP_STEP_US,
+        .step_ms = SWEEP_STEP_MS,
+        .drive_ma = SWEEP_DRIVE_MA,
+        .margin_us = SWEEP_MARGIN_US,
+        .timeout_ms = SWEEP_TIMEOUT_MS,
+    };
+    int calibrated = 0;
+    uint16_t skipped[2] = {0};
+    for (int c = 0; c < 2; c++) {
+        for (int ch = 0; ch < SERVOS_PER_PCA; ch++) {
+            servo_cal_sweep_result_t result;
+            err = servo_cal_sweep(controllers[c], ch, &sweep_cfg, &result);
+            if (err == ESP_ERR_NOT_FOUND) {
+                ESP_LOGI(TAG, "PCA%d channel %d: no servo", c + 1, ch);
+                continue;
+            }
+            if (err != ESP_OK) {
+                ESP_LOGW(TAG, "PCA%d channel %d: %s", c + 1, ch, esp_err_to_name(err));
+                skipped[c] |= 1u << ch;
+                continue;
+            }
+            servo_cal_set(&cal, c, ch, result.pulse_off_us, result.pulse_on_us);
+            servo_cal_set_travel(&cal, c, ch, result.travel_ms);
+            calibrated++;
+            ESP_LOGI(TAG, "PCA%d channel %d: 0 deg %u us, 90 deg %u us, swing %u ms", c + 1, ch,
+                     result.pulse_off_us, result.pulse_on_us, result.travel_ms);
+        }
+    }
+    // Failed channels keep their earlier entries; ESP_ERR_INVALID_RESPONSE means the current
+    // never rose clearly above the unpowered one (check the shunt amplifier's wiring)
+    for (int c = 0; c < 2; c++) {
+        if (skipped[c]) ESP_LOGW(TAG, "PCA%d: channels 0x%04X not saved", c + 1, skipped[c]);
+    }
+    ESP_ERROR_CHECK(servo_cal_save(&cal, NVS_NAMESPACE));
+    ESP_LOGI(TAG, "%d servo(s) calibrated", calibrated);
+
+    // Every calibrated servo to its 0 degree endpoint
+    for (int c = 0; c < 2; c++) {
+        for (int ch = 0; ch < SERVOS_PER_PCA; ch++) {
+            const servo_cal_entry_t *entry = servo_cal_get(&cal, c, ch);
+            if (entry) pca9685_set_servo_pulse(controllers[c], ch, entry->pulse_off_us);
+        }
+    }
+}
+
+void app_main(void)
+{
+    esp_err_t err = nvs_flash_init();
+    if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        err = nvs_flash_init();
+    }
+    ESP_ERROR_CHECK(err);
+
+    ESP_ERROR_CHECK(i2c_bus_init(I2C_PORT, SDA_GPIO, SCL_GPIO, 400000));
+    ESP_LOGI(TAG, "I2C bus initialized");
+
+    // Initialize PCA9685 controllers, asleep to awake at 50 Hz in one transaction each
+    static pca9685_dev_t pca1, pca2;
+    ESP_ERROR_CHECK(pca9685_init_frequency(&pca1, I2C_PORT, PCA1_ADDR, SERVO_FREQ_HZ));
+    ESP_LOGI(TAG, "PCA9685 @ 0x%02X initialized", PCA1_ADDR);
+    ESP_ERROR_CHECK(pca9685_init_frequency(&pca2, I2C_PORT, PCA2_ADDR, SERVO_FREQ_HZ));
+    ESP_LOGI(TAG, "PCA9685 @ 0x%02X initialized", PCA2_ADDR);
+
+    pca9685_dev_t *controllers[2] = {&pca1, &pca2};
+    if (CALIBRATE) {
+        calibrate_servos(controllers);
+    } else {
+        zero_servos(controllers);
+    }
+}